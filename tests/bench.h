@@ -0,0 +1,160 @@
+// bench.h
+// Copyright (c) 2026, zhiayang
+// Licensed under the Apache License Version 2.0.
+
+// the harness that all the benchmarks share. each one is run as `./bench <case> [args...] [--runs N] [--warmup N]
+// [--json]`; the case is run `warmup` times first (not measured), then `runs` times, and the time of each of those
+// is measured. what gets printed is the median, mean, standard deviation, min and max of the time per operation,
+// and the throughput for cases that process a known number of bytes per operation. with --json, each case prints
+// one line of JSON instead, so that the results of two builds can be compared by a script.
+
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+namespace bench
+{
+	struct Args
+	{
+		Args(int argc, char* argv[])
+		{
+			for(int i = 1; i < argc; i++)
+			{
+				auto arg = std::string(argv[i]);
+				if(arg == "--json")
+					this->json = true;
+				else if(arg == "--runs" && i + 1 < argc)
+					this->runs = std::max(1, atoi(argv[++i]));
+				else if(arg == "--warmup" && i + 1 < argc)
+					this->warmup = std::max(0, atoi(argv[++i]));
+				else
+					this->positional.push_back(std::move(arg));
+			}
+		}
+
+		// the positional arguments, not counting the program name; the first one is the case.
+		std::string get(size_t i, const std::string& def = "") const
+		{
+			return i < this->positional.size() ? this->positional[i] : def;
+		}
+
+		long getInt(size_t i, long def) const
+		{
+			return i < this->positional.size() ? std::stol(this->positional[i]) : def;
+		}
+
+		int runs = 10;
+		int warmup = 1;
+		bool json = false;
+
+		std::vector<std::string> positional;
+	};
+
+	// without this, the compiler notices that nothing uses what the loops compute.
+	template <typename T>
+	inline void keep(const T& x)
+	{
+		asm volatile("" : : "r,m"(x) : "memory");
+	}
+
+	template <typename T>
+	inline void clobber(T& x)
+	{
+		asm volatile("" : "+r"(x) : : "memory");
+	}
+
+	struct Stats
+	{
+		double median = 0;
+		double mean = 0;
+		double stddev = 0;
+		double min = 0;
+		double max = 0;
+	};
+
+	// of the time per operation in each run, in nanoseconds.
+	inline Stats compute(std::vector<double> ns)
+	{
+		auto ret = Stats();
+		if(ns.empty())
+			return ret;
+
+		std::sort(ns.begin(), ns.end());
+
+		auto n = ns.size();
+		ret.min = ns.front();
+		ret.max = ns.back();
+		ret.median = (n % 2 == 1) ? ns[n / 2] : (ns[n / 2 - 1] + ns[n / 2]) / 2;
+
+		for(auto x : ns)
+			ret.mean += x;
+		ret.mean /= static_cast<double>(n);
+
+		for(auto x : ns)
+			ret.stddev += (x - ret.mean) * (x - ret.mean);
+		ret.stddev = n > 1 ? std::sqrt(ret.stddev / static_cast<double>(n - 1)) : 0;
+
+		return ret;
+	}
+
+	inline void report(const Args& args, const std::string& name, long ops, const Stats& st, size_t bytes_per_op)
+	{
+		// MB/s, from the median.
+		double mbps = 0;
+		if(bytes_per_op > 0 && st.median > 0)
+			mbps = static_cast<double>(bytes_per_op) / st.median * 1e9 / (1024.0 * 1024.0);
+
+		if(args.json)
+		{
+			printf("{\"name\":\"%s\",\"runs\":%d,\"ops\":%ld,\"median_ns\":%.3f,\"mean_ns\":%.3f,\"stddev_ns\":%.3f,"
+				"\"min_ns\":%.3f,\"max_ns\":%.3f", name.c_str(), args.runs, ops, st.median, st.mean, st.stddev,
+				st.min, st.max);
+
+			if(bytes_per_op > 0)
+				printf(",\"mb_per_s\":%.3f", mbps);
+
+			printf("}\n");
+		}
+		else
+		{
+			printf("%-28s %12.2f ns/op   (mean %.2f, sd %.2f, min %.2f, max %.2f; %d runs x %ld)", name.c_str(),
+				st.median, st.mean, st.stddev, st.min, st.max, args.runs, ops);
+
+			if(bytes_per_op > 0)
+				printf("   %.1f MB/s", mbps);
+
+			printf("\n");
+		}
+
+		fflush(stdout);
+	}
+
+	// calls fn(), which should do `ops` operations, warmup + runs times, and reports the time per operation.
+	template <typename Fn>
+	void run(const Args& args, const std::string& name, long ops, Fn&& fn, size_t bytes_per_op = 0)
+	{
+		for(int i = 0; i < args.warmup; i++)
+			fn();
+
+		auto times = std::vector<double>();
+		for(int i = 0; i < args.runs; i++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			fn();
+			auto end = std::chrono::steady_clock::now();
+
+			auto ns = std::chrono::duration<double, std::nano>(end - start).count();
+			times.push_back(ns / static_cast<double>(std::max(ops, 1L)));
+		}
+
+		report(args, name, ops, compute(std::move(times)), bytes_per_op);
+	}
+}
@@ -0,0 +1,26 @@
+#!/usr/bin/env fish
+
+# any arguments (eg. --json, or --runs 20) are passed on to every case.
+
+for kind in chr find rfind ffo
+	for impl in std zbuf zst
+		./bench {$impl}_{$kind} $argv
+	end
+end
+
+./bench memchr $argv
+./bench memmem $argv
+
+./bench buffer_drop $argv
+./bench ring_consume $argv
+
+./bench buffer_append $argv
+./bench std_append $argv
+
+./bench autowrite_packet $argv
+./bench writer_packet $argv
+./bench reader_packet $argv
+
+# these take a smaller count, since each one goes through a 64 MiB file.
+./bench read_lines 10 $argv
+./bench mapped_lines 10 $argv
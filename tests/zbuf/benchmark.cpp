@@ -0,0 +1,329 @@
+// benchmark.cpp
+// Copyright (c) 2026, zhiayang
+// Licensed under the Apache License Version 2.0.
+
+#include <cstddef>
+#include <cstring>
+
+#include <string>
+#include <string_view>
+#include <stdio.h>
+
+#include "zbuf.h"
+#include "zst.h"
+
+#include "../bench.h"
+
+#include <cassert>
+
+// something that looks like the HTTP headers that zurl searches through, with the things we are
+// looking for only right at the end (or, for rfind, right at the start).
+static std::string make_haystack(size_t size)
+{
+	std::string ret;
+	ret.reserve(size + 64);
+
+	ret += "GET / HTTP/1.1\r\n";
+
+	while(ret.size() < size)
+		ret += "X-Some-Header: some value that is not too short, abcdefghijklmnop\r\n";
+
+	ret += "Last: header?#\r\n\r\n";
+	return ret;
+}
+
+using bench::clobber;
+
+void speedTest(const std::string& which, long count, const std::string& haystack, const std::string& path)
+{
+	auto ptr = haystack.data();
+	auto zbv = [&]() { clobber(ptr); return zbuf::str_view(ptr, haystack.size()); };
+	auto zsv = [&]() { clobber(ptr); return zst::str_view(ptr, haystack.size()); };
+	auto stv = [&]() { clobber(ptr); return std::string_view(ptr, haystack.size()); };
+
+	const char* needle = "\r\n\r\n";
+	const char* set = "?#";
+
+	// accumulate the results so that nothing gets optimised away.
+	size_t total = 0;
+
+	// single byte
+	if(which == "memchr")
+	{
+		for(long i = 0; i < count; ++i)
+		{
+			clobber(ptr);
+			total += static_cast<size_t>(static_cast<const char*>(memchr(ptr, '?', haystack.size())) - ptr);
+		}
+	}
+	else if(which == "std_chr")
+	{
+		for(long i = 0; i < count; ++i)
+			total += stv().find('?');
+	}
+	else if(which == "zbuf_chr")
+	{
+		for(long i = 0; i < count; ++i)
+			total += zbv().find('?');
+	}
+	else if(which == "zst_chr")
+	{
+		for(long i = 0; i < count; ++i)
+			total += zsv().find('?');
+	}
+	// substring
+	else if(which == "memmem")
+	{
+		for(long i = 0; i < count; ++i)
+		{
+			clobber(ptr);
+			total += static_cast<size_t>(static_cast<const char*>(memmem(ptr, haystack.size(), needle, 4)) - ptr);
+		}
+	}
+	else if(which == "std_find")
+	{
+		for(long i = 0; i < count; ++i)
+			total += stv().find(needle);
+	}
+	else if(which == "zbuf_find")
+	{
+		for(long i = 0; i < count; ++i)
+			total += zbv().find(needle);
+	}
+	else if(which == "zst_find")
+	{
+		for(long i = 0; i < count; ++i)
+			total += zsv().find(needle);
+	}
+	// substring, from the back
+	else if(which == "std_rfind")
+	{
+		for(long i = 0; i < count; ++i)
+			total += stv().rfind("GET /");
+	}
+	else if(which == "zbuf_rfind")
+	{
+		for(long i = 0; i < count; ++i)
+			total += zbv().rfind("GET /");
+	}
+	else if(which == "zst_rfind")
+	{
+		for(long i = 0; i < count; ++i)
+			total += zsv().rfind("GET /");
+	}
+	// set of bytes
+	else if(which == "std_ffo")
+	{
+		for(long i = 0; i < count; ++i)
+			total += stv().find_first_of(set);
+	}
+	else if(which == "zbuf_ffo")
+	{
+		for(long i = 0; i < count; ++i)
+			total += zbv().find_first_of(set);
+	}
+	else if(which == "zst_ffo")
+	{
+		for(long i = 0; i < count; ++i)
+			total += zsv().find_first_of(set);
+	}
+	// streaming: keep about 64k buffered, adding 4k at a time and consuming it in small pieces
+	else if(which == "buffer_drop")
+	{
+		auto buf = zbuf::Buffer(128 * 1024);
+		for(long i = 0; i < count; ++i)
+		{
+			if(buf.size() < 64 * 1024)
+				buf.write(ptr, 4096);
+
+			total += buf.data()[0];
+			buf.drop(512);
+			clobber(ptr);
+		}
+	}
+	else if(which == "ring_consume")
+	{
+		auto buf = zbuf::RingBuffer(128 * 1024);
+		for(long i = 0; i < count; ++i)
+		{
+			if(buf.size() < 64 * 1024)
+				buf.write(ptr, 4096);
+
+			total += buf.readable().first.data()[0];
+			buf.consume(512);
+			clobber(ptr);
+		}
+	}
+	// appending small pieces, which is what building up a request (or a log line) looks like.
+	else if(which == "buffer_append")
+	{
+		auto buf = zbuf::Buffer(4096);
+		for(long i = 0; i < count; ++i)
+		{
+			buf.clear();
+			for(size_t k = 0; k < 32; k++)
+				buf.write(ptr + k * 16, 16 + (k % 8));
+
+			total += buf.size();
+			clobber(ptr);
+		}
+	}
+	else if(which == "std_append")
+	{
+		auto buf = std::string();
+		buf.reserve(4096);
+
+		for(long i = 0; i < count; ++i)
+		{
+			buf.clear();
+			for(size_t k = 0; k < 32; k++)
+				buf.append(ptr + k * 16, 16 + (k % 8));
+
+			total += buf.size();
+			clobber(ptr);
+		}
+	}
+	// encoding small packets (a big-endian header, a varint and a payload), 64 to a buffer, by hand with a
+	// capacity check for every field, or with a Writer and one reservation; and decoding them again.
+	else if(which == "autowrite_packet")
+	{
+		auto buf = zbuf::Buffer(4096);
+		for(long i = 0; i < count; ++i)
+		{
+			if(i % 64 == 0)
+				buf.unsafeClear();
+
+			auto kind = zst::byteswap(static_cast<uint16_t>(i));
+			auto len = zst::byteswap(static_cast<uint32_t>(32));
+			auto time = zst::byteswap(static_cast<uint64_t>(i) * 1000);
+			buf.autoWrite(&kind, sizeof(kind));
+			buf.autoWrite(&len, sizeof(len));
+			buf.autoWrite(&time, sizeof(time));
+
+			uint8_t varint[10];
+			size_t n = 0;
+			for(auto id = static_cast<uint64_t>(i); ; id >>= 7)
+			{
+				varint[n++] = static_cast<uint8_t>(id | (id >= 0x80 ? 0x80 : 0));
+				if(id < 0x80)
+					break;
+			}
+
+			buf.autoWrite(varint, n);
+			buf.autoWrite(ptr, 32);
+
+			total += buf.size();
+			clobber(ptr);
+		}
+	}
+	else if(which == "writer_packet" || which == "reader_packet")
+	{
+		auto buf = zbuf::Buffer(4096);
+		auto w = zbuf::Writer(buf);
+
+		for(long i = 0; i < count; ++i)
+		{
+			if(i % 64 == 0)
+			{
+				// decode the 64 packets that were just written.
+				if(which == "reader_packet")
+				{
+					auto r = zbuf::Reader(buf.span());
+					while(!r.empty())
+					{
+						total += r.read<uint16_t, zbuf::endian::big>();
+						auto len = r.read<uint32_t, zbuf::endian::big>();
+						total += r.read<uint64_t, zbuf::endian::big>();
+						total += r.readVarint<uint64_t>();
+						total += r.readBytes(len).size();
+					}
+				}
+
+				buf.unsafeClear();
+			}
+
+			auto id = static_cast<uint64_t>(i);
+			w.reserve(14 + zbuf::varintSize(id) + 32);
+			w.write<uint16_t, zbuf::endian::big>(static_cast<uint16_t>(i));
+			w.write<uint32_t, zbuf::endian::big>(32);
+			w.write<uint64_t, zbuf::endian::big>(id * 1000);
+			w.writeVarint(id);
+			w.writeBytes(ptr, 32);
+
+			total += buf.size();
+			clobber(ptr);
+		}
+	}
+	// splitting a file into lines: reading it into a Buffer first, or mapping it.
+	else if(which == "read_lines")
+	{
+		for(long i = 0; i < count; ++i)
+		{
+			FILE* f = fopen(path.c_str(), "rb");
+			fseek(f, 0, SEEK_END);
+			auto size = static_cast<size_t>(ftell(f));
+			fseek(f, 0, SEEK_SET);
+
+			auto buf = zbuf::Buffer(size);
+			buf.incrementSize(fread(buf.data(), 1, size, f));
+			fclose(f);
+
+			for(auto line : zbuf::lines(buf.sv()))
+				total += line.size();
+		}
+	}
+	else if(which == "mapped_lines")
+	{
+		auto opts = zbuf::MappedFile::Options();
+		opts.sequential = true;
+
+		for(long i = 0; i < count; ++i)
+		{
+			auto file = zbuf::MappedFile::map(path, opts);
+			for(auto line : file.lines())
+				total += line.size();
+		}
+	}
+	else
+	{
+		assert(0 && "speed test for which version?");
+	}
+
+	bench::keep(total);
+}
+
+
+int main(int argc, char* argv[])
+{
+	auto args = bench::Args(argc, argv);
+	if(args.positional.empty())
+		return 0;
+
+	auto which = args.get(0);
+	auto count = args.getInt(1, 100000);
+	const auto haystack = make_haystack(64 * 1024);
+
+	// the searches go through the whole haystack every time.
+	bool search = which.find("chr") != std::string::npos || which.find("find") != std::string::npos
+		|| which.find("ffo") != std::string::npos || which == "memmem";
+
+	// the line splitters read a file of (by default) 64 MiB each time; it stays in the page cache.
+	bool lines = which.find("lines") != std::string::npos;
+	auto path = args.get(2, "/tmp/zbuf-bench-lines.txt");
+
+	if(lines)
+	{
+		FILE* f = fopen(path.c_str(), "wb");
+		for(size_t i = 0; i < 1024; i++)
+			fwrite(haystack.data(), 1, haystack.size(), f);
+		fclose(f);
+	}
+
+	bench::run(args, "zbuf/" + which, count, [&]() { speedTest(which, count, haystack, path); },
+		search ? haystack.size() : (lines ? 1024 * haystack.size() : 0));
+
+	if(lines)
+		remove(path.c_str());
+
+	return 0;
+}
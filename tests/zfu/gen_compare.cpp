@@ -0,0 +1,133 @@
+// gen_compare.cpp
+// Copyright (c) 2026, zhiayang
+// Licensed under the Apache License Version 2.0.
+
+#include <cstdio>
+#include <cstdint>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#define ZFU_PARALLEL 0
+#include "zfu.h"
+
+// `./gen_compare [max_n]`: check that the zfu::gen generators make the same results as the eager versions (as
+// sets, since the order is different), that the ranks and partitions line up, and that the counts are exact for
+// large n.
+
+static int failed = 0;
+
+static void check(bool ok, const std::string& what)
+{
+	if(!ok)
+	{
+		fprintf(stderr, "FAIL: %s\n", what.c_str());
+		failed++;
+	}
+}
+
+template <typename T>
+static std::vector<std::vector<T>> collect(zfu::gen::Generator<T> g)
+{
+	auto ret = std::vector<std::vector<T>>();
+	while(g.next())
+		ret.push_back(g.current());
+
+	return ret;
+}
+
+template <typename T>
+static std::vector<std::vector<T>> sorted(std::vector<std::vector<T>> xs)
+{
+	std::sort(xs.begin(), xs.end());
+	return xs;
+}
+
+// the whole sequence, the concatenation of k partitions, and a generator started at each rank must all agree.
+template <typename T>
+static void compare(const std::string& name, zfu::gen::Generator<T> g, const std::vector<std::vector<T>>& eager)
+{
+	auto all = collect(g);
+
+	check(g.total() == eager.size(), name + ": total() is " + std::to_string(g.total()) + ", eager has "
+		+ std::to_string(eager.size()));
+
+	check(sorted(all) == sorted(eager), name + ": different results");
+
+	for(size_t k = 1; k <= 5; k++)
+	{
+		auto parts = std::vector<std::vector<T>>();
+		for(size_t i = 0; i < k; i++)
+		{
+			auto p = collect(g.partition(i, k));
+			parts.insert(parts.end(), p.begin(), p.end());
+		}
+
+		check(parts == all, name + ": partitions into " + std::to_string(k) + " don't match");
+	}
+
+	check(g.partition(0, 0).size() == 0, name + ": partition(0, 0) is not empty");
+
+	for(size_t r = 0; r < all.size(); r++)
+	{
+		auto s = g.slice(r, r + 1);
+		check(s.next() && s.current() == all[r] && s.rank() == r, name + ": slice at " + std::to_string(r));
+	}
+}
+
+static void check_counts()
+{
+	auto xs = std::vector<int>(64);
+
+	check(zfu::gen::combinations(xs, 32).total() == 1832624140942590534ULL, "C(64, 32)");
+	check(zfu::gen::combinations(xs, 1).total() == 64, "C(64, 1)");
+	check(zfu::gen::combinations(xs, 0).total() == 0, "C(64, 0)");
+
+	xs.resize(67);
+	check(zfu::gen::combinations(xs, 33).total() == 14226520737620288370ULL, "C(67, 33)");
+
+	xs.resize(1000);
+	check(zfu::gen::combinations(xs, 7).total() == 194280608456793000ULL, "C(1000, 7)");
+	check(zfu::gen::combinations(xs, 993).total() == 194280608456793000ULL, "C(1000, 993)");
+
+	// the last combination of 32 out of 64 is the last 32 indices, which is only right if every count on the way
+	// there was too.
+	xs.resize(64);
+	auto g = zfu::gen::combinations(xs, 32);
+	auto last = g.slice(g.total() - 1, g.total());
+	check(last.next() && last.indices().front() == 32 && last.indices().back() == 63, "last combination of C(64, 32)");
+
+	auto mid = g.partition(1, 2);
+	check(mid.next() && mid.rank() == g.total() / 2, "second half of C(64, 32)");
+}
+
+int main(int argc, char* argv[])
+{
+	size_t max_n = (argc > 1) ? static_cast<size_t>(std::stoul(argv[1])) : 7;
+
+	for(size_t n = 0; n <= max_n; n++)
+	{
+		auto xs = std::vector<int>();
+		for(size_t i = 0; i < n; i++)
+			xs.push_back(static_cast<int>(i * 10));
+
+		auto sn = std::to_string(n);
+		compare("powerset(" + sn + ")", zfu::gen::powerset(xs), zfu::powerset(xs));
+		compare("permutations(" + sn + ")", zfu::gen::permutations(xs), zfu::permutations(xs));
+
+		for(size_t r = 0; r <= n; r++)
+		{
+			auto sr = sn + ", " + std::to_string(r);
+			compare("combinations(" + sr + ")", zfu::gen::combinations(xs, r), zfu::combinations(xs, r));
+			compare("permutations(" + sr + ")", zfu::gen::permutations(xs, r), zfu::permutations(xs, r));
+		}
+	}
+
+	check_counts();
+
+	if(failed == 0)
+		printf("all passed\n");
+
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,15 @@
+#!/usr/bin/env fish
+
+# any arguments (eg. --json, or --runs 20) are passed on to every case.
+
+for kind in mpmc spsc wait_queue
+	./bench $kind $argv
+end
+
+for kind in pool_run pool_steal parallel_for
+	./bench $kind $argv
+end
+
+for kind in sync_read rcu_read seqlock_read
+	./bench $kind $argv
+end
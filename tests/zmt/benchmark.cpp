@@ -0,0 +1,183 @@
+// benchmark.cpp
+// Copyright (c) 2026, zhiayang
+// Licensed under the Apache License Version 2.0.
+
+#include <cstdio>
+#include <cstdint>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "zmt.h"
+
+#include "../bench.h"
+
+// a value that's a bit bigger than a word, so that readers actually have to copy something.
+struct Point
+{
+	int64_t x;
+	int64_t y;
+	int64_t z;
+	int64_t w;
+};
+
+// `producers` threads push count items in total, `consumers` threads pop them all.
+template <typename Queue>
+static void queueTest(Queue& q, long count, int producers, int consumers)
+{
+	auto threads = std::vector<std::thread>();
+	auto total = std::atomic<int64_t>(0);
+
+	for(int p = 0; p < producers; p++)
+	{
+		threads.emplace_back([&q, count, producers]() {
+			for(long i = 0; i < count / producers; i++)
+				q.push(i);
+		});
+	}
+
+	for(int c = 0; c < consumers; c++)
+	{
+		threads.emplace_back([&q, &total, count, producers, consumers]() {
+			int64_t sum = 0;
+			for(long i = 0; i < (count / producers) * producers / consumers; i++)
+				sum += q.pop();
+
+			total.fetch_add(sum, std::memory_order_relaxed);
+		});
+	}
+
+	for(auto& t : threads)
+		t.join();
+
+	bench::keep(total.load());
+}
+
+// `readers` threads read the value `count` times each while one thread keeps writing to it.
+template <typename Sync>
+static void readTest(Sync& s, long count, int readers)
+{
+	auto stop = std::atomic<bool>(false);
+	auto writer = std::thread([&]() {
+		int64_t n = 0;
+		while(!stop.load(std::memory_order_relaxed))
+		{
+			s.perform_write([n](Point& p) { p = Point { n, n, n, n }; });
+			n++;
+
+			std::this_thread::yield();
+		}
+	});
+
+	auto threads = std::vector<std::thread>();
+	for(int r = 0; r < readers; r++)
+	{
+		threads.emplace_back([&s, count]() {
+			int64_t sum = 0;
+			for(long i = 0; i < count; i++)
+				sum += s.map_read([](const Point& p) { return p.x + p.w; });
+
+			bench::keep(sum);
+		});
+	}
+
+	for(auto& t : threads)
+		t.join();
+
+	stop.store(true);
+	writer.join();
+}
+
+static void speedTest(const std::string& which, long count, int threads)
+{
+	if(which == "mpmc")
+	{
+		static zmt::mpmc_queue<int64_t, 1024> q;
+		queueTest(q, count, threads, threads);
+	}
+	else if(which == "spsc")
+	{
+		static zmt::spsc_queue<int64_t, 1024> q;
+		queueTest(q, count, 1, 1);
+	}
+	else if(which == "wait_queue")
+	{
+		static zmt::wait_queue<int64_t> q;
+		queueTest(q, count, threads, threads);
+	}
+	// one small job per run(), waiting for all of them at the end.
+	else if(which == "pool_run" || which == "pool_steal")
+	{
+		static zmt::ThreadPool pool(zmt::ThreadPool::Options {
+			.num_workers = static_cast<size_t>(threads),
+			.work_stealing = (which == "pool_steal"),
+		});
+
+		auto futs = std::vector<zmt::future<int64_t>>();
+		futs.reserve(static_cast<size_t>(count));
+
+		for(long i = 0; i < count; i++)
+			futs.push_back(pool.run([i]() -> int64_t { return i * 3; }));
+
+		int64_t sum = 0;
+		for(auto& f : futs)
+			sum += f.get();
+
+		bench::keep(sum);
+	}
+	else if(which == "parallel_for")
+	{
+		static zmt::ThreadPool pool(static_cast<size_t>(threads));
+		static std::vector<int64_t> xs(static_cast<size_t>(count));
+
+		pool.parallel_for(0, xs.size(), 1024, [](size_t i) {
+			xs[i] = static_cast<int64_t>(i) * 3;
+		});
+
+		bench::keep(xs.back());
+	}
+	else if(which == "sync_read")
+	{
+		static zmt::Synchronised<Point> s;
+		readTest(s, count / threads, threads);
+	}
+	else if(which == "rcu_read")
+	{
+		static zmt::RcuSynchronised<Point> s;
+		readTest(s, count / threads, threads);
+	}
+	else if(which == "seqlock_read")
+	{
+		static zmt::SeqlockSynchronised<Point> s;
+		readTest(s, count / threads, threads);
+	}
+	else
+	{
+		fprintf(stderr, "unknown case '%s'\n", which.c_str());
+		exit(1);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	// ./bench <case> [count] [threads]
+	auto args = bench::Args(argc, argv);
+	if(args.positional.empty())
+	{
+		fprintf(stderr, "usage: ./bench <case> [count] [threads] [--runs N] [--warmup N] [--json]\n");
+		return 1;
+	}
+
+	auto which = args.get(0);
+	auto count = args.getInt(1, 1000000);
+	auto threads = static_cast<int>(args.getInt(2, 4));
+
+	auto name = "zmt/" + which + (which == "spsc" ? "" : "/" + std::to_string(threads));
+	bench::run(args, name, count, [&]() {
+		speedTest(which, count, threads);
+	});
+
+	return 0;
+}
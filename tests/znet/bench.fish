@@ -0,0 +1,7 @@
+#!/usr/bin/env fish
+
+# any arguments (eg. --json, or --runs 20) are passed on to every case.
+
+for kind in tcp_latency tcp_throughput udp_latency udp_throughput
+	./bench $kind $argv
+end
@@ -0,0 +1,288 @@
+// benchmark.cpp
+// Copyright (c) 2026, zhiayang
+// Licensed under the Apache License Version 2.0.
+
+#include <cstdio>
+#include <cstdint>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#define ZNET_IMPLEMENTATION
+#include "znet.h"
+
+#include "../bench.h"
+
+// znet only does the client side, so the other end of each connection is a plain socket on a thread. it binds
+// to port 0 on loopback and returns the port that it got; the thread lives until the process exits.
+
+static constexpr size_t MSG_SIZE = 64;
+static constexpr size_t CHUNK_SIZE = 64 * 1024;
+static constexpr size_t DGRAM_SIZE = 1400;
+
+static uint16_t boundPort(int fd)
+{
+	auto sa = sockaddr_in { };
+	socklen_t len = sizeof(sa);
+	getsockname(fd, reinterpret_cast<sockaddr*>(&sa), &len);
+
+	return ntohs(sa.sin_port);
+}
+
+static int makeSocket(int type)
+{
+	auto fd = socket(AF_INET, type, 0);
+
+	auto sa = sockaddr_in { };
+	sa.sin_family = AF_INET;
+	sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	sa.sin_port = 0;
+
+	int yes = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+	if(bind(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) < 0)
+	{
+		perror("bind");
+		exit(1);
+	}
+
+	return fd;
+}
+
+static bool readExactly(int fd, uint8_t* buf, size_t len)
+{
+	while(len > 0)
+	{
+		auto n = read(fd, buf, len);
+		if(n <= 0)
+			return false;
+
+		buf += n;
+		len -= static_cast<size_t>(n);
+	}
+
+	return true;
+}
+
+static bool sendAll(znet::TCPSocket& sock, const uint8_t* buf, size_t len)
+{
+	while(len > 0)
+	{
+		auto n = sock.send(buf, len);
+		if(n <= 0)
+			return false;
+
+		buf += n;
+		len -= static_cast<size_t>(n);
+	}
+
+	return true;
+}
+
+static bool receiveAll(znet::TCPSocket& sock, uint8_t* buf, size_t len)
+{
+	while(len > 0)
+	{
+		auto n = sock.receive(buf, len);
+		if(n <= 0)
+			return false;
+
+		buf += n;
+		len -= static_cast<size_t>(n);
+	}
+
+	return true;
+}
+
+// echo: sends back every message of MSG_SIZE bytes. sink: reads `chunks` chunks at a time, then sends one byte.
+static uint16_t startTcpServer(bool echo, long chunks)
+{
+	auto fd = makeSocket(SOCK_STREAM);
+	listen(fd, 4);
+
+	auto port = boundPort(fd);
+	std::thread([fd, echo, chunks]() {
+		auto conn = accept(fd, nullptr, nullptr);
+
+		int yes = 1;
+		setsockopt(conn, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+		auto buf = std::vector<uint8_t>(CHUNK_SIZE);
+		while(true)
+		{
+			if(echo)
+			{
+				if(!readExactly(conn, buf.data(), MSG_SIZE) || write(conn, buf.data(), MSG_SIZE) != MSG_SIZE)
+					break;
+			}
+			else
+			{
+				bool ok = true;
+				for(long i = 0; i < chunks && ok; i++)
+					ok = readExactly(conn, buf.data(), CHUNK_SIZE);
+
+				if(!ok || write(conn, buf.data(), 1) != 1)
+					break;
+			}
+		}
+
+		close(conn);
+		close(fd);
+	}).detach();
+
+	return port;
+}
+
+// echo: sends every datagram back to where it came from. sink: just receives them.
+static uint16_t startUdpServer(bool echo, std::atomic<long>* received)
+{
+	auto fd = makeSocket(SOCK_DGRAM);
+	auto port = boundPort(fd);
+
+	int size = 64 * 1024 * 1024;
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+	std::thread([fd, echo, received]() {
+		auto buf = std::vector<uint8_t>(65536);
+		while(true)
+		{
+			auto sa = sockaddr_storage { };
+			socklen_t len = sizeof(sa);
+
+			auto n = recvfrom(fd, buf.data(), buf.size(), 0, reinterpret_cast<sockaddr*>(&sa), &len);
+			if(n <= 0)
+				continue;
+
+			if(echo)
+				sendto(fd, buf.data(), static_cast<size_t>(n), 0, reinterpret_cast<sockaddr*>(&sa), len);
+			else
+				received->fetch_add(1, std::memory_order_relaxed);
+		}
+	}).detach();
+
+	return port;
+}
+
+int main(int argc, char* argv[])
+{
+	// ./bench <case> [count]
+	auto args = bench::Args(argc, argv);
+	if(args.positional.empty())
+	{
+		fprintf(stderr, "usage: ./bench <case> [count] [--runs N] [--warmup N] [--json]\n");
+		return 1;
+	}
+
+	auto which = args.get(0);
+	auto name = "znet/" + which;
+
+	// round trips of MSG_SIZE bytes.
+	if(which == "tcp_latency")
+	{
+		auto count = args.getInt(1, 20000);
+		auto port = startTcpServer(/* echo: */ true, 0);
+
+		auto sock = znet::TCPSocket(znet::IPAddress::ip4("127.0.0.1", port), /* ssl: */ false);
+		if(!sock.connect())
+			return 1;
+
+		auto buf = std::vector<uint8_t>(MSG_SIZE, 'x');
+		bench::run(args, name, count, [&]() {
+			for(long i = 0; i < count; i++)
+			{
+				if(!sendAll(sock, buf.data(), MSG_SIZE) || !receiveAll(sock, buf.data(), MSG_SIZE))
+					exit(1);
+			}
+		});
+	}
+	// `count` chunks of CHUNK_SIZE bytes, one way, then waiting for the other end to say it got them.
+	else if(which == "tcp_throughput")
+	{
+		auto count = args.getInt(1, 4096);
+		auto port = startTcpServer(/* echo: */ false, count);
+
+		auto sock = znet::TCPSocket(znet::IPAddress::ip4("127.0.0.1", port), /* ssl: */ false);
+		if(!sock.connect())
+			return 1;
+
+		auto buf = std::vector<uint8_t>(CHUNK_SIZE, 'x');
+		bench::run(args, name, count, [&]() {
+			for(long i = 0; i < count; i++)
+			{
+				if(!sendAll(sock, buf.data(), CHUNK_SIZE))
+					exit(1);
+			}
+
+			if(!receiveAll(sock, buf.data(), 1))
+				exit(1);
+		}, CHUNK_SIZE);
+	}
+	// round trips of one MSG_SIZE datagram. a datagram that doesn't come back within a second is sent again.
+	else if(which == "udp_latency")
+	{
+		auto count = args.getInt(1, 20000);
+		auto port = startUdpServer(/* echo: */ true, nullptr);
+
+		auto sock = znet::UDPSocket(znet::IPAddress::ip4("127.0.0.1", 0), znet::IPAddress::ip4("127.0.0.1", port));
+		if(!sock.bind())
+			return 1;
+
+		auto buf = std::vector<uint8_t>(MSG_SIZE, 'x');
+		bench::run(args, name, count, [&]() {
+			for(long i = 0; i < count; i++)
+			{
+				do {
+					sock.send(buf.data(), MSG_SIZE);
+				} while(sock.receive(buf.data(), buf.size(), 1.0) <= 0);
+			}
+		});
+	}
+	// `count` datagrams of DGRAM_SIZE bytes, sent in batches. loopback UDP drops datagrams when the receiver falls
+	// behind, so this measures how fast they can be sent; the number that arrived is printed (to stderr) at the end.
+	else if(which == "udp_throughput")
+	{
+		auto count = args.getInt(1, 200000);
+
+		auto received = std::atomic<long>(0);
+		auto port = startUdpServer(/* echo: */ false, &received);
+
+		auto sock = znet::UDPSocket(znet::IPAddress::ip4("127.0.0.1", 0), znet::IPAddress::ip4("127.0.0.1", port));
+		if(!sock.bind())
+			return 1;
+
+		auto batch = znet::UDPBatch(64, DGRAM_SIZE);
+		auto buf = std::vector<uint8_t>(DGRAM_SIZE, 'x');
+
+		long sent = 0;
+		bench::run(args, name, count, [&]() {
+			for(long i = 0; i < count; )
+			{
+				batch.clear();
+				while(i < count && batch.push(buf.data(), DGRAM_SIZE))
+					i++;
+
+				if(auto n = sock.sendBatch(batch); n > 0)
+					sent += n;
+			}
+		}, DGRAM_SIZE);
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		fprintf(stderr, "udp_throughput: %ld of %ld datagrams arrived\n", received.load(), sent);
+	}
+	else
+	{
+		fprintf(stderr, "unknown case '%s'\n", which.c_str());
+		return 1;
+	}
+
+	return 0;
+}
@@ -1,14 +1,13 @@
 #!/usr/bin/env fish
 
-printf "printf:\t"
-time ./bench printf
-
-printf "zpr:\t"
-time ./bench zpr
-
-printf "fmt:\t"
-time ./bench fmt
-
-printf "fmt2:\t"
-time ./bench fmt2
-
+# any arguments are passed on to each case, eg. `./bench.fish /dev/null 100000 --runs 20 --json`
+
+for case in printf zpr zpr2 fmt fmt2 \
+	printf_float zpr_float fmt_float \
+	printf_int zpr_int fmt_int \
+	printf_hex zpr_hex fmt_hex \
+	zpr_ints_loop zpr_ints \
+	printf_str zpr_str fmt_str \
+	zpr_mt zpr_async
+	./bench $case $argv
+end
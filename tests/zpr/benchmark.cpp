@@ -7,11 +7,17 @@
 #include <cstddef>
 
 #include <string>
+#include <memory>
+#include <thread>
+#include <vector>
 #include <fstream>
 #include <stdio.h>
 
+#define ZPR_ASYNC_SINK
 #include "zpr.h"
 
+#include "../bench.h"
+
 #include <cassert>
 #include <fmt/core.h>
 #include <fmt/compile.h>
@@ -39,6 +45,15 @@ void speedTest(FILE* fd, const std::string& which, long count)
 			// zpr::fprint(fd, "{}:{.99}:{}\n", BIG_STRING, BIG_STRING, BIG_STRING);
 		}
 	}
+	else if(which == "zpr2")
+	{
+		for(long i = 0; i < count; ++i)
+		{
+			zpr::fprint(fd, ZPR_FMT("{.10f}:{04}:{+g}:{}:{p}:{}:%\n"), 1.234, 42, 3.13, "str", (void*) 1000, 'X');
+			// zpr::fprint(fd, ZPR_FMT("{.10f}:{+g}:{e}\n"), 1.23456, 3.4951, 1234567.890123456);
+			// zpr::fprint(fd, ZPR_FMT("{}:{.99}:{}\n"), BIG_STRING, BIG_STRING, BIG_STRING);
+		}
+	}
 	else if(which == "fmt")
 	{
 		for(long i = 0; i < count; ++i)
@@ -57,6 +72,126 @@ void speedTest(FILE* fd, const std::string& which, long count)
 			// fmt::print(fd, fmt::format(FMT_COMPILE("{}:{:.*}:{}\n"), BIG_STRING, 999, BIG_STRING, BIG_STRING));
 		}
 	}
+	// floating point throughput: shortest round-trip output (%.17g is the closest printf can do), and fixed precision.
+	else if(which == "printf_float")
+	{
+		for(long i = 0; i < count; ++i)
+		{
+			double x = 1.234 + static_cast<double>(i) * 1e-7;
+			fprintf(fd, "%.17g %.17g %.17g %.3f\n", x, x * 1e-9, x * 6.02214076e23, x * 100);
+		}
+	}
+	else if(which == "zpr_float")
+	{
+		for(long i = 0; i < count; ++i)
+		{
+			double x = 1.234 + static_cast<double>(i) * 1e-7;
+			zpr::fprint(fd, "{} {} {} {.3f}\n", x, x * 1e-9, x * 6.02214076e23, x * 100);
+		}
+	}
+	else if(which == "fmt_float")
+	{
+		for(long i = 0; i < count; ++i)
+		{
+			double x = 1.234 + static_cast<double>(i) * 1e-7;
+			fmt::print(fd, "{} {} {} {:.3f}\n", x, x * 1e-9, x * 6.02214076e23, x * 100);
+		}
+	}
+	// integers: a spread of magnitudes and signs, so that the digit count is not always the same.
+	else if(which == "printf_int")
+	{
+		for(long i = 0; i < count; ++i)
+			fprintf(fd, "%ld %ld %d %lu\n", i, -i * 7919, static_cast<int>(i & 0xff), static_cast<unsigned long>(i) * 2654435761UL);
+	}
+	else if(which == "zpr_int")
+	{
+		for(long i = 0; i < count; ++i)
+			zpr::fprint(fd, "{} {} {} {}\n", i, -i * 7919, static_cast<int>(i & 0xff), static_cast<unsigned long>(i) * 2654435761UL);
+	}
+	else if(which == "fmt_int")
+	{
+		for(long i = 0; i < count; ++i)
+			fmt::print(fd, "{} {} {} {}\n", i, -i * 7919, static_cast<int>(i & 0xff), static_cast<unsigned long>(i) * 2654435761UL);
+	}
+	else if(which == "printf_hex")
+	{
+		for(long i = 0; i < count; ++i)
+			fprintf(fd, "%lx %08lx %#lx\n", static_cast<unsigned long>(i), static_cast<unsigned long>(i) * 2654435761UL, static_cast<unsigned long>(i));
+	}
+	else if(which == "zpr_hex")
+	{
+		for(long i = 0; i < count; ++i)
+			zpr::fprint(fd, "{x} {08x} {#x}\n", static_cast<unsigned long>(i), static_cast<unsigned long>(i) * 2654435761UL, static_cast<unsigned long>(i));
+	}
+	else if(which == "fmt_hex")
+	{
+		for(long i = 0; i < count; ++i)
+			fmt::print(fd, "{:x} {:08x} {:#x}\n", static_cast<unsigned long>(i), static_cast<unsigned long>(i) * 2654435761UL, static_cast<unsigned long>(i));
+	}
+	// arrays of integers, 1024 at a time: one sprint() each, or one format_ints() for all of them.
+	else if(which == "zpr_ints_loop" || which == "zpr_ints")
+	{
+		constexpr size_t BATCH = 1024;
+
+		auto values = std::vector<long>(BATCH);
+		auto buf = std::vector<char>(BATCH * 22);
+
+		for(long i = 0; i < count; i += static_cast<long>(BATCH))
+		{
+			for(size_t k = 0; k < BATCH; k++)
+				values[k] = (i + static_cast<long>(k)) * ((k & 1) ? 7919 : -2654435761L);
+
+			size_t n = 0;
+			if(which == "zpr_ints")
+			{
+				n = zpr::format_ints(buf.size(), buf.data(), values.data(), BATCH, " ");
+			}
+			else
+			{
+				for(size_t k = 0; k < BATCH; k++)
+					n += zpr::sprint(buf.size() - n, buf.data() + n, k > 0 ? " {}" : "{}", values[k]);
+			}
+
+			fwrite(buf.data(), 1, n, fd);
+		}
+	}
+	// strings: long ones, with and without a precision.
+	else if(which == "printf_str")
+	{
+		for(long i = 0; i < count; ++i)
+			fprintf(fd, "%s:%.99s:%s\n", BIG_STRING, BIG_STRING, BIG_STRING);
+	}
+	else if(which == "zpr_str")
+	{
+		for(long i = 0; i < count; ++i)
+			zpr::fprint(fd, "{}:{.99}:{}\n", BIG_STRING, BIG_STRING, BIG_STRING);
+	}
+	else if(which == "fmt_str")
+	{
+		for(long i = 0; i < count; ++i)
+			fmt::print(fd, "{}:{:.99}:{}\n", BIG_STRING, BIG_STRING, BIG_STRING);
+	}
+	// many threads logging at once: straight to the FILE*, or through an async_sink.
+	else if(which == "zpr_mt" || which == "zpr_async")
+	{
+		constexpr long NUM_THREADS = 4;
+		auto sink = (which == "zpr_async" ? std::make_unique<zpr::async_sink>(fd) : nullptr);
+
+		auto threads = std::vector<std::thread>();
+		for(long t = 0; t < NUM_THREADS; t++)
+		{
+			threads.emplace_back([&]() {
+				for(long i = 0; i < count / NUM_THREADS; ++i)
+				{
+					if(sink) sink->print(ZPR_FMT("{.10f}:{04}:{+g}:{}:{p}:{}:%\n"), 1.234, 42, 3.13, "str", (void*) 1000, 'X');
+					else     zpr::fprint(fd, ZPR_FMT("{.10f}:{04}:{+g}:{}:{p}:{}:%\n"), 1.234, 42, 3.13, "str", (void*) 1000, 'X');
+				}
+			});
+		}
+
+		for(auto& t : threads)
+			t.join();
+	}
 	else
 	{
 		assert(0 && "speed test for which version?");
@@ -66,9 +201,22 @@ void speedTest(FILE* fd, const std::string& which, long count)
 
 int main(int argc, char* argv[])
 {
-	FILE* fd = fopen(argc > 2 ? argv[2] : "/dev/null", "w");
-	if(argc >= 2)
-		speedTest(fd, argv[1], argc > 3 ? std::stol(argv[3]) : 1000000);
+	// ./bench <case> [file] [count]; output goes to /dev/null unless a file is given.
+	auto args = bench::Args(argc, argv);
+	if(args.positional.empty())
+	{
+		fprintf(stderr, "usage: ./bench <case> [file] [count] [--runs N] [--warmup N] [--json]\n");
+		return 1;
+	}
+
+	auto which = args.get(0);
+	auto count = args.getInt(2, 200000);
+
+	FILE* fd = fopen(args.get(1, "/dev/null").c_str(), "w");
+	bench::run(args, "zpr/" + which, count, [&]() {
+		speedTest(fd, which, count);
+		fflush(fd);
+	});
 
 	fclose(fd);
 	return 0;
@@ -8,11 +8,205 @@
 #include <vector>
 #include <string_view>
 
+#include <cstdlib>
+#include <cstring>
+
 #define ZPR_USE_STD 0
 #include "zpr.h"
 
+// `./printf_compare float [count]`: check that `{}` round-trips (and print it next to %.17g), that the
+// fixed/exponent/general modes match printf exactly, and then round-trip `count` random doubles.
+static int compare_floats(long count)
+{
+	const double values[] = {
+		0.0, -0.0, 0.1, 0.2, 0.3, 1.0 / 3.0, 2.0 / 3.0, 0.5, 1.5, 2.5, 2.675, 1.005, 1.234, 3.13, 100.0,
+		123456.789, 9007199254740993.0, 1e15, 1e16, 1.5e16, 1e21, 1e22, 1e23, 1e-5, 1e-7, 1e-10, 1e-300,
+		5e-324, 2.2250738585072009e-308, 2.2250738585072014e-308, 1.7976931348623157e308, 299792458.0,
+		6.02214076e23, 6.62607015e-34, 1.602176634e-19, 4294967295.0, 18446744073709551615.0,
+	};
+
+	int failed = 0;
+	char buf[1024];
+	char want[1024];
+
+	auto check = [&](const char* zfmt, const char* pfmt, int prec, double x) {
+		char zf[32];
+		snprintf(zf, sizeof(zf), zfmt, prec);
+
+		auto n = zpr::sprint(sizeof(buf) - 1, buf, zpr::tt::str_view(zf, strlen(zf)), x);
+		buf[n] = 0;
+
+		snprintf(want, sizeof(want), pfmt, prec, x);
+		if(strcmp(buf, want) != 0)
+			printf("MISMATCH: %-8s %-24.17g printf: %s, zpr: %s\n", zf, x, want, buf), failed++;
+	};
+
+	printf("%-26s %-26s\n", "%.17g", "{}");
+	for(double x : values)
+	{
+		auto n = zpr::sprint(sizeof(buf) - 1, buf, "{}", x);
+		buf[n] = 0;
+
+		bool ok = (strtod(buf, nullptr) == x);
+		printf("%-26.17g %-26s%s\n", x, buf, ok ? "" : "  (does not round-trip)");
+		failed += !ok;
+
+		for(int prec : { 0, 1, 2, 3, 6, 10, 17, 25 })
+		{
+			for(double y : { x, -x })
+			{
+				check("{.%df}", "%.*f", prec, y);
+				check("{.%de}", "%.*e", prec, y);
+				check("{.%dg}", "%.*g", prec, y);
+				check("{+18.%df}", "%+18.*f", prec, y);
+				check("{-18.%de}|", "%-18.*e|", prec, y);
+				check("{018.%dg}", "%018.*g", prec, y);
+			}
+		}
+	}
+
+	uint64_t state = 0x9E3779B97F4A7C15;
+	for(long i = 0; i < count; i++)
+	{
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+
+		double x = 0;
+		memcpy(&x, &state, sizeof(x));
+		if(x != x || x > 1.7976931348623157e308 || x < -1.7976931348623157e308)
+			continue;
+
+		auto n = zpr::sprint(sizeof(buf) - 1, buf, "{}", x);
+		buf[n] = 0;
+
+		if(strtod(buf, nullptr) != x)
+			printf("MISMATCH: {} of %.17g gave %s\n", x, buf), failed++;
+	}
+
+	printf("\n%d mismatches\n", failed);
+	return failed == 0 ? 0 : 1;
+}
+
+// `./printf_compare int [count]`: check integers against printf, with the edge cases (the limits of each type, and
+// either side of every power of 10 and 16) in every mode, then `count` random ones; and then format_ints().
+static int compare_ints(long count)
+{
+	int failed = 0;
+	char buf[256];
+	char want[256];
+
+	auto check = [&](const char* zfmt, const char* pfmt, auto x) {
+		auto n = zpr::sprint(sizeof(buf) - 1, buf, zpr::tt::str_view(zfmt, strlen(zfmt)), x);
+		buf[n] = 0;
+
+		snprintf(want, sizeof(want), pfmt, x);
+		if(strcmp(buf, want) != 0)
+			printf("MISMATCH: %-8s printf: %s, zpr: %s\n", zfmt, want, buf), failed++;
+	};
+
+	auto check_all = [&](long long x) {
+		check("{}", "%lld", x);
+		check("{}", "%d", static_cast<int>(x));
+		check("{}", "%hd", static_cast<short>(x));
+		check("{}", "%llu", static_cast<unsigned long long>(x));
+		check("{}", "%u", static_cast<unsigned int>(x));
+		check("{+}", "%+lld", x);
+		check("{ }", "%+lld", x < 0 ? x : -1);
+		check("{24}|", "%24lld|", x);
+		check("{-24}|", "%-24lld|", x);
+		check("{024}", "%024lld", x);
+		check("{.22}", "%.22lld", x);
+		check("{x}", "%llx", x);
+		check("{X}", "%llX", x);
+		check("{x}", "%x", static_cast<unsigned int>(x));
+
+		// printf leaves out the 0x for zero, but zpr doesn't.
+		if(x != 0)
+		{
+			check("{#x}", "%#llx", x);
+			check("{#20x}|", "%#20llx|", x);
+		}
+		check("{-20.18x}|", "%-20.18llx|", x);
+	};
+
+	check_all(0);
+	check_all(INT64_MIN);
+	check_all(INT64_MAX);
+	check_all(INT32_MIN);
+	check_all(INT32_MAX);
+	check_all(INT16_MIN);
+	check_all(UINT32_MAX);
+
+	uint64_t p10 = 1;
+	for(int i = 0; i < 19; i++, p10 *= 10)
+	{
+		for(uint64_t d : { p10 - 1, p10, p10 + 1 })
+			check_all(static_cast<long long>(d)), check_all(-static_cast<long long>(d));
+	}
+
+	for(int i = 0; i < 64; i += 4)
+	{
+		auto p16 = 1ULL << i;
+		for(uint64_t d : { p16 - 1, p16, p16 + 1 })
+			check_all(static_cast<long long>(d));
+	}
+
+	check("{}", "%llu", UINT64_MAX);
+	check("{}", "%llu", 10000000000000000000ULL);
+	check("{}", "%llu", 9999999999999999999ULL);
+	check("{x}", "%llx", UINT64_MAX);
+
+	uint64_t state = 0x9E3779B97F4A7C15;
+	for(long i = 0; i < count; i++)
+	{
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+
+		// a random number of bits, so that every length is tested and not just the longest.
+		auto x = static_cast<long long>(state >> (state % 64));
+		check("{}", "%lld", x);
+		check("{}", "%lld", -x);
+		check("{x}", "%llx", x);
+	}
+
+	{
+		const long long values[] = { 0, -1, 12, INT64_MIN, INT64_MAX, 100000000, -99999999 };
+		const char* all = "0, -1, 12, -9223372036854775808, 9223372036854775807, 100000000, -99999999";
+
+		// every length of buffer, so that the truncation is checked at every position.
+		for(size_t len = 0; len <= strlen(all) + 1; len++)
+		{
+			memset(buf, '#', sizeof(buf));
+			auto n = zpr::format_ints(len, buf, values, sizeof(values) / sizeof(values[0]));
+
+			auto want_len = zpr::tt::_Minimum(len, strlen(all));
+			if(n != want_len || memcmp(buf, all, n) != 0 || buf[n] != '#')
+				printf("MISMATCH: format_ints with %zu bytes: %.*s\n", len, static_cast<int>(n), buf), failed++;
+		}
+
+		const unsigned char bytes[] = { 0, 9, 10, 99, 100, 255 };
+		auto n = zpr::format_ints(sizeof(buf), buf, bytes, sizeof(bytes), "|");
+		if(std::string_view(buf, n) != "0|9|10|99|100|255")
+			printf("MISMATCH: format_ints of bytes: %.*s\n", static_cast<int>(n), buf), failed++;
+
+		if(zpr::format_ints(sizeof(buf), buf, bytes, 0) != 0)
+			printf("MISMATCH: format_ints of nothing\n"), failed++;
+	}
+
+	printf("%d mismatches\n", failed);
+	return failed == 0 ? 0 : 1;
+}
+
 int main(int argc, char** argv)
 {
+	if(argc > 1 && strcmp(argv[1], "float") == 0)
+		return compare_floats(argc > 2 ? atol(argv[2]) : 1000000);
+
+	if(argc > 1 && strcmp(argv[1], "int") == 0)
+		return compare_ints(argc > 2 ? atol(argv[2]) : 1000000);
+
 	std::string str = "a std::string";
 	std::string_view sv = "a std::string_view";
 	std::vector<int> vec = { 1, 2, 3, 4, 5 };
@@ -0,0 +1,7 @@
+#!/usr/bin/env fish
+
+# any arguments (eg. --json, or --runs 20) are passed on to every case.
+
+for kind in client_small client_large client_deflate oneshot
+	./bench $kind $argv
+end
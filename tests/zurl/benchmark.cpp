@@ -0,0 +1,204 @@
+// benchmark.cpp
+// Copyright (c) 2026, zhiayang
+// Licensed under the Apache License Version 2.0.
+
+#include <cstdio>
+#include <cstdint>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+// link with -lz.
+#define ZNET_IMPLEMENTATION
+#define ZURL_IMPLEMENTATION
+#define ZURL_ENABLE_ZLIB
+#include "zurl.h"
+
+#include <zlib.h>
+
+#include "../bench.h"
+
+// a minimal HTTP/1.1 server on loopback, so that the numbers don't depend on anything outside this process: it
+// answers GET /small with a few bytes, GET /large with LARGE_SIZE bytes, and GET /deflate with LARGE_SIZE bytes of
+// text compressed with zlib, and keeps connections open until the client closes them. it only understands requests without a body, which is all that the cases send.
+
+static constexpr size_t LARGE_SIZE = 1024 * 1024;
+
+static void sendAll(int fd, const std::string& s)
+{
+	size_t done = 0;
+	while(done < s.size())
+	{
+		auto n = write(fd, s.data() + done, s.size() - done);
+		if(n <= 0)
+			return;
+
+		done += static_cast<size_t>(n);
+	}
+}
+
+static void serveConnection(int conn)
+{
+	// these are never freed, since the connection threads are still running when the process exits.
+	static const auto& small = *new std::string("HTTP/1.1 200 OK\r\nContent-Length: 13\r\n"
+		"Content-Type: text/plain\r\n\r\nhello, world!");
+
+	static const auto& large = *new std::string("HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(LARGE_SIZE)
+		+ "\r\nContent-Type: application/octet-stream\r\n\r\n" + std::string(LARGE_SIZE, 'x'));
+
+	static const auto& deflated = *new std::string([]() {
+		auto text = std::string();
+		for(size_t i = 0; text.size() < LARGE_SIZE; i++)
+			text += "line " + std::to_string(i) + " of some text that compresses reasonably well\n";
+
+		text.resize(LARGE_SIZE);
+
+		auto len = compressBound(LARGE_SIZE);
+		auto out = std::string(len, '\0');
+		compress(reinterpret_cast<Bytef*>(out.data()), &len, reinterpret_cast<const Bytef*>(text.data()), LARGE_SIZE);
+		out.resize(len);
+
+		return "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(out.size())
+			+ "\r\nContent-Encoding: deflate\r\n\r\n" + out;
+	}());
+
+	int yes = 1;
+	setsockopt(conn, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+	auto pending = std::string();
+	char buf[4096];
+
+	while(true)
+	{
+		auto end = pending.find("\r\n\r\n");
+		if(end == std::string::npos)
+		{
+			auto n = read(conn, buf, sizeof(buf));
+			if(n <= 0)
+				break;
+
+			pending.append(buf, static_cast<size_t>(n));
+			continue;
+		}
+
+		auto is_large = pending.compare(0, 10, "GET /large") == 0;
+		auto is_deflate = pending.compare(0, 12, "GET /deflate") == 0;
+		pending.erase(0, end + 4);
+
+		sendAll(conn, is_deflate ? deflated : is_large ? large : small);
+	}
+
+	close(conn);
+}
+
+static uint16_t startServer()
+{
+	auto fd = socket(AF_INET, SOCK_STREAM, 0);
+
+	int yes = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+	auto sa = sockaddr_in { };
+	sa.sin_family = AF_INET;
+	sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	sa.sin_port = 0;
+
+	if(bind(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) < 0 || listen(fd, 64) < 0)
+	{
+		perror("bind");
+		exit(1);
+	}
+
+	socklen_t len = sizeof(sa);
+	getsockname(fd, reinterpret_cast<sockaddr*>(&sa), &len);
+
+	std::thread([fd]() {
+		while(true)
+		{
+			auto conn = accept(fd, nullptr, nullptr);
+			if(conn < 0)
+				continue;
+
+			std::thread(serveConnection, conn).detach();
+		}
+	}).detach();
+
+	return ntohs(sa.sin_port);
+}
+
+int main(int argc, char* argv[])
+{
+	// ./bench <case> [count]
+	auto args = bench::Args(argc, argv);
+	if(args.positional.empty())
+	{
+		fprintf(stderr, "usage: ./bench <case> [count] [--runs N] [--warmup N] [--json]\n");
+		return 1;
+	}
+
+	auto which = args.get(0);
+	auto name = "zurl/" + which;
+
+	auto port = startServer();
+	auto url = [port](const char* path) {
+		return zurl::Request { .url = zurl::URL("http://127.0.0.1:" + std::to_string(port) + path) };
+	};
+
+	// requests on one kept-alive connection; client_deflate is the same size as client_large after decompressing.
+	if(which == "client_small" || which == "client_large" || which == "client_deflate")
+	{
+		bool deflate = (which == "client_deflate");
+		bool large = (which == "client_large") || deflate;
+		auto count = args.getInt(1, large ? 500 : 10000);
+		auto req = url(deflate ? "/deflate" : large ? "/large" : "/small");
+
+		auto client = zurl::Client();
+		bench::run(args, name, count, [&]() {
+			size_t total = 0;
+			for(long i = 0; i < count; i++)
+			{
+				auto resp = client.get(req);
+				if(!resp)
+					exit(1);
+
+				total += resp->content.size();
+			}
+
+			bench::keep(total);
+		}, large ? LARGE_SIZE : 0);
+	}
+	// the free function, which connects again for every request.
+	else if(which == "oneshot")
+	{
+		auto count = args.getInt(1, 2000);
+		auto req = url("/small");
+
+		bench::run(args, name, count, [&]() {
+			size_t total = 0;
+			for(long i = 0; i < count; i++)
+			{
+				auto resp = zurl::get(req);
+				if(!resp)
+					exit(1);
+
+				total += resp->content.size();
+			}
+
+			bench::keep(total);
+		});
+	}
+	else
+	{
+		fprintf(stderr, "unknown case '%s'\n", which.c_str());
+		return 1;
+	}
+
+	return 0;
+}
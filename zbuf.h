@@ -16,7 +16,7 @@
 */
 
 /*
-	Version 1.0.4
+	Version 1.2.0
 	=============
 
 
@@ -48,17 +48,103 @@
 
 	- ZBUF_FREESTANDING
 		this is *FALSE by default; controls whether or not a standard library implementation is
-		available. if not, then memset(), memmove(), strlen(), and strncmp() are forward declared according to the
-		C library specifications, but not defined.
+		available. if not, then memset(), memcmp(), memmove(), strlen(), and strncmp() are forward declared according
+		to the C library specifications, but not defined.
 
 
-	Note that ZBUF_FREESTANDING implies ZBUF_USE_STD = 0.
+	- ZBUF_USE_SIMD
+		this is *TRUE* by default. controls whether str_view::find(), rfind() and find_first_of() use SSE2,
+		AVX2 or NEON instructions (whichever the compiler is targeting), instead of scalar loops.
+
+
+	Note that ZBUF_FREESTANDING implies ZBUF_USE_STD = 0 and ZBUF_USE_SIMD = 0.
+
+
+	By default, a Buffer gets its memory from new[]. To use something else, implement `zbuf::Allocator` and pass
+	it to the constructor; `zbuf::Arena` is a bump allocator that releases everything at once, for short-lived
+	buffers (eg. everything to do with one request):
+
+		uint8_t stack[4096];
+		auto arena = zbuf::Arena(stack, sizeof(stack));
+		auto buf = zbuf::Buffer(1024, &arena);
+
+	Growing the most recently allocated buffer in an arena extends it in place, without copying.
+
+
+	For streaming data through (write at the back, consume from the front), use `zbuf::RingBuffer` instead of
+	Buffer::drop(), which moves everything that is left. The readable and writable parts of a ring buffer are
+	given as two spans, for readv()/writev(); RingBuffer::mirrored() maps the memory twice so that it always
+	looks contiguous (this needs mmap, so it is not available with ZBUF_FREESTANDING).
+
+
+	To read a big file without copying it into a Buffer first, map it with `zbuf::MappedFile`; span() and sv()
+	point straight into the mapping. The options give hints to the kernel about how it will be read:
+
+		auto opts = zbuf::MappedFile::Options();
+		opts.sequential = true;
+
+		auto file = zbuf::MappedFile::map("capture.log", opts);
+		if(!file.isOpen())
+			return file.error();
+
+		for(auto line : file.lines())
+			process(line);
+
+	lines() and records(delim) are also available as free functions for any str_view; they split it without
+	copying, using the vectorised find(). MappedFile needs mmap, so it is not available with ZBUF_FREESTANDING.
+
+
+	To encode and decode binary messages, use `zbuf::Writer` (which appends to a Buffer) and `zbuf::Reader` (which
+	reads from a Span). Values are written either with a fixed width, in little- or big-endian order (`zbuf::endian`
+	is the same as zst::impl::endian), or as varints:
+
+		auto w = zbuf::Writer(buf);
+		w.reserve(4 + zbuf::varintSize(id) + payload.size());
+		w.write<uint16_t, zbuf::endian::big>(kind);
+		w.writeVarint(id);
+		w.writeBytes(payload);
+
+		auto r = zbuf::Reader(buf.span());
+		auto kind = r.read<uint16_t, zbuf::endian::big>();
+		auto id = r.readVarint<int64_t>();
+		if(r.failed())
+			return false;
+
+	Reading past the end gives zeros and sets failed(), so each field doesn't need to be checked separately.
 
 
 
 	Version History
 	===============
 
+	1.2.0 - 14/10/2026
+	------------------
+	- add MappedFile, which maps a file read-only and gives it as a Span or str_view without copying
+	- add Records, lines() and records(), which split a str_view into lines or delimited records
+	- add Writer and Reader, for binary messages with fixed-width (in either byte order) and varint fields
+
+
+
+	1.1.0 - 14/10/2026
+	------------------
+	- use SSE2/AVX2/NEON for str_view::find(), rfind() and find_first_of(); add ZBUF_USE_SIMD to turn it off
+	- fix rfind() for needles longer than one character returning the wrong position
+	- make str_view::find_first_of() const
+	- fix compile errors with ZBUF_FREESTANDING (size_t was used before it was declared)
+	- add Allocator and Arena; Buffers can now get their memory from an allocator
+	- make autoWrite() grow the buffer by at least half, instead of by exactly what is needed
+	- add RingBuffer, with an optional mirrored (double-mapped) mode
+	- fix Span::take_last() returning everything except the first n bytes
+
+
+
+	1.0.5 - 14/10/2026
+	------------------
+	Bug fixes:
+	- fix Buffer::drop() not updating the size of the buffer
+
+
+
 	1.0.4 - 30/03/2021
 	------------------
 	Add '.back()' and '.front()' for str_view
@@ -112,6 +198,16 @@
 	#define ZBUF_FREESTANDING 1
 #endif
 
+#if !defined(ZBUF_USE_SIMD)
+	#define ZBUF_USE_SIMD 1
+#elif (ZBUF_EXPAND(ZBUF_USE_SIMD) == 1)
+	#undef ZBUF_USE_SIMD
+	#define ZBUF_USE_SIMD 1
+#endif
+
+
+#include <cstdint>
+#include <cstddef>
 
 #if !ZBUF_FREESTANDING
 	#include <cstring>
@@ -119,7 +215,11 @@
 	#undef ZBUF_USE_STD
 	#define ZBUF_USE_STD 0
 
+	#undef ZBUF_USE_SIMD
+	#define ZBUF_USE_SIMD 0
+
 	extern "C" void* memset(void* s, int c, size_t n);
+	extern "C" int memcmp(const void* s1, const void* s2, size_t n);
 	extern "C" void* memmove(void* dest, const void* src, size_t n);
 
 	extern "C" size_t strlen(const char* s);
@@ -131,12 +231,38 @@
 	#include <string_view>
 #endif
 
+// for RingBuffer::mirrored() and MappedFile
+#if !ZBUF_FREESTANDING && (defined(__linux__) || defined(__APPLE__) || defined(__unix__))
+	#define ZBUF_HAVE_MMAP 1
+
+	#include <errno.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#else
+	#define ZBUF_HAVE_MMAP 0
+#endif
+
+#if ZBUF_USE_SIMD
+	#if defined(__AVX2__) || defined(__SSE2__)
+		#include <immintrin.h>
+	#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+		#include <arm_neon.h>
+	#endif
+#endif
+
+// for zbuf::endian, which is std::endian if there is one (like zst::impl::endian).
+#if !ZBUF_FREESTANDING && (__cplusplus >= 202000L)
+	#include <bit>
+	#define ZBUF_HAVE_STD_ENDIAN 1
+#else
+	#define ZBUF_HAVE_STD_ENDIAN 0
+#endif
+
 #undef ZBUF_DO_EXPAND
 #undef ZBUF_EXPAND
 
-#include <cstdint>
-#include <cstddef>
-
 namespace zbuf
 {
 	namespace detail
@@ -149,8 +275,259 @@ namespace zbuf
 
 		template <bool B, typename T = void>    struct enable_if { };
 		template <typename T>                   struct enable_if<true, T> { using type = T; };
+
+
+		// vectorised searching for str_view. these only look at bytes, so they work for any 8-bit character type.
+		// the widest instruction set that the compiler was told to use is picked (so compile with -mavx2 or
+		// -march=native to get AVX2); anything else gets the scalar loops.
+		namespace search
+		{
+		#if ZBUF_USE_SIMD && defined(__AVX2__)
+			constexpr size_t WIDTH = 32;
+			using vec_t = __m256i;
+			using mask_t = uint32_t;
+			constexpr size_t BITS_PER_BYTE = 1;
+
+			inline vec_t load(const char* p)  { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+			inline vec_t splat(char c)        { return _mm256_set1_epi8(c); }
+			inline mask_t match(vec_t a, vec_t b)
+			{
+				return static_cast<mask_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)));
+			}
+
+			#define ZBUF_HAVE_SIMD_SEARCH 1
+
+		#elif ZBUF_USE_SIMD && defined(__SSE2__)
+			constexpr size_t WIDTH = 16;
+			using vec_t = __m128i;
+			using mask_t = uint32_t;
+			constexpr size_t BITS_PER_BYTE = 1;
+
+			inline vec_t load(const char* p)  { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+			inline vec_t splat(char c)        { return _mm_set1_epi8(c); }
+			inline mask_t match(vec_t a, vec_t b)
+			{
+				return static_cast<mask_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)));
+			}
+
+			#define ZBUF_HAVE_SIMD_SEARCH 1
+
+		#elif ZBUF_USE_SIMD && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+			constexpr size_t WIDTH = 16;
+			using vec_t = uint8x16_t;
+			using mask_t = uint64_t;
+			constexpr size_t BITS_PER_BYTE = 4;
+
+			inline vec_t load(const char* p)  { return vld1q_u8(reinterpret_cast<const uint8_t*>(p)); }
+			inline vec_t splat(char c)        { return vdupq_n_u8(static_cast<uint8_t>(c)); }
+
+			// there's no movemask, so narrow each byte of the comparison to 4 bits, and keep one bit of those.
+			inline mask_t match(vec_t a, vec_t b)
+			{
+				auto nibbles = vshrn_n_u16(vreinterpretq_u16_u8(vceqq_u8(a, b)), 4);
+				return vget_lane_u64(vreinterpret_u64_u8(nibbles), 0) & 0x8888888888888888ull;
+			}
+
+			#define ZBUF_HAVE_SIMD_SEARCH 1
+		#endif
+
+		#if defined(ZBUF_HAVE_SIMD_SEARCH)
+			constexpr size_t MASK_BITS = sizeof(mask_t) * 8;
+
+			inline size_t ctz(uint32_t x) { return static_cast<size_t>(__builtin_ctz(x)); }
+			inline size_t ctz(uint64_t x) { return static_cast<size_t>(__builtin_ctzll(x)); }
+			inline size_t clz(uint32_t x) { return static_cast<size_t>(__builtin_clz(x)); }
+			inline size_t clz(uint64_t x) { return static_cast<size_t>(__builtin_clzll(x)); }
+
+			// the byte offsets of the first and last matches in a (non-zero) mask, and the mask without them.
+			inline size_t first(mask_t m)     { return ctz(m) / BITS_PER_BYTE; }
+			inline size_t last(mask_t m)      { return (MASK_BITS - 1 - clz(m)) / BITS_PER_BYTE; }
+			inline mask_t pop_first(mask_t m) { return m & (m - 1); }
+			inline mask_t pop_last(mask_t m)  { return m & ~(static_cast<mask_t>(1) << (MASK_BITS - 1 - clz(m))); }
+		#endif
+
+			inline size_t find_byte(const char* s, size_t n, char c)
+			{
+				size_t i = 0;
+
+			#if defined(ZBUF_HAVE_SIMD_SEARCH)
+				const auto v = splat(c);
+
+				// four vectors at a time, since the loop overhead is otherwise about as large as the actual work.
+				for(; i + 4 * WIDTH <= n; i += 4 * WIDTH)
+				{
+					auto m0 = match(load(s + i + 0 * WIDTH), v);
+					auto m1 = match(load(s + i + 1 * WIDTH), v);
+					auto m2 = match(load(s + i + 2 * WIDTH), v);
+					auto m3 = match(load(s + i + 3 * WIDTH), v);
+
+					if((m0 | m1 | m2 | m3) != 0)
+					{
+						if(m0 != 0) return i + 0 * WIDTH + first(m0);
+						if(m1 != 0) return i + 1 * WIDTH + first(m1);
+						if(m2 != 0) return i + 2 * WIDTH + first(m2);
+						return i + 3 * WIDTH + first(m3);
+					}
+				}
+
+				for(; i + WIDTH <= n; i += WIDTH)
+				{
+					auto m = match(load(s + i), v);
+					if(m != 0)
+						return i + first(m);
+				}
+			#endif
+
+				for(; i < n; i++)
+				{
+					if(s[i] == c)
+						return i;
+				}
+
+				return static_cast<size_t>(-1);
+			}
+
+			inline size_t rfind_byte(const char* s, size_t n, char c)
+			{
+				size_t i = n;
+
+			#if defined(ZBUF_HAVE_SIMD_SEARCH)
+				for(auto v = splat(c); i >= WIDTH; )
+				{
+					i -= WIDTH;
+
+					auto m = match(load(s + i), v);
+					if(m != 0)
+						return i + last(m);
+				}
+			#endif
+
+				while(i-- > 0)
+				{
+					if(s[i] == c)
+						return i;
+				}
+
+				return static_cast<size_t>(-1);
+			}
+
+			// for substrings, look for the first and last characters of the needle at the same time (which filters out
+			// nearly all false positives), then check the rest of it for each candidate.
+			inline size_t find(const char* s, size_t n, const char* t, size_t m)
+			{
+				if(m > n)       return static_cast<size_t>(-1);
+				else if(m == 0) return 0;
+				else if(m == 1) return find_byte(s, n, t[0]);
+
+				// the number of places where the needle could start.
+				const size_t positions = n - m + 1;
+				size_t i = 0;
+
+			#if defined(ZBUF_HAVE_SIMD_SEARCH)
+				const auto head = splat(t[0]);
+				const auto tail = splat(t[m - 1]);
+
+				for(; i + WIDTH <= positions; i += WIDTH)
+				{
+					for(auto k = match(load(s + i), head) & match(load(s + i + m - 1), tail); k != 0; k = pop_first(k))
+					{
+						auto at = i + first(k);
+						if(memcmp(s + at + 1, t + 1, m - 2) == 0)
+							return at;
+					}
+				}
+			#endif
+
+				for(; i < positions; i++)
+				{
+					if(s[i] == t[0] && s[i + m - 1] == t[m - 1] && memcmp(s + i + 1, t + 1, m - 2) == 0)
+						return i;
+				}
+
+				return static_cast<size_t>(-1);
+			}
+
+			inline size_t rfind(const char* s, size_t n, const char* t, size_t m)
+			{
+				if(m > n)       return static_cast<size_t>(-1);
+				else if(m == 0) return n - 1;
+				else if(m == 1) return rfind_byte(s, n, t[0]);
+
+				size_t i = n - m + 1;
+
+			#if defined(ZBUF_HAVE_SIMD_SEARCH)
+				const auto head = splat(t[0]);
+				const auto tail = splat(t[m - 1]);
+
+				while(i >= WIDTH)
+				{
+					i -= WIDTH;
+					for(auto k = match(load(s + i), head) & match(load(s + i + m - 1), tail); k != 0; k = pop_last(k))
+					{
+						auto at = i + last(k);
+						if(memcmp(s + at + 1, t + 1, m - 2) == 0)
+							return at;
+					}
+				}
+			#endif
+
+				while(i-- > 0)
+				{
+					if(s[i] == t[0] && s[i + m - 1] == t[m - 1] && memcmp(s + i + 1, t + 1, m - 2) == 0)
+						return i;
+				}
+
+				return static_cast<size_t>(-1);
+			}
+
+			// small sets are compared against every character in the set at once; large ones use a lookup table.
+			inline size_t find_first_of(const char* s, size_t n, const char* set, size_t k)
+			{
+				if(k == 0)      return static_cast<size_t>(-1);
+				else if(k == 1) return find_byte(s, n, set[0]);
+
+				size_t i = 0;
+
+			#if defined(ZBUF_HAVE_SIMD_SEARCH)
+				constexpr size_t MAX_SIMD_SET = 16;
+
+				if(k <= MAX_SIMD_SET)
+				{
+					vec_t chars[MAX_SIMD_SET];
+					for(size_t j = 0; j < k; j++)
+						chars[j] = splat(set[j]);
+
+					for(; i + WIDTH <= n; i += WIDTH)
+					{
+						auto v = load(s + i);
+
+						mask_t m = 0;
+						for(size_t j = 0; j < k; j++)
+							m |= match(v, chars[j]);
+
+						if(m != 0)
+							return i + first(m);
+					}
+				}
+			#endif
+
+				bool table[256] = { };
+				for(size_t j = 0; j < k; j++)
+					table[static_cast<uint8_t>(set[j])] = true;
+
+				for(; i < n; i++)
+				{
+					if(table[static_cast<uint8_t>(s[i])])
+						return i;
+				}
+
+				return static_cast<size_t>(-1);
+			}
+		}
 	}
 
+	#undef ZBUF_HAVE_SIMD_SEARCH
+
 	struct Span;
 
 	struct str_view
@@ -198,54 +575,16 @@ namespace zbuf
 
 		inline char operator[] (size_t n) { return this->ptr[n]; }
 
-		inline size_t find(char c) const { return this->find(str_view(&c, 1)); }
-		inline size_t find(str_view sv) const
-		{
-			if(sv.size() > this->size())
-				return -1;
-
-			else if(sv.empty())
-				return 0;
+		inline size_t find(char c) const        { return detail::search::find_byte(this->ptr, this->len, c); }
+		inline size_t find(str_view sv) const   { return detail::search::find(this->ptr, this->len, sv.ptr, sv.len); }
 
-			for(size_t i = 0; i < 1 + this->size() - sv.size(); i++)
-			{
-				if(this->drop(i).take(sv.size()) == sv)
-					return i;
-			}
-
-			return -1;
-		}
-
-		inline size_t rfind(char c) const { return this->rfind(str_view(&c, 1)); }
-		inline size_t rfind(str_view sv) const
-		{
-			if(sv.size() > this->size())
-				return -1;
-
-			else if(sv.empty())
-				return this->size() - 1;
-
-			for(size_t i = 1 + this->size() - sv.size(); i-- > 0;)
-			{
-				if(this->take(1 + i).take_last(sv.size()) == sv)
-					return i;
-			}
-
-			return -1;
-		}
+		// note: rfind() of an empty string returns size() - 1.
+		inline size_t rfind(char c) const       { return detail::search::rfind_byte(this->ptr, this->len, c); }
+		inline size_t rfind(str_view sv) const  { return detail::search::rfind(this->ptr, this->len, sv.ptr, sv.len); }
 
-		inline size_t find_first_of(str_view sv)
+		inline size_t find_first_of(str_view sv) const
 		{
-			for(size_t i = 0; i < this->len; i++)
-			{
-				for(char k : sv)
-				{
-					if(this->ptr[i] == k)
-						return i;
-				}
-			}
-
-			return -1;
+			return detail::search::find_first_of(this->ptr, this->len, sv.ptr, sv.len);
 		}
 
 		inline str_view drop(size_t n) const { return (this->size() >= n ? this->substr(n, this->size() - n) : ""); }
@@ -288,6 +627,171 @@ namespace zbuf
 	inline const char* end(const str_view& sv) { return sv.end(); }
 
 
+	// where a Buffer gets its memory from. a Buffer without an allocator uses new[] and delete[].
+	struct Allocator
+	{
+		virtual void* allocate(size_t size, size_t align) = 0;
+		virtual void deallocate(void* ptr, size_t size) = 0;
+
+		// change the size of the allocation at `ptr` without moving it; returns false if that can't be done.
+		virtual bool resize(void* ptr, size_t old_size, size_t new_size) { (void) ptr; (void) old_size; (void) new_size; return false; }
+
+	protected:
+		~Allocator() = default;
+	};
+
+	// a bump allocator: memory is handed out from large blocks, and only given back all at once, by reset() or
+	// the destructor. deallocate() and resize() only do something for the most recent allocation, which is what
+	// makes a growing Buffer cheap. the blocks come from `backing` (or new[], if it is null).
+	//
+	// an arena can also start with a buffer of your own (eg. on the stack), which is used before any blocks are
+	// allocated. it is not thread-safe, so use one per thread, or one per request.
+	struct Arena : Allocator
+	{
+		inline explicit Arena(size_t block_size = 65536, Allocator* backing = nullptr)
+			: m_blockSize(block_size), m_backing(backing) { }
+
+		inline Arena(void* initial, size_t size, size_t block_size = 65536, Allocator* backing = nullptr)
+			: m_blockSize(block_size), m_backing(backing)
+		{
+			this->m_initial = static_cast<uint8_t*>(initial);
+			this->m_initialSize = size;
+			this->m_cur = this->m_initial;
+			this->m_end = this->m_initial + size;
+		}
+
+		inline ~Arena() { this->free_blocks(nullptr); }
+
+		Arena(const Arena&) = delete;
+		Arena& operator= (const Arena&) = delete;
+
+		inline void* allocate(size_t size, size_t align) override
+		{
+			auto p = this->align_up(this->m_cur, align);
+			if(p == nullptr || p > this->m_end || size > static_cast<size_t>(this->m_end - p))
+			{
+				this->new_block(size + align);
+				p = this->align_up(this->m_cur, align);
+			}
+
+			this->m_last = p;
+			this->m_cur = p + size;
+			this->m_used += size;
+
+			return p;
+		}
+
+		inline void deallocate(void* ptr, size_t size) override
+		{
+			if(ptr != nullptr && ptr == this->m_last && this->m_last + size == this->m_cur)
+			{
+				this->m_cur = this->m_last;
+				this->m_last = nullptr;
+				this->m_used -= size;
+			}
+		}
+
+		inline bool resize(void* ptr, size_t old_size, size_t new_size) override
+		{
+			if(ptr == nullptr || ptr != this->m_last || this->m_last + old_size != this->m_cur)
+				return false;
+
+			if(new_size > static_cast<size_t>(this->m_end - this->m_last))
+				return false;
+
+			this->m_cur = this->m_last + new_size;
+			this->m_used = this->m_used - old_size + new_size;
+			return true;
+		}
+
+		// everything that was allocated is gone after this. the most recent block is kept to be reused
+		// (or the initial buffer, if there was one).
+		inline void reset()
+		{
+			if(this->m_initial != nullptr)
+			{
+				this->free_blocks(nullptr);
+				this->m_cur = this->m_initial;
+				this->m_end = this->m_initial + this->m_initialSize;
+			}
+			else if(this->m_block != nullptr)
+			{
+				this->free_blocks(this->m_block);
+				this->m_cur = reinterpret_cast<uint8_t*>(this->m_block) + BLOCK_HEADER;
+			}
+
+			this->m_last = nullptr;
+			this->m_used = 0;
+		}
+
+		// the number of bytes handed out since the last reset.
+		inline size_t used() const { return this->m_used; }
+
+	private:
+		struct Block
+		{
+			Block* prev;
+			size_t size;
+		};
+
+		static constexpr size_t BLOCK_ALIGN = 16;
+		static constexpr size_t BLOCK_HEADER = (sizeof(Block) + BLOCK_ALIGN - 1) & ~(BLOCK_ALIGN - 1);
+
+		static inline uint8_t* align_up(uint8_t* p, size_t align)
+		{
+			auto x = reinterpret_cast<uintptr_t>(p);
+			return reinterpret_cast<uint8_t*>((x + align - 1) & ~static_cast<uintptr_t>(align - 1));
+		}
+
+		inline void new_block(size_t min_size)
+		{
+			auto size = BLOCK_HEADER + (min_size > this->m_blockSize ? min_size : this->m_blockSize);
+			auto mem = (this->m_backing != nullptr
+				? static_cast<uint8_t*>(this->m_backing->allocate(size, BLOCK_ALIGN))
+				: new uint8_t[size]);
+
+			auto blk = reinterpret_cast<Block*>(mem);
+			blk->prev = this->m_block;
+			blk->size = size;
+
+			this->m_block = blk;
+			this->m_cur = mem + BLOCK_HEADER;
+			this->m_end = mem + size;
+		}
+
+		// frees every block except `keep` (which must be the most recent one, if it isn't null).
+		inline void free_blocks(Block* keep)
+		{
+			auto blk = this->m_block;
+			if(keep != nullptr)
+				blk = keep->prev, keep->prev = nullptr;
+
+			while(blk != nullptr)
+			{
+				auto prev = blk->prev;
+				if(this->m_backing != nullptr)  this->m_backing->deallocate(blk, blk->size);
+				else                            delete[] reinterpret_cast<uint8_t*>(blk);
+
+				blk = prev;
+			}
+
+			this->m_block = keep;
+		}
+
+		size_t m_blockSize;
+		Allocator* m_backing;
+
+		Block* m_block = nullptr;
+		uint8_t* m_cur = nullptr;
+		uint8_t* m_end = nullptr;
+		uint8_t* m_last = nullptr;
+		size_t m_used = 0;
+
+		uint8_t* m_initial = nullptr;
+		size_t m_initialSize = 0;
+	};
+
+
 	struct Buffer
 	{
 		Buffer(const Buffer&) = delete;
@@ -300,12 +804,13 @@ namespace zbuf
 
 		inline ~Buffer()
 		{
-			if(this->ptr)
-				delete[] this->ptr;
+			this->deallocate(this->ptr, this->cap);
 		}
 
-		inline explicit Buffer(size_t cap) : len(0), cap(cap), ptr(new uint8_t[cap])
+		// if `allocator` is given, all the memory of the buffer comes from it (so it must outlive the buffer).
+		inline explicit Buffer(size_t cap, Allocator* allocator = nullptr) : len(0), cap(cap), alloc(allocator)
 		{
+			this->ptr = this->allocate(cap);
 			this->originalCap = cap;
 		}
 
@@ -314,6 +819,7 @@ namespace zbuf
 			this->ptr = oth.ptr;    oth.ptr = nullptr;
 			this->len = oth.len;    oth.len = 0;
 			this->cap = oth.cap;    oth.cap = 0;
+			this->alloc = oth.alloc;
 			this->originalCap = oth.originalCap;
 		}
 
@@ -322,12 +828,12 @@ namespace zbuf
 			if(this == &oth)
 				return *this;
 
-			if(this->ptr)
-				delete[] this->ptr;
+			this->deallocate(this->ptr, this->cap);
 
 			this->ptr = oth.ptr;    oth.ptr = nullptr;
 			this->len = oth.len;    oth.len = 0;
 			this->cap = oth.cap;    oth.cap = 0;
+			this->alloc = oth.alloc;
 			this->originalCap = oth.originalCap;
 
 			return *this;
@@ -348,14 +854,17 @@ namespace zbuf
 		inline Span span() const;
 		inline str_view sv() const { return str_view(reinterpret_cast<const char*>(this->ptr), this->len); }
 
+		// the clone uses the same allocator.
 		inline Buffer clone() const
 		{
-			auto ret = Buffer(this->cap);
+			auto ret = Buffer(this->cap, this->alloc);
 			ret.write(this->ptr, this->len);
 
 			return ret;
 		}
 
+		inline Allocator* allocator() const { return this->alloc; }
+
 		inline uint8_t* data()             { return this->ptr; }
 		inline const uint8_t* data() const { return this->ptr; }
 
@@ -385,10 +894,10 @@ namespace zbuf
 		{
 			if(this->cap != this->originalCap)
 			{
-				delete[] this->ptr;
+				this->deallocate(this->ptr, this->cap);
 				this->cap = this->originalCap;
 				this->len = 0;
-				this->ptr = new uint8_t[this->cap];
+				this->ptr = this->allocate(this->cap);
 			}
 			else
 			{
@@ -406,6 +915,7 @@ namespace zbuf
 			else if(n > 0)
 			{
 				memmove(this->ptr, this->ptr + n, this->len - n);
+				this->len -= n;
 			}
 
 			return *this;
@@ -430,8 +940,9 @@ namespace zbuf
 		inline void autoWrite(const Buffer& b) { return this->autoWrite(b.data(), b.size());}
 		inline void autoWrite(const void* data, size_t len)
 		{
+			// grow by at least half, so that lots of small writes don't reallocate every time.
 			if(this->remaining() < len)
-				this->grow(len - this->remaining());
+				this->grow(len - this->remaining() > this->cap / 2 ? len - this->remaining() : this->cap / 2);
 
 			this->write(data, len);
 		}
@@ -455,11 +966,18 @@ namespace zbuf
 			if(sz < this->cap)
 				return;
 
-			auto tmp = new uint8_t[sz];
+			// an arena can usually just extend the last allocation.
+			if(this->alloc != nullptr && this->ptr != nullptr && this->alloc->resize(this->ptr, this->cap, sz))
+			{
+				this->cap = sz;
+				return;
+			}
+
+			auto tmp = this->allocate(sz);
 			if(this->ptr)
 			{
 				memmove(tmp, this->ptr, this->len);
-				delete[] this->ptr;
+				this->deallocate(this->ptr, this->cap);
 			}
 
 			this->ptr = tmp;
@@ -490,9 +1008,27 @@ namespace zbuf
 
 
 	private:
+		inline uint8_t* allocate(size_t n)
+		{
+			if(this->alloc != nullptr)
+				return static_cast<uint8_t*>(this->alloc->allocate(n, 1));
+
+			return new uint8_t[n];
+		}
+
+		inline void deallocate(uint8_t* p, size_t n)
+		{
+			if(p == nullptr)
+				return;
+
+			if(this->alloc != nullptr)  this->alloc->deallocate(p, n);
+			else                        delete[] p;
+		}
+
 		size_t len;
 		size_t cap;
 		uint8_t* ptr;
+		Allocator* alloc = nullptr;
 
 		size_t originalCap;
 	};
@@ -525,7 +1061,7 @@ namespace zbuf
 		inline Span drop(size_t n) const { auto copy = *this; return copy.remove_prefix(n); }
 		inline Span take(size_t n) const { auto copy = *this; return copy.remove_suffix(this->len > n ? this->len - n : 0); }
 
-		inline Span take_last(size_t n) const { return (this->size() >= n ? Span(this->ptr + n, this->size() - n) : *this); }
+		inline Span take_last(size_t n) const { return (this->size() >= n ? Span(this->ptr + this->size() - n, n) : *this); }
 		inline Span drop_last(size_t n) const { return (this->size() >= n ? Span(this->ptr, this->size() - n) : *this); }
 
 		template <typename T>
@@ -571,4 +1107,896 @@ namespace zbuf
 	{
 		return Span(this->data(), this->size());
 	}
-}
+
+
+
+	// iterates over the parts of a str_view that are separated by `delim`, without copying anything; each one is a
+	// str_view into the original. a delimiter at the very end doesn't make an empty record after it (so "a\nb\n" is
+	// two lines, just like "a\nb"), but two delimiters in a row do make one in between. the searching is done with
+	// str_view::find(), so it is vectorised.
+	struct Records
+	{
+		struct iterator
+		{
+			inline str_view operator* () const { return this->cur; }
+			inline const str_view* operator-> () const { return &this->cur; }
+
+			inline iterator& operator++ () { this->advance(); return *this; }
+			inline iterator operator++ (int) { auto copy = *this; this->advance(); return copy; }
+
+			inline bool operator== (const iterator& other) const
+			{
+				return this->done == other.done && (this->done || this->cur.data() == other.cur.data());
+			}
+
+			inline bool operator!= (const iterator& other) const { return !(*this == other); }
+
+		private:
+			friend struct Records;
+			inline iterator() : done(true) { }
+			inline iterator(str_view s, str_view d, bool cr) : rest(s), delim(d), strip_cr(cr), done(false)
+			{
+				this->advance();
+			}
+
+			inline void advance()
+			{
+				if(this->rest.empty())
+				{
+					this->done = true;
+					return;
+				}
+
+				auto i = (this->delim.empty() ? static_cast<size_t>(-1) : this->rest.find(this->delim));
+				if(i == static_cast<size_t>(-1))
+				{
+					this->cur = this->rest;
+					this->rest = this->rest.drop(this->rest.size());
+				}
+				else
+				{
+					this->cur = this->rest.take(i);
+					this->rest = this->rest.drop(i + this->delim.size());
+				}
+
+				if(this->strip_cr && !this->cur.empty() && this->cur.back() == '\r')
+					this->cur = this->cur.drop_last(1);
+			}
+
+			str_view rest;
+			str_view cur;
+			str_view delim;
+			bool strip_cr = false;
+			bool done = true;
+		};
+
+		inline Records(str_view s, str_view d, bool cr = false) : sv(s), delim(d), strip_cr(cr) { }
+
+		inline iterator begin() const { return iterator(this->sv, this->delim, this->strip_cr); }
+		inline iterator end() const { return iterator(); }
+
+	private:
+		str_view sv;
+		str_view delim;
+		bool strip_cr;
+	};
+
+	inline Records records(str_view sv, str_view delim) { return Records(sv, delim); }
+
+	// lines are split on '\n', and a '\r' before it is left out too.
+	inline Records lines(str_view sv) { return Records(sv, "\n", /* strip_cr: */ true); }
+
+
+
+	// the same as zst::impl::endian (so with c++20, both are std::endian and can be used interchangeably; but not
+	// with ZBUF_FREESTANDING, which can't include <bit>).
+#if ZBUF_HAVE_STD_ENDIAN
+	using endian = std::endian;
+#else
+	enum class endian
+	{
+	#if defined(_WIN32)
+		little = 0,
+		big    = 1,
+		native = little,
+	#else
+		little = __ORDER_LITTLE_ENDIAN__,
+		big    = __ORDER_BIG_ENDIAN__,
+		native = __BYTE_ORDER__,
+	#endif
+	};
+#endif
+
+	namespace detail
+	{
+		inline uint8_t bswap(uint8_t x) { return x; }
+
+	#if defined(__GNUC__) || defined(__clang__)
+		inline uint16_t bswap(uint16_t x) { return __builtin_bswap16(x); }
+		inline uint32_t bswap(uint32_t x) { return __builtin_bswap32(x); }
+		inline uint64_t bswap(uint64_t x) { return __builtin_bswap64(x); }
+	#else
+		inline uint16_t bswap(uint16_t x) { return static_cast<uint16_t>((x << 8) | (x >> 8)); }
+		inline uint32_t bswap(uint32_t x) { return (bswap(static_cast<uint16_t>(x)) * 0x10000u) | bswap(static_cast<uint16_t>(x >> 16)); }
+		inline uint64_t bswap(uint64_t x) { return (static_cast<uint64_t>(bswap(static_cast<uint32_t>(x))) << 32) | bswap(static_cast<uint32_t>(x >> 32)); }
+	#endif
+
+		// the unsigned integer with the same size as T, which is what the bytes of a T are moved around as.
+		template <size_t N> struct uint_of_size { };
+		template <> struct uint_of_size<1> { using type = uint8_t; };
+		template <> struct uint_of_size<2> { using type = uint16_t; };
+		template <> struct uint_of_size<4> { using type = uint32_t; };
+		template <> struct uint_of_size<8> { using type = uint64_t; };
+
+		// just enough of <type_traits> for Writer and Reader, since it isn't there with ZBUF_FREESTANDING. the
+		// enum and trivially-copyable checks use the compiler builtins, which gcc, clang and msvc all have.
+		template <typename T> struct remove_cv                    { using type = T; };
+		template <typename T> struct remove_cv<const T>           { using type = T; };
+		template <typename T> struct remove_cv<volatile T>        { using type = T; };
+		template <typename T> struct remove_cv<const volatile T>  { using type = T; };
+
+		template <typename T> struct is_integral_impl { static constexpr bool value = false; };
+		template <> struct is_integral_impl<bool>                 { static constexpr bool value = true; };
+		template <> struct is_integral_impl<char>                 { static constexpr bool value = true; };
+		template <> struct is_integral_impl<signed char>          { static constexpr bool value = true; };
+		template <> struct is_integral_impl<unsigned char>        { static constexpr bool value = true; };
+		template <> struct is_integral_impl<wchar_t>              { static constexpr bool value = true; };
+		template <> struct is_integral_impl<char16_t>             { static constexpr bool value = true; };
+		template <> struct is_integral_impl<char32_t>             { static constexpr bool value = true; };
+		template <> struct is_integral_impl<short>                { static constexpr bool value = true; };
+		template <> struct is_integral_impl<unsigned short>       { static constexpr bool value = true; };
+		template <> struct is_integral_impl<int>                  { static constexpr bool value = true; };
+		template <> struct is_integral_impl<unsigned int>         { static constexpr bool value = true; };
+		template <> struct is_integral_impl<long>                 { static constexpr bool value = true; };
+		template <> struct is_integral_impl<unsigned long>        { static constexpr bool value = true; };
+		template <> struct is_integral_impl<long long>            { static constexpr bool value = true; };
+		template <> struct is_integral_impl<unsigned long long>   { static constexpr bool value = true; };
+	#if defined(__cpp_char8_t)
+		template <> struct is_integral_impl<char8_t>              { static constexpr bool value = true; };
+	#endif
+
+		template <typename T> struct is_floating_impl { static constexpr bool value = false; };
+		template <> struct is_floating_impl<float>                { static constexpr bool value = true; };
+		template <> struct is_floating_impl<double>               { static constexpr bool value = true; };
+		template <> struct is_floating_impl<long double>          { static constexpr bool value = true; };
+
+		template <typename T>
+		constexpr bool is_integral = is_integral_impl<typename remove_cv<T>::type>::value;
+
+		template <typename T>
+		constexpr bool is_floating_point = is_floating_impl<typename remove_cv<T>::type>::value;
+
+		template <typename T>
+		constexpr bool is_enum = __is_enum(T);
+
+		template <typename T>
+		constexpr bool is_trivially_copyable = __is_trivially_copyable(T);
+
+		// integers other than bool, which is all that varints can be.
+		template <typename T>
+		constexpr bool is_varint = is_integral<T> && !is_same<typename remove_cv<T>::type, bool>::value;
+
+		// only for integers; the unsigned integer of the same size has the same bits.
+		template <typename T>
+		constexpr bool is_signed = static_cast<T>(-1) < static_cast<T>(0);
+
+		template <typename T>
+		using make_unsigned = typename uint_of_size<sizeof(T)>::type;
+
+		template <typename T>
+		constexpr bool is_fixed_width = (is_integral<T> || is_floating_point<T> || is_enum<T>)
+			&& !is_same<typename remove_cv<T>::type, bool>::value
+			&& (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8);
+
+		// stores a T as `sizeof(T)` bytes in the given byte order, and back.
+		template <endian E, typename T>
+		inline void store(uint8_t* dst, T x)
+		{
+			typename uint_of_size<sizeof(T)>::type bits;
+			memmove(&bits, &x, sizeof(T));
+
+			if constexpr (E != endian::native)
+				bits = bswap(bits);
+
+			memmove(dst, &bits, sizeof(T));
+		}
+
+		template <endian E, typename T>
+		inline T load(const uint8_t* src)
+		{
+			typename uint_of_size<sizeof(T)>::type bits;
+			memmove(&bits, src, sizeof(T));
+
+			if constexpr (E != endian::native)
+				bits = bswap(bits);
+
+			T ret;
+			memmove(&ret, &bits, sizeof(T));
+			return ret;
+		}
+
+		// signed varints are zigzag-encoded, so that small negative numbers are small too.
+		template <typename T>
+		inline auto zigzag(T x)
+		{
+			using U = make_unsigned<T>;
+			if constexpr (is_signed<T>)
+				return static_cast<U>((static_cast<U>(x) << 1) ^ static_cast<U>(x < 0 ? -1 : 0));
+			else
+				return x;
+		}
+
+		template <typename T>
+		inline T unzigzag(make_unsigned<T> x)
+		{
+			if constexpr (is_signed<T>)
+				return static_cast<T>((x >> 1) ^ (0 - (x & 1)));
+			else
+				return x;
+		}
+	}
+
+	// the most bytes that a varint of type T can take.
+	template <typename T>
+	constexpr size_t maxVarintSize() { return (sizeof(T) * 8 + 6) / 7; }
+
+	// the number of bytes that writeVarint(x) writes, for working out the size of a message beforehand.
+	template <typename T>
+	inline size_t varintSize(T x)
+	{
+		static_assert(detail::is_varint<T>, "varints must be integers");
+
+		auto u = detail::zigzag(x);
+
+		size_t n = 1;
+		while(u >= 0x80)
+			u >>= 7, n++;
+
+		return n;
+	}
+
+
+	// writes binary data to the end of a Buffer. integers, floats and enums are written with a fixed width (in
+	// either byte order; little-endian is the default), or as varints (LEB128, zigzag-encoded if signed). each
+	// write grows the buffer if it's full, but if reserve() is called first with the size of the whole message,
+	// that only happens once.
+	struct Writer
+	{
+		inline explicit Writer(Buffer& buf) : buf(&buf) { }
+
+		// makes sure that `n` more bytes can be written without growing the buffer again.
+		inline void reserve(size_t n)
+		{
+			if(this->buf->remaining() < n)
+				this->buf->grow(n - this->buf->remaining());
+		}
+
+		template <typename T, endian E = endian::little>
+		inline void write(T x)
+		{
+			static_assert(detail::is_fixed_width<T>, "only integers, floats and enums can be written");
+
+			detail::store<E>(this->ensure(sizeof(T)), x);
+			this->buf->incrementSize(sizeof(T));
+		}
+
+		template <typename T>
+		inline void writeVarint(T x)
+		{
+			static_assert(detail::is_varint<T>, "varints must be integers");
+
+			auto u = detail::zigzag(x);
+			auto dst = this->ensure(maxVarintSize<T>());
+
+			size_t n = 0;
+			while(u >= 0x80)
+			{
+				dst[n++] = static_cast<uint8_t>(u | 0x80);
+				u >>= 7;
+			}
+
+			dst[n++] = static_cast<uint8_t>(u);
+			this->buf->incrementSize(n);
+		}
+
+		// an array of fixed-width values. in the native byte order, this is a single copy.
+		template <typename T, endian E = endian::little>
+		inline void writeArray(const T* xs, size_t count)
+		{
+			static_assert(detail::is_trivially_copyable<T>, "arrays must be trivially copyable");
+
+			auto dst = this->ensure(count * sizeof(T));
+			if constexpr (E == endian::native || sizeof(T) == 1 || !detail::is_fixed_width<T>)
+			{
+				memmove(dst, xs, count * sizeof(T));
+			}
+			else
+			{
+				for(size_t i = 0; i < count; i++)
+					detail::store<E>(dst + i * sizeof(T), xs[i]);
+			}
+
+			this->buf->incrementSize(count * sizeof(T));
+		}
+
+		inline void writeBytes(const void* data, size_t len)
+		{
+			memmove(this->ensure(len), data, len);
+			this->buf->incrementSize(len);
+		}
+
+		inline void writeBytes(Span s)      { this->writeBytes(s.data(), s.size()); }
+		inline void writeBytes(str_view s)  { this->writeBytes(s.data(), s.size()); }
+
+		inline Buffer& buffer() { return *this->buf; }
+		inline size_t size() const { return this->buf->size(); }
+
+	private:
+		// returns where the next `n` bytes go, growing the buffer (by at least half, like autoWrite()) if needed.
+		inline uint8_t* ensure(size_t n)
+		{
+			if(this->buf->remaining() < n)
+			{
+				auto cap = this->buf->size() + this->buf->remaining();
+				auto need = n - this->buf->remaining();
+				this->buf->grow(need > cap / 2 ? need : cap / 2);
+			}
+
+			return this->buf->data() + this->buf->size();
+		}
+
+		Buffer* buf;
+	};
+
+	// reads binary data written by a Writer from a Span. reading past the end doesn't crash, but gives zeros (or an
+	// empty span), and marks the reader as failed -- so a whole message can be read, and then checked once.
+	struct Reader
+	{
+		inline explicit Reader(Span s) : cur(s.data()), end(s.data() + s.size()) { }
+
+		inline bool ok() const          { return !this->fail; }
+		inline bool failed() const      { return this->fail; }
+		inline bool empty() const       { return this->cur == this->end; }
+		inline size_t remaining() const { return static_cast<size_t>(this->end - this->cur); }
+
+		// what hasn't been read yet.
+		inline Span rest() const        { return Span(this->cur, this->remaining()); }
+
+		template <typename T, endian E = endian::little>
+		inline T read()
+		{
+			static_assert(detail::is_fixed_width<T>, "only integers, floats and enums can be read");
+
+			if(!this->take(sizeof(T)))
+				return T();
+
+			return detail::load<E, T>(this->cur - sizeof(T));
+		}
+
+		template <typename T>
+		inline T readVarint()
+		{
+			static_assert(detail::is_varint<T>, "varints must be integers");
+			using U = detail::make_unsigned<T>;
+
+			constexpr size_t max_size = maxVarintSize<T>();
+
+			// if there's enough left for the longest possible varint, there's no need to check for the end.
+			auto limit = (this->remaining() >= max_size ? max_size : this->remaining());
+
+			U ret = 0;
+			for(size_t i = 0; i < limit; i++)
+			{
+				auto b = this->cur[i];
+				ret |= static_cast<U>(static_cast<U>(b & 0x7F) << (7 * i));
+
+				if((b & 0x80) == 0)
+				{
+					this->cur += i + 1;
+					return detail::unzigzag<T>(ret);
+				}
+			}
+
+			// too long, or it ran off the end.
+			this->cur = this->end;
+			this->fail = true;
+			return T();
+		}
+
+		template <typename T, endian E = endian::little>
+		inline bool readArray(T* out, size_t count)
+		{
+			static_assert(detail::is_trivially_copyable<T>, "arrays must be trivially copyable");
+
+			// (the division is so that a huge count can't overflow.)
+			if(count > this->remaining() / sizeof(T))
+				return this->take(this->remaining() + 1);
+
+			auto src = this->cur;
+			this->cur += count * sizeof(T);
+
+			if constexpr (E == endian::native || sizeof(T) == 1 || !detail::is_fixed_width<T>)
+			{
+				memmove(out, src, count * sizeof(T));
+			}
+			else
+			{
+				for(size_t i = 0; i < count; i++)
+					out[i] = detail::load<E, T>(src + i * sizeof(T));
+			}
+
+			return true;
+		}
+
+		// the next `n` bytes, without copying them.
+		inline Span readBytes(size_t n)
+		{
+			if(!this->take(n))
+				return Span(this->cur, 0);
+
+			return Span(this->cur - n, n);
+		}
+
+		inline void skip(size_t n) { this->take(n); }
+
+	private:
+		inline bool take(size_t n)
+		{
+			if(this->remaining() < n)
+			{
+				this->cur = this->end;
+				this->fail = true;
+				return false;
+			}
+
+			this->cur += n;
+			return true;
+		}
+
+		const uint8_t* cur;
+		const uint8_t* end;
+		bool fail = false;
+	};
+
+
+
+	// a fixed-size circular buffer: bytes are written at the back and consumed from the front, and consume()
+	// just moves an index (unlike Buffer::drop(), which moves the data). the capacity is rounded up to a power
+	// of two. since the data can wrap around the end, what can be read (or written) is given as two parts, the
+	// second of which is empty if it doesn't wrap -- these map directly onto iovecs for readv/writev.
+	//
+	// a mirrored ring buffer maps the same memory twice, back-to-back, so that the data never *looks* like it
+	// wraps around: the first part is always everything, and the second is always empty.
+	struct RingBuffer
+	{
+		// a writable region of the buffer.
+		struct Region
+		{
+			inline Region(uint8_t* p, size_t l) : ptr(p), len(l) { }
+
+			inline uint8_t* data() const { return this->ptr; }
+			inline size_t size() const { return this->len; }
+
+		private:
+			uint8_t* ptr;
+			size_t len;
+		};
+
+		template <typename T>
+		struct Parts
+		{
+			T first;
+			T second;
+
+			inline size_t size() const { return this->first.size() + this->second.size(); }
+		};
+
+		RingBuffer(const RingBuffer&) = delete;
+		RingBuffer& operator= (const RingBuffer&) = delete;
+
+		inline explicit RingBuffer(size_t capacity, Allocator* allocator = nullptr) : alloc(allocator)
+		{
+			this->cap = round_up_pow2(capacity);
+			this->ptr = (allocator != nullptr
+				? static_cast<uint8_t*>(allocator->allocate(this->cap, 1))
+				: new uint8_t[this->cap]);
+		}
+
+		inline RingBuffer(RingBuffer&& oth) : ptr(oth.ptr), cap(oth.cap), head(oth.head), tail(oth.tail),
+			alloc(oth.alloc), mirror(oth.mirror)
+		{
+			oth.ptr = nullptr;
+			oth.cap = 0;
+			oth.head = 0;
+			oth.tail = 0;
+		}
+
+		inline RingBuffer& operator= (RingBuffer&& oth)
+		{
+			if(this == &oth)
+				return *this;
+
+			this->release();
+
+			this->ptr = oth.ptr;        oth.ptr = nullptr;
+			this->cap = oth.cap;        oth.cap = 0;
+			this->head = oth.head;      oth.head = 0;
+			this->tail = oth.tail;      oth.tail = 0;
+			this->alloc = oth.alloc;
+			this->mirror = oth.mirror;
+
+			return *this;
+		}
+
+		inline ~RingBuffer()
+		{
+			this->release();
+		}
+
+		// the capacity is rounded up to a multiple of the page size. if the memory can't be mapped (or there is
+		// no mmap), you get a normal RingBuffer instead; check isMirrored() if it matters.
+		static inline RingBuffer mirrored(size_t capacity);
+
+
+		inline size_t size() const          { return this->tail - this->head; }
+		inline size_t capacity() const      { return this->cap; }
+		inline size_t remaining() const     { return this->cap - this->size(); }
+
+		inline bool empty() const           { return this->head == this->tail; }
+		inline bool full() const            { return this->size() == this->cap; }
+		inline bool isMirrored() const      { return this->mirror; }
+
+		// the data that can be read, and the free space that can be written to (call commit() afterwards).
+		inline Parts<Span> readable() const
+		{
+			auto ofs = this->head & (this->cap - 1);
+			auto n = this->size();
+
+			if(this->mirror || ofs + n <= this->cap)
+				return { Span(this->ptr + ofs, n), Span(this->ptr, 0) };
+
+			return { Span(this->ptr + ofs, this->cap - ofs), Span(this->ptr, n - (this->cap - ofs)) };
+		}
+
+		inline Parts<Region> writable()
+		{
+			auto ofs = this->tail & (this->cap - 1);
+			auto n = this->remaining();
+
+			if(this->mirror || ofs + n <= this->cap)
+				return { Region(this->ptr + ofs, n), Region(this->ptr, 0) };
+
+			return { Region(this->ptr + ofs, this->cap - ofs), Region(this->ptr, n - (this->cap - ofs)) };
+		}
+
+		// the first `n` bytes that were written to writable() are now part of the data.
+		inline void commit(size_t n)
+		{
+			this->tail += detail::min(n, this->remaining());
+		}
+
+		// throws away the first `n` bytes of the data. this is O(1).
+		inline void consume(size_t n)
+		{
+			this->head += detail::min(n, this->size());
+		}
+
+		inline void clear()
+		{
+			this->head = 0;
+			this->tail = 0;
+		}
+
+		// returns how many bytes were written, which is less than `len` if the buffer got full.
+		inline size_t write(const void* data, size_t len)
+		{
+			auto w = this->writable();
+			auto src = static_cast<const uint8_t*>(data);
+
+			auto a = detail::min(len, w.first.size());
+			auto b = detail::min(len - a, w.second.size());
+
+			memmove(w.first.data(), src, a);
+			memmove(w.second.data(), src + a, b);
+
+			this->tail += a + b;
+			return a + b;
+		}
+
+		inline size_t write(Span s)     { return this->write(s.data(), s.size()); }
+		inline size_t write(str_view s) { return this->write(s.data(), s.size()); }
+
+		// copies out (and consumes) up to `len` bytes; returns how many.
+		inline size_t read(void* out, size_t len)
+		{
+			auto r = this->readable();
+			auto dst = static_cast<uint8_t*>(out);
+
+			auto a = detail::min(len, r.first.size());
+			auto b = detail::min(len - a, r.second.size());
+
+			memmove(dst, r.first.data(), a);
+			memmove(dst + a, r.second.data(), b);
+
+			this->head += a + b;
+			return a + b;
+		}
+
+	private:
+		inline RingBuffer() { }
+
+		static inline size_t round_up_pow2(size_t x)
+		{
+			size_t ret = 1;
+			while(ret < x)
+				ret <<= 1;
+
+			return ret;
+		}
+
+		inline void release()
+		{
+			if(this->ptr == nullptr)
+				return;
+
+		#if ZBUF_HAVE_MMAP
+			if(this->mirror)
+			{
+				munmap(this->ptr, 2 * this->cap);
+				this->ptr = nullptr;
+				return;
+			}
+		#endif
+
+			if(this->alloc != nullptr)  this->alloc->deallocate(this->ptr, this->cap);
+			else                        delete[] this->ptr;
+
+			this->ptr = nullptr;
+		}
+
+		uint8_t* ptr = nullptr;
+		size_t cap = 0;
+
+		// these only ever increase (and wrap around at SIZE_MAX, which is fine since the capacity is a power of 2).
+		size_t head = 0;
+		size_t tail = 0;
+
+		Allocator* alloc = nullptr;
+		bool mirror = false;
+	};
+
+	inline RingBuffer RingBuffer::mirrored(size_t capacity)
+	{
+	#if ZBUF_HAVE_MMAP
+		auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		auto size = round_up_pow2(capacity < page ? page : capacity);
+
+		// get some memory that isn't backed by a file, which we can map twice.
+		int fd = -1;
+	#if defined(__linux__)
+		fd = memfd_create("zbuf-ring", 0);
+	#else
+		char name[64] = "/zbuf-ring-";
+		auto pid = static_cast<unsigned long>(getpid());
+		auto addr = reinterpret_cast<uintptr_t>(&name);
+		for(size_t i = 0; i < 16; i++)
+			name[11 + i] = "0123456789abcdef"[((i < 8 ? pid : addr) >> (4 * (i % 8))) & 0xf];
+
+		if(fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600); fd >= 0)
+			shm_unlink(name);
+	#endif
+
+		if(fd >= 0 && ftruncate(fd, static_cast<off_t>(size)) == 0)
+		{
+			// reserve twice the space, then put the same memory in both halves.
+			auto base = static_cast<uint8_t*>(mmap(nullptr, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANON, -1, 0));
+			if(base != MAP_FAILED)
+			{
+				auto a = mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+				auto b = mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+
+				if(a != MAP_FAILED && b != MAP_FAILED)
+				{
+					close(fd);
+
+					auto ret = RingBuffer();
+					ret.ptr = base;
+					ret.cap = size;
+					ret.mirror = true;
+					return ret;
+				}
+
+				munmap(base, 2 * size);
+			}
+		}
+
+		if(fd >= 0)
+			close(fd);
+	#endif
+
+		return RingBuffer(capacity);
+	}
+
+
+
+#if ZBUF_HAVE_MMAP
+	// a file mapped into memory, read-only; span() and sv() are views straight into the mapping (so they are only
+	// valid while the MappedFile is alive), and nothing is copied or read until it is touched. if the file can't be
+	// opened or mapped, you get a MappedFile that isn't open, and error() has the errno. (an empty file is open,
+	// but has no data, since an empty mapping isn't allowed.)
+	struct MappedFile
+	{
+		struct Options
+		{
+			// MADV_SEQUENTIAL: the kernel reads ahead more aggressively, and can drop pages once they've been read.
+			bool sequential = false;
+
+			// MADV_HUGEPAGE (only on linux): fewer TLB misses for very big files, if the filesystem supports it.
+			bool hugepages = false;
+
+			// MADV_WILLNEED: start reading the whole file in the background now, instead of faulting each page in
+			// when it is touched. use prefetch() to do this for only a part of the file.
+			bool prefetch = false;
+		};
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator= (const MappedFile&) = delete;
+
+		inline MappedFile() { }
+
+		inline MappedFile(MappedFile&& oth) : ptr(oth.ptr), len(oth.len), err(oth.err), valid(oth.valid)
+		{
+			oth.ptr = nullptr;
+			oth.len = 0;
+			oth.valid = false;
+		}
+
+		inline MappedFile& operator= (MappedFile&& oth)
+		{
+			if(this == &oth)
+				return *this;
+
+			this->release();
+
+			this->ptr = oth.ptr;        oth.ptr = nullptr;
+			this->len = oth.len;        oth.len = 0;
+			this->valid = oth.valid;    oth.valid = false;
+			this->err = oth.err;
+
+			return *this;
+		}
+
+		inline ~MappedFile()
+		{
+			this->release();
+		}
+
+		// (these can't have a default argument for opts, since Options isn't complete yet.)
+		static inline MappedFile map(const char* path, const Options& opts);
+		static inline MappedFile map(const char* path);
+
+	#if ZBUF_USE_STD
+		static inline MappedFile map(const std::string& path, const Options& opts) { return map(path.c_str(), opts); }
+		static inline MappedFile map(const std::string& path) { return map(path.c_str()); }
+	#endif // ZBUF_USE_STD
+
+		inline bool isOpen() const          { return this->valid; }
+		inline int error() const            { return this->err; }
+
+		inline size_t size() const          { return this->len; }
+		inline bool empty() const           { return this->len == 0; }
+		inline const uint8_t* data() const  { return this->ptr; }
+
+		inline Span span() const            { return Span(this->ptr, this->len); }
+		inline str_view sv() const          { return str_view(reinterpret_cast<const char*>(this->ptr), this->len); }
+
+		inline Records lines() const                { return zbuf::lines(this->sv()); }
+		inline Records records(str_view delim) const { return zbuf::records(this->sv(), delim); }
+
+		// start reading `n` bytes at `offset` in the background (MADV_WILLNEED), eg. the next chunk of a file
+		// that is being processed in pieces.
+		inline void prefetch(size_t offset, size_t n) const
+		{
+			if(offset >= this->len)
+				return;
+
+			this->advise(offset, detail::min(n, this->len - offset), MADV_WILLNEED);
+		}
+
+	private:
+		inline void advise(size_t offset, size_t n, int advice) const
+		{
+			// madvise() wants a page-aligned address (which the start of the mapping is).
+			auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+			auto start = offset & ~(page - 1);
+
+			madvise(const_cast<uint8_t*>(this->ptr) + start, n + (offset - start), advice);
+		}
+
+		inline void release()
+		{
+			if(this->ptr != nullptr)
+				munmap(const_cast<uint8_t*>(this->ptr), this->len);
+
+			this->ptr = nullptr;
+			this->len = 0;
+			this->valid = false;
+		}
+
+		const uint8_t* ptr = nullptr;
+		size_t len = 0;
+		int err = 0;
+		bool valid = false;
+	};
+
+	inline MappedFile MappedFile::map(const char* path)
+	{
+		return map(path, Options());
+	}
+
+	inline MappedFile MappedFile::map(const char* path, const Options& opts)
+	{
+		auto ret = MappedFile();
+
+		int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+		if(fd < 0)
+		{
+			ret.err = errno;
+			return ret;
+		}
+
+		struct stat st;
+		if(fstat(fd, &st) != 0)
+		{
+			ret.err = errno;
+			close(fd);
+			return ret;
+		}
+
+		if(static_cast<unsigned long long>(st.st_size) > static_cast<size_t>(-1))
+		{
+			ret.err = EFBIG;
+			close(fd);
+			return ret;
+		}
+
+		auto size = static_cast<size_t>(st.st_size);
+		if(size > 0)
+		{
+			auto p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(p == MAP_FAILED)
+			{
+				ret.err = errno;
+				close(fd);
+				return ret;
+			}
+
+			ret.ptr = static_cast<const uint8_t*>(p);
+			ret.len = size;
+		}
+
+		// the mapping keeps the file alive by itself.
+		close(fd);
+		ret.valid = true;
+
+		if(size > 0)
+		{
+			if(opts.sequential)
+				ret.advise(0, size, MADV_SEQUENTIAL);
+
+		#if defined(MADV_HUGEPAGE)
+			if(opts.hugepages)
+				ret.advise(0, size, MADV_HUGEPAGE);
+		#endif
+
+			if(opts.prefetch)
+				ret.advise(0, size, MADV_WILLNEED);
+		}
+
+		return ret;
+	}
+#endif // ZBUF_HAVE_MMAP
+}
+
+#undef ZBUF_HAVE_MMAP
+#undef ZBUF_HAVE_STD_ENDIAN
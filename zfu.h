@@ -18,6 +18,13 @@
 /*
 	Version History
 	---------------
+	0.2.0 - 14/10/2026
+	- add lazy(), for fused chains of map, filter, flatmap, take, drop (and friends) without intermediate vectors
+	- add zfu::par::map, filter, reduce and sort, which run on a zmt::ThreadPool
+	- add overloads of the vector operators for temporaries, which reuse them instead of copying
+	- vectorOf() no longer builds (and copies) a vector per argument
+	- add zfu::gen::powerset, combinations and permutations, which make one result at a time, and can be partitioned
+
 	0.1.0 - 19/07/2020
 	Initial release.
 
@@ -25,16 +32,48 @@
 	Documentation
 	-------------
 	The functions should be mostly self-explanatory. But... you probably don't want to use this library.
+
+	Everything here is eager, and makes a new vector at every step. For a chain of them, use the lazy versions instead:
+	`zfu::lazy(xs).filter(...).map(...).toVector()` goes over `xs` once, without any vectors in between.
+
+	powerset, combinations and permutations make every result up front; zfu::gen has versions of them that make one
+	result at a time instead (and can be split up, to go through the results in parallel).
+
+	zfu::par has parallel versions of map, filter, reduce and sort, which split the input into chunks and run them on a
+	zmt::ThreadPool (so this needs zmt.h). The calling thread works on the chunks too, so it is fine to use them from
+	inside a job on the same pool. Define ZFU_PARALLEL to 0 to leave them out (and not include zmt.h).
 */
 
 #pragma once
 #include <map>
+#include <array>
+#include <tuple>
 #include <string>
 #include <vector>
+#include <iterator>
+#include <optional>
 #include <algorithm>
+#include <functional>
 #include <type_traits>
 #include <unordered_map>
 
+#define ZFU_DO_EXPAND(VAL)  VAL ## 1
+#define ZFU_EXPAND(VAL)     ZFU_DO_EXPAND(VAL)
+
+#if !defined(ZFU_PARALLEL)
+	#define ZFU_PARALLEL 1
+#elif (ZFU_EXPAND(ZFU_PARALLEL) == 1)
+	#undef ZFU_PARALLEL
+	#define ZFU_PARALLEL 1
+#endif
+
+#undef ZFU_DO_EXPAND
+#undef ZFU_EXPAND
+
+#if ZFU_PARALLEL
+	#include "zmt.h"
+#endif
+
 template <typename T>
 std::vector<T> operator + (const std::vector<T>& vec, const T& elm)
 {
@@ -62,6 +101,61 @@ std::vector<T> operator + (const std::vector<T>& a, const std::vector<T>& b)
 	return ret;
 }
 
+// when one of the sides is a temporary, reuse it instead of copying it. the element parameters use
+// vector<T>::value_type so that they don't take part in deducing T, which would make them forwarding references.
+template <typename T>
+std::vector<T> operator + (std::vector<T>&& vec, const T& elm)
+{
+	vec.push_back(elm);
+	return std::move(vec);
+}
+
+template <typename T>
+std::vector<T> operator + (std::vector<T>&& vec, typename std::vector<T>::value_type&& elm)
+{
+	vec.push_back(std::move(elm));
+	return std::move(vec);
+}
+
+template <typename T>
+std::vector<T> operator + (const std::vector<T>& vec, typename std::vector<T>::value_type&& elm)
+{
+	auto copy = std::vector<T>();
+	copy.reserve(vec.size() + 1);
+	copy.insert(copy.end(), vec.begin(), vec.end());
+
+	copy.push_back(std::move(elm));
+	return copy;
+}
+
+template <typename T>
+std::vector<T> operator + (const T& elm, std::vector<T>&& vec)
+{
+	vec.insert(vec.begin(), elm);
+	return std::move(vec);
+}
+
+template <typename T>
+std::vector<T> operator + (std::vector<T>&& a, const std::vector<T>& b)
+{
+	a.insert(a.end(), b.begin(), b.end());
+	return std::move(a);
+}
+
+template <typename T>
+std::vector<T> operator + (const std::vector<T>& a, std::vector<T>&& b)
+{
+	b.insert(b.begin(), a.begin(), a.end());
+	return std::move(b);
+}
+
+template <typename T>
+std::vector<T> operator + (std::vector<T>&& a, std::vector<T>&& b)
+{
+	a.insert(a.end(), std::make_move_iterator(b.begin()), std::make_move_iterator(b.end()));
+	return std::move(a);
+}
+
 
 template <typename T, size_t N>
 std::array<T, N + 1> operator + (const T& elm, const std::array<T, N>& vec)
@@ -83,6 +177,13 @@ std::vector<T>& operator += (std::vector<T>& vec, const T& elm)
 	return vec;
 }
 
+template <typename T>
+std::vector<T>& operator += (std::vector<T>& vec, typename std::vector<T>::value_type&& elm)
+{
+	vec.push_back(std::move(elm));
+	return vec;
+}
+
 template <typename T>
 std::vector<T>& operator += (std::vector<T>& vec, const std::vector<T>& xs)
 {
@@ -90,6 +191,17 @@ std::vector<T>& operator += (std::vector<T>& vec, const std::vector<T>& xs)
 	return vec;
 }
 
+template <typename T>
+std::vector<T>& operator += (std::vector<T>& vec, std::vector<T>&& xs)
+{
+	if(vec.empty())
+		vec = std::move(xs);
+	else
+		vec.insert(vec.end(), std::make_move_iterator(xs.begin()), std::make_move_iterator(xs.end()));
+
+	return vec;
+}
+
 
 namespace zfu
 {
@@ -136,7 +248,13 @@ namespace zfu
 	template <typename T, typename... Args>
 	std::vector<T> vectorOf(const T& x, const Args&... xs)
 	{
-		return x + vectorOf<T>(xs...);
+		std::vector<T> ret;
+		ret.reserve(1 + sizeof...(xs));
+
+		ret.push_back(x);
+		(ret.push_back(xs), ...);
+
+		return ret;
 	}
 
 	template <typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
@@ -532,6 +650,324 @@ namespace zfu
 	}
 
 
+	// streaming versions of powerset, combinations and permutations. instead of a vector of every result, these give
+	// a generator that makes one result at a time, in a buffer that is reused:
+	//
+	//   auto g = zfu::gen::combinations(xs, 3);
+	//   while(g.next())
+	//       use(g.current());          // or g.indices(), which are the positions in `xs`
+	//
+	// (or `for(auto& c : g)`). they make the same results as the eager versions (including none at all for r = 0,
+	// and leaving the empty and full subsets out of the powerset), but not always in the same order; and when `xs`
+	// has repeated elements, permutations of them are not skipped. every result has a rank in [0, g.total()), and the
+	// order is fixed: combinations and permutations are in lexicographic order of the indices (so the elements of a
+	// combination are in the order they appear in `xs`), and powerset goes through the subsets of size 1, 2, ..., n - 1
+	// in turn. the generator only refers to `xs`, so it must stay alive (which is why they can't be given a temporary).
+	// slice(begin, end) and partition(i, k) give a generator over part of the ranks, which starts there directly
+	// (without going through the ones before), so that each worker can go through its own part. the number of results
+	// must fit in a size_t.
+	namespace gen
+	{
+		namespace detail
+		{
+			inline size_t choose(size_t n, size_t k)
+			{
+				if(k > n) return 0;
+
+				k = std::min(k, n - k);
+
+				// ret * m is always a multiple of i, but it can overflow even when the result doesn't; dividing first
+				// means that it only overflows if the result does.
+				size_t ret = 1;
+				for(size_t i = 1; i <= k; i++)
+				{
+					auto m = n - k + i;
+					ret = (ret / i) * m + (ret % i) * m / i;
+				}
+
+				return ret;
+			}
+
+			// n * (n - 1) * ... * (n - k + 1)
+			inline size_t falling(size_t n, size_t k)
+			{
+				if(k > n) return 0;
+
+				size_t ret = 1;
+				for(size_t i = 0; i < k; i++)
+					ret *= (n - i);
+
+				return ret;
+			}
+		}
+
+		template <typename T>
+		struct Generator
+		{
+			enum class Kind { Combinations, Permutations, Powerset };
+
+			Generator(const std::vector<T>& xs, Kind kind, size_t r) : m_xs(&xs), m_kind(kind), m_r(r)
+			{
+				this->m_end = this->total();
+			}
+
+			// the number of results in the whole sequence, and in this part of it.
+			size_t total() const
+			{
+				auto n = this->m_xs->size();
+				switch(this->m_kind)
+				{
+					case Kind::Combinations:    return this->m_r == 0 ? 0 : detail::choose(n, this->m_r);
+					case Kind::Permutations:    return this->m_r == 0 ? 0 : detail::falling(n, this->m_r);
+					case Kind::Powerset:        return n == 0 || n >= 8 * sizeof(size_t) ? 0 : (size_t(1) << n) - 2;
+				}
+
+				return 0;
+			}
+
+			size_t size() const { return this->m_end - this->m_begin; }
+
+			// the results with ranks in [begin, end), which must be in this generator's range.
+			Generator slice(size_t begin, size_t end) const
+			{
+				auto ret = Generator(*this->m_xs, this->m_kind, this->m_r);
+				ret.m_begin = std::min(begin, this->m_end);
+				ret.m_end = std::max(ret.m_begin, std::min(end, this->m_end));
+				ret.m_rank = ret.m_begin;
+
+				return ret;
+			}
+
+			// the i-th of k (almost) equal parts of this generator's range.
+			Generator partition(size_t i, size_t k) const
+			{
+				if(k == 0)
+					return this->slice(this->m_end, this->m_end);
+
+				auto len = this->size() / k;
+				auto rem = this->size() % k;
+
+				auto begin = this->m_begin + i * len + std::min(i, rem);
+				return this->slice(begin, begin + len + (i < rem ? 1 : 0));
+			}
+
+			// makes the next result, and returns false (leaving current() as it was) when there are no more.
+			bool next()
+			{
+				if(this->m_started)
+					this->m_rank++;
+
+				if(this->m_rank >= this->m_end)
+				{
+					// so that calling next() again doesn't keep counting up.
+					this->m_rank = this->m_end;
+					return false;
+				}
+
+				if(!this->m_started)
+					this->unrank(this->m_rank);
+				else
+					this->step();
+
+				this->m_started = true;
+
+				// assign over the old elements where we can, so their storage (eg. of strings) is reused.
+				auto& cur = this->m_cur;
+				cur.erase(cur.begin() + static_cast<ptrdiff_t>(std::min(cur.size(), this->m_idx.size())), cur.end());
+
+				for(size_t i = 0; i < this->m_idx.size(); i++)
+				{
+					if(i < cur.size())  cur[i] = (*this->m_xs)[this->m_idx[i]];
+					else                cur.push_back((*this->m_xs)[this->m_idx[i]]);
+				}
+
+				return true;
+			}
+
+			const std::vector<T>& current() const { return this->m_cur; }
+			const std::vector<size_t>& indices() const { return this->m_idx; }
+
+			// the rank of current().
+			size_t rank() const { return this->m_rank; }
+
+
+			struct iterator
+			{
+				const std::vector<T>& operator* () const { return this->gen->current(); }
+				const std::vector<T>* operator-> () const { return &this->gen->current(); }
+
+				iterator& operator++ ()
+				{
+					if(!this->gen->next())
+						this->gen = nullptr;
+
+					return *this;
+				}
+
+				bool operator == (const iterator& other) const { return this->gen == other.gen; }
+				bool operator != (const iterator& other) const { return this->gen != other.gen; }
+
+				Generator* gen;
+			};
+
+			iterator begin() { return ++iterator { this }; }
+			iterator end() { return iterator { nullptr }; }
+
+		private:
+			void unrank(size_t rank)
+			{
+				auto n = this->m_xs->size();
+				this->m_idx.clear();
+
+				if(this->m_kind == Kind::Permutations)
+				{
+					this->m_used.assign(n, false);
+					for(size_t i = 0; i < this->m_r; i++)
+					{
+						// each choice at position i covers a block of this many permutations.
+						auto block = detail::falling(n - i - 1, this->m_r - i - 1);
+						auto skip = rank / block;
+						rank %= block;
+
+						size_t k = 0;
+						while(this->m_used[k] || skip-- > 0)
+							k++;
+
+						this->m_used[k] = true;
+						this->m_idx.push_back(k);
+					}
+				}
+				else
+				{
+					size_t r = this->m_r;
+					if(this->m_kind == Kind::Powerset)
+					{
+						// starting after the empty subset.
+						r = 1;
+						while(rank >= detail::choose(n, r))
+							rank -= detail::choose(n, r++);
+
+						this->m_r = r;
+					}
+
+					size_t k = 0;
+					for(size_t i = 0; i < r; i++, k++)
+					{
+						// skip over all the combinations that start with k, while there are enough of them.
+						size_t c = 0;
+						while(rank >= (c = detail::choose(n - k - 1, r - i - 1)))
+							rank -= c, k++;
+
+						this->m_idx.push_back(k);
+					}
+				}
+			}
+
+			void step()
+			{
+				auto n = this->m_xs->size();
+				auto& idx = this->m_idx;
+
+				if(this->m_kind == Kind::Permutations)
+				{
+					// find the last position that can take a bigger unused index, then fill the rest with the
+					// smallest unused ones.
+					for(size_t i = idx.size(); i-- > 0;)
+					{
+						this->m_used[idx[i]] = false;
+
+						size_t k = idx[i] + 1;
+						while(k < n && this->m_used[k])
+							k++;
+
+						if(k == n)
+							continue;
+
+						idx[i] = k;
+						this->m_used[k] = true;
+
+						k = 0;
+						for(size_t j = i + 1; j < idx.size(); j++)
+						{
+							while(this->m_used[k])
+								k++;
+
+							idx[j] = k;
+							this->m_used[k] = true;
+						}
+
+						return;
+					}
+				}
+				else
+				{
+					auto r = idx.size();
+					for(size_t i = r; i-- > 0;)
+					{
+						if(idx[i] < n - r + i)
+						{
+							idx[i]++;
+							for(size_t j = i + 1; j < r; j++)
+								idx[j] = idx[j - 1] + 1;
+
+							return;
+						}
+					}
+
+					// ran out of subsets of this size, so go to the next one.
+					this->m_r = r + 1;
+					idx.resize(r + 1);
+					for(size_t j = 0; j < r + 1; j++)
+						idx[j] = j;
+				}
+			}
+
+			const std::vector<T>* m_xs;
+			Kind m_kind;
+			size_t m_r;
+
+			size_t m_begin = 0;
+			size_t m_end = 0;
+			size_t m_rank = 0;
+			bool m_started = false;
+
+			std::vector<size_t> m_idx;
+			std::vector<bool> m_used;
+			std::vector<T> m_cur;
+		};
+
+		template <typename T>
+		Generator<T> combinations(const std::vector<T>& xs, size_t r)
+		{
+			return Generator<T>(xs, Generator<T>::Kind::Combinations, r);
+		}
+
+		template <typename T>
+		Generator<T> permutations(const std::vector<T>& xs, size_t r)
+		{
+			return Generator<T>(xs, Generator<T>::Kind::Permutations, r);
+		}
+
+		template <typename T>
+		Generator<T> permutations(const std::vector<T>& xs)
+		{
+			return Generator<T>(xs, Generator<T>::Kind::Permutations, xs.size());
+		}
+
+		template <typename T>
+		Generator<T> powerset(const std::vector<T>& xs)
+		{
+			return Generator<T>(xs, Generator<T>::Kind::Powerset, 0);
+		}
+
+		// the generators keep a pointer to `xs`, which would dangle (eg. in a range-for) if it was a temporary.
+		template <typename T> Generator<T> combinations(std::vector<T>&& xs, size_t r) = delete;
+		template <typename T> Generator<T> permutations(std::vector<T>&& xs, size_t r) = delete;
+		template <typename T> Generator<T> permutations(std::vector<T>&& xs) = delete;
+		template <typename T> Generator<T> powerset(std::vector<T>&& xs) = delete;
+	}
+
+
 
 
 
@@ -606,6 +1042,350 @@ namespace zfu
 	}
 
 
+
+
+
+	// lazy versions of (some of) the above: lazy(xs).filter(...).map(...) describes a pipeline without running it, and
+	// the terminal operations (toVector, foldl, sum, foreach, count, matchAny, matchAll) run the whole chain over
+	// the input in one pass -- each element goes through every stage before the next one is looked at, so there
+	// are no intermediate vectors. lazy(xs) only refers to `xs` (so it must stay alive); lazy(std::move(xs))
+	// takes ownership, and moves the elements out instead of copying them (so it can only be run once). each
+	// stage consumes the pipeline it is called on, so use std::move() to extend one kept in a variable.
+	namespace detail
+	{
+		// every stage has a run(sink), which calls sink(x) for each element (in order) until sink returns
+		// false; run returns false if it was stopped like that, and true if it ran out of elements.
+		template <typename Container>
+		struct RefSource
+		{
+			using value_type = typename Container::value_type;
+			using reference = const value_type&;
+
+			template <typename Sink>
+			bool run(Sink& sink)
+			{
+				for(const auto& x : *this->xs)
+					if(!sink(x)) return false;
+
+				return true;
+			}
+
+			const Container* xs;
+		};
+
+		template <typename Container>
+		struct OwnedSource
+		{
+			using value_type = typename Container::value_type;
+			using reference = value_type&&;
+
+			template <typename Sink>
+			bool run(Sink& sink)
+			{
+				for(auto& x : this->xs)
+					if(!sink(std::move(x))) return false;
+
+				return true;
+			}
+
+			Container xs;
+		};
+
+		template <typename Src, typename Fn>
+		struct MapStage
+		{
+			using reference = decltype(std::declval<Fn&>()(std::declval<typename Src::reference>()));
+			using value_type = std::decay_t<reference>;
+
+			template <typename Sink>
+			bool run(Sink& sink)
+			{
+				auto next = [&sink, this](typename Src::reference&& x) -> bool {
+					return sink(this->fn(static_cast<typename Src::reference&&>(x)));
+				};
+
+				return this->src.run(next);
+			}
+
+			Src src;
+			Fn fn;
+		};
+
+		template <typename Src, typename Pred>
+		struct FilterStage
+		{
+			using reference = typename Src::reference;
+			using value_type = typename Src::value_type;
+
+			template <typename Sink>
+			bool run(Sink& sink)
+			{
+				auto next = [&sink, this](reference&& x) -> bool {
+					if(!this->pred(static_cast<const value_type&>(x)))
+						return true;
+
+					return sink(static_cast<reference&&>(x));
+				};
+
+				return this->src.run(next);
+			}
+
+			Src src;
+			Pred pred;
+		};
+
+		template <typename Src, typename Fn>
+		struct FlatMapStage
+		{
+			using result = decltype(std::declval<Fn&>()(std::declval<typename Src::reference>()));
+			using value_type = typename std::decay_t<result>::value_type;
+
+			// if the function gives us its own container, we can move out of it.
+			using reference = std::conditional_t<std::is_lvalue_reference_v<result>, const value_type&, value_type&&>;
+
+			template <typename Sink>
+			bool run(Sink& sink)
+			{
+				auto next = [&sink, this](typename Src::reference&& x) -> bool {
+					auto&& xs = this->fn(static_cast<typename Src::reference&&>(x));
+					for(auto& y : xs)
+						if(!sink(static_cast<reference&&>(y))) return false;
+
+					return true;
+				};
+
+				return this->src.run(next);
+			}
+
+			Src src;
+			Fn fn;
+		};
+
+		template <typename Src>
+		struct TakeStage
+		{
+			using reference = typename Src::reference;
+			using value_type = typename Src::value_type;
+
+			template <typename Sink>
+			bool run(Sink& sink)
+			{
+				if(this->num == 0)
+					return true;
+
+				// stop as soon as we have enough, so the stages before this don't do any more work.
+				size_t taken = 0;
+				auto next = [&sink, &taken, this](reference&& x) -> bool {
+					return sink(static_cast<reference&&>(x)) && ++taken < this->num;
+				};
+
+				return this->src.run(next) || taken == this->num;
+			}
+
+			Src src;
+			size_t num;
+		};
+
+		template <typename Src, typename Pred>
+		struct TakeWhileStage
+		{
+			using reference = typename Src::reference;
+			using value_type = typename Src::value_type;
+
+			template <typename Sink>
+			bool run(Sink& sink)
+			{
+				bool ended = false;
+				auto next = [&sink, &ended, this](reference&& x) -> bool {
+					if(!this->pred(static_cast<const value_type&>(x)))
+						return (ended = true, false);
+
+					return sink(static_cast<reference&&>(x));
+				};
+
+				return this->src.run(next) || ended;
+			}
+
+			Src src;
+			Pred pred;
+		};
+
+		template <typename Src>
+		struct DropStage
+		{
+			using reference = typename Src::reference;
+			using value_type = typename Src::value_type;
+
+			template <typename Sink>
+			bool run(Sink& sink)
+			{
+				size_t dropped = 0;
+				auto next = [&sink, &dropped, this](reference&& x) -> bool {
+					if(dropped < this->num)
+						return (dropped++, true);
+
+					return sink(static_cast<reference&&>(x));
+				};
+
+				return this->src.run(next);
+			}
+
+			Src src;
+			size_t num;
+		};
+
+		template <typename Src, typename Pred>
+		struct DropWhileStage
+		{
+			using reference = typename Src::reference;
+			using value_type = typename Src::value_type;
+
+			template <typename Sink>
+			bool run(Sink& sink)
+			{
+				bool dropping = true;
+				auto next = [&sink, &dropping, this](reference&& x) -> bool {
+					if(dropping && this->pred(static_cast<const value_type&>(x)))
+						return true;
+
+					dropping = false;
+					return sink(static_cast<reference&&>(x));
+				};
+
+				return this->src.run(next);
+			}
+
+			Src src;
+			Pred pred;
+		};
+	}
+
+	template <typename Src>
+	struct Lazy
+	{
+		using value_type = typename Src::value_type;
+		using reference = typename Src::reference;
+
+		explicit Lazy(Src src) : m_src(std::move(src)) { }
+
+		template <typename UnaryOp>
+		auto map(UnaryOp fn) && -> Lazy<detail::MapStage<Src, UnaryOp>>
+		{
+			return Lazy<detail::MapStage<Src, UnaryOp>>({ std::move(this->m_src), std::move(fn) });
+		}
+
+		template <typename Predicate>
+		auto filter(Predicate cond) && -> Lazy<detail::FilterStage<Src, Predicate>>
+		{
+			return Lazy<detail::FilterStage<Src, Predicate>>({ std::move(this->m_src), std::move(cond) });
+		}
+
+		template <typename UnaryOp>
+		auto flatmap(UnaryOp fn) && -> Lazy<detail::FlatMapStage<Src, UnaryOp>>
+		{
+			return Lazy<detail::FlatMapStage<Src, UnaryOp>>({ std::move(this->m_src), std::move(fn) });
+		}
+
+		auto take(size_t num) && -> Lazy<detail::TakeStage<Src>>
+		{
+			return Lazy<detail::TakeStage<Src>>({ std::move(this->m_src), num });
+		}
+
+		template <typename Predicate>
+		auto takeWhile(Predicate cond) && -> Lazy<detail::TakeWhileStage<Src, Predicate>>
+		{
+			return Lazy<detail::TakeWhileStage<Src, Predicate>>({ std::move(this->m_src), std::move(cond) });
+		}
+
+		auto drop(size_t num) && -> Lazy<detail::DropStage<Src>>
+		{
+			return Lazy<detail::DropStage<Src>>({ std::move(this->m_src), num });
+		}
+
+		template <typename Predicate>
+		auto dropWhile(Predicate cond) && -> Lazy<detail::DropWhileStage<Src, Predicate>>
+		{
+			return Lazy<detail::DropWhileStage<Src, Predicate>>({ std::move(this->m_src), std::move(cond) });
+		}
+
+
+		std::vector<value_type> toVector()
+		{
+			std::vector<value_type> ret;
+			this->foreach([&ret](reference&& x) { ret.push_back(static_cast<reference&&>(x)); });
+
+			return ret;
+		}
+
+		template <typename U, typename FoldOp>
+		U foldl(const U& i, FoldOp fn)
+		{
+			auto ret = i;
+			this->foreach([&ret, &fn](reference&& x) { ret = fn(ret, static_cast<reference&&>(x)); });
+
+			return ret;
+		}
+
+		value_type sum()
+		{
+			return this->foldl(value_type(), [](const value_type& a, const value_type& b) -> value_type { return a + b; });
+		}
+
+		size_t count()
+		{
+			size_t ret = 0;
+			this->foreach([&ret](reference&&) { ret++; });
+
+			return ret;
+		}
+
+		template <typename UnaryOp>
+		void foreach(UnaryOp fn)
+		{
+			auto sink = [&fn](reference&& x) -> bool {
+				fn(static_cast<reference&&>(x));
+				return true;
+			};
+
+			this->m_src.run(sink);
+		}
+
+		template <typename Predicate>
+		bool matchAny(Predicate cond)
+		{
+			bool found = false;
+			auto sink = [&found, &cond](reference&& x) -> bool {
+				return !(found = cond(static_cast<const value_type&>(x)));
+			};
+
+			this->m_src.run(sink);
+			return found;
+		}
+
+		template <typename Predicate>
+		bool matchAll(Predicate cond)
+		{
+			return !this->matchAny([&cond](const value_type& x) -> bool { return !cond(x); });
+		}
+
+	private:
+		Src m_src;
+	};
+
+	template <typename Container>
+	auto lazy(const Container& xs) -> Lazy<detail::RefSource<Container>>
+	{
+		return Lazy<detail::RefSource<Container>>({ &xs });
+	}
+
+	template <typename Container, typename = std::enable_if_t<!std::is_lvalue_reference_v<Container>>>
+	auto lazy(Container&& xs) -> Lazy<detail::OwnedSource<Container>>
+	{
+		return Lazy<detail::OwnedSource<Container>>({ std::move(xs) });
+	}
+
+
+
 	struct identity
 	{
 		template <typename T>
@@ -643,15 +1423,186 @@ namespace zfu
 
 
 
+#if ZFU_PARALLEL
+
+namespace zfu::par
+{
+	// the pool that is used when one isn't given; it has a worker for every core, and is made the first time it's needed.
+	inline zmt::ThreadPool& defaultPool()
+	{
+		static zmt::ThreadPool pool;
+		return pool;
+	}
+
+	namespace detail
+	{
+		struct ChunkState
+		{
+			size_t numChunks = 0;
+			std::atomic<size_t> next = 0;
+			std::atomic<size_t> finished = 0;
+
+			std::mutex lock;
+			std::condition_variable cv;
+		};
+
+		inline size_t chunk_count(size_t n, size_t chunk_size, const zmt::ThreadPool& pool)
+		{
+			// a few chunks per worker, so that uneven chunks even out.
+			if(chunk_size == 0)
+				chunk_size = std::max(size_t(1), n / (4 * std::max(pool.size(), size_t(1))));
+
+			return (n + chunk_size - 1) / chunk_size;
+		}
+
+		// calls fn(chunk) for every chunk in [0, numChunks), on the pool's workers and on this thread, and returns
+		// once all of them are done. the chunks are taken from a shared counter, so this thread finishes the job
+		// by itself if the workers are busy (eg. when this is called from inside a job). jobs that start after
+		// everything was taken just return, without touching `fn`.
+		template <typename Fn>
+		void run_chunks(zmt::ThreadPool& pool, size_t numChunks, Fn& fn)
+		{
+			if(numChunks == 0)
+				return;
+
+			auto state = std::make_shared<ChunkState>();
+			state->numChunks = numChunks;
+
+			auto work = [state, &fn]() {
+				size_t i = 0;
+				while((i = state->next++) < state->numChunks)
+				{
+					fn(i);
+					if(++state->finished == state->numChunks)
+					{
+						auto lk = std::lock_guard<std::mutex>(state->lock);
+						state->cv.notify_all();
+					}
+				}
+			};
+
+			for(size_t i = 1; i < std::min(numChunks, pool.size() + 1); i++)
+				pool.run([work]() { work(); }).discard();
+
+			work();
+
+			auto lk = std::unique_lock<std::mutex>(state->lock);
+			state->cv.wait(lk, [&state]() { return state->finished == state->numChunks; });
+		}
+	}
+
+	template <typename T, typename UnaryOp>
+	auto map(const std::vector<T>& input, UnaryOp fn, zmt::ThreadPool& pool = defaultPool(), size_t chunk_size = 0)
+		-> std::vector<decltype(fn(input[0]))>
+	{
+		using R = decltype(fn(input[0]));
+
+		auto numChunks = detail::chunk_count(input.size(), chunk_size, pool);
+		auto size = (input.size() + numChunks - 1) / std::max(numChunks, size_t(1));
+
+		std::vector<std::vector<R>> parts(numChunks);
+		auto mapper = [&](size_t chunk) {
+			auto end = std::min(input.size(), (chunk + 1) * size);
+
+			auto& out = parts[chunk];
+			out.reserve(end - chunk * size);
+
+			for(size_t i = chunk * size; i < end; i++)
+				out.push_back(fn(input[i]));
+		};
+
+		detail::run_chunks(pool, numChunks, mapper);
+
+		std::vector<R> ret;
+		ret.reserve(input.size());
+		for(auto& p : parts)
+			ret.insert(ret.end(), std::make_move_iterator(p.begin()), std::make_move_iterator(p.end()));
+
+		return ret;
+	}
+
+	template <typename T, typename Predicate>
+	std::vector<T> filter(const std::vector<T>& input, Predicate cond, zmt::ThreadPool& pool = defaultPool(),
+		size_t chunk_size = 0)
+	{
+		auto numChunks = detail::chunk_count(input.size(), chunk_size, pool);
+		auto size = (input.size() + numChunks - 1) / std::max(numChunks, size_t(1));
+
+		std::vector<std::vector<T>> parts(numChunks);
+		auto filterer = [&](size_t chunk) {
+			auto end = std::min(input.size(), (chunk + 1) * size);
+			for(size_t i = chunk * size; i < end; i++)
+			{
+				if(cond(input[i]))
+					parts[chunk].push_back(input[i]);
+			}
+		};
+
+		detail::run_chunks(pool, numChunks, filterer);
 
+		std::vector<T> ret;
+		for(auto& p : parts)
+			ret.insert(ret.end(), std::make_move_iterator(p.begin()), std::make_move_iterator(p.end()));
 
+		return ret;
+	}
 
+	// like foldl, but `fn` must be associative, since each chunk is folded separately (starting from its first
+	// element), and then `i` and the results of the chunks are folded in order.
+	template <typename T, typename BinaryOp>
+	T reduce(const T& i, const std::vector<T>& xs, BinaryOp fn, zmt::ThreadPool& pool = defaultPool(),
+		size_t chunk_size = 0)
+	{
+		auto numChunks = detail::chunk_count(xs.size(), chunk_size, pool);
+		auto size = (xs.size() + numChunks - 1) / std::max(numChunks, size_t(1));
 
+		std::vector<std::optional<T>> parts(numChunks);
+		auto reducer = [&](size_t chunk) {
+			auto end = std::min(xs.size(), (chunk + 1) * size);
 
+			auto acc = xs[chunk * size];
+			for(size_t k = chunk * size + 1; k < end; k++)
+				acc = fn(acc, xs[k]);
 
+			parts[chunk] = std::move(acc);
+		};
 
+		detail::run_chunks(pool, numChunks, reducer);
 
+		auto ret = i;
+		for(auto& p : parts)
+			ret = fn(ret, *p);
 
+		return ret;
+	}
+
+	// sorts the chunks in parallel, then merges neighbouring runs (also in parallel) until there is only one.
+	// like std::sort, this is not stable.
+	template <typename T, typename Compare = std::less<>>
+	void sort(std::vector<T>& xs, Compare cmp = Compare(), zmt::ThreadPool& pool = defaultPool(), size_t chunk_size = 0)
+	{
+		auto numChunks = detail::chunk_count(xs.size(), chunk_size, pool);
+		auto size = (xs.size() + numChunks - 1) / std::max(numChunks, size_t(1));
+
+		auto at = [&xs](size_t k) { return xs.begin() + static_cast<ptrdiff_t>(std::min(k, xs.size())); };
+
+		auto sorter = [&](size_t chunk) {
+			std::sort(at(chunk * size), at((chunk + 1) * size), cmp);
+		};
 
+		detail::run_chunks(pool, numChunks, sorter);
 
+		for(size_t width = size; width < xs.size(); width *= 2)
+		{
+			auto merger = [&](size_t pair) {
+				auto begin = pair * 2 * width;
+				std::inplace_merge(at(begin), at(begin + width), at(begin + 2 * width), cmp);
+			};
+
+			auto pairs = (xs.size() + 2 * width - 1) / (2 * width);
+			detail::run_chunks(pool, pairs, merger);
+		}
+	}
+}
 
+#endif // ZFU_PARALLEL
@@ -16,7 +16,7 @@
 */
 
 /*
-	Version 0.1.0
+	Version 0.3.0
 	=============
 
 
@@ -25,17 +25,74 @@
 
 	This C++17 library contains some useful primitives for working in multithreaded programs, including:
 	- condvar that actually has a sane API
-	- semaphores
+	- semaphores (that spin for a bit before sleeping)
 	- wait_queue
-	- Synchronised<T> wrapper
-	- ThreadPool
+	- mpmc_queue and spsc_queue (bounded, lock-free)
+	- Synchronised<T> wrapper (and RcuSynchronised<T> and SeqlockSynchronised<T>, for values that are mostly read)
+	- ThreadPool, with parallel_for, parallel_reduce, and TaskGraph
 
 	Everything is templated, so there's no need to do the "_IMPLEMENTATION" macro for this library.
 
+	By default, all the workers of a ThreadPool pop jobs from one shared wait_queue. For many small jobs, that
+	queue quickly becomes the bottleneck; construct the pool with `ThreadPool::Options { .work_stealing = true }`
+	to give each worker its own deque instead (see the comment on `ThreadPool::Options`).
+
+	Instead of blocking on a future, `fut.then(fn)` runs `fn` with its value once it is ready (as another job on the
+	same pool), and gives a future for the result; futures::when_all and futures::when_any combine futures without
+	blocking either. In C++20, futures can also be co_await-ed, and a function returning a future can be a coroutine.
+
+	For loops over many small items, use `pool.parallel_for(begin, end, grain, fn)` (or parallel_reduce) instead of
+	a job per item; for a fixed set of tasks with dependencies between them that runs many times, use a TaskGraph.
+
+	With ZMT_INSTRUMENT defined (to the same value in every translation unit), ThreadPool counts the jobs submitted
+	(`zmt.pool.jobs`), and samples the number of jobs waiting when each one is submitted (`zmt.pool.queue_depth`),
+	how long each one waited before a worker started it (`zmt.pool.wait_ns`), and how long it ran (`zmt.pool.run_ns`).
+	znet and zurl have their own switches (ZNET_INSTRUMENT and ZURL_INSTRUMENT), and all of them send their metrics
+	to the same `zmt::instrument::Sink`, set with zmt::instrument::set_sink(). Without these macros, the hooks
+	compile to nothing, and no sink is ever called.
+
+	zmt::instrument::Registry is a ready-made sink that adds up the counters and keeps a histogram of each kind of
+	sample, without locking or allocating. If zpr.h is included before this header, zmt::instrument::dump() prints
+	every metric in a registry:
+
+	  static zmt::instrument::Registry metrics;
+	  zmt::instrument::set_sink(&metrics);
+	  ...
+	  zmt::instrument::dump(metrics);        // eg. "zmt.pool.wait_ns   n=1000 mean=812.5 p50=640 p90=1536 ..."
+
 
 	Version History
 	===============
 
+	0.3.0 - 14/10/2026
+	------------------
+	- add mpmc_queue<T, N> and spsc_queue<T, N>, fixed-capacity lock-free ring buffers with try, spinning,
+	  blocking, and batched (push_n/pop_n) operations
+	- add promise<T>, to complete a future from outside a ThreadPool
+	- move the value into a future instead of copying it, so that move-only types work
+	- fix a data race between discard() and the destructor of a future's other copy
+	- add future::then() continuations (scheduled back onto the ThreadPool), on_ready(), ready() and wait_for()
+	- add futures::when_all and futures::when_any, which don't block
+	- add future::cancel(), which skips jobs that haven't started; running ones can check this_job::cancelled()
+	- futures can be co_await-ed, and returned from coroutines (in C++20)
+	- add ThreadPool::parallel_for and parallel_reduce, which split a range adaptively between the workers
+	- add TaskGraph, a graph of tasks with dependencies that can be run more than once
+	- unique_function no longer uses std::function; it stores small callables inline (the size is a template
+	  parameter), so ThreadPool::run does not allocate for them
+	- semaphore and condvar spin (adaptively) before they go to sleep, use a futex on linux, don't make a syscall
+	  to notify when nobody is asleep, and count how often they had to wait (stats()); wait_queue::pop and
+	  the ThreadPool workers get this for free
+	- add RcuSynchronised<T> and SeqlockSynchronised<T>, with the same map_read/map_write API as Synchronised<T>,
+	  where readers don't take any locks
+	- add optional instrumentation hooks (ZMT_INSTRUMENT) for ThreadPool, and zmt::instrument (Sink, Registry,
+	  Histogram, and a zpr-based dump()), which znet and zurl also use
+
+	0.2.0 - 14/10/2026
+	------------------
+	- add work-stealing mode and core pinning for ThreadPool (via ThreadPool::Options)
+	- fix ThreadPool::stop_all() leaving a stale stop job behind, which broke set_max_workers()
+	- fix compilation on GCC (explicit specialisation of future::internal_state at class scope)
+
 	0.1.0 - 01/05/2021
 	------------------
 	Initial release
@@ -44,76 +101,562 @@
 #pragma once
 
 #include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 
 #include <mutex>
 #include <deque>
+#include <chrono>
+#include <vector>
 #include <thread>
 #include <atomic>
+#include <new>
 #include <memory>
 #include <functional>
 #include <type_traits>
 #include <shared_mutex>
+#include <condition_variable>
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+	#include <coroutine>
+	#define ZMT_COROUTINES 1
+#endif
+
+#if defined(__linux__)
+	#include <sched.h>
+	#include <unistd.h>
+	#include <sys/syscall.h>
+	#include <linux/futex.h>
+	#include <pthread.h>
+#elif defined(__APPLE__)
+	#include <pthread.h>
+	#include <mach/thread_act.h>
+	#include <mach/thread_policy.h>
+#endif
+
+#define ZMT_DO_EXPAND(VAL)  VAL ## 1
+#define ZMT_EXPAND(VAL)     ZMT_DO_EXPAND(VAL)
+
+#if !defined(ZMT_INSTRUMENT)
+	#define ZMT_INSTRUMENT 0
+#elif (ZMT_EXPAND(ZMT_INSTRUMENT) == 1)
+	#undef ZMT_INSTRUMENT
+	#define ZMT_INSTRUMENT 1
+#endif
+
+#undef ZMT_DO_EXPAND
+#undef ZMT_EXPAND
+
+
+// instrumentation
+namespace zmt::instrument
+{
+	/*
+		Receives every measurement made by the instrumentation hooks (in zmt, znet and zurl). Counters are
+		things that get added up (jobs run, bytes sent); samples are values that should go into a histogram
+		(latencies in nanoseconds, queue depths). Metric names are string literals, so they can be compared
+		by address first. Both functions are called from many threads at once.
+	*/
+	struct Sink
+	{
+		virtual ~Sink() { }
+		virtual void count(const char* name, uint64_t n) = 0;
+		virtual void sample(const char* name, uint64_t value) = 0;
+	};
+
+	namespace detail
+	{
+		inline std::atomic<Sink*>& current_sink()
+		{
+			static std::atomic<Sink*> sink = nullptr;
+			return sink;
+		}
+	}
+
+	// the sink must outlive everything that might still be measuring; set it to null to stop.
+	inline void set_sink(Sink* sink) { detail::current_sink().store(sink, std::memory_order_release); }
+	inline Sink* sink() { return detail::current_sink().load(std::memory_order_acquire); }
+
+	inline void count(const char* name, uint64_t n)
+	{
+		if(auto s = sink(); s != nullptr)
+			s->count(name, n);
+	}
+
+	inline void sample(const char* name, uint64_t value)
+	{
+		if(auto s = sink(); s != nullptr)
+			s->sample(name, value);
+	}
+
+	// nanoseconds, from a monotonic clock.
+	inline uint64_t now()
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	/*
+		A histogram with logarithmic buckets: four per power of two, so every value is within 25% of its
+		bucket's lower bound, and any uint64_t fits. Adding a value is a few relaxed atomic increments.
+	*/
+	struct Histogram
+	{
+		static constexpr size_t NUM_BUCKETS = 252;
+
+		void add(uint64_t x)
+		{
+			this->buckets[bucket_of(x)].fetch_add(1, std::memory_order_relaxed);
+			this->num.fetch_add(1, std::memory_order_relaxed);
+			this->sum.fetch_add(x, std::memory_order_relaxed);
+
+			auto m = this->max_.load(std::memory_order_relaxed);
+			while(x > m && !this->max_.compare_exchange_weak(m, x, std::memory_order_relaxed))
+				;
+
+			m = this->min_.load(std::memory_order_relaxed);
+			while(x < m && !this->min_.compare_exchange_weak(m, x, std::memory_order_relaxed))
+				;
+		}
+
+		uint64_t count() const { return this->num.load(std::memory_order_relaxed); }
+		uint64_t total() const { return this->sum.load(std::memory_order_relaxed); }
+		uint64_t max() const { return this->max_.load(std::memory_order_relaxed); }
+		uint64_t min() const { return this->count() == 0 ? 0 : this->min_.load(std::memory_order_relaxed); }
+		double mean() const { return this->count() == 0 ? 0 : static_cast<double>(this->total()) / static_cast<double>(this->count()); }
+
+		// eg. 0.5 for the median; the answer is the lower bound of the bucket that it falls in.
+		uint64_t percentile(double p) const
+		{
+			auto n = this->count();
+			if(n == 0)
+				return 0;
+
+			auto rank = static_cast<uint64_t>(p * static_cast<double>(n - 1));
+
+			uint64_t seen = 0;
+			for(size_t i = 0; i < NUM_BUCKETS; i++)
+			{
+				seen += this->buckets[i].load(std::memory_order_relaxed);
+				if(seen > rank)
+				{
+					auto x = lower_bound(i);
+					return x < this->min() ? this->min() : (x > this->max() ? this->max() : x);
+				}
+			}
+
+			return this->max();
+		}
+
+		void reset()
+		{
+			for(auto& b : this->buckets)
+				b.store(0, std::memory_order_relaxed);
+
+			this->num.store(0, std::memory_order_relaxed);
+			this->sum.store(0, std::memory_order_relaxed);
+			this->max_.store(0, std::memory_order_relaxed);
+			this->min_.store(UINT64_MAX, std::memory_order_relaxed);
+		}
+
+		static size_t bucket_of(uint64_t x)
+		{
+			if(x < 4)
+				return static_cast<size_t>(x);
+
+			auto msb = static_cast<size_t>(63 - __builtin_clzll(x));
+			return (msb - 1) * 4 + static_cast<size_t>((x >> (msb - 2)) & 3);
+		}
+
+		static uint64_t lower_bound(size_t i)
+		{
+			if(i < 4)
+				return i;
+
+			return (4 + (i % 4)) << (i / 4 - 1);
+		}
+
+	private:
+		std::atomic<uint64_t> buckets[NUM_BUCKETS] = { };
+		std::atomic<uint64_t> num = 0;
+		std::atomic<uint64_t> sum = 0;
+		std::atomic<uint64_t> max_ = 0;
+		std::atomic<uint64_t> min_ = UINT64_MAX;
+	};
+
+	/*
+		A Sink that keeps every metric itself: a total for counters, and a Histogram for samples. The metrics
+		live in a fixed table (of MAX_METRICS), so recording never allocates or takes a lock; once the table is
+		full, measurements of new names are dropped (and counted in dropped()).
+
+		Use it as the sink, and print it with zmt::instrument::dump() (if zpr.h is included before this header),
+		or walk the metrics with for_each().
+	*/
+	struct Registry : Sink
+	{
+		static constexpr size_t MAX_METRICS = 64;
+
+		struct Metric
+		{
+			const char* name() const { return this->name_.load(std::memory_order_acquire); }
+			bool is_counter() const { return this->counter.load(std::memory_order_relaxed); }
+
+			uint64_t total() const { return this->is_counter() ? this->value.load(std::memory_order_relaxed) : this->hist.total(); }
+			const Histogram& histogram() const { return this->hist; }
+
+		private:
+			friend struct Registry;
+
+			std::atomic<const char*> name_ = nullptr;
+			std::atomic<bool> counter = false;
+			std::atomic<uint64_t> value = 0;
+			Histogram hist;
+		};
+
+		virtual void count(const char* name, uint64_t n) override
+		{
+			if(auto m = this->lookup(name, /* counter: */ true); m != nullptr)
+				m->value.fetch_add(n, std::memory_order_relaxed);
+		}
+
+		virtual void sample(const char* name, uint64_t value) override
+		{
+			if(auto m = this->lookup(name, /* counter: */ false); m != nullptr)
+				m->hist.add(value);
+		}
+
+		// calls fn(const Metric&) for every metric that has been recorded, in no particular order.
+		template <typename Fn>
+		void for_each(Fn&& fn) const
+		{
+			for(auto& m : this->metrics)
+			{
+				if(m.name() != nullptr)
+					fn(m);
+			}
+		}
+
+		// zeroes every metric, but keeps their names.
+		void reset()
+		{
+			for(auto& m : this->metrics)
+			{
+				m.value.store(0, std::memory_order_relaxed);
+				m.hist.reset();
+			}
+
+			this->dropped_.store(0, std::memory_order_relaxed);
+		}
+
+		uint64_t dropped() const { return this->dropped_.load(std::memory_order_relaxed); }
+
+	private:
+		Metric* lookup(const char* name, bool counter)
+		{
+			// the same literal in two translation units might have two addresses, so hash the contents.
+			size_t hash = 14695981039346656037ULL;
+			for(auto p = name; *p; p++)
+				hash = (hash ^ static_cast<uint8_t>(*p)) * 1099511628211ULL;
+
+			for(size_t k = 0; k < MAX_METRICS; k++)
+			{
+				auto& m = this->metrics[(hash + k) % MAX_METRICS];
+
+				auto existing = m.name();
+				if(existing == nullptr)
+				{
+					// claim the slot; if someone else got there first, see whether it was for the same name.
+					if(m.name_.compare_exchange_strong(existing, name, std::memory_order_acq_rel))
+					{
+						m.counter.store(counter, std::memory_order_relaxed);
+						return &m;
+					}
+				}
+
+				if(existing == name || strcmp(existing, name) == 0)
+					return &m;
+			}
+
+			this->dropped_.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		Metric metrics[MAX_METRICS];
+		std::atomic<uint64_t> dropped_ = 0;
+	};
+}
 
 
 // primitives
 namespace zmt
 {
-	// taken from "Move-only version of std::function"
-	// https://stackoverflow.com/a/52358928/
-	template <typename T>
-	struct unique_function : private std::function<T>
+	namespace detail
 	{
-	private:
-		template <typename Fn, typename = void>
-		struct wrapper;
+		template <typename T> T min(T a, T b) { return a < b ? a : b; }
 
-		// specialise for copyable types
-		template <typename Fn>
-		struct wrapper<Fn, std::enable_if_t<std::is_copy_constructible_v<Fn>>>
+		// not std::hardware_destructive_interference_size, because gcc warns about its use in headers.
+		constexpr size_t CACHE_LINE_SIZE = 64;
+
+		inline void cpu_relax()
 		{
-			Fn fn;
+		#if defined(__x86_64__) || defined(__i386__)
+			__builtin_ia32_pause();
+		#elif defined(__aarch64__) || defined(__arm__)
+			asm volatile("yield");
+		#endif
+		}
 
-			template <typename... Args>
-			auto operator() (Args&&... args) { return this->fn(static_cast<Args&&>(args)...); }
+		// spin for a while, then start yielding our timeslice.
+		template <typename Predicate>
+		inline void spin_until(Predicate p)
+		{
+			for(size_t i = 0; !p(); i++)
+			{
+				if(i < 64) cpu_relax();
+				else       std::this_thread::yield();
+			}
+		}
+
+		// a word that threads can sleep on until it changes: a futex on linux, std::atomic::wait where we have
+		// it, and a mutex and condition_variable otherwise.
+		struct parking_word
+		{
+			std::atomic<uint32_t> word = 0;
+
+			// sleeps until `word` is not `expected` (or not at all, if it already isn't). this can return
+			// spuriously, so check again.
+			void wait(uint32_t expected)
+			{
+			#if defined(__linux__)
+				syscall(SYS_futex, reinterpret_cast<uint32_t*>(&this->word), FUTEX_WAIT_PRIVATE, expected,
+					nullptr, nullptr, 0);
+			#elif defined(__cpp_lib_atomic_wait)
+				this->word.wait(expected);
+			#else
+				auto lk = std::unique_lock<std::mutex>(this->mtx);
+				this->cv.wait(lk, [&]() { return this->word.load() != expected; });
+			#endif
+			}
+
+			// changes the word, and wakes up (some of) the threads sleeping on it.
+			void wake(bool all)
+			{
+			#if defined(__linux__)
+				this->word.fetch_add(1);
+				syscall(SYS_futex, reinterpret_cast<uint32_t*>(&this->word), FUTEX_WAKE_PRIVATE, all ? INT32_MAX : 1,
+					nullptr, nullptr, 0);
+			#elif defined(__cpp_lib_atomic_wait)
+				this->word.fetch_add(1);
+				if(all) this->word.notify_all();
+				else    this->word.notify_one();
+			#else
+				{
+					auto lk = std::unique_lock<std::mutex>(this->mtx);
+					this->word.fetch_add(1);
+				}
+				if(all) this->cv.notify_all();
+				else    this->cv.notify_one();
+			#endif
+			}
+
+		#if !defined(__linux__) && !defined(__cpp_lib_atomic_wait)
+			std::mutex mtx;
+			std::condition_variable cv;
+		#endif
 		};
 
-		// specialise for move-only types
-		template <typename Fn>
-		struct wrapper<Fn, std::enable_if_t<!std::is_copy_constructible_v<Fn> && std::is_move_constructible_v<Fn>>>
+		// how long to spin before going to sleep. it grows when spinning works out, and shrinks when it doesn't,
+		// so that a thread waiting for something that takes long quickly stops wasting time on it.
+		struct adaptive_spin
 		{
-			Fn fn;
+			static constexpr uint32_t MIN_SPINS = 16;
+			static constexpr uint32_t MAX_SPINS = 4096;
 
-			wrapper(Fn&& fn) : fn(static_cast<Fn&&>(fn)) { }
+			// spinning is pointless with only one core, since whoever we're waiting for can't run meanwhile.
+			adaptive_spin(uint32_t initial) : limit(single_core() ? 0 : initial) { }
 
-			wrapper(wrapper&&) = default;
-			wrapper& operator= (wrapper&&) = default;
+			static bool single_core()
+			{
+				static const bool single = std::thread::hardware_concurrency() <= 1;
+				return single;
+			}
 
-			// in theory, these two functions are never called.
-			wrapper(const wrapper& other) : fn(const_cast<Fn&&>(other.fn)) { abort(); }
-			wrapper& operator= (const wrapper&) { abort(); }
+			uint32_t get() const { return this->limit.load(std::memory_order_relaxed); }
 
-			template <typename... Args>
-			auto operator() (Args&&... args) { return this->fn(static_cast<Args&&>(args)...); }
+			void succeeded()
+			{
+				auto n = this->get();
+				if(n > 0 && n < MAX_SPINS)
+					this->limit.store(detail::min(MAX_SPINS, n + n / 8 + 1), std::memory_order_relaxed);
+			}
+
+			void failed()
+			{
+				auto n = this->get();
+				if(n > MIN_SPINS)
+					this->limit.store(n - n / 8, std::memory_order_relaxed);
+			}
+
+			std::atomic<uint32_t> limit;
 		};
 
-		using base_type = std::function<T>;
+		struct contention_counters
+		{
+			std::atomic<uint64_t> contended = 0;
+			std::atomic<uint64_t> spun = 0;
+			std::atomic<uint64_t> parked = 0;
 
-	public:
+			void add(std::atomic<uint64_t>& x) { x.fetch_add(1, std::memory_order_relaxed); }
+		};
+	}
+
+	// how often waiting on a semaphore (or condvar) could not finish right away; of those, how many were done
+	// while spinning, and how many times a thread had to go to sleep.
+	struct contention_stats
+	{
+		uint64_t contended = 0;
+		uint64_t spun = 0;
+		uint64_t parked = 0;
+	};
+
+	// a move-only std::function. callables of up to `InlineSize` bytes (that can be moved without throwing) are
+	// stored inside the object itself, so making one doesn't allocate; bigger ones go on the heap. calling it is
+	// one indirect call, either way.
+	template <typename T, size_t InlineSize = 48>
+	struct unique_function;
+
+	template <typename R, typename... Args, size_t InlineSize>
+	struct unique_function<R (Args...), InlineSize>
+	{
 		unique_function() = default;
-		unique_function(std::nullptr_t) : base_type(nullptr) { }
+		unique_function(std::nullptr_t) { }
+
+		template <typename Fn, typename = std::enable_if_t<!std::is_same_v<std::decay_t<Fn>, unique_function>>>
+		unique_function(Fn&& fn) { this->emplace<std::decay_t<Fn>>(static_cast<Fn&&>(fn)); }
+
+		unique_function(unique_function&& other) noexcept { this->take(other); }
+
+		unique_function& operator= (unique_function&& other) noexcept
+		{
+			if(this != &other)
+			{
+				this->reset();
+				this->take(other);
+			}
+
+			return *this;
+		}
+
+		template <typename Fn, typename = std::enable_if_t<!std::is_same_v<std::decay_t<Fn>, unique_function>>>
+		unique_function& operator= (Fn&& fn)
+		{
+			this->reset();
+			this->emplace<std::decay_t<Fn>>(static_cast<Fn&&>(fn));
+			return *this;
+		}
 
-		unique_function(unique_function&&) = default;
-		unique_function& operator= (unique_function&&) = default;
+		unique_function& operator= (std::nullptr_t) { this->reset(); return *this; }
+
+		unique_function(const unique_function&) = delete;
+		unique_function& operator= (const unique_function&) = delete;
+
+		~unique_function() { this->reset(); }
+
+		R operator() (Args... args) const
+		{
+			return this->invoker(this->buf, static_cast<Args&&>(args)...);
+		}
+
+		explicit operator bool() const { return this->invoker != nullptr; }
+
+	private:
+		enum class Op { Move, Destroy };
 
 		template <typename Fn>
-		unique_function(Fn&& fn) : base_type(wrapper<Fn>(static_cast<Fn&&>(fn))) { }
+		static constexpr bool fits_inline = sizeof(Fn) <= InlineSize && alignof(Fn) <= alignof(std::max_align_t)
+			&& std::is_nothrow_move_constructible_v<Fn>;
 
+		// a unique_function<void (...)> can hold a callable that returns something; the result is dropped.
 		template <typename Fn>
-		unique_function& operator= (Fn&& fn) { base_type::operator=(wrapper<Fn>(static_cast<Fn&&>(fn))); return *this; }
+		static R invoke(Fn& fn, Args&&... args)
+		{
+			if constexpr (std::is_void_v<R>)
+				fn(static_cast<Args&&>(args)...);
+			else
+				return fn(static_cast<Args&&>(args)...);
+		}
+
+		template <typename Fn, typename Arg>
+		void emplace(Arg&& fn)
+		{
+			// like std::function, a null function pointer makes an empty one.
+			if constexpr (std::is_pointer_v<Fn>)
+			{
+				if(fn == nullptr)
+					return;
+			}
+
+			if constexpr (fits_inline<Fn>)
+			{
+				new (this->buf) Fn(static_cast<Arg&&>(fn));
+
+				this->invoker = [](void* p, Args&&... args) -> R {
+					return invoke(*static_cast<Fn*>(p), static_cast<Args&&>(args)...);
+				};
+
+				this->manager = [](Op op, void* src, void* dst) {
+					if(op == Op::Move)
+						new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+
+					static_cast<Fn*>(src)->~Fn();
+				};
+			}
+			else
+			{
+				auto ptr = new Fn(static_cast<Arg&&>(fn));
+				memcpy(this->buf, &ptr, sizeof(Fn*));
+
+				this->invoker = [](void* p, Args&&... args) -> R {
+					return invoke(**static_cast<Fn**>(p), static_cast<Args&&>(args)...);
+				};
+
+				// moving just moves the pointer.
+				this->manager = [](Op op, void* src, void* dst) {
+					if(op == Op::Move)  memcpy(dst, src, sizeof(Fn*));
+					else                delete *static_cast<Fn**>(src);
+				};
+			}
+		}
+
+		void take(unique_function& other)
+		{
+			if(!other.invoker)
+				return;
+
+			other.manager(Op::Move, other.buf, this->buf);
+			this->invoker = other.invoker;
+			this->manager = other.manager;
+
+			other.invoker = nullptr;
+			other.manager = nullptr;
+		}
+
+		void reset()
+		{
+			if(this->manager)
+				this->manager(Op::Destroy, this->buf, nullptr);
+
+			this->invoker = nullptr;
+			this->manager = nullptr;
+		}
 
-		unique_function& operator= (std::nullptr_t) { base_type::operator=(nullptr); return *this; }
+		static_assert(InlineSize >= sizeof(void*), "unique_function needs space for at least a pointer");
 
-		using base_type::operator();
+		R (*invoker)(void*, Args&&...) = nullptr;
+		void (*manager)(Op, void*, void*) = nullptr;
+
+		alignas(std::max_align_t) mutable unsigned char buf[InlineSize];
 	};
 
 	template <typename T>
@@ -139,6 +682,7 @@ namespace zmt
 		{
 			auto lk = std::lock_guard<std::mutex>(this->mtx);
 			this->value = x;
+			this->version.fetch_add(1, std::memory_order_release);
 		}
 
 		T get()
@@ -148,23 +692,27 @@ namespace zmt
 
 		bool wait(const T& x)
 		{
-			auto lk = std::unique_lock<std::mutex>(this->mtx);
-			this->cv.wait(lk, [&]{ return this->value == x; });
-			return true;
+			return this->wait_pred([&]{ return this->value == x; });
 		}
 
 		// returns true only if the value was set; if we timed out, it returns false.
 		bool wait(const T& x, std::chrono::nanoseconds timeout)
 		{
-			auto lk = std::unique_lock<std::mutex>(this->mtx);
-			return this->cv.wait_for(lk, timeout, [&]{ return this->value == x; });
+			return this->wait_pred(timeout, [&]{ return this->value == x; });
 		}
 
+		// all the waits spin for a little while (see spin_wait) before they go to sleep.
 		template <typename Predicate>
 		bool wait_pred(Predicate p)
 		{
 			auto lk = std::unique_lock<std::mutex>(this->mtx);
+			if(this->spin_wait(lk, p))
+				return true;
+
+			this->sleepers++;
 			this->cv.wait(lk, p);
+			this->sleepers--;
+
 			return true;
 		}
 
@@ -173,48 +721,176 @@ namespace zmt
 		bool wait_pred(std::chrono::nanoseconds timeout, Predicate p)
 		{
 			auto lk = std::unique_lock<std::mutex>(this->mtx);
-			return this->cv.wait_for(lk, timeout, p);
+			if(this->spin_wait(lk, p))
+				return true;
+
+			this->sleepers++;
+			auto ret = this->cv.wait_for(lk, timeout, p);
+			this->sleepers--;
+
+			return ret;
+		}
+
+		// these don't make a syscall when nobody is asleep.
+		void notify_one()
+		{
+			this->version.fetch_add(1, std::memory_order_release);
+			if(this->sleepers.load(std::memory_order_relaxed) > 0)
+				this->cv.notify_one();
+		}
+
+		void notify_all()
+		{
+			this->version.fetch_add(1, std::memory_order_release);
+			if(this->sleepers.load(std::memory_order_relaxed) > 0)
+				this->cv.notify_all();
+		}
+
+		// the maximum number of times to spin before sleeping; 0 turns off spinning.
+		void set_spin(uint32_t spins)
+		{
+			this->spin.limit.store(spins, std::memory_order_relaxed);
 		}
 
-		void notify_one() { this->cv.notify_one(); }
-		void notify_all() { this->cv.notify_all(); }
+		contention_stats stats() const
+		{
+			return { this->counters.contended.load(), this->counters.spun.load(), this->counters.parked.load() };
+		}
 
 	private:
+		// called (and returns) with the lock held. if the predicate is false, spin (without the lock) until
+		// something changes -- every set() and notify bumps `version` -- and check again. returns false if it
+		// ran out of spins, and the caller should sleep.
+		template <typename Predicate>
+		bool spin_wait(std::unique_lock<std::mutex>& lk, Predicate& p)
+		{
+			if(p())
+				return true;
+
+			this->counters.add(this->counters.contended);
+
+			auto limit = this->spin.get();
+			auto seen = this->version.load(std::memory_order_acquire);
+
+			lk.unlock();
+			for(uint32_t i = 0; i < limit; i++)
+			{
+				detail::cpu_relax();
+				if(this->version.load(std::memory_order_acquire) == seen)
+					continue;
+
+				lk.lock();
+				if(p())
+				{
+					this->spin.succeeded();
+					this->counters.add(this->counters.spun);
+					return true;
+				}
+
+				seen = this->version.load(std::memory_order_acquire);
+				lk.unlock();
+			}
+
+			lk.lock();
+			if(p())
+				return true;
+
+			this->spin.failed();
+			this->counters.add(this->counters.parked);
+			return false;
+		}
+
 		T value;
 		std::mutex mtx;
 		std::condition_variable cv;
 
+		// `sleepers` is only changed with the lock held.
+		std::atomic<uint32_t> version = 0;
+		std::atomic<uint32_t> sleepers = 0;
+
+		detail::adaptive_spin spin { 256 };
+		detail::contention_counters counters;
+
 		friend struct semaphore;
 	};
 
+	// wait() first tries to take the semaphore without blocking, then spins for a while (adaptively, see
+	// detail::adaptive_spin; `spin` is where it starts, and 0 turns it off), and only then goes to sleep on a
+	// futex (or the closest thing to one). post() doesn't make a syscall unless someone is asleep.
 	struct semaphore
 	{
-		semaphore(uint64_t x) : value(x) { }
+		semaphore(uint64_t x, uint32_t spin = 256) : value(x), spin(spin) { }
+
+		semaphore(const semaphore&) = delete;
+		semaphore& operator= (const semaphore&) = delete;
 
 		void post(uint64_t num = 1)
 		{
+			// seq_cst, so that either we see the sleeper, or the sleeper sees the new value.
+			this->value.fetch_add(num);
+			if(this->sleepers.load() > 0)
+				this->parker.wake(num > 1);
+		}
+
+		bool try_wait()
+		{
+			auto v = this->value.load();
+			while(v > 0)
 			{
-				auto lk = std::unique_lock<std::mutex>(this->mtx);
-				this->value += num;
+				if(this->value.compare_exchange_weak(v, v - 1))
+					return true;
 			}
 
-			if(num > 1) this->cv.notify_all();
-			else        this->cv.notify_one();
+			return false;
 		}
 
 		void wait()
 		{
-			auto lk = std::unique_lock<std::mutex>(this->mtx);
-			while(this->value == 0)
-				this->cv.wait(lk);
+			if(this->try_wait())
+				return;
+
+			this->counters.add(this->counters.contended);
+
+			auto limit = this->spin.get();
+			for(uint32_t i = 0; i < limit; i++)
+			{
+				detail::cpu_relax();
+				if(this->value.load(std::memory_order_relaxed) > 0 && this->try_wait())
+				{
+					this->spin.succeeded();
+					this->counters.add(this->counters.spun);
+					return;
+				}
+			}
 
-			this->value -= 1;
+			this->spin.failed();
+			this->sleepers.fetch_add(1);
+
+			while(true)
+			{
+				auto seen = this->parker.word.load();
+				if(this->try_wait())
+					break;
+
+				this->counters.add(this->counters.parked);
+				this->parker.wait(seen);
+			}
+
+			this->sleepers.fetch_sub(1);
+		}
+
+		contention_stats stats() const
+		{
+			return { this->counters.contended.load(), this->counters.spun.load(), this->counters.parked.load() };
 		}
 
 	private:
-		uint64_t value = 0;
-		std::condition_variable cv;
-		std::mutex mtx;
+		std::atomic<uint64_t> value = 0;
+		std::atomic<uint32_t> sleepers = 0;
+
+		detail::parking_word parker;
+		detail::adaptive_spin spin;
+		detail::contention_counters counters;
 	};
 
 
@@ -322,11 +998,547 @@ namespace zmt
 
 
 
-// Synchronised<T>
+// bounded queues
 namespace zmt
 {
-	template <typename T>
-	struct Synchronised
+	namespace detail
+	{
+		// lets threads sleep until some condition (checked by the sleeper) becomes true. notifying is
+		// very cheap when nobody is waiting, so the queues can call it on every push and pop.
+		struct waiter_list
+		{
+			template <typename Predicate>
+			void wait(Predicate p)
+			{
+				this->waiters.fetch_add(1);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				{
+					auto lk = std::unique_lock<std::mutex>(this->mtx);
+					this->cv.wait(lk, p);
+				}
+				this->waiters.fetch_sub(1);
+			}
+
+			void notify(bool all = false)
+			{
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if(this->waiters.load(std::memory_order_relaxed) == 0)
+					return;
+
+				auto lk = std::unique_lock<std::mutex>(this->mtx);
+				if(all) this->cv.notify_all();
+				else    this->cv.notify_one();
+			}
+
+		private:
+			std::atomic<size_t> waiters = 0;
+			std::mutex mtx;
+			std::condition_variable cv;
+		};
+
+		template <typename T>
+		struct alignas(T) uninitialised
+		{
+			T* ptr() { return reinterpret_cast<T*>(&this->bytes[0]); }
+
+			template <typename... Args>
+			void construct(Args&&... xs) { new (&this->bytes[0]) T(static_cast<Args&&>(xs)...); }
+
+			// moves the value out, and destroys what's left behind.
+			T take() { T ret = static_cast<T&&>(*this->ptr()); this->ptr()->~T(); return ret; }
+
+		private:
+			unsigned char bytes[sizeof(T)];
+		};
+	}
+
+	/*
+		A bounded, lock-free, multi-producer multi-consumer queue with a fixed capacity of N (which must be a
+		power of two), based on Dmitry Vyukov's design. No memory is allocated after construction.
+
+		Each operation comes in three flavours:
+		- try_push / try_pop        return immediately, with false if the queue was full or empty
+		- push_spin / pop_spin      busy-wait (pause, then yield) until they succeed
+		- push / pop                sleep until they succeed
+
+		push_n and pop_n transfer a batch of elements, claiming all the slots in one go.
+	*/
+	template <typename T, size_t N>
+	struct mpmc_queue
+	{
+		static_assert(N >= 2 && (N & (N - 1)) == 0, "capacity of mpmc_queue must be a power of two");
+
+		mpmc_queue()
+		{
+			for(size_t i = 0; i < N; i++)
+				this->cells[i].seq.store(i, std::memory_order_relaxed);
+		}
+
+		~mpmc_queue()
+		{
+			auto h = this->head.load(std::memory_order_relaxed);
+			auto t = this->tail.load(std::memory_order_relaxed);
+			for(; h != t; h++)
+				this->cells[h & MASK].value.ptr()->~T();
+		}
+
+		mpmc_queue(mpmc_queue&&) = delete;
+		mpmc_queue(const mpmc_queue&) = delete;
+		mpmc_queue& operator= (mpmc_queue&&) = delete;
+		mpmc_queue& operator= (const mpmc_queue&) = delete;
+
+		bool try_push(const T& x) { return this->try_emplace(x); }
+		bool try_push(T&& x) { return this->try_emplace(static_cast<T&&>(x)); }
+
+		template <typename... Args>
+		bool try_emplace(Args&&... xs)
+		{
+			size_t pos = 0;
+			size_t count = 1;
+			auto c = this->claim_push(pos, count);
+			if(c == nullptr)
+				return false;
+
+			c->value.construct(static_cast<Args&&>(xs)...);
+			c->seq.store(pos + 1, std::memory_order_release);
+
+			this->not_empty.notify();
+			return true;
+		}
+
+		bool try_pop(T& out)
+		{
+			size_t pos = 0;
+			size_t count = 1;
+			auto c = this->claim_pop(pos, count);
+			if(c == nullptr)
+				return false;
+
+			out = c->value.take();
+			c->seq.store(pos + N, std::memory_order_release);
+
+			this->not_full.notify();
+			return true;
+		}
+
+		void push_spin(const T& x) { detail::spin_until([&]() { return this->try_push(x); }); }
+		void push_spin(T&& x) { detail::spin_until([&]() { return this->try_push(static_cast<T&&>(x)); }); }
+
+		void push(const T& x)
+		{
+			while(!this->try_push(x))
+				this->not_full.wait([this]() { return this->can_push(); });
+		}
+
+		void push(T&& x)
+		{
+			// note that try_push() only moves from x if it succeeds.
+			while(!this->try_push(static_cast<T&&>(x)))
+				this->not_full.wait([this]() { return this->can_push(); });
+		}
+
+		T pop_spin()
+		{
+			size_t pos = 0;
+			size_t count = 1;
+			cell* c = nullptr;
+			detail::spin_until([&]() { return (c = this->claim_pop(pos, count)) != nullptr; });
+
+			return this->finish_pop(c, pos);
+		}
+
+		T pop()
+		{
+			size_t pos = 0;
+			size_t count = 1;
+			cell* c = nullptr;
+			while((c = this->claim_pop(pos, count)) == nullptr)
+				this->not_empty.wait([this]() { return this->can_pop(); });
+
+			return this->finish_pop(c, pos);
+		}
+
+		// pushes as many of the `n` elements as will fit, returning the number that were pushed.
+		size_t try_push_n(const T* xs, size_t n)
+		{
+			size_t pos = 0;
+			size_t count = n;
+			if(n == 0 || this->claim_push(pos, count) == nullptr)
+				return 0;
+
+			for(size_t i = 0; i < count; i++)
+			{
+				auto& c = this->cells[(pos + i) & MASK];
+				c.value.construct(xs[i]);
+				c.seq.store(pos + i + 1, std::memory_order_release);
+			}
+
+			this->not_empty.notify(/* all: */ count > 1);
+			return count;
+		}
+
+		// pops at most `n` elements into `out`, returning the number that were popped.
+		size_t try_pop_n(T* out, size_t n)
+		{
+			size_t pos = 0;
+			size_t count = n;
+			if(n == 0 || this->claim_pop(pos, count) == nullptr)
+				return 0;
+
+			for(size_t i = 0; i < count; i++)
+			{
+				auto& c = this->cells[(pos + i) & MASK];
+				out[i] = c.value.take();
+				c.seq.store(pos + i + N, std::memory_order_release);
+			}
+
+			this->not_full.notify(/* all: */ count > 1);
+			return count;
+		}
+
+		// blocks until all `n` elements have been pushed.
+		void push_n(const T* xs, size_t n)
+		{
+			while(n > 0)
+			{
+				auto k = this->try_push_n(xs, n);
+				xs += k;
+				n -= k;
+
+				if(k == 0)
+					this->not_full.wait([this]() { return this->can_push(); });
+			}
+		}
+
+		// blocks until at least one element is available, then pops at most `n` of them.
+		size_t pop_n(T* out, size_t n)
+		{
+			size_t k = 0;
+			while(n > 0 && (k = this->try_pop_n(out, n)) == 0)
+				this->not_empty.wait([this]() { return this->can_pop(); });
+
+			return k;
+		}
+
+		// only approximate, since other threads can be pushing and popping concurrently.
+		size_t size() const
+		{
+			auto t = this->tail.load(std::memory_order_relaxed);
+			auto h = this->head.load(std::memory_order_relaxed);
+			return t > h ? t - h : 0;
+		}
+
+		bool empty() const { return this->size() == 0; }
+		static constexpr size_t capacity() { return N; }
+
+	private:
+		static constexpr size_t MASK = N - 1;
+
+		struct alignas(detail::CACHE_LINE_SIZE) cell
+		{
+			std::atomic<size_t> seq;
+			detail::uninitialised<T> value;
+		};
+
+		// cell i is free for the producer at position p when seq == p, and holds a value for the consumer
+		// at position p when seq == p + 1. claims at most `count` consecutive slots (at least one), and updates
+		// `count` with the number that were actually claimed. returns the first cell, or null if none were free.
+		cell* claim_push(size_t& pos, size_t& count)
+		{
+			pos = this->tail.load(std::memory_order_relaxed);
+			while(true)
+			{
+				auto k = this->count_ready(pos, count, 0);
+				if(k == 0)
+				{
+					auto seq = this->cells[pos & MASK].seq.load(std::memory_order_acquire);
+					if(static_cast<intptr_t>(seq - pos) < 0)
+						return nullptr;
+
+					// someone else took our slot, so try again.
+					pos = this->tail.load(std::memory_order_relaxed);
+					continue;
+				}
+
+				if(this->tail.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed))
+				{
+					count = k;
+					return &this->cells[pos & MASK];
+				}
+			}
+		}
+
+		cell* claim_pop(size_t& pos, size_t& count)
+		{
+			pos = this->head.load(std::memory_order_relaxed);
+			while(true)
+			{
+				auto k = this->count_ready(pos, count, 1);
+				if(k == 0)
+				{
+					auto seq = this->cells[pos & MASK].seq.load(std::memory_order_acquire);
+					if(static_cast<intptr_t>(seq - (pos + 1)) < 0)
+						return nullptr;
+
+					pos = this->head.load(std::memory_order_relaxed);
+					continue;
+				}
+
+				if(this->head.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed))
+				{
+					count = k;
+					return &this->cells[pos & MASK];
+				}
+			}
+		}
+
+		size_t count_ready(size_t pos, size_t max, size_t offset) const
+		{
+			size_t k = 0;
+			while(k < max && k < N && this->cells[(pos + k) & MASK].seq.load(std::memory_order_acquire) == pos + k + offset)
+				k++;
+
+			return k;
+		}
+
+		T finish_pop(cell* c, size_t pos)
+		{
+			auto ret = c->value.take();
+			c->seq.store(pos + N, std::memory_order_release);
+
+			this->not_full.notify();
+			return ret;
+		}
+
+		bool can_push() const
+		{
+			auto pos = this->tail.load();
+			return this->cells[pos & MASK].seq.load() == pos;
+		}
+
+		bool can_pop() const
+		{
+			auto pos = this->head.load();
+			return this->cells[pos & MASK].seq.load() == pos + 1;
+		}
+
+		alignas(detail::CACHE_LINE_SIZE) std::atomic<size_t> head = 0;
+		alignas(detail::CACHE_LINE_SIZE) std::atomic<size_t> tail = 0;
+
+		cell cells[N];
+
+		detail::waiter_list not_full;
+		detail::waiter_list not_empty;
+	};
+
+
+	/*
+		A bounded, lock-free, single-producer single-consumer queue with a fixed capacity of N (which must be a
+		power of two). Exactly one thread may push, and exactly one thread may pop. It has the same interface as
+		mpmc_queue, but is quite a bit cheaper.
+	*/
+	template <typename T, size_t N>
+	struct spsc_queue
+	{
+		static_assert(N >= 2 && (N & (N - 1)) == 0, "capacity of spsc_queue must be a power of two");
+
+		spsc_queue() { }
+		~spsc_queue()
+		{
+			auto h = this->head.load(std::memory_order_relaxed);
+			auto t = this->tail.load(std::memory_order_relaxed);
+			for(; h != t; h++)
+				this->slots[h & MASK].ptr()->~T();
+		}
+
+		spsc_queue(spsc_queue&&) = delete;
+		spsc_queue(const spsc_queue&) = delete;
+		spsc_queue& operator= (spsc_queue&&) = delete;
+		spsc_queue& operator= (const spsc_queue&) = delete;
+
+		bool try_push(const T& x) { return this->try_emplace(x); }
+		bool try_push(T&& x) { return this->try_emplace(static_cast<T&&>(x)); }
+
+		template <typename... Args>
+		bool try_emplace(Args&&... xs)
+		{
+			auto t = this->tail.load(std::memory_order_relaxed);
+			if(this->free_slots(t) == 0)
+				return false;
+
+			this->slots[t & MASK].construct(static_cast<Args&&>(xs)...);
+			this->tail.store(t + 1, std::memory_order_release);
+
+			this->not_empty.notify();
+			return true;
+		}
+
+		bool try_pop(T& out)
+		{
+			auto h = this->head.load(std::memory_order_relaxed);
+			if(this->used_slots(h) == 0)
+				return false;
+
+			out = this->slots[h & MASK].take();
+			this->head.store(h + 1, std::memory_order_release);
+
+			this->not_full.notify();
+			return true;
+		}
+
+		void push_spin(const T& x) { detail::spin_until([&]() { return this->try_push(x); }); }
+		void push_spin(T&& x) { detail::spin_until([&]() { return this->try_push(static_cast<T&&>(x)); }); }
+
+		void push(const T& x)
+		{
+			while(!this->try_push(x))
+				this->not_full.wait([this]() { return this->can_push(); });
+		}
+
+		void push(T&& x)
+		{
+			while(!this->try_push(static_cast<T&&>(x)))
+				this->not_full.wait([this]() { return this->can_push(); });
+		}
+
+		T pop_spin()
+		{
+			auto h = this->head.load(std::memory_order_relaxed);
+			detail::spin_until([&]() { return this->used_slots(h) > 0; });
+
+			return this->finish_pop(h);
+		}
+
+		T pop()
+		{
+			auto h = this->head.load(std::memory_order_relaxed);
+			while(this->used_slots(h) == 0)
+				this->not_empty.wait([this]() { return this->can_pop(); });
+
+			return this->finish_pop(h);
+		}
+
+		size_t try_push_n(const T* xs, size_t n)
+		{
+			auto t = this->tail.load(std::memory_order_relaxed);
+			auto k = detail::min(n, this->free_slots(t));
+
+			for(size_t i = 0; i < k; i++)
+				this->slots[(t + i) & MASK].construct(xs[i]);
+
+			if(k > 0)
+			{
+				this->tail.store(t + k, std::memory_order_release);
+				this->not_empty.notify();
+			}
+
+			return k;
+		}
+
+		size_t try_pop_n(T* out, size_t n)
+		{
+			auto h = this->head.load(std::memory_order_relaxed);
+			auto k = detail::min(n, this->used_slots(h));
+
+			for(size_t i = 0; i < k; i++)
+				out[i] = this->slots[(h + i) & MASK].take();
+
+			if(k > 0)
+			{
+				this->head.store(h + k, std::memory_order_release);
+				this->not_full.notify();
+			}
+
+			return k;
+		}
+
+		void push_n(const T* xs, size_t n)
+		{
+			while(n > 0)
+			{
+				auto k = this->try_push_n(xs, n);
+				xs += k;
+				n -= k;
+
+				if(k == 0)
+					this->not_full.wait([this]() { return this->can_push(); });
+			}
+		}
+
+		size_t pop_n(T* out, size_t n)
+		{
+			size_t k = 0;
+			while(n > 0 && (k = this->try_pop_n(out, n)) == 0)
+				this->not_empty.wait([this]() { return this->can_pop(); });
+
+			return k;
+		}
+
+		size_t size() const
+		{
+			return this->tail.load(std::memory_order_relaxed) - this->head.load(std::memory_order_relaxed);
+		}
+
+		bool empty() const { return this->size() == 0; }
+		static constexpr size_t capacity() { return N; }
+
+	private:
+		static constexpr size_t MASK = N - 1;
+
+		// the producer keeps a cached copy of the head (and the consumer of the tail), so that we only
+		// need to touch the other side's cache line when we think the queue is full (or empty).
+		size_t free_slots(size_t t)
+		{
+			if(auto n = N - (t - this->cached_head); n > 0)
+				return n;
+
+			this->cached_head = this->head.load(std::memory_order_acquire);
+			return N - (t - this->cached_head);
+		}
+
+		size_t used_slots(size_t h)
+		{
+			if(auto n = this->cached_tail - h; n > 0)
+				return n;
+
+			this->cached_tail = this->tail.load(std::memory_order_acquire);
+			return this->cached_tail - h;
+		}
+
+		T finish_pop(size_t h)
+		{
+			auto ret = this->slots[h & MASK].take();
+			this->head.store(h + 1, std::memory_order_release);
+
+			this->not_full.notify();
+			return ret;
+		}
+
+		bool can_push() const { return this->tail.load() - this->head.load() < N; }
+		bool can_pop() const { return this->tail.load() != this->head.load(); }
+
+		// consumer side
+		alignas(detail::CACHE_LINE_SIZE) std::atomic<size_t> head = 0;
+		size_t cached_tail = 0;
+
+		// producer side
+		alignas(detail::CACHE_LINE_SIZE) std::atomic<size_t> tail = 0;
+		size_t cached_head = 0;
+
+		alignas(detail::CACHE_LINE_SIZE) detail::uninitialised<T> slots[N];
+
+		detail::waiter_list not_full;
+		detail::waiter_list not_empty;
+	};
+}
+
+
+
+// Synchronised<T>
+namespace zmt
+{
+	template <typename T>
+	struct Synchronised
 	{
 	private:
 		struct ReadLockedInstance;
@@ -457,28 +1669,385 @@ namespace zmt
 }
 
 
-// async operations (threadpool, futures)
+
+// RcuSynchronised<T>, SeqlockSynchronised<T>
 namespace zmt
 {
-	template <typename T>
-	struct future
+	namespace detail
 	{
-		template <typename F = T>
-		std::enable_if_t<!std::is_same_v<void, F>, T>& get()
-		{
-			this->wait();
-			return this->state->value;
-		}
+		constexpr size_t RCU_READER_SLOTS = 32;
 
-		template <typename F = T>
-		void set(std::enable_if_t<!std::is_same_v<void, F>, T>&& x)
+		// readers are spread over a few slots (by thread), so that they don't all write to the same cache line.
+		inline size_t rcu_reader_slot()
 		{
-			this->state->value = x;
-			this->state->cv.set(true);
+			static std::atomic<size_t> next_slot = 0;
+			thread_local size_t slot = next_slot++ % RCU_READER_SLOTS;
+			return slot;
 		}
+	}
 
-		template <typename F = T>
-		std::enable_if_t<std::is_same_v<void, F>, void> get()
+	// like Synchronised<T>, but for values that are read much more often than they are written: readers never
+	// wait, and don't touch any shared cache lines (other than the pointer to the value). a write makes a copy of
+	// the value, modifies that, and publishes it; the old copy is deleted once all the readers that might still be
+	// looking at it are done (so map_write waits for those, but not for the readers that came after it).
+	//
+	// the `const T&` given to map_read must not escape it, and map_write must not be called from inside map_read
+	// (on the same thread); that would wait for itself forever.
+	template <typename T>
+	struct RcuSynchronised
+	{
+		RcuSynchronised() : value(new T()) { }
+		~RcuSynchronised() { delete this->value.load(); }
+
+		RcuSynchronised(const T& x) : value(new T(x)) { }
+		RcuSynchronised(T&& x) : value(new T(std::move(x))) { }
+
+		template <typename... Args>
+		RcuSynchronised(Args&&... xs) : value(new T(std::forward<Args>(xs)...)) { }
+
+		RcuSynchronised(RcuSynchronised&&) = delete;
+		RcuSynchronised(const RcuSynchronised&) = delete;
+		RcuSynchronised& operator= (RcuSynchronised&&) = delete;
+		RcuSynchronised& operator= (const RcuSynchronised&) = delete;
+
+		template <typename Functor>
+		void perform_read(Functor&& fn) const
+		{
+			auto unlock = unlocker { this, this->read_lock() };
+			fn(static_cast<const T&>(*this->value.load()));
+		}
+
+		template <typename Functor>
+		auto map_read(Functor&& fn) const -> decltype(fn(std::declval<const T&>()))
+		{
+			auto unlock = unlocker { this, this->read_lock() };
+			return fn(static_cast<const T&>(*this->value.load()));
+		}
+
+		template <typename Functor>
+		void perform_write(Functor&& fn)
+		{
+			auto lk = std::unique_lock<std::mutex>(this->write_lock);
+
+			auto copy = std::make_unique<T>(*this->value.load());
+			fn(*copy);
+
+			this->publish(copy.release());
+		}
+
+		template <typename Functor>
+		auto map_write(Functor&& fn) -> decltype(fn(std::declval<T&>()))
+		{
+			auto lk = std::unique_lock<std::mutex>(this->write_lock);
+
+			auto copy = std::make_unique<T>(*this->value.load());
+
+			if constexpr (std::is_same_v<void, decltype(fn(*copy))>)
+			{
+				fn(*copy);
+				this->publish(copy.release());
+			}
+			else
+			{
+				auto ret = fn(*copy);
+				this->publish(copy.release());
+				return ret;
+			}
+		}
+
+		// replaces the value, without copying the old one first.
+		void store(T x)
+		{
+			auto lk = std::unique_lock<std::mutex>(this->write_lock);
+			this->publish(new T(std::move(x)));
+		}
+
+	private:
+		// so that a reader is counted out even if `fn` throws; otherwise the next writer would wait forever.
+		struct unlocker
+		{
+			~unlocker() { this->self->read_unlock(this->epoch); }
+			const RcuSynchronised* self;
+			size_t epoch;
+		};
+
+		// a reader counts itself in the slot for the current epoch, so the writer knows which readers started
+		// before it swapped the pointer (those in the old epoch) and must be waited for.
+		size_t read_lock() const
+		{
+			auto& slot = this->readers[detail::rcu_reader_slot()];
+			while(true)
+			{
+				auto epoch = this->epoch.load() & 1;
+				slot.count[epoch].fetch_add(1);
+
+				// if the writer flipped the epoch in between, it might have missed us; try again in the new one.
+				if((this->epoch.load() & 1) == epoch)
+					return epoch;
+
+				slot.count[epoch].fetch_sub(1);
+			}
+		}
+
+		void read_unlock(size_t epoch) const
+		{
+			this->readers[detail::rcu_reader_slot()].count[epoch].fetch_sub(1, std::memory_order_release);
+		}
+
+		// called with the write lock held.
+		void publish(T* x)
+		{
+			auto old = this->value.exchange(x);
+			auto prev = this->epoch.fetch_add(1) & 1;
+
+			for(auto& slot : this->readers)
+				detail::spin_until([&]() { return slot.count[prev].load() == 0; });
+
+			delete old;
+		}
+
+		struct alignas(detail::CACHE_LINE_SIZE) reader_slot
+		{
+			std::atomic<size_t> count[2] = { 0, 0 };
+		};
+
+		std::atomic<T*> value;
+
+		alignas(detail::CACHE_LINE_SIZE) std::atomic<size_t> epoch = 0;
+		std::mutex write_lock;
+
+		mutable reader_slot readers[detail::RCU_READER_SLOTS];
+	};
+
+
+	// for small, trivially copyable values: readers copy the value out, and try again if a write happened while
+	// they were copying; they never write to shared memory at all. writers take a lock (against other writers)
+	// but never wait for readers. since the value is copied for every read, keep T small (a few cache lines).
+	template <typename T>
+	struct SeqlockSynchronised
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "SeqlockSynchronised<T> needs a trivially copyable T");
+
+		SeqlockSynchronised() : SeqlockSynchronised(T()) { }
+		SeqlockSynchronised(const T& x) { this->store_words(x); }
+
+		SeqlockSynchronised(SeqlockSynchronised&&) = delete;
+		SeqlockSynchronised(const SeqlockSynchronised&) = delete;
+		SeqlockSynchronised& operator= (SeqlockSynchronised&&) = delete;
+		SeqlockSynchronised& operator= (const SeqlockSynchronised&) = delete;
+
+		T load() const
+		{
+			T ret;
+			for(size_t i = 0; ; i++)
+			{
+				// like spin_until: a writer that takes long (eg. because it was descheduled) shouldn't cost us a
+				// whole core, so start yielding after a while.
+				if(i >= 64)
+					std::this_thread::yield();
+				else if(i > 0)
+					detail::cpu_relax();
+
+				auto seq = this->seq.load(std::memory_order_acquire);
+				if(seq & 1)
+					continue;
+
+				ret = this->load_words();
+
+				if(this->seq.load(std::memory_order_relaxed) == seq)
+					return ret;
+			}
+		}
+
+		void store(const T& x)
+		{
+			this->perform_write([&x](T& val) { val = x; });
+		}
+
+		template <typename Functor>
+		void perform_read(Functor&& fn) const
+		{
+			const T val = this->load();
+			fn(val);
+		}
+
+		template <typename Functor>
+		auto map_read(Functor&& fn) const -> decltype(fn(std::declval<const T&>()))
+		{
+			const T val = this->load();
+			return fn(val);
+		}
+
+		// `fn` gets a copy of the value, which is stored back when it returns.
+		template <typename Functor>
+		void perform_write(Functor&& fn)
+		{
+			this->map_write([&fn](T& val) { fn(val); });
+		}
+
+		template <typename Functor>
+		auto map_write(Functor&& fn) -> decltype(fn(std::declval<T&>()))
+		{
+			auto lk = std::unique_lock<std::mutex>(this->write_lock);
+
+			// no other writers, so this doesn't need to check the sequence.
+			auto val = this->load_words();
+
+			if constexpr (std::is_same_v<void, decltype(fn(val))>)
+			{
+				fn(val);
+				this->write(val);
+			}
+			else
+			{
+				auto ret = fn(val);
+				this->write(val);
+				return ret;
+			}
+		}
+
+	private:
+		// called with the write lock held.
+		void write(const T& val)
+		{
+			this->seq.store(this->seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			this->store_words(val);
+
+			this->seq.store(this->seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+
+		// the value is kept as atomic words, so that a reader racing with a writer is not undefined behaviour
+		// (it just gets garbage, which it then throws away). the words are stored with release and loaded with
+		// acquire, so a reader that sees any new word also sees the odd sequence number that came before it.
+		static constexpr size_t NUM_WORDS = (sizeof(T) + sizeof(uintptr_t) - 1) / sizeof(uintptr_t);
+
+		T load_words() const
+		{
+			uintptr_t buf[NUM_WORDS];
+			for(size_t i = 0; i < NUM_WORDS; i++)
+				buf[i] = this->words[i].load(std::memory_order_acquire);
+
+			T ret;
+			memcpy(&ret, buf, sizeof(T));
+			return ret;
+		}
+
+		void store_words(const T& val)
+		{
+			uintptr_t buf[NUM_WORDS] = { };
+			memcpy(buf, &val, sizeof(T));
+
+			for(size_t i = 0; i < NUM_WORDS; i++)
+				this->words[i].store(buf[i], std::memory_order_release);
+		}
+
+		alignas(detail::CACHE_LINE_SIZE) std::atomic<size_t> seq = 0;
+		std::atomic<uintptr_t> words[NUM_WORDS];
+
+		std::mutex write_lock;
+	};
+}
+
+
+// async operations (threadpool, futures)
+namespace zmt
+{
+	struct ThreadPool;
+
+	namespace detail
+	{
+		// the parts of a future's state that don't depend on its type.
+		struct future_state_base
+		{
+			condvar<bool> cv;
+			std::atomic<bool> discard = false;
+			std::atomic<bool> cancelled = false;
+			std::atomic<bool> ready = false;
+
+			// the pool the future's job runs on, where its continuations go by default (if it has one).
+			ThreadPool* pool = nullptr;
+
+			// wakes up the waiters, then runs the callbacks (on this thread).
+			void complete()
+			{
+				std::vector<unique_function<void (void)>> cbs;
+				{
+					auto lk = std::lock_guard<std::mutex>(this->callback_lock);
+					this->ready = true;
+					cbs = std::move(this->callbacks);
+				}
+
+				this->cv.set(true);
+				for(auto& cb : cbs)
+					cb();
+			}
+
+			// takes `fn` and returns true, unless the future is already complete; then `fn` is left alone.
+			bool add_callback(unique_function<void (void)>& fn)
+			{
+				auto lk = std::lock_guard<std::mutex>(this->callback_lock);
+				if(this->ready)
+					return false;
+
+				this->callbacks.push_back(std::move(fn));
+				return true;
+			}
+
+		private:
+			std::mutex callback_lock;
+			std::vector<unique_function<void (void)>> callbacks;
+		};
+
+		// the cancellation flag of the job running on this thread, for this_job::cancelled().
+		inline thread_local const std::atomic<bool>* current_cancel_flag = nullptr;
+
+		struct job_scope
+		{
+			job_scope(const std::atomic<bool>* flag) : prev(current_cancel_flag) { current_cancel_flag = flag; }
+			~job_scope() { current_cancel_flag = this->prev; }
+
+			job_scope(const job_scope&) = delete;
+			job_scope& operator = (const job_scope&) = delete;
+
+			const std::atomic<bool>* prev;
+		};
+
+		template <typename T, typename Fn>
+		struct continuation_result { using type = decltype(std::declval<Fn&>()(std::declval<T&&>())); };
+
+		template <typename Fn>
+		struct continuation_result<void, Fn> { using type = decltype(std::declval<Fn&>()()); };
+	}
+
+	namespace this_job
+	{
+		// whether the future of the job (or continuation) running on this thread was cancelled. jobs that
+		// take a while can check this once in a while, and stop early.
+		inline bool cancelled()
+		{
+			return detail::current_cancel_flag && detail::current_cancel_flag->load(std::memory_order_relaxed);
+		}
+	}
+
+	template <typename T>
+	struct future
+	{
+		template <typename F = T>
+		std::enable_if_t<!std::is_same_v<void, F>, T>& get()
+		{
+			this->wait();
+			return this->state->value;
+		}
+
+		template <typename F = T>
+		void set(std::enable_if_t<!std::is_same_v<void, F>, T>&& x)
+		{
+			this->state->value = std::move(x);
+			this->state->complete();
+		}
+
+		template <typename F = T>
+		std::enable_if_t<std::is_same_v<void, F>, void> get()
 		{
 			this->wait();
 		}
@@ -486,7 +2055,7 @@ namespace zmt
 		template <typename F = T>
 		std::enable_if_t<std::is_same_v<void, F>, void> set()
 		{
-			this->state->cv.set(true);
+			this->state->complete();
 		}
 
 		void wait() const
@@ -494,30 +2063,100 @@ namespace zmt
 			this->state->cv.wait(true);
 		}
 
+		// returns false if the future is still not complete after `timeout`.
+		bool wait_for(std::chrono::nanoseconds timeout) const
+		{
+			return this->state->cv.wait(true, timeout);
+		}
+
+		bool ready() const
+		{
+			return this->state->ready;
+		}
+
 		void discard()
 		{
 			this->state->discard = true;
 		}
 
+		// a job (or continuation) that hasn't started yet will not run at all; the future is then completed
+		// without a value (so get() gives a default-constructed one). one that is already running can check
+		// this_job::cancelled(). continuations of a cancelled future are cancelled too.
+		void cancel()
+		{
+			this->state->cancelled = true;
+		}
+
+		bool cancelled() const
+		{
+			return this->state->cancelled;
+		}
+
+		// calls `fn` once the future is complete: on the thread that completes it, or right now if it already is.
+		template <typename Fn>
+		void on_ready(Fn&& fn)
+		{
+			auto cb = unique_function<void (void)>(std::decay_t<Fn>(static_cast<Fn&&>(fn)));
+			if(!this->state->add_callback(cb))
+				cb();
+		}
+
+		// runs `fn` with the value (moved out of this future; for void futures, with nothing) once this future is
+		// complete, and returns a future for its result. `fn` runs as a job on `pool`, or by default on the pool
+		// that runs this future's job; for futures not from a ThreadPool (eg. a promise), it runs on the thread
+		// that completes them. this future no longer needs to be waited for, since the new one takes its place.
+		template <typename Fn>
+		auto then(Fn&& fn) -> future<typename detail::continuation_result<T, std::decay_t<Fn>>::type>
+		{
+			return this->then_on(this->state->pool, std::decay_t<Fn>(static_cast<Fn&&>(fn)));
+		}
+
+		template <typename Fn>
+		auto then(ThreadPool& pool, Fn&& fn) -> future<typename detail::continuation_result<T, std::decay_t<Fn>>::type>
+		{
+			return this->then_on(&pool, std::decay_t<Fn>(static_cast<Fn&&>(fn)));
+		}
+
+	#if ZMT_COROUTINES
+		// `co_await fut` suspends the coroutine until the future is complete, and resumes it on the thread that
+		// completes it (so it doesn't block anything while waiting). it gives the value, moved out of the future.
+		bool await_ready() const
+		{
+			return this->ready();
+		}
+
+		bool await_suspend(std::coroutine_handle<> handle)
+		{
+			auto cb = unique_function<void (void)>([handle]() { handle.resume(); });
+			return this->state->add_callback(cb);
+		}
+
+		T await_resume()
+		{
+			if constexpr (!std::is_same_v<void, T>)
+				return std::move(this->state->value);
+		}
+	#endif
+
 		~future() { if(this->state && !this->state->discard) { this->state->cv.wait(true); } }
 
-		future() { this->state = std::make_shared<internal_state<T>>(); this->state->cv.set(false); }
+		future() { this->state = std::make_shared<internal_state<T>>(); }
 
 		template <typename F = T>
 		future(std::enable_if_t<!std::is_same_v<void, F>, T>&& val)
 		{
 			this->state = std::make_shared<internal_state<T>>();
-			this->state->value = val;
-			this->state->cv.set(true);
+			this->state->value = std::move(val);
+			this->state->complete();
 		}
 
-		future(future&& f)
+		future(future&& f) noexcept
 		{
 			this->state = f.state;
 			f.state = nullptr;
 		}
 
-		future& operator = (future&& f)
+		future& operator = (future&& f) noexcept
 		{
 			if(this != &f)
 			{
@@ -534,31 +2173,62 @@ namespace zmt
 	private:
 		friend struct ThreadPool;
 
+		template <typename>
+		friend struct promise;
+
+		template <typename>
+		friend struct future;
+
+		template <typename E, typename = void>
+		struct internal_state : detail::future_state_base
+		{
+			E value;
+		};
+
+		// this needs to be a partial specialisation; explicit specialisations are not allowed at class scope.
 		template <typename E>
-		struct internal_state
+		struct internal_state<E, std::enable_if_t<std::is_void_v<E>>> : detail::future_state_base
 		{
-			internal_state() { cv.set(false); }
+		};
 
-			E value;
-			condvar<bool> cv;
-			bool discard = false;
+		template <typename Fn>
+		auto then_on(ThreadPool* pool, Fn fn) -> future<typename detail::continuation_result<T, Fn>::type>;
 
-			internal_state(internal_state&& f) = delete;
-			internal_state& operator = (internal_state&& f) = delete;
+	#if ZMT_COROUTINES
+		template <typename E, typename P>
+		struct coroutine_return
+		{
+			void return_value(E x)
+			{
+				auto& st = static_cast<P*>(this)->state;
+				st->value = std::move(x);
+				st->complete();
+			}
 		};
 
-		template <>
-		struct internal_state<void>
+		template <typename P>
+		struct coroutine_return<void, P>
 		{
-			internal_state() { discard = false; cv.set(false); }
+			void return_void() { static_cast<P*>(this)->state->complete(); }
+		};
 
-			condvar<bool> cv;
-			bool discard;
+	public:
+		// so that a function returning a future<T> can be a coroutine. it starts running right away (on the
+		// calling thread), up to its first co_await.
+		struct promise_type : coroutine_return<T, promise_type>
+		{
+			future get_return_object() { return future(this->state); }
+
+			std::suspend_never initial_suspend() noexcept { return { }; }
+			std::suspend_never final_suspend() noexcept { return { }; }
+
+			void unhandled_exception() { std::terminate(); }
 
-			internal_state(internal_state&& f) = delete;
-			internal_state& operator = (internal_state&& f) = delete;
+			std::shared_ptr<internal_state<T>> state = std::make_shared<internal_state<T>>();
 		};
 
+	private:
+	#endif
 
 		future(std::shared_ptr<internal_state<T>> st) : state(st) { }
 		future clone() { return future(this->state); }
@@ -566,15 +2236,73 @@ namespace zmt
 		std::shared_ptr<internal_state<T>> state;
 	};
 
+	// the other end of a future, for when the value is produced by something other than a ThreadPool job.
+	// the future returned by get_future() is completed when set() is called (which must happen exactly once).
+	template <typename T>
+	struct promise
+	{
+		future<T> get_future() { return future<T>(this->state); }
+
+		template <typename F = T>
+		void set(std::enable_if_t<!std::is_same_v<void, F>, T>&& x)
+		{
+			this->state->value = std::move(x);
+			this->state->complete();
+		}
+
+		template <typename F = T>
+		std::enable_if_t<std::is_same_v<void, F>, void> set()
+		{
+			this->state->complete();
+		}
+
+		// whether cancel() was called on the future; there's no job to skip, so the producer should check this.
+		bool cancelled() const
+		{
+			return this->state->cancelled;
+		}
+
+		promise() : state(std::make_shared<state_t>()) { }
+
+		promise(promise&&) = default;
+		promise& operator = (promise&&) = default;
+
+		promise(const promise&) = delete;
+		promise& operator = (const promise&) = delete;
+
+	private:
+		using state_t = typename future<T>::template internal_state<T>;
+		std::shared_ptr<state_t> state;
+	};
+
 	struct ThreadPool
 	{
+		// `work_stealing` gives each worker its own deque; jobs submitted from inside a worker go to the back
+		// of that worker's deque, and idle workers steal from the front of other workers' deques. jobs submitted
+		// from outside the pool are distributed round-robin. when false, all workers share one wait_queue.
+		//
+		// `pin_to_cores` sets the affinity of worker `i` to core `i % hardware_concurrency()`. this is only a
+		// hint on macOS (affinity tags), and does nothing on platforms where we don't know how to do it.
+		struct Options
+		{
+			size_t num_workers = std::thread::hardware_concurrency();
+			bool work_stealing = false;
+			bool pin_to_cores = false;
+		};
+
 		template <typename Fn, typename... Args>
 		auto run(Fn&& fn, Args&&... args) -> future<decltype(fn(static_cast<Args&&>(args)...))>
 		{
 			using T = decltype(fn(static_cast<Args&&>(args)...));
 
 			auto fut = future<T>();
-			this->jobs.emplace([fn = std::move(fn), args..., f1 = fut.clone()]() mutable {
+			fut.state->pool = this;
+
+			this->submit(Job([fn = std::move(fn), args..., f1 = fut.clone()]() mutable {
+				if(f1.state->cancelled)
+					return f1.state->complete();
+
+				auto scope = detail::job_scope(&f1.state->cancelled);
 				if constexpr (!std::is_same_v<T, void>)
 				{
 					f1.set(fn(static_cast<decltype(args)&&>(args)...));
@@ -584,63 +2312,351 @@ namespace zmt
 					fn(static_cast<decltype(args)&&>(args)...);
 					f1.set();
 				}
-			});
+			}));
 
 			return fut;
 		}
 
+		// calls fn(i) for every i in [begin, end), or fn(lo, hi) for consecutive ranges covering it, on the workers
+		// and on this thread; returns when all of them are done. the ranges start big and get smaller towards
+		// the end (but never smaller than `grain`, unless that's all that is left), so there is not much overhead
+		// even when fn is small, and uneven work still gets spread out. since this thread also does the work, it
+		// is safe to call this from inside a job.
+		template <typename Fn>
+		void parallel_for(size_t begin, size_t end, size_t grain, Fn&& fn)
+		{
+			auto body = [&fn](size_t lo, size_t hi) {
+				if constexpr (std::is_invocable_v<Fn&, size_t, size_t>)
+				{
+					fn(lo, hi);
+				}
+				else
+				{
+					for(size_t i = lo; i < hi; i++)
+						fn(i);
+				}
+			};
+
+			this->run_ranges(begin, end, grain, body);
+		}
+
+		// like parallel_for, but combines the results of fn(i) (or fn(lo, hi)) with `combine`, starting from
+		// `identity`. `combine` must be associative and commutative, since the ranges finish in any order.
+		template <typename T, typename Fn, typename Combine>
+		T parallel_reduce(size_t begin, size_t end, size_t grain, T identity, Fn&& fn, Combine&& combine)
+		{
+			auto result = identity;
+			std::mutex result_lock;
+
+			auto body = [&](size_t lo, size_t hi) {
+				auto acc = identity;
+				if constexpr (std::is_invocable_v<Fn&, size_t, size_t>)
+				{
+					acc = fn(lo, hi);
+				}
+				else
+				{
+					for(size_t i = lo; i < hi; i++)
+						acc = combine(std::move(acc), fn(i));
+				}
+
+				auto lk = std::lock_guard<std::mutex>(result_lock);
+				result = combine(std::move(result), std::move(acc));
+			};
+
+			this->run_ranges(begin, end, grain, body);
+			return result;
+		}
+
 		ThreadPool(size_t num = std::thread::hardware_concurrency())
 		{
-			if(num == 0)
-				num = 1;
+			Options opts {};
+			opts.num_workers = num;
 
-			this->num_workers = num;
-			this->workers = new std::thread[this->num_workers];
-			this->start_workers();
+			this->init(opts);
+		}
+
+		explicit ThreadPool(const Options& opts)
+		{
+			this->init(opts);
 		}
 
 		~ThreadPool()
 		{
 			this->stop_all();
 			delete[] this->workers;
+			delete[] this->queues;
 		}
 
+		// waits for all pending jobs to finish, then stops all the workers.
 		void stop_all()
 		{
-			this->jobs.push(Job::stop());
+			if(this->workers == nullptr || !this->workers[0].joinable())
+				return;
+
+			if(this->options.work_stealing)
+			{
+				{
+					auto lk = std::unique_lock<std::mutex>(this->park_mtx);
+					this->stopping = true;
+				}
+				this->park_cv.notify_all();
+			}
+			else
+			{
+				this->jobs.push(Job::stop());
+			}
+
 			for(size_t i = 0; i < this->num_workers; i++)
 				this->workers[i].join();
+
+			// the last worker to quit puts the stop job back, so take it out again.
+			if(!this->options.work_stealing)
+				this->jobs.pop();
+
+			this->stopping = false;
 		}
 
 		void set_max_workers(size_t num)
 		{
 			this->stop_all();
 			delete[] this->workers;
+			delete[] this->queues;
 
-			if(num == 0)
-				num = 1;
+			auto opts = this->options;
+			opts.num_workers = num;
 
-			this->num_workers = num;
-			this->workers = new std::thread[this->num_workers];
-			this->start_workers();
+			this->init(opts);
 		}
 
+		size_t size() const { return this->num_workers; }
+
 		ThreadPool(ThreadPool&&) = delete;
 		ThreadPool(const ThreadPool&) = delete;
 		ThreadPool& operator = (ThreadPool&&) = delete;
 		ThreadPool& operator = (const ThreadPool&) = delete;
 
 	private:
+		template <typename>
+		friend struct future;
+
+		friend struct TaskGraph;
+
+		// shared by everyone working on one parallel_for, and kept alive by the helper jobs -- the ones that
+		// only start after everything is done don't touch anything else.
+		struct range_state
+		{
+			std::atomic<size_t> next = 0;
+			size_t end = 0;
+			size_t grain = 1;
+			size_t participants = 1;
+
+			std::atomic<size_t> finished = 0;
+			size_t total = 0;
+
+			std::mutex lock;
+			std::condition_variable cv;
+			bool done = false;
+
+			bool claim(size_t& lo, size_t& hi)
+			{
+				auto cur = this->next.load(std::memory_order_relaxed);
+				while(cur < this->end)
+				{
+					auto remaining = this->end - cur;
+					auto n = std::min(remaining, std::max(this->grain, remaining / (2 * this->participants)));
+
+					if(this->next.compare_exchange_weak(cur, cur + n, std::memory_order_relaxed))
+					{
+						lo = cur;
+						hi = cur + n;
+						return true;
+					}
+				}
+
+				return false;
+			}
+		};
+
+		template <typename Body>
+		void run_ranges(size_t begin, size_t end, size_t grain, Body& body)
+		{
+			if(begin >= end)
+				return;
+
+			auto st = std::make_shared<range_state>();
+			st->next = begin;
+			st->end = end;
+			st->grain = grain == 0 ? 1 : grain;
+			st->total = end - begin;
+
+			auto helpers = std::min(this->num_workers, (st->total + st->grain - 1) / st->grain - 1);
+			st->participants = helpers + 1;
+
+			auto work = [st, &body]() {
+				size_t lo = 0;
+				size_t hi = 0;
+				while(st->claim(lo, hi))
+				{
+					body(lo, hi);
+					if(st->finished.fetch_add(hi - lo) + (hi - lo) == st->total)
+					{
+						auto lk = std::lock_guard<std::mutex>(st->lock);
+						st->done = true;
+						st->cv.notify_all();
+					}
+				}
+			};
+
+			for(size_t i = 0; i < helpers; i++)
+				this->submit(Job([work]() { work(); }));
+
+			work();
+
+			auto lk = std::unique_lock<std::mutex>(st->lock);
+			st->cv.wait(lk, [&st]() { return st->done; });
+		}
+
+		struct Job
+		{
+			bool should_stop = false;
+
+			// big enough for the closure made by run() (the function, its arguments, and a future), so that
+			// submitting a job doesn't allocate unless those are big.
+			unique_function<void (void), 64> func;
+
+		#if ZMT_INSTRUMENT
+			uint64_t queued_at = 0;
+		#endif
+
+			Job() { }
+
+			template <typename Fn, typename = std::enable_if_t<!std::is_same_v<std::decay_t<Fn>, Job>>>
+			explicit Job(Fn&& f) : func(static_cast<Fn&&>(f)) { }
+
+			static inline Job stop() { Job j; j.should_stop = true; return j; }
+		};
+
+		// padded so that the locks of neighbouring workers don't share a cache line.
+		struct alignas(64) worker_queue
+		{
+			std::mutex mtx;
+			std::deque<Job> jobs;
+		};
+
+		void init(const Options& opts)
+		{
+			this->options = opts;
+			this->num_workers = opts.num_workers == 0 ? 1 : opts.num_workers;
+
+			if(opts.work_stealing)
+				this->queues = new worker_queue[this->num_workers];
+
+			this->workers = new std::thread[this->num_workers];
+			this->start_workers();
+		}
+
 		void start_workers()
 		{
 			for(size_t i = 0; i < num_workers; i++)
 			{
-				this->workers[i] = std::thread([this]() {
-					worker(this);
+				this->workers[i] = std::thread([this, i]() {
+					current_pool = this;
+					current_index = i;
+
+					if(this->options.work_stealing)
+						stealing_worker(this, i);
+					else
+						worker(this);
+
+					current_pool = nullptr;
 				});
+
+				if(this->options.pin_to_cores)
+					pin_thread(this->workers[i], i);
+			}
+		}
+
+		void submit(Job&& job)
+		{
+		#if ZMT_INSTRUMENT
+			job.queued_at = instrument::now();
+			instrument::count("zmt.pool.jobs", 1);
+			instrument::sample("zmt.pool.queue_depth", static_cast<uint64_t>(this->queued.fetch_add(1) + 1));
+		#endif
+
+			if(!this->options.work_stealing)
+				return this->jobs.push(std::move(job));
+
+			// if we are being called from one of our own workers, push to the back of its own queue;
+			// otherwise, just spread the jobs around.
+			size_t idx = 0;
+			if(current_pool == this)
+				idx = current_index;
+			else
+				idx = this->next_queue.fetch_add(1, std::memory_order_relaxed) % this->num_workers;
+
+			{
+				auto& q = this->queues[idx];
+				auto lk = std::unique_lock<std::mutex>(q.mtx);
+				q.jobs.push_back(std::move(job));
+			}
+
+			// this (and the matching pair in stealing_worker) must be seq_cst, so that either we see the
+			// sleeper, or the sleeper sees the job.
+			this->pending.fetch_add(1);
+			if(this->sleepers.load() > 0)
+			{
+				auto lk = std::unique_lock<std::mutex>(this->park_mtx);
+				this->park_cv.notify_one();
+			}
+		}
+
+		bool try_pop_own(size_t idx, Job& out)
+		{
+			auto& q = this->queues[idx];
+			auto lk = std::unique_lock<std::mutex>(q.mtx);
+			if(q.jobs.empty())
+				return false;
+
+			out = std::move(q.jobs.back());
+			q.jobs.pop_back();
+			return true;
+		}
+
+		bool try_steal(size_t thief, Job& out)
+		{
+			for(size_t k = 1; k < this->num_workers; k++)
+			{
+				auto& q = this->queues[(thief + k) % this->num_workers];
+
+				// don't wait for the lock -- if someone else is touching it, go and look elsewhere.
+				auto lk = std::unique_lock<std::mutex>(q.mtx, std::try_to_lock);
+				if(!lk.owns_lock() || q.jobs.empty())
+					continue;
+
+				out = std::move(q.jobs.front());
+				q.jobs.pop_front();
+				return true;
 			}
+
+			return false;
 		}
 
+		void run_job(Job& job)
+		{
+		#if ZMT_INSTRUMENT
+			auto start = instrument::now();
+			this->queued.fetch_sub(1, std::memory_order_relaxed);
+			instrument::sample("zmt.pool.wait_ns", start - job.queued_at);
+		#endif
+
+			job.func();
+
+		#if ZMT_INSTRUMENT
+			instrument::sample("zmt.pool.run_ns", instrument::now() - start);
+		#endif
+		}
 
 		static void worker(ThreadPool* tp)
 		{
@@ -653,27 +2669,269 @@ namespace zmt
 					break;
 				}
 
-				job.func();
+				tp->run_job(job);
 			}
 		}
 
-		struct Job
+		static void stealing_worker(ThreadPool* tp, size_t idx)
 		{
-			bool should_stop = false;
-			unique_function<void (void)> func;
+			while(true)
+			{
+				Job job;
+				if(tp->try_pop_own(idx, job) || tp->try_steal(idx, job))
+				{
+					tp->pending.fetch_sub(1);
+					tp->run_job(job);
+					continue;
+				}
 
-			Job() { }
-			explicit Job(unique_function<void (void)>&& f) : func(std::move(f)) { }
+				// jobs often come in quick succession, so wait a little before going to sleep.
+				bool found = false;
+				for(uint32_t i = 0; i < tp->spin.get() && !found; i++)
+				{
+					detail::cpu_relax();
+					found = tp->pending.load(std::memory_order_relaxed) > 0;
+				}
 
-			static inline Job stop() { Job j; j.should_stop = true; return j; }
-		};
+				if(found)
+				{
+					tp->spin.succeeded();
+					continue;
+				}
+
+				tp->spin.failed();
+
+				// there's a chance that a steal failed because of lock contention, so we only go to sleep
+				// when there is really nothing left.
+				auto lk = std::unique_lock<std::mutex>(tp->park_mtx);
+
+				tp->sleepers.fetch_add(1);
+				tp->park_cv.wait(lk, [tp]() { return tp->stopping || tp->pending.load() > 0; });
+				tp->sleepers.fetch_sub(1);
+
+				// finish everything before quitting.
+				if(tp->stopping && tp->pending.load() == 0)
+					break;
+			}
+		}
+
+		static void pin_thread(std::thread& thread, size_t idx)
+		{
+			auto cores = std::thread::hardware_concurrency();
+			if(cores == 0)
+				return;
+
+		#if defined(__linux__)
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(idx % cores, &set);
+			pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &set);
+		#elif defined(__APPLE__)
+			auto policy = thread_affinity_policy_data_t { static_cast<integer_t>(1 + (idx % cores)) };
+			thread_policy_set(pthread_mach_thread_np(thread.native_handle()), THREAD_AFFINITY_POLICY,
+				reinterpret_cast<thread_policy_t>(&policy), THREAD_AFFINITY_POLICY_COUNT);
+		#else
+			(void) thread;
+			(void) idx;
+		#endif
+		}
+
+		Options options = { };
 
 		size_t num_workers = 0;
 		std::thread* workers = nullptr;
 
+		// used with the shared queue
 		wait_queue<Job> jobs;
+
+		// used with work stealing
+		worker_queue* queues = nullptr;
+		std::atomic<size_t> next_queue = 0;
+		std::atomic<int64_t> pending = 0;
+		std::atomic<size_t> sleepers = 0;
+
+		bool stopping = false;
+		std::mutex park_mtx;
+		std::condition_variable park_cv;
+		detail::adaptive_spin spin { 256 };
+
+	#if ZMT_INSTRUMENT
+		// jobs submitted but not started yet, for the queue depth.
+		std::atomic<int64_t> queued = 0;
+	#endif
+
+		static inline thread_local ThreadPool* current_pool = nullptr;
+		static inline thread_local size_t current_index = 0;
+	};
+
+	// a set of tasks, with dependencies between them (which must not form a cycle). the graph is built once, and can
+	// then be run many times; running it doesn't allocate anything (other than what the pool does to queue jobs).
+	// run() blocks until every task is done, so don't call it from inside a job on the same pool.
+	//
+	//   auto g = zmt::TaskGraph();
+	//   auto a = g.add([]() { ... });
+	//   auto b = g.add([]() { ... }, { a });      // b runs after a
+	//   g.run(pool);
+	struct TaskGraph
+	{
+		using Task = size_t;
+
+		template <typename Fn>
+		Task add(Fn&& fn, std::initializer_list<Task> deps = { })
+		{
+			auto& node = this->nodes.emplace_back();
+			node.fn = unique_function<void (void)>(std::decay_t<Fn>(static_cast<Fn&&>(fn)));
+
+			auto id = this->nodes.size() - 1;
+			for(auto d : deps)
+				this->precede(d, id);
+
+			return id;
+		}
+
+		// `after` only runs once `before` is done.
+		void precede(Task before, Task after)
+		{
+			this->nodes[before].successors.push_back(after);
+			this->nodes[after].num_preds += 1;
+		}
+
+		size_t size() const { return this->nodes.size(); }
+
+		void run(ThreadPool& pool)
+		{
+			if(this->nodes.empty())
+				return;
+
+			this->pool = &pool;
+			this->remaining = this->nodes.size();
+			this->done = false;
+
+			for(auto& n : this->nodes)
+				n.pending = n.num_preds;
+
+			for(size_t i = 0; i < this->nodes.size(); i++)
+			{
+				if(this->nodes[i].num_preds == 0)
+					this->start(i);
+			}
+
+			auto lk = std::unique_lock<std::mutex>(this->lock);
+			this->cv.wait(lk, [this]() { return this->done; });
+		}
+
+		TaskGraph() = default;
+
+		TaskGraph(TaskGraph&&) = delete;
+		TaskGraph(const TaskGraph&) = delete;
+		TaskGraph& operator = (TaskGraph&&) = delete;
+		TaskGraph& operator = (const TaskGraph&) = delete;
+
+	private:
+		struct Node
+		{
+			unique_function<void (void)> fn;
+			std::vector<Task> successors;
+			size_t num_preds = 0;
+
+			std::atomic<size_t> pending = 0;
+		};
+
+		void start(Task t)
+		{
+			this->pool->submit(ThreadPool::Job([this, t]() { this->finish(t); }));
+		}
+
+		void finish(Task t)
+		{
+			auto& node = this->nodes[t];
+			node.fn();
+
+			for(auto s : node.successors)
+			{
+				if(--this->nodes[s].pending == 0)
+					this->start(s);
+			}
+
+			if(--this->remaining == 0)
+			{
+				auto lk = std::lock_guard<std::mutex>(this->lock);
+				this->done = true;
+				this->cv.notify_all();
+			}
+		}
+
+		// a deque, so that adding nodes doesn't move the old ones (which can't be moved anyway).
+		std::deque<Node> nodes;
+
+		ThreadPool* pool = nullptr;
+		std::atomic<size_t> remaining = 0;
+
+		std::mutex lock;
+		std::condition_variable cv;
+		bool done = false;
 	};
 
+	template <typename T>
+	template <typename Fn>
+	auto future<T>::then_on(ThreadPool* pool, Fn fn) -> future<typename detail::continuation_result<T, Fn>::type>
+	{
+		using U = typename detail::continuation_result<T, Fn>::type;
+
+		auto ret = future<U>();
+		ret.state->pool = pool;
+
+		auto work = [src = this->state, dst = ret.state, fn = std::move(fn)]() mutable {
+			if(src->cancelled || dst->cancelled)
+			{
+				dst->cancelled = true;
+				return dst->complete();
+			}
+
+			auto scope = detail::job_scope(&dst->cancelled);
+
+			if constexpr (std::is_same_v<void, T> && std::is_same_v<void, U>)   fn();
+			else if constexpr (std::is_same_v<void, T>)                         dst->value = fn();
+			else if constexpr (std::is_same_v<void, U>)                         fn(std::move(src->value));
+			else                                                                dst->value = fn(std::move(src->value));
+
+			dst->complete();
+		};
+
+		auto cb = unique_function<void (void)>([pool, work = std::move(work)]() mutable {
+			if(pool != nullptr)
+				pool->submit(ThreadPool::Job(std::move(work)));
+			else
+				work();
+		});
+
+		// the continuation holds on to the state now, so nobody needs to wait for this future.
+		this->state->discard = true;
+		if(!this->state->add_callback(cb))
+			cb();
+
+		return ret;
+	}
+
+	namespace detail
+	{
+		struct all_state
+		{
+			std::atomic<size_t> remaining = 1;
+			promise<void> done;
+
+			void finish_one() { if(--this->remaining == 0) this->done.set(); }
+		};
+
+		struct any_state
+		{
+			std::atomic<bool> finished = false;
+			promise<size_t> done;
+
+			void finish(size_t idx) { if(!this->finished.exchange(true)) this->done.set(std::move(idx)); }
+		};
+	}
+
 	namespace futures
 	{
 		template <typename... Args>
@@ -689,5 +2947,111 @@ namespace zmt
 			for(const auto& f : futures)
 				f.wait();
 		}
+
+		// these don't block; they give a future that completes when all (or any one) of the given futures are
+		// complete. the values stay in the original futures, which must stay alive until then.
+		template <typename... Args>
+		inline future<void> when_all(future<Args>&... futures)
+		{
+			auto st = std::make_shared<detail::all_state>();
+			auto ret = st->done.get_future();
+
+			st->remaining += sizeof...(futures);
+			(futures.on_ready([st]() { st->finish_one(); }), ...);
+
+			st->finish_one();
+			return ret;
+		}
+
+		template <typename L>
+		inline future<void> when_all(L& futures)
+		{
+			auto st = std::make_shared<detail::all_state>();
+			auto ret = st->done.get_future();
+
+			st->remaining += futures.size();
+			for(auto& f : futures)
+				f.on_ready([st]() { st->finish_one(); });
+
+			st->finish_one();
+			return ret;
+		}
+
+		// the value is the index of the first future to complete (or 0 if there are none).
+		template <typename... Args>
+		inline future<size_t> when_any(future<Args>&... futures)
+		{
+			auto st = std::make_shared<detail::any_state>();
+			auto ret = st->done.get_future();
+
+			if constexpr (sizeof...(futures) == 0)
+			{
+				st->finish(0);
+			}
+			else
+			{
+				size_t idx = 0;
+				(futures.on_ready([st, i = idx++]() { st->finish(i); }), ...);
+			}
+
+			return ret;
+		}
+
+		template <typename L>
+		inline future<size_t> when_any(L& futures)
+		{
+			auto st = std::make_shared<detail::any_state>();
+			auto ret = st->done.get_future();
+
+			if(futures.empty())
+				st->finish(0);
+
+			size_t idx = 0;
+			for(auto& f : futures)
+				f.on_ready([st, i = idx++]() { st->finish(i); });
+
+			return ret;
+		}
+	}
+}
+
+
+
+// zpr.h always defines these macros, so if they are defined, it was included before us and we can use it
+// to print the metrics of an instrument::Registry.
+#if defined(ZPR_USE_STD) || defined(ZPR_FREESTANDING)
+#if !ZPR_FREESTANDING
+
+#include <algorithm>
+
+namespace zmt::instrument
+{
+	// one line per metric, sorted by name: the total of each counter, and the count, mean, median, 90th
+	// and 99th percentiles, and maximum of each set of samples.
+	inline void dump(const Registry& registry, FILE* out = stderr)
+	{
+		auto metrics = std::vector<const Registry::Metric*>();
+		registry.for_each([&metrics](const Registry::Metric& m) { metrics.push_back(&m); });
+
+		std::sort(metrics.begin(), metrics.end(), [](auto a, auto b) { return strcmp(a->name(), b->name()) < 0; });
+
+		for(auto m : metrics)
+		{
+			if(m->is_counter())
+			{
+				zpr::fprintln(out, "{-32} {}", m->name(), m->total());
+				continue;
+			}
+
+			auto& h = m->histogram();
+			zpr::fprintln(out, "{-32} n={} mean={.1f} p50={} p90={} p99={} max={}", m->name(), h.count(), h.mean(),
+				h.percentile(0.5), h.percentile(0.9), h.percentile(0.99), h.max());
+		}
+
+		if(auto n = registry.dropped(); n > 0)
+			zpr::fprintln(out, "({} measurements dropped; there were more than {} metrics)", n, Registry::MAX_METRICS);
 	}
 }
+
+#endif // !ZPR_FREESTANDING
+#endif // ZPR_USE_STD || ZPR_FREESTANDING
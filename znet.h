@@ -16,7 +16,7 @@
 */
 
 /*
-	Version 0.3.0
+	Version 0.4.0
 	=============
 
 
@@ -33,10 +33,32 @@
 	and std::string.
 
 	Both TCP and UDP sockets have a asynchronous callback interface as well as a synchronous, blocking
-	interface. Currently, it is not possible to set either socket to non-blocking mode. Furthermore, arbitarily
-	switching between the sync and async functions is not supported, since the callback-calling thread
-	continues to try and read the socket simultaneously --- which might get into weird behaviour depending on
-	which thread your kernel decides to respond to.
+	interface. Sockets can be put into non-blocking mode with setBlocking(false); then, send() and receive()
+	return 0 for TCP sockets instead of waiting (receive() on a UDP socket returns -1, with errno set to EAGAIN).
+	Furthermore, arbitarily switching between the sync and async functions is not supported, since the
+	callback-calling thread continues to try and read the socket simultaneously --- which might get into weird
+	behaviour depending on which thread your kernel decides to respond to.
+
+	By default, every socket with an onReceive() callback gets its own thread to call it. For many sockets, add them
+	to a `znet::EventLoop` instead, which waits on all of them with epoll (linux) or kqueue (macOS/BSD) from a fixed
+	number of threads, and calls the same onReceive() and onClose() callbacks. Sockets in a loop are non-blocking.
+
+	UDP sockets can also send and receive many datagrams per syscall with a `znet::UDPBatch`, which owns one block of
+	memory with a fixed number of fixed-size slots. receiveBatch() fills it with whatever is queued (recvmmsg on linux),
+	sendBatch() sends everything pushed into it (sendmmsg), and onReceiveBatch() is the batched version of onReceive().
+	On linux, useGSO() lets sendBatch() give runs of same-sized datagrams to the kernel in one go, and useGRO() lets the
+	kernel coalesce received datagrams; for GRO, call it before onReceiveBatch(), or use 64kB slots in your own batch.
+
+	SSL sockets share a `znet::TLSContext` (TLSContext::shared(), unless you give them your own), which owns the SSL_CTX
+	and caches the last TLS session for each host and port, so that connecting to the same place again resumes it
+	instead of doing a full handshake. Connecting can also be done without blocking: either with startConnect() and
+	continueConnect() on the socket (waiting on its fd() in between), or by handing it to EventLoop::connect(), which
+	does the TCP connect and TLS handshake on the loop's threads and then adds the socket to the loop.
+
+	Hostnames are resolved with a `znet::Resolver`, which caches the addresses of each host (all of them, both IPv4
+	and IPv6), and can look them up asynchronously on its own threads; a `Resolver::Result` has either the addresses,
+	or the reason that there aren't any. TCPSocket::connectFirst() then connects to whichever of the addresses answers first,
+	starting a new attempt every 250ms or so instead of waiting for each one to time out (happy eyeballs).
 
 	Since the main socket objects are not templated, this library follows the stb_* style of header-only
 	libraries --- in exactly one cpp file, #define ZNET_IMPLEMENTATION to generate the definitions of the
@@ -55,6 +77,13 @@
 		of socket. Useful to reduce code size if you only need one kind of socket and not the other. You can
 		also separate the definitions into two translation units, if you need to for some perverse reason.
 
+	- ZNET_INSTRUMENT
+		this is *FALSE* by default. When it is TRUE, every send and receive syscall (or SSL_write/SSL_read) is
+		counted, along with the bytes that it moved, as `znet.{tcp,udp}.{send,recv}.{calls,bytes}`; the times taken
+		by TCP connects and TLS handshakes are sampled as `znet.tcp.connect_ns` and `znet.tls.handshake_ns`. These
+		go to the sink set with zmt::instrument::set_sink(), so this includes zmt.h. When it is FALSE, the hooks
+		compile to nothing. It only needs to be set where ZNET_IMPLEMENTATION is defined.
+
 
 
 
@@ -64,6 +93,31 @@
 	Version History
 	===============
 
+	0.4.0 - 14/10/2026
+	------------------
+	- add EventLoop, which dispatches the callbacks of many sockets from a few threads using epoll/kqueue
+	- add UDPBatch, UDPSocket::receiveBatch(), sendBatch() and onReceiveBatch() using recvmmsg/sendmmsg
+	- add UDP segmentation/receive offload (GSO/GRO) on linux
+	- support non-blocking mode properly (send() and receive() return 0 instead of failing)
+	- fix setBlocking(true) making blocking sockets non-blocking
+	- fix UDP receive() never filling in the sender's address
+	- fix data races between the receiving threads and useCallback()/disconnect()
+	- add TCPSocket::getSSLSession() and setSSLSession() for TLS session resumption
+	- don't raise SIGPIPE when sending to a TCP socket that the other side closed
+	- fix compile errors with gcc (missing includes, designated initialisers out of order)
+	- add TCPSocket::sendv() (writev-style, with small parts batched into one TLS record for SSL sockets)
+	- add TCPSocket::sendFile(), using sendfile() for non-SSL sockets
+	- add TLSContext, a shared SSL_CTX with a thread-safe session cache; sockets to the same host resume the last session
+	- add non-blocking connects and TLS handshakes (TCPSocket::startConnect(), continueConnect(), EventLoop::connect())
+	- non-blocking SSL sockets return 0 from send() when they would block, and -1 on errors
+	- fix leaking the socket (and SSL object) of a TCPSocket that was never connected
+	- add Resolver, which resolves hostnames to all of their addresses (asynchronously, if needed) and caches them
+	- add TCPSocket::connectFirst(), which races connections to several addresses (happy eyeballs)
+	- IPAddress::hostname4() no longer aborts when the host doesn't resolve; it returns an empty address instead
+	- add IPAddress::family(), port() and setPort(); TCP sockets can connect to IPv6 addresses
+	- add optional instrumentation of syscalls, bytes, and connect/handshake times (ZNET_INSTRUMENT)
+
+
 	0.3.0 - 15/03/2021
 	------------------
 	- add methods to switch between blocking and callback modes of the sockets.
@@ -88,10 +142,21 @@
 
 #pragma once
 
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
 #include <thread>
+#include <vector>
+#include <cstring>
 #include <functional>
+#include <unordered_map>
+#include <condition_variable>
 
 #include <netdb.h>
+#include <sys/uio.h>
 #include <sys/socket.h>
 #include <netinet/ip.h>
 
@@ -110,6 +175,17 @@
 	#include <openssl/err.h>
 #endif // ZNET_ENABLE_SSL
 
+#if !defined(ZNET_INSTRUMENT)
+	#define ZNET_INSTRUMENT 0
+#elif (ZNET_EXPAND(ZNET_INSTRUMENT) == 1)
+	#undef ZNET_INSTRUMENT
+	#define ZNET_INSTRUMENT 1
+#endif // ZNET_INSTRUMENT
+
+#if ZNET_INSTRUMENT
+	#include "zmt.h"
+#endif // ZNET_INSTRUMENT
+
 #if !defined(ZNET_IMPLEMENTATION)
 	#define ZNET_IMPLEMENTATION 0
 #elif (ZNET_EXPAND(ZNET_IMPLEMENTATION) == 1)
@@ -158,9 +234,23 @@
 	return;                                     \
 } while(0)
 
+// one syscall (or SSL_read/SSL_write) that moved `bytes` bytes, if that is positive. `dir` is the prefix of the
+// metric names, eg. "znet.tcp.send" counts "znet.tcp.send.calls" and "znet.tcp.send.bytes".
+#if ZNET_INSTRUMENT
+	#define ZNET_COUNT_IO(dir, bytes) do {                                      \
+		zmt::instrument::count(dir ".calls", 1);                              \
+		if(auto zn_bytes = static_cast<ssize_t>(bytes); zn_bytes > 0)         \
+			zmt::instrument::count(dir ".bytes", static_cast<uint64_t>(zn_bytes)); \
+	} while(0)
+#else
+	#define ZNET_COUNT_IO(dir, bytes) do { } while(0)
+#endif // ZNET_INSTRUMENT
+
 
 namespace znet
 {
+	struct EventLoop;
+
 	namespace detail
 	{
 		void set_timeout(int sock, double timeout_secs);
@@ -202,11 +292,16 @@ namespace znet
 		inline std::string hostnameString() const { return this->hostname_string; }
 		inline struct sockaddr* ptr()             { return reinterpret_cast<struct sockaddr*>(&this->storage); }
 		inline const struct sockaddr* ptr() const { return reinterpret_cast<const struct sockaddr*>(&this->storage); }
+		inline int family() const                 { return this->length == 0 ? AF_UNSPEC : this->storage.ss_family; }
+
+		uint16_t port() const;
+		void setPort(uint16_t port);
 
 		// note: 'ip' must be a 4-component IP address, eg. 192.168.1.69
 		static IPAddress ip4(const std::string& ip, uint16_t port);
 
-		// hostname is any hostname --- obviously without the URI type (eg. https)
+		// hostname is any hostname --- obviously without the URI type (eg. https). this blocks, and only gives
+		// the first IPv4 address; if the host can't be resolved, the address is empty(). see znet::Resolver.
 		static IPAddress hostname4(const std::string& host, uint16_t port);
 
 		// equivalent to INADDR_ANY
@@ -216,6 +311,8 @@ namespace znet
 		static IPAddress udpBroadcast(uint16_t port);
 
 	private:
+		friend struct Resolver;
+
 		size_t length;
 		struct sockaddr_storage storage;
 
@@ -223,7 +320,153 @@ namespace znet
 		std::string hostname_string;
 	};
 
+	// resolves hostnames to all of their IPv4 and IPv6 addresses, and caches them. getaddrinfo() can block for a long
+	// time, so the asynchronous resolve() runs it on the resolver's own threads (started when first needed); many
+	// requests for the same host while it is being looked up share one lookup. the addresses are ordered for
+	// happy eyeballs (RFC 8305): in the system's order of preference, but alternating between the two families.
+	struct Resolver
+	{
+		struct Options
+		{
+			// getaddrinfo() doesn't tell us the TTLs of the records, so this is how long (in seconds) they are kept.
+			double cacheTimeout = 60;
+
+			// failed lookups are remembered for this long, so a host that doesn't exist isn't looked up every time.
+			double failureCacheTimeout = 5;
+
+			// the number of hosts to remember; when full, the expired ones are dropped, and then if there are none,
+			// the one that would expire first.
+			size_t maxCacheSize = 1024;
+
+			// the number of threads for asynchronous lookups.
+			size_t numThreads = 2;
+
+			// whether to ask for AAAA records too.
+			bool ipv6 = true;
+		};
+
+		using Addresses = std::vector<IPAddress>;
+
+		// the addresses if the lookup worked, otherwise why it didn't.
+		struct Result
+		{
+			bool ok() const { return this->error.empty(); }
+
+			Addresses addresses;
+			std::string error;
+		};
+
+		Resolver();
+		explicit Resolver(const Options& opts);
+		~Resolver();
+
+		Resolver(Resolver&&) = delete;
+		Resolver(const Resolver&) = delete;
+		Resolver& operator= (Resolver&&) = delete;
+		Resolver& operator= (const Resolver&) = delete;
+
+		static Resolver& shared();
+
+		// synchronous: returns straight away if the host is cached, otherwise looks it up on this thread (or
+		// waits for the lookup that is already in progress).
+		Result resolve(const std::string& host, uint16_t port);
+
+		// asynchronous: `callback` is called on one of the resolver's threads, or on this one if the host is cached.
+		void resolve(const std::string& host, uint16_t port, std::function<void (Result)> callback);
+
+		// forget all cached addresses (lookups that are in progress still finish).
+		void clear();
+		size_t cacheSize() const;
+
+	private:
+		struct Entry
+		{
+			Addresses addresses;
+			std::string error;
+			std::chrono::steady_clock::time_point expiry;
+		};
+
+		struct Lookup
+		{
+			bool done = false;
+			Entry entry;
+			std::vector<std::function<void (const Entry&)>> waiters;
+		};
+
+		void finish_lookup(const std::string& host, Entry entry);
+		Entry do_lookup(const std::string& host) const;
+		void work();
+
+		static Result make_result(const Entry& entry, uint16_t port);
+
+		Options m_options;
+
+		mutable std::mutex m_lock;
+		std::condition_variable m_cv;
+		std::unordered_map<std::string, Entry> m_cache;
+		std::unordered_map<std::string, std::shared_ptr<Lookup>> m_lookups;
+
+		std::deque<std::string> m_queue;
+		std::vector<std::thread> m_threads;
+		bool m_stopping = false;
+	};
+
+
+
+	// a batch of datagrams for UDPSocket::receiveBatch() and sendBatch(). all the memory is allocated up-front:
+	// one contiguous buffer with room for `capacity` datagrams of up to `max_size` bytes each, plus their addresses.
+	struct UDPBatch
+	{
+		explicit UDPBatch(size_t capacity = 64, size_t max_size = 2048);
+
+		// the number of datagrams in the batch. with GRO, this can be more than capacity(), since the kernel
+		// can put several datagrams (from the same sender) into each slot.
+		size_t size() const                 { return this->m_entries.size(); }
+		bool empty() const                  { return this->m_entries.empty(); }
+		size_t capacity() const             { return this->m_capacity; }
+		size_t maxDatagramSize() const      { return this->m_maxSize; }
+
+		const uint8_t* data(size_t i) const { return this->m_arena.data() + this->m_entries[i].offset; }
+		size_t length(size_t i) const       { return this->m_entries[i].length; }
 
+		// for received datagrams, the sender; for pushed ones, the destination (which is empty if
+		// it should go to the socket's remote address).
+		IPAddress address(size_t i) const;
+
+		// copy a datagram into the batch, to be sent with sendBatch(). returns false if the batch
+		// is full, or if the datagram is larger than `max_size`.
+		bool push(const uint8_t* buf, size_t len);
+		bool push(const uint8_t* buf, size_t len, const IPAddress& to);
+
+		void clear();
+
+	private:
+		friend struct UDPSocket;
+
+		struct Entry
+		{
+			size_t offset;
+			size_t length;
+			size_t slot;
+		};
+
+		size_t m_capacity;
+		size_t m_maxSize;
+		size_t m_slotsUsed = 0;
+
+		std::vector<uint8_t> m_arena;
+		std::vector<Entry> m_entries;
+		std::vector<struct sockaddr_storage> m_addrs;
+		std::vector<socklen_t> m_addrlens;
+
+		// scratch space for the syscalls, so they don't need to allocate.
+		mutable std::vector<struct iovec> m_iovs;
+	#if defined(__linux__)
+		mutable std::vector<struct mmsghdr> m_msgs;
+		mutable std::vector<uint64_t> m_control;
+		std::vector<size_t> m_segments;
+	#endif
+	};
 
 	struct UDPSocket
 	{
@@ -250,6 +493,27 @@ namespace znet
 		// synchronous
 		ssize_t receive(uint8_t* buf, size_t len, double timeout_secs = 0, IPAddress* from = nullptr);
 
+		// batched: receive as many datagrams as are available (up to the batch's capacity) with one syscall, waiting
+		// for at most `timeout_secs` for the first one; and send all the datagrams in a batch. on linux, these use
+		// recvmmsg() and sendmmsg(); elsewhere, they loop over recvfrom() and sendto(). both return the number of
+		// datagrams, or -1 on error.
+		ssize_t receiveBatch(UDPBatch& batch, double timeout_secs = 0);
+		ssize_t sendBatch(const UDPBatch& batch);
+
+		// like onReceive, but called with a batch of datagrams at a time (instead of calling the onReceive callback).
+		// the loop's threads use the batch without any locking, so this must be called before the socket is added
+		// to an EventLoop (or after it is removed); it returns false if the socket is in one.
+		bool onReceiveBatch(std::function<void (const UDPBatch&)> callback, size_t batch_size = 64);
+
+		// linux only: with GSO, sendBatch() hands a run of equally-sized datagrams to the same destination to the
+		// kernel as one big buffer, which it splits up; with GRO, the kernel may coalesce datagrams from the same
+		// sender into one slot of the batch (which gets split up again in the UDPBatch), so the slots should be
+		// large (eg. 65535 bytes). both return false if they are not supported.
+		bool useGSO(bool use);
+		bool useGRO(bool use);
+		bool usingGSO() const;
+		bool usingGRO() const;
+
 		void setBlocking(bool blocking);
 		bool isBlocking() const;
 
@@ -257,16 +521,29 @@ namespace znet
 		bool usingCallback() const;
 
 	private:
+		friend struct EventLoop;
+
 		void setup_receiver();
+		void stop_receiver();
+		bool dispatch_readable();
 		ssize_t do_socket_read(uint8_t* buf, size_t len, double timeout_secs, IPAddress* from);
+		ssize_t do_batch_read(UDPBatch& batch, bool wait);
+		ssize_t do_batch_send(const UDPBatch& batch, size_t first, size_t count);
 
 		int m_sock = -1;
 		bool m_connected = false;
 		uint8_t* m_buffer = nullptr;
+		EventLoop* m_loop = nullptr;
 		std::thread m_thread = { };
 		std::function<void ()> m_closeCallback;
 		std::function<void (const uint8_t*, size_t, const IPAddress& from)> m_callback;
 
+		std::unique_ptr<UDPBatch> m_batch;
+		std::function<void (const UDPBatch&)> m_batchCallback;
+
+		bool m_gso = false;
+		bool m_gro = false;
+
 		IPAddress m_recvaddr = { };
 		IPAddress m_sendaddr = { };
 
@@ -276,11 +553,82 @@ namespace znet
 		static constexpr size_t BUFFER_SIZE = 8192;
 	};
 
+#if ZNET_ENABLE_SSL
+
+	// an SSL_CTX that any number of sockets (on any number of threads) can share, instead of each socket making
+	// its own. it also caches the TLS session of the last connection to each host and port (including TLS 1.3
+	// session tickets, which only arrive after the handshake), and TCPSockets using the context automatically
+	// resume it when they connect to the same place again.
+	struct TLSContext
+	{
+		struct Options
+		{
+			// verify the server's certificate chain and hostname. this is off by default, to match the
+			// behaviour of TCPSocket before contexts existed.
+			bool verifyPeer = false;
+
+			// where to find trusted certificates for verifyPeer; if empty, the system's default paths are used.
+			std::string caFile;
+
+			int minVersion = TLS1_VERSION;
+
+			// the number of hosts to remember sessions for; when full, the least recently stored is dropped.
+			size_t sessionCacheSize = 256;
+		};
+
+		TLSContext();
+		explicit TLSContext(const Options& opts);
+		~TLSContext();
+
+		TLSContext(TLSContext&&) = delete;
+		TLSContext(const TLSContext&) = delete;
+		TLSContext& operator= (TLSContext&&) = delete;
+		TLSContext& operator= (const TLSContext&) = delete;
+
+		// the context used by TCPSockets constructed with `ssl = true`.
+		static TLSContext& shared();
+
+		SSL_CTX* native() const;
+		const Options& options() const;
+
+		void clearSessions();
+		size_t numSessions() const;
+
+	private:
+		friend struct TCPSocket;
+
+		struct Session
+		{
+			SSL_SESSION* session;
+			uint64_t stamp;
+		};
+
+		// returns a new reference (or null), which the caller must free.
+		SSL_SESSION* get_session(const std::string& key) const;
+		void put_session(const std::string& key, SSL_SESSION* session);
+
+		static int new_session_callback(SSL* ssl, SSL_SESSION* session);
+
+		Options m_options;
+		SSL_CTX* m_ctx = nullptr;
+
+		mutable std::mutex m_lock;
+		std::unordered_map<std::string, Session> m_sessions;
+		uint64_t m_stamp = 0;
+	};
+
+#endif // ZNET_ENABLE_SSL
+
 	struct TCPSocket
 	{
 		TCPSocket(const IPAddress& addr, bool ssl);
 		~TCPSocket();
 
+	#if ZNET_ENABLE_SSL
+		// an SSL socket using the given context (which must outlive the socket).
+		TCPSocket(const IPAddress& addr, TLSContext& tls);
+	#endif
+
 		TCPSocket(TCPSocket&&);
 		TCPSocket& operator= (TCPSocket&&);
 
@@ -291,8 +639,42 @@ namespace znet
 		void disconnect();
 		bool connected() const;
 
+		// connecting without blocking: startConnect() switches the socket to non-blocking mode and starts the
+		// TCP connection (and then the TLS handshake, for SSL sockets). until it returns Done or Failed, wait
+		// for the socket's fd() to become readable or writable (as it says), then call continueConnect().
+		enum class ConnectStatus { Done, WantRead, WantWrite, Failed };
+
+		ConnectStatus startConnect();
+		ConnectStatus continueConnect();
+
+		int fd() const;
+
+		// connect to whichever of `addrs` answers first, trying them in order, but without waiting more than
+		// `stagger_secs` for one before also starting the next (happy eyeballs, RFC 8305). for SSL sockets, this
+		// includes the handshake. the socket is returned in blocking mode, or null if none of them connected
+		// within `timeout_secs` (if it is more than 0).
+		static std::unique_ptr<TCPSocket> connectFirst(const std::vector<IPAddress>& addrs, bool ssl,
+			double timeout_secs = 0, double stagger_secs = 0.25);
+
+	#if ZNET_ENABLE_SSL
+		static std::unique_ptr<TCPSocket> connectFirst(const std::vector<IPAddress>& addrs, TLSContext& tls,
+			double timeout_secs = 0, double stagger_secs = 0.25);
+	#endif
+
+		// on a non-blocking SSL socket, send() returns 0 when it needs to wait for the socket; it must then
+		// be called again with the same data.
 		ssize_t send(const uint8_t* buf, size_t len);
 
+		// sends all the parts, in order, as though they were one buffer (but without copying them together).
+		// on a blocking socket this only returns once everything was sent; on a non-blocking one, it returns
+		// how much was sent before the socket would have blocked.
+		ssize_t sendv(const iovec* parts, size_t count);
+
+		// sends `len` bytes of the file `fd`, starting at `offset`, using sendfile() when possible (ie. not
+		// for SSL sockets, where the file has to be read and encrypted first). the file offset of `fd` is not
+		// changed. returns how much was sent, which is less than `len` if the file was shorter.
+		ssize_t sendFile(int fd, off_t offset, size_t len);
+
 		// asynchronous
 		void onClose(std::function<void ()> callback);
 		void onReceive(std::function<void (const uint8_t*, size_t)> callback);
@@ -306,13 +688,46 @@ namespace znet
 		void useCallback(bool use);
 		bool usingCallback() const;
 
+	#if ZNET_ENABLE_SSL
+		// TLS session resumption: getSSLSession() returns the session of a connected socket (or null),
+		// which the caller must release with SSL_SESSION_free(). Passing it to setSSLSession() on another
+		// socket to the same server, before connect(), lets the handshake resume it. this is only needed
+		// for sockets using different contexts; otherwise, the context's session cache does it.
+		SSL_SESSION* getSSLSession() const;
+		void setSSLSession(SSL_SESSION* session);
+		bool sessionReused() const;
+	#endif // ZNET_ENABLE_SSL
+
 	private:
+		friend struct EventLoop;
+
 		void setup_receiver();
+		void stop_receiver();
+		bool dispatch_readable();
 		ssize_t do_socket_read(uint8_t* buf, size_t len, double timeout_secs);
+		ssize_t do_nonblocking_read(uint8_t* buf, size_t len, bool& closed);
+		void prepare_handshake();
+
+		static std::unique_ptr<TCPSocket> connect_first(const std::vector<IPAddress>& addrs,
+			const std::function<std::unique_ptr<TCPSocket> (const IPAddress&)>& make, double timeout_secs,
+			double stagger_secs);
+
+	#if ZNET_ENABLE_SSL
+		void setup_ssl(TLSContext& tls);
+	#endif
 
 		int m_sock = -1;
 		bool m_connected = false;
 		uint8_t* m_buffer = nullptr;
+		EventLoop* m_loop = nullptr;
+
+		// where startConnect() and continueConnect() are up to.
+		enum class Connecting { None, TCP, TLS };
+		Connecting m_connecting = Connecting::None;
+
+		// when the current step of a non-blocking connect started (only used with ZNET_INSTRUMENT, but always
+		// here so that the layout doesn't depend on it).
+		uint64_t m_connectStart = 0;
 
 		std::thread m_thread = { };
 		std::function<void ()> m_closeCallback;
@@ -325,7 +740,7 @@ namespace znet
 	#if ZNET_ENABLE_SSL
 
 		SSL* m_ssl = nullptr;
-		SSL_CTX* m_sslContext = nullptr;
+		TLSContext* m_tls = nullptr;
 
 		bool m_useSSL = false;
 
@@ -336,6 +751,59 @@ namespace znet
 		static constexpr size_t BUFFER_SIZE = 2048;
 	};
 
+	// runs the receive callbacks of many sockets on a small, fixed number of threads, using epoll (linux) or
+	// kqueue (macOS and the BSDs), instead of every socket having its own receiving thread.
+	struct EventLoop
+	{
+		explicit EventLoop(size_t num_threads = 1);
+		~EventLoop();
+
+		EventLoop(EventLoop&&) = delete;
+		EventLoop(const EventLoop&) = delete;
+		EventLoop& operator= (EventLoop&&) = delete;
+		EventLoop& operator= (const EventLoop&) = delete;
+
+		// add a connected TCP socket or a bound UDP socket. it is switched to non-blocking mode, and any
+		// receiving thread it had is stopped; from now on, its onReceive callback is called by the loop
+		// (with at most one callback running at a time for each socket). when the other side closes a TCP
+		// connection, the socket is removed and disconnect()-ed, which calls its onClose callback.
+		bool add(TCPSocket& sock);
+		bool add(UDPSocket& sock);
+
+		// connect a TCP socket (including the TLS handshake, for SSL sockets) without blocking any thread, then
+		// add it as above. `done` is called by the loop once that finishes, with whether it succeeded; if it
+		// failed, the socket was already taken out of the loop. returns false if connecting failed immediately.
+		bool connect(TCPSocket& sock, std::function<void (bool)> done);
+
+		// stop watching the socket, and put it back into the blocking mode it had before. once this returns,
+		// no callback for the socket is running (unless this is called from that callback). this happens
+		// automatically when a socket is disconnected, closed, or destroyed.
+		void remove(TCPSocket& sock);
+		void remove(UDPSocket& sock);
+
+		// stops and joins all the threads, and removes all the sockets.
+		void stop();
+
+		size_t numThreads() const;
+		size_t numSockets() const;
+
+	private:
+		struct Poller;
+
+		// `readable` is called when there is data, and returns false once the socket is closed;
+		// `detach` is called when the socket is removed, for whatever reason. if `writable` is given, the
+		// socket is also watched for being writable to begin with, which calls that instead.
+		bool add_fd(int fd, std::function<bool ()> readable, std::function<void ()> closed,
+			std::function<void ()> detach, std::function<bool ()> writable = { });
+		void remove_fd(int fd);
+
+		// turns watching for writability on or off; only for use in the fd's own callbacks.
+		static void want_write(int fd, bool write);
+
+		std::vector<std::unique_ptr<Poller>> m_pollers;
+		std::atomic<size_t> m_next = 0;
+	};
+
 #if ZNET_ENABLE_SSL
 
 	// this initialises ssl when the program starts, by means of a global variable's constructor
@@ -367,12 +835,70 @@ namespace znet
 #include <sys/socket.h>
 #include <netinet/ip.h>
 
+#include <algorithm>
+
+#if defined(__linux__)
+	#include <sys/sendfile.h>
+#endif
+
 
 namespace znet
 {
+#if ZNET_ENABLE_SSL
+	namespace detail
+	{
+		// each SSL object remembers the key (host:port) that its session goes under in the context's cache,
+		// since the new-session callback only gets the SSL object.
+		static int tls_key_index()
+		{
+			static int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr,
+				[](void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*) {
+					delete static_cast<std::string*>(ptr);
+				});
+
+			return index;
+		}
+
+		static std::string tls_session_key(const IPAddress& addr)
+		{
+			char host[INET6_ADDRSTRLEN] = { };
+			uint16_t port = 0;
+
+			if(addr.ptr()->sa_family == AF_INET6)
+			{
+				auto in6 = reinterpret_cast<const struct sockaddr_in6*>(addr.ptr());
+				inet_ntop(AF_INET6, &in6->sin6_addr, host, sizeof(host));
+				port = ntohs(in6->sin6_port);
+			}
+			else
+			{
+				auto in = reinterpret_cast<const struct sockaddr_in*>(addr.ptr());
+				inet_ntop(AF_INET, &in->sin_addr, host, sizeof(host));
+				port = ntohs(in->sin_port);
+			}
+
+			// prefer the hostname, since one address can serve many hosts (with different certificates).
+			auto name = addr.hostnameString();
+			return (name.empty() ? std::string(host) : name) + ":" + std::to_string(port);
+		}
+
+		static const char* ssl_error_string(int ret)
+		{
+			if(auto err = ERR_get_error(); err != 0)
+			{
+				if(auto str = ERR_reason_error_string(err); str != nullptr)
+					return str;
+			}
+
+			return (ret < 0 && errno != 0) ? strerror(errno) : "unknown error";
+		}
+	}
+#endif // ZNET_ENABLE_SSL
+
 	TCPSocket::TCPSocket(const IPAddress& addr, bool ssl)
 	{
-		if(this->m_sock = socket(PF_INET, SOCK_STREAM, 0); this->m_sock < 0)
+		auto family = (addr.family() == AF_INET6 ? PF_INET6 : PF_INET);
+		if(this->m_sock = socket(family, SOCK_STREAM, 0); this->m_sock < 0)
 			ZNET_ERROR_ABORT("error creating tcp socket: %s\n", strerror(errno));
 
 		this->m_addr = addr;
@@ -382,6 +908,10 @@ namespace znet
 		int yes = 1;
 		setsockopt(this->m_sock, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
 
+	#if defined(SO_NOSIGPIPE)
+		setsockopt(this->m_sock, SOL_SOCKET, SO_NOSIGPIPE, &yes, sizeof(yes));
+	#endif
+
 		if(ssl && !ZNET_ENABLE_SSL)
 			ZNET_ERROR_ABORT("cannot use SSL without ZNET_ENABLE_SSL=1\n");
 
@@ -390,25 +920,56 @@ namespace znet
 		this->m_useSSL = ssl;
 		if(!ssl) return;
 
-		this->m_sslContext = SSL_CTX_new(TLS_client_method());
-		if(!this->m_sslContext) ZNET_ERROR_ABORT("failed to allocate SSL context: %s\n", strerror(errno));
+		this->setup_ssl(TLSContext::shared());
 
-		this->m_ssl = SSL_new(this->m_sslContext);
-		if(!this->m_ssl) ZNET_ERROR_ABORT("failed to allocate SSL object: %s\n", strerror(errno));
+	#endif // ZNET_ENABLE_SSL
+
+	}
 
-		SSL_set_min_proto_version(this->m_ssl, TLS1_VERSION);
-		SSL_set_tlsext_host_name(this->m_ssl, addr.hostnameString().c_str());
+#if ZNET_ENABLE_SSL
+	TCPSocket::TCPSocket(const IPAddress& addr, TLSContext& tls) : TCPSocket(addr, false)
+	{
+		this->m_useSSL = true;
+		this->setup_ssl(tls);
+	}
+
+	void TCPSocket::setup_ssl(TLSContext& tls)
+	{
+		this->m_tls = &tls;
+
+		this->m_ssl = SSL_new(tls.native());
+		if(!this->m_ssl) ZNET_ERROR_ABORT("failed to allocate SSL object: %s\n", strerror(errno));
 
-	    SSL_set_fd(this->m_ssl, this->m_sock);
+		auto host = this->m_addr.hostnameString();
+		SSL_set_tlsext_host_name(this->m_ssl, host.c_str());
 
-	#endif // ZNET_ENABLE_SSL
+		if(tls.options().verifyPeer && !host.empty())
+			SSL_set1_host(this->m_ssl, host.c_str());
 
+		SSL_set_ex_data(this->m_ssl, detail::tls_key_index(), new std::string(detail::tls_session_key(this->m_addr)));
+		SSL_set_fd(this->m_ssl, this->m_sock);
 	}
+#endif // ZNET_ENABLE_SSL
 
 	TCPSocket::~TCPSocket()
 	{
 		if(this->m_connected)
+		{
 			this->disconnect();
+		}
+		else if(this->m_sock != -1)
+		{
+			// it was never connected (or failed to), so there is nobody to tell.
+			if(this->m_loop)
+				this->m_loop->remove(*this);
+
+		#if ZNET_ENABLE_SSL
+			if(this->m_ssl)
+				SSL_free(this->m_ssl);
+		#endif
+
+			::close(this->m_sock);
+		}
 
 		if(this->m_buffer)
 			delete[] this->m_buffer;
@@ -422,6 +983,7 @@ namespace znet
 		this->m_sock            = other.m_sock;         other.m_sock = -1;
 		this->m_connected       = other.m_connected;    other.m_connected = false;
 		this->m_buffer          = other.m_buffer;       other.m_buffer = nullptr;
+		this->m_loop            = other.m_loop;         other.m_loop = nullptr;
 		this->m_thread          = std::move(other.m_thread);
 		this->m_addr            = std::move(other.m_addr);
 		this->m_closeCallback   = std::move(other.m_closeCallback);
@@ -430,7 +992,7 @@ namespace znet
 	#if ZNET_ENABLE_SSL
 		this->m_useSSL          = other.m_useSSL;       other.m_useSSL = false;
 		this->m_ssl             = other.m_ssl;          other.m_ssl = nullptr;
-		this->m_sslContext      = other.m_sslContext;   other.m_sslContext = nullptr;
+		this->m_tls             = other.m_tls;          other.m_tls = nullptr;
 	#endif
 	}
 
@@ -444,6 +1006,7 @@ namespace znet
 			this->m_sock            = other.m_sock;         other.m_sock = -1;
 			this->m_connected       = other.m_connected;    other.m_connected = false;
 			this->m_buffer          = other.m_buffer;       other.m_buffer = nullptr;
+			this->m_loop            = other.m_loop;         other.m_loop = nullptr;
 			this->m_thread          = std::move(other.m_thread);
 			this->m_addr            = std::move(other.m_addr);
 			this->m_closeCallback   = std::move(other.m_closeCallback);
@@ -452,7 +1015,7 @@ namespace znet
 		#if ZNET_ENABLE_SSL
 			this->m_useSSL          = other.m_useSSL;       other.m_useSSL = false;
 			this->m_ssl             = other.m_ssl;          other.m_ssl = nullptr;
-			this->m_sslContext      = other.m_sslContext;   other.m_sslContext = nullptr;
+			this->m_tls             = other.m_tls;          other.m_tls = nullptr;
 		#endif
 		}
 		return *this;
@@ -475,6 +1038,10 @@ namespace znet
 
 	bool TCPSocket::connect(double timeout_secs)
 	{
+	#if ZNET_INSTRUMENT
+		auto start = zmt::instrument::now();
+	#endif
+
 		bool wasBlocking = false;
 		if(timeout_secs > 0)
 		{
@@ -494,7 +1061,9 @@ namespace znet
 			// now we wait for the idiot to finish. use poll here because i can't be bothered.
 			// if you need microsecond precision on your connection timeout, go away.
 
-			auto fds = pollfd { .fd = this->m_sock, .events = POLLOUT };
+			struct pollfd fds = { };
+			fds.fd = this->m_sock;
+			fds.events = POLLOUT;
 			auto ret = poll(&fds, 1, static_cast<int>(timeout_secs * 1000));
 			if(ret < 0)
 			{
@@ -511,12 +1080,26 @@ namespace znet
 			this->setBlocking(wasBlocking);
 		}
 
+	#if ZNET_INSTRUMENT
+		zmt::instrument::sample("znet.tcp.connect_ns", zmt::instrument::now() - start);
+	#endif
 
 	#if ZNET_ENABLE_SSL
 		if(this->m_useSSL)
 		{
-			if(SSL_connect(this->m_ssl) < 0)
-				ZNET_ERROR_RETURN(false, "SSL connection error: %s\n", strerror(errno));
+		#if ZNET_INSTRUMENT
+			start = zmt::instrument::now();
+		#endif
+
+			this->prepare_handshake();
+			if(int ret = SSL_connect(this->m_ssl); ret != 1)
+			{
+				ZNET_ERROR_RETURN(false, "SSL connection error: %s\n", detail::ssl_error_string(ret));
+			}
+
+		#if ZNET_INSTRUMENT
+			zmt::instrument::sample("znet.tls.handshake_ns", zmt::instrument::now() - start);
+		#endif
 		}
 	#endif // ZNET_ENABLE_SSL
 
@@ -524,104 +1107,530 @@ namespace znet
 		return true;
 	}
 
-	void TCPSocket::disconnect()
+	TCPSocket::ConnectStatus TCPSocket::startConnect()
 	{
-		if(this->m_sock == -1)
-			ZNET_ERROR_RETURN_VOID("warning: attempted to close socket that was already closed\n");
+		if(this->m_connected || this->m_connecting != Connecting::None)
+			ZNET_ERROR_RETURN(ConnectStatus::Failed, "socket is already connected or connecting\n");
 
-		if(this->m_closeCallback)
-			this->m_closeCallback();
+		this->setBlocking(false);
+		if(int x = ::connect(this->m_sock, this->m_addr.ptr(), this->m_addr.size()); x < 0 && errno != EINPROGRESS)
+			ZNET_ERROR_RETURN(ConnectStatus::Failed, "socket connection error: %s\n", strerror(errno));
 
-		// tell the listener thread to die
-		__atomic_store_n(&this->m_connected, false, __ATOMIC_RELEASE);
-		if(this->m_thread.joinable())
-			this->m_thread.join();
+	#if ZNET_INSTRUMENT
+		this->m_connectStart = zmt::instrument::now();
+	#endif
 
-	#if ZNET_ENABLE_SSL
-		if(this->m_useSSL)
+		this->m_connecting = Connecting::TCP;
+		return this->continueConnect();
+	}
+
+	TCPSocket::ConnectStatus TCPSocket::continueConnect()
+	{
+		if(this->m_connecting == Connecting::TCP)
 		{
-			if(this->m_ssl)
+			// the socket only becomes writable once the connection is made (or failed).
+			struct pollfd fds = { };
+			fds.fd = this->m_sock;
+			fds.events = POLLOUT;
+			if(poll(&fds, 1, 0) == 0)
+				return ConnectStatus::WantWrite;
+
+			int err = 0;
+			socklen_t len = sizeof(err);
+			if(getsockopt(this->m_sock, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0)
 			{
-				SSL_set_shutdown(this->m_ssl, SSL_RECEIVED_SHUTDOWN | SSL_SENT_SHUTDOWN);
-				SSL_shutdown(this->m_ssl);
-				SSL_free(this->m_ssl);
+				this->m_connecting = Connecting::None;
+				ZNET_ERROR_RETURN(ConnectStatus::Failed, "socket connection error: %s\n", strerror(err ? err : errno));
 			}
 
-			if(this->m_sslContext)
+			this->m_connecting = Connecting::TLS;
+
+		#if ZNET_INSTRUMENT
+			auto now = zmt::instrument::now();
+			zmt::instrument::sample("znet.tcp.connect_ns", now - this->m_connectStart);
+			this->m_connectStart = now;
+		#endif
+
+		#if ZNET_ENABLE_SSL
+			if(this->m_useSSL)
+				this->prepare_handshake();
+		#endif
+		}
+
+		if(this->m_connecting == Connecting::TLS)
+		{
+		#if ZNET_ENABLE_SSL
+			if(this->m_useSSL)
 			{
-				SSL_CTX_free(this->m_sslContext);
+				if(int ret = SSL_connect(this->m_ssl); ret != 1)
+				{
+					auto err = SSL_get_error(this->m_ssl, ret);
+					if(err == SSL_ERROR_WANT_READ)
+						return ConnectStatus::WantRead;
+
+					else if(err == SSL_ERROR_WANT_WRITE)
+						return ConnectStatus::WantWrite;
+
+					this->m_connecting = Connecting::None;
+					ZNET_ERROR_RETURN(ConnectStatus::Failed, "SSL connection error: %s\n", detail::ssl_error_string(ret));
+				}
+
+			#if ZNET_INSTRUMENT
+				zmt::instrument::sample("znet.tls.handshake_ns", zmt::instrument::now() - this->m_connectStart);
+			#endif
 			}
+		#endif // ZNET_ENABLE_SSL
+
+			this->m_connecting = Connecting::None;
+			__atomic_store_n(&this->m_connected, true, __ATOMIC_RELEASE);
+			return ConnectStatus::Done;
 		}
-	#endif // ZNET_ENABLE_SSL
 
-		::close(this->m_sock);
+		return this->m_connected ? ConnectStatus::Done : ConnectStatus::Failed;
 	}
 
-	ssize_t TCPSocket::send(const uint8_t* buf, size_t len)
+	// before the handshake, resume the cached session for this host (unless one was set explicitly).
+	void TCPSocket::prepare_handshake()
 	{
 	#if ZNET_ENABLE_SSL
-		if(this->m_useSSL)
+		if(!this->m_tls || SSL_get_session(this->m_ssl) != nullptr)
+			return;
+
+		auto key = static_cast<std::string*>(SSL_get_ex_data(this->m_ssl, detail::tls_key_index()));
+		if(key == nullptr)
+			return;
+
+		if(auto session = this->m_tls->get_session(*key); session != nullptr)
 		{
-			// TODO: handle SSL errors
-			size_t bytes = 0;
-			SSL_write_ex(this->m_ssl, buf, len, &bytes);
-			return bytes;
+			SSL_set_session(this->m_ssl, session);
+			SSL_SESSION_free(session);
 		}
-		else
 	#endif // ZNET_ENABLE_SSL
-		{
-			auto bytes = ::send(this->m_sock, buf, len, 0);
-			if(bytes < 0) ZNET_ERROR_RETURN(-1, "socket error: %s\n", strerror(errno));
-
-			return bytes;
-		}
 	}
 
-	void TCPSocket::useCallback(bool use)
+	int TCPSocket::fd() const
 	{
-		__atomic_store_n(&this->m_usecallback, use, __ATOMIC_RELEASE);
+		return this->m_sock;
 	}
 
-	bool TCPSocket::usingCallback() const
+	std::unique_ptr<TCPSocket> TCPSocket::connectFirst(const std::vector<IPAddress>& addrs, bool ssl,
+		double timeout_secs, double stagger_secs)
 	{
-		return this->m_usecallback;
+		return connect_first(addrs, [ssl](const IPAddress& addr) {
+			return std::make_unique<TCPSocket>(addr, ssl);
+		}, timeout_secs, stagger_secs);
 	}
 
-	void TCPSocket::onClose(std::function<void ()> callback)
+#if ZNET_ENABLE_SSL
+	std::unique_ptr<TCPSocket> TCPSocket::connectFirst(const std::vector<IPAddress>& addrs, TLSContext& tls,
+		double timeout_secs, double stagger_secs)
 	{
-		this->m_closeCallback = std::move(callback);
+		return connect_first(addrs, [&tls](const IPAddress& addr) {
+			return std::make_unique<TCPSocket>(addr, tls);
+		}, timeout_secs, stagger_secs);
 	}
+#endif // ZNET_ENABLE_SSL
 
-	void TCPSocket::onReceive(std::function<void (const uint8_t*, size_t)> callback)
+	std::unique_ptr<TCPSocket> TCPSocket::connect_first(const std::vector<IPAddress>& addrs,
+		const std::function<std::unique_ptr<TCPSocket> (const IPAddress&)>& make, double timeout_secs,
+		double stagger_secs)
 	{
-		this->m_callback = std::move(callback);
+		using clock = std::chrono::steady_clock;
+		auto seconds = [](double s) {
+			return std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(s));
+		};
 
-		if(!this->m_usecallback)
-			this->setup_receiver();
-	}
+		auto deadline = (timeout_secs > 0 ? clock::now() + seconds(timeout_secs) : clock::time_point::max());
+		auto nextStart = clock::now();
+		size_t next = 0;
 
-	void TCPSocket::setup_receiver()
-	{
-		using namespace std::chrono_literals;
+		std::vector<std::unique_ptr<TCPSocket>> racing;
+		std::vector<ConnectStatus> statuses;
+		std::vector<pollfd> fds;
 
-		this->useCallback(true);
-		this->m_thread = std::thread([this]() {
+		while(true)
+		{
+			auto now = clock::now();
+			if(now >= deadline)
+				return nullptr;
 
-			while(true)
+			// start the next attempt once it is time, or straight away if all the others failed.
+			if(next < addrs.size() && (now >= nextStart || racing.empty()))
 			{
-				if(!this->m_connected || !this->m_usecallback)
-					break;
+				auto sock = make(addrs[next++]);
+				nextStart = now + seconds(stagger_secs);
+
+				if(auto st = sock->startConnect(); st == ConnectStatus::Done)
+				{
+					sock->setBlocking(true);
+					return sock;
+				}
+				else if(st != ConnectStatus::Failed)
+				{
+					racing.push_back(std::move(sock));
+					statuses.push_back(st);
+				}
+
+				continue;
+			}
 
-				auto bytes = this->do_socket_read(this->m_buffer, BUFFER_SIZE, (0.2s).count());
-				if(bytes <= 0) continue;
+			if(racing.empty())
+				return nullptr;
 
-				this->m_callback(this->m_buffer, bytes);
+			fds.clear();
+			for(size_t i = 0; i < racing.size(); i++)
+			{
+				fds.push_back(pollfd {
+					.fd = racing[i]->m_sock,
+					.events = static_cast<short>(statuses[i] == ConnectStatus::WantRead ? POLLIN : POLLOUT),
+					.revents = 0
+				});
 			}
-		});
-	}
 
-	ssize_t TCPSocket::receive(uint8_t* buf, size_t len, double timeout_secs)
-	{
+			auto until = (next < addrs.size() ? std::min(deadline, nextStart) : deadline);
+			auto wait = (until == clock::time_point::max() ? -1
+				: static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(until - now).count()));
+
+			if(poll(fds.data(), fds.size(), wait) < 0 && errno != EINTR)
+				ZNET_ERROR_RETURN(nullptr, "poll error: %s\n", strerror(errno));
+
+			for(size_t i = fds.size(); i-- > 0; )
+			{
+				if(fds[i].revents == 0)
+					continue;
+
+				auto st = racing[i]->continueConnect();
+				if(st == ConnectStatus::Done)
+				{
+					// the losers are closed when they go out of scope.
+					auto sock = std::move(racing[i]);
+					sock->setBlocking(true);
+					return sock;
+				}
+				else if(st == ConnectStatus::Failed)
+				{
+					racing.erase(racing.begin() + static_cast<ptrdiff_t>(i));
+					statuses.erase(statuses.begin() + static_cast<ptrdiff_t>(i));
+				}
+				else
+				{
+					statuses[i] = st;
+				}
+			}
+		}
+	}
+
+	void TCPSocket::disconnect()
+	{
+		if(this->m_sock == -1)
+			ZNET_ERROR_RETURN_VOID("warning: attempted to close socket that was already closed\n");
+
+		if(this->m_loop)
+			this->m_loop->remove(*this);
+
+		if(this->m_closeCallback)
+			this->m_closeCallback();
+
+		// tell the listener thread to die
+		__atomic_store_n(&this->m_connected, false, __ATOMIC_RELEASE);
+		if(this->m_thread.joinable())
+			this->m_thread.join();
+
+	#if ZNET_ENABLE_SSL
+		if(this->m_useSSL)
+		{
+			if(this->m_ssl)
+			{
+				SSL_set_shutdown(this->m_ssl, SSL_RECEIVED_SHUTDOWN | SSL_SENT_SHUTDOWN);
+				SSL_shutdown(this->m_ssl);
+				SSL_free(this->m_ssl);
+				this->m_ssl = nullptr;
+			}
+		}
+	#endif // ZNET_ENABLE_SSL
+
+		::close(this->m_sock);
+		this->m_sock = -1;
+	}
+
+	ssize_t TCPSocket::send(const uint8_t* buf, size_t len)
+	{
+	#if ZNET_ENABLE_SSL
+		if(this->m_useSSL)
+		{
+			size_t bytes = 0;
+			int ret = SSL_write_ex(this->m_ssl, buf, len, &bytes);
+			ZNET_COUNT_IO("znet.tcp.send", bytes);
+
+			if(ret != 1)
+			{
+				// in non-blocking mode, we need to wait (for the socket to become writable, or for a
+				// renegotiation to read something).
+				if(auto err = SSL_get_error(this->m_ssl, ret); err == SSL_ERROR_WANT_WRITE || err == SSL_ERROR_WANT_READ)
+					return 0;
+
+				ZNET_ERROR_RETURN(-1, "SSL error: %s\n", detail::ssl_error_string(ret));
+			}
+
+			return static_cast<ssize_t>(bytes);
+		}
+		else
+	#endif // ZNET_ENABLE_SSL
+		{
+			// don't die from SIGPIPE if the other side already closed the connection
+		#if defined(MSG_NOSIGNAL)
+			auto bytes = ::send(this->m_sock, buf, len, MSG_NOSIGNAL);
+		#else
+			auto bytes = ::send(this->m_sock, buf, len, 0);
+		#endif
+			ZNET_COUNT_IO("znet.tcp.send", bytes);
+
+			// in non-blocking mode, the send buffer might be full; that's not an error.
+			if(bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+				return 0;
+
+			if(bytes < 0) ZNET_ERROR_RETURN(-1, "socket error: %s\n", strerror(errno));
+
+			return bytes;
+		}
+	}
+
+	ssize_t TCPSocket::sendv(const iovec* parts, size_t count)
+	{
+	#if ZNET_ENABLE_SSL
+		if(this->m_useSSL)
+		{
+			// every SSL_write makes (at least) one TLS record, so small parts are put together first. anything
+			// bigger than a record is written directly, since it will be split into full records anyway.
+			constexpr size_t RECORD_SIZE = 16384;
+			uint8_t record[RECORD_SIZE];
+			size_t filled = 0;
+			size_t total = 0;
+
+			auto write = [this, &total](const void* buf, size_t len) -> bool {
+				if(len == 0)
+					return true;
+
+				size_t bytes = 0;
+				auto ok = SSL_write_ex(this->m_ssl, buf, len, &bytes) == 1;
+				ZNET_COUNT_IO("znet.tcp.send", bytes);
+
+				if(!ok)
+					return false;
+
+				total += bytes;
+				return true;
+			};
+
+			for(size_t i = 0; i < count; i++)
+			{
+				auto len = parts[i].iov_len;
+				if(filled + len > RECORD_SIZE)
+				{
+					if(!write(record, filled))
+						return static_cast<ssize_t>(total);
+
+					filled = 0;
+				}
+
+				if(len >= RECORD_SIZE)
+				{
+					if(!write(parts[i].iov_base, len))
+						return static_cast<ssize_t>(total);
+				}
+				else
+				{
+					memcpy(record + filled, parts[i].iov_base, len);
+					filled += len;
+				}
+			}
+
+			write(record, filled);
+			return static_cast<ssize_t>(total);
+		}
+		else
+	#endif // ZNET_ENABLE_SSL
+		{
+			// writev might not send everything at once, so we need our own copy of the iovecs to advance.
+			constexpr size_t MAX_PARTS = 64;
+			iovec iovs[MAX_PARTS];
+
+			size_t total = 0;
+			while(count > 0)
+			{
+				auto n = std::min(count, MAX_PARTS);
+				std::copy(parts, parts + n, iovs);
+
+				auto iov = iovs;
+				while(n > 0)
+				{
+					// sendmsg instead of writev, to get MSG_NOSIGNAL.
+					auto msg = msghdr { };
+					msg.msg_iov = iov;
+					msg.msg_iovlen = static_cast<decltype(msg.msg_iovlen)>(n);
+
+				#if defined(MSG_NOSIGNAL)
+					auto bytes = ::sendmsg(this->m_sock, &msg, MSG_NOSIGNAL);
+				#else
+					auto bytes = ::sendmsg(this->m_sock, &msg, 0);
+				#endif
+					ZNET_COUNT_IO("znet.tcp.send", bytes);
+
+					if(bytes < 0 && errno == EINTR)
+						continue;
+
+					if(bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+						return static_cast<ssize_t>(total);
+
+					if(bytes < 0) ZNET_ERROR_RETURN(-1, "socket error: %s\n", strerror(errno));
+
+					total += static_cast<size_t>(bytes);
+
+					// skip over whatever was sent completely, and move into the one that was sent partially.
+					auto sent = static_cast<size_t>(bytes);
+					while(n > 0 && sent >= iov->iov_len)
+						sent -= iov->iov_len, iov++, n--, parts++, count--;
+
+					if(n > 0)
+					{
+						iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + sent;
+						iov->iov_len -= sent;
+					}
+				}
+			}
+
+			return static_cast<ssize_t>(total);
+		}
+	}
+
+	ssize_t TCPSocket::sendFile(int fd, off_t offset, size_t len)
+	{
+		size_t total = 0;
+
+	#if defined(__linux__) || defined(__APPLE__)
+	#if ZNET_ENABLE_SSL
+		if(!this->m_useSSL)
+	#endif
+		{
+			while(total < len)
+			{
+			#if defined(__linux__)
+				auto ofs = offset + static_cast<off_t>(total);
+				auto bytes = ::sendfile(this->m_sock, fd, &ofs, len - total);
+			#else
+				// this can fail (eg. with EAGAIN) after sending some of it, so look at `amt` first.
+				auto amt = static_cast<off_t>(len - total);
+				auto ret = ::sendfile(fd, this->m_sock, offset + static_cast<off_t>(total), &amt, nullptr, 0);
+				auto bytes = (ret == 0 || amt > 0) ? static_cast<ssize_t>(amt) : -1;
+			#endif
+				ZNET_COUNT_IO("znet.tcp.send", bytes);
+
+				if(bytes < 0 && errno == EINTR)
+					continue;
+
+				if(bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+					return static_cast<ssize_t>(total);
+
+				// the file doesn't support it (eg. it is a pipe); fall back to reading it ourselves.
+				if(bytes < 0 && (errno == EINVAL || errno == ENOSYS || errno == ENOTSUP))
+					break;
+
+				if(bytes < 0) ZNET_ERROR_RETURN(-1, "socket error: %s\n", strerror(errno));
+
+				// end of the file.
+				if(bytes == 0)
+					return static_cast<ssize_t>(total);
+
+				total += static_cast<size_t>(bytes);
+			}
+
+			if(total == len)
+				return static_cast<ssize_t>(total);
+		}
+	#endif
+
+		constexpr size_t CHUNK_SIZE = 65536;
+		auto buf = std::make_unique<uint8_t[]>(CHUNK_SIZE);
+
+		while(total < len)
+		{
+			auto amt = ::pread(fd, buf.get(), std::min(CHUNK_SIZE, len - total), offset + static_cast<off_t>(total));
+			if(amt < 0 && errno == EINTR)
+				continue;
+
+			if(amt < 0) ZNET_ERROR_RETURN(-1, "error reading file: %s\n", strerror(errno));
+			if(amt == 0)
+				break;
+
+			auto chunk = iovec { .iov_base = buf.get(), .iov_len = static_cast<size_t>(amt) };
+			auto sent = this->sendv(&chunk, 1);
+			if(sent < 0)
+				return -1;
+
+			total += static_cast<size_t>(sent);
+			if(sent < amt)
+				break;
+		}
+
+		return static_cast<ssize_t>(total);
+	}
+
+	void TCPSocket::useCallback(bool use)
+	{
+		__atomic_store_n(&this->m_usecallback, use, __ATOMIC_RELEASE);
+	}
+
+	bool TCPSocket::usingCallback() const
+	{
+		return this->m_usecallback;
+	}
+
+	void TCPSocket::onClose(std::function<void ()> callback)
+	{
+		this->m_closeCallback = std::move(callback);
+	}
+
+	void TCPSocket::onReceive(std::function<void (const uint8_t*, size_t)> callback)
+	{
+		this->m_callback = std::move(callback);
+
+		// when in an event loop, the loop calls the callback for us.
+		if(this->m_loop)
+			this->useCallback(true);
+
+		else if(!this->m_usecallback)
+			this->setup_receiver();
+	}
+
+	void TCPSocket::stop_receiver()
+	{
+		this->useCallback(false);
+		if(this->m_thread.joinable())
+			this->m_thread.join();
+	}
+
+	void TCPSocket::setup_receiver()
+	{
+		using namespace std::chrono_literals;
+
+		this->useCallback(true);
+		this->m_thread = std::thread([this]() {
+
+			while(true)
+			{
+				if(!__atomic_load_n(&this->m_connected, __ATOMIC_ACQUIRE) || !__atomic_load_n(&this->m_usecallback, __ATOMIC_ACQUIRE))
+					break;
+
+				auto bytes = this->do_socket_read(this->m_buffer, BUFFER_SIZE, (0.2s).count());
+				if(bytes <= 0) continue;
+
+				this->m_callback(this->m_buffer, bytes);
+			}
+		});
+	}
+
+	ssize_t TCPSocket::receive(uint8_t* buf, size_t len, double timeout_secs)
+	{
 		this->useCallback(false);
 		return this->do_socket_read(buf, len, timeout_secs);
 	}
@@ -636,12 +1645,17 @@ namespace znet
 			// TODO: handle SSL errors
 			size_t bytes = 0;
 			SSL_read_ex(this->m_ssl, buf, len, &bytes);
+			ZNET_COUNT_IO("znet.tcp.recv", bytes);
+
 			return bytes;
 		}
 		else
 	#endif // ZNET_ENABLE_SSL
 		{
-			if(auto bytes = recv(this->m_sock, buf, len, 0); bytes < 0)
+			auto bytes = recv(this->m_sock, buf, len, 0);
+			ZNET_COUNT_IO("znet.tcp.recv", bytes);
+
+			if(bytes < 0)
 			{
 				if(errno == EAGAIN || errno == EWOULDBLOCK)
 					return 0;
@@ -659,295 +1673,1830 @@ namespace znet
 	}
 
 
-#if ZNET_ENABLE_SSL
-	SSLInitialiser::SSLInitialiser()
+	// called by the event loop when the socket is readable; returns false once the connection is closed.
+	// to be fair to the other sockets, only read a limited amount at once -- the loop is level-triggered, so
+	// it comes back if there's more. the exception is data that openssl has already decrypted and buffered,
+	// which the loop can't see, so that has to be read now.
+	bool TCPSocket::dispatch_readable()
 	{
-		OPENSSL_init_ssl(OPENSSL_INIT_LOAD_SSL_STRINGS | OPENSSL_INIT_LOAD_CRYPTO_STRINGS,
-			nullptr);
+		constexpr int MAX_READS = 16;
 
-		OPENSSL_init_crypto(OPENSSL_INIT_LOAD_CONFIG | OPENSSL_INIT_ADD_ALL_CIPHERS | OPENSSL_INIT_ADD_ALL_DIGESTS,
-			nullptr
-		);
+		for(int i = 0; ; i++)
+		{
+			bool pending = false;
+		#if ZNET_ENABLE_SSL
+			pending = (this->m_useSSL && SSL_pending(this->m_ssl) > 0);
+		#endif
+
+			if(i >= MAX_READS && !pending)
+				return true;
+
+			bool closed = false;
+			auto bytes = this->do_nonblocking_read(this->m_buffer, BUFFER_SIZE, closed);
+			if(closed)
+				return false;
+
+			if(bytes <= 0)
+				return true;
+
+			if(this->m_usecallback)
+				this->m_callback(this->m_buffer, static_cast<size_t>(bytes));
+		}
 	}
 
-	static SSLInitialiser sslInitialiser;
-#endif // ZNET_ENABLE_SSL
-}
+	// unlike do_socket_read, this tells apart "nothing to read" (returns 0) and the connection
+	// being closed (sets `closed`).
+	ssize_t TCPSocket::do_nonblocking_read(uint8_t* buf, size_t len, bool& closed)
+	{
+	#if ZNET_ENABLE_SSL
+		if(this->m_useSSL)
+		{
+			size_t bytes = 0;
+			int ret = SSL_read_ex(this->m_ssl, buf, len, &bytes);
+			ZNET_COUNT_IO("znet.tcp.recv", bytes);
 
-#endif // ZNET_TCP_IMPLEMENTATION
+			if(ret == 1)
+				return static_cast<ssize_t>(bytes);
 
+			else if(auto err = SSL_get_error(this->m_ssl, ret); err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE)
+				return 0;
 
+			closed = true;
+			return -1;
+		}
+		else
+	#endif // ZNET_ENABLE_SSL
+		{
+			while(true)
+			{
+				auto bytes = recv(this->m_sock, buf, len, 0);
+				ZNET_COUNT_IO("znet.tcp.recv", bytes);
 
+				if(bytes > 0)
+					return bytes;
 
-#if ZNET_UDP_IMPLEMENTATION
+				if(bytes < 0 && errno == EINTR)
+					continue;
 
-#include <cstdio>
-#include <cstdlib>
+				if(bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+					return 0;
 
-#include <netdb.h>
-#include <unistd.h>
-#include <sys/types.h>
-#include <arpa/inet.h>
-#include <sys/socket.h>
-#include <netinet/ip.h>
+				// either an orderly shutdown (0), or an error like ECONNRESET.
+				closed = true;
+				return -1;
+			}
+		}
+	}
+
+	bool EventLoop::add(TCPSocket& sock)
+	{
+		if(!sock.connected())
+			ZNET_ERROR_RETURN(false, "cannot add a socket that is not connected to an event loop\n");
+
+		if(sock.m_loop != nullptr)
+			ZNET_ERROR_RETURN(false, "socket is already in an event loop\n");
+
+		sock.stop_receiver();
+
+		auto wasBlocking = sock.isBlocking();
+		sock.setBlocking(false);
+		sock.m_loop = this;
+		sock.useCallback(true);
+
+		auto detach = [&sock, wasBlocking]() {
+			sock.m_loop = nullptr;
+			sock.useCallback(false);
+			sock.setBlocking(wasBlocking);
+		};
+
+		if(!this->add_fd(sock.m_sock, [&sock]() { return sock.dispatch_readable(); }, [&sock]() { sock.disconnect(); }, detach))
+		{
+			detach();
+			return false;
+		}
+
+		return true;
+	}
+
+	void EventLoop::remove(TCPSocket& sock)
+	{
+		if(sock.m_loop == this)
+			this->remove_fd(sock.m_sock);
+	}
+
+	bool EventLoop::connect(TCPSocket& sock, std::function<void (bool)> done)
+	{
+		if(sock.connected())
+			ZNET_ERROR_RETURN(false, "socket is already connected\n");
+
+		if(sock.m_loop != nullptr)
+			ZNET_ERROR_RETURN(false, "socket is already in an event loop\n");
+
+		sock.stop_receiver();
+
+		auto wasBlocking = sock.isBlocking();
+		if(sock.startConnect() == TCPSocket::ConnectStatus::Failed)
+		{
+			sock.setBlocking(wasBlocking);
+			return false;
+		}
+
+		sock.m_loop = this;
+
+		auto detach = [&sock, wasBlocking]() {
+			sock.m_loop = nullptr;
+			sock.useCallback(false);
+			sock.setBlocking(wasBlocking);
+		};
+
+		// until the handshake is done, every event (readable or writable) just moves it along. after that,
+		// this is the same as a socket that was added while connected.
+		// the socket starts off watched for writing, which is also how we find out if it connected straight
+		// away (eg. to localhost, without SSL). these callbacks only ever run on the poller's thread.
+		auto fd = sock.m_sock;
+		auto connecting = std::make_shared<bool>(true);
+		auto step = [&sock, fd, done, connecting]() -> bool {
+			if(!*connecting)
+				return sock.dispatch_readable();
+
+			auto status = (sock.m_connected ? TCPSocket::ConnectStatus::Done : sock.continueConnect());
+			switch(status)
+			{
+				case TCPSocket::ConnectStatus::WantRead:
+					want_write(fd, false);
+					return true;
+
+				case TCPSocket::ConnectStatus::WantWrite:
+					want_write(fd, true);
+					return true;
+
+				case TCPSocket::ConnectStatus::Done:
+					*connecting = false;
+					want_write(fd, false);
+					sock.useCallback(true);
+					done(true);
+
+					// the server might have sent something along with the end of the handshake.
+					return sock.m_connected ? sock.dispatch_readable() : true;
+
+				default:
+					return false;
+			}
+		};
+
+		auto closed = [&sock, done]() {
+			if(sock.m_connected)
+				sock.disconnect();
+			else
+				done(false);
+		};
+
+		if(!this->add_fd(fd, step, closed, detach, step))
+		{
+			detach();
+			return false;
+		}
+
+		return true;
+	}
+
+
+#if ZNET_ENABLE_SSL
+	SSL_SESSION* TCPSocket::getSSLSession() const
+	{
+		if(!this->m_useSSL || !this->m_ssl || !this->m_connected)
+			return nullptr;
+
+		return SSL_get1_session(this->m_ssl);
+	}
+
+	void TCPSocket::setSSLSession(SSL_SESSION* session)
+	{
+		if(!this->m_useSSL || !this->m_ssl)
+			return;
+
+		if(SSL_set_session(this->m_ssl, session) != 1)
+			ZNET_ERROR_RETURN_VOID("failed to set SSL session\n");
+	}
+
+	bool TCPSocket::sessionReused() const
+	{
+		return this->m_useSSL && this->m_ssl && SSL_session_reused(this->m_ssl) == 1;
+	}
+
+	TLSContext::TLSContext() : TLSContext(Options { })
+	{
+	}
+
+	TLSContext::TLSContext(const Options& opts) : m_options(opts)
+	{
+		this->m_ctx = SSL_CTX_new(TLS_client_method());
+		if(!this->m_ctx) ZNET_ERROR_ABORT("failed to allocate SSL context: %s\n", strerror(errno));
+
+		SSL_CTX_set_min_proto_version(this->m_ctx, opts.minVersion);
+
+		// a non-blocking SSL_write that could not finish has to be retried, but not necessarily from the same
+		// address (eg. when sending from a buffer that may have been reallocated).
+		SSL_CTX_set_mode(this->m_ctx, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
+		if(opts.verifyPeer)
+		{
+			SSL_CTX_set_verify(this->m_ctx, SSL_VERIFY_PEER, nullptr);
+
+			auto loaded = opts.caFile.empty()
+				? SSL_CTX_set_default_verify_paths(this->m_ctx)
+				: SSL_CTX_load_verify_locations(this->m_ctx, opts.caFile.c_str(), nullptr);
+
+			if(loaded != 1)
+				fprintf(stderr, "failed to load trusted certificates: %s\n", detail::ssl_error_string(0));
+		}
+
+		// openssl's own client-side cache is useless (it never looks anything up), so keep the sessions
+		// ourselves. the callback also sees the tickets that a TLS 1.3 server sends after the handshake.
+		SSL_CTX_set_app_data(this->m_ctx, this);
+		SSL_CTX_set_session_cache_mode(this->m_ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+		SSL_CTX_sess_set_new_cb(this->m_ctx, &TLSContext::new_session_callback);
+	}
+
+	TLSContext::~TLSContext()
+	{
+		this->clearSessions();
+
+		// sockets keep the SSL_CTX alive for as long as they need it, but they must not call back into us.
+		SSL_CTX_set_app_data(this->m_ctx, nullptr);
+		SSL_CTX_free(this->m_ctx);
+	}
+
+	TLSContext& TLSContext::shared()
+	{
+		static TLSContext context;
+		return context;
+	}
+
+	SSL_CTX* TLSContext::native() const
+	{
+		return this->m_ctx;
+	}
+
+	const TLSContext::Options& TLSContext::options() const
+	{
+		return this->m_options;
+	}
+
+	void TLSContext::clearSessions()
+	{
+		auto lk = std::lock_guard<std::mutex>(this->m_lock);
+		for(auto& [ key, sess ] : this->m_sessions)
+			SSL_SESSION_free(sess.session);
+
+		this->m_sessions.clear();
+	}
+
+	size_t TLSContext::numSessions() const
+	{
+		auto lk = std::lock_guard<std::mutex>(this->m_lock);
+		return this->m_sessions.size();
+	}
+
+	SSL_SESSION* TLSContext::get_session(const std::string& key) const
+	{
+		auto lk = std::lock_guard<std::mutex>(this->m_lock);
+		if(auto it = this->m_sessions.find(key); it != this->m_sessions.end())
+		{
+			SSL_SESSION_up_ref(it->second.session);
+			return it->second.session;
+		}
+
+		return nullptr;
+	}
+
+	void TLSContext::put_session(const std::string& key, SSL_SESSION* session)
+	{
+		auto lk = std::lock_guard<std::mutex>(this->m_lock);
+		if(auto it = this->m_sessions.find(key); it != this->m_sessions.end())
+		{
+			SSL_SESSION_free(it->second.session);
+			it->second = Session { .session = session, .stamp = this->m_stamp++ };
+			return;
+		}
+
+		if(this->m_options.sessionCacheSize == 0)
+		{
+			SSL_SESSION_free(session);
+			return;
+		}
+
+		// the cache is small, so finding the oldest entry by looking at all of them is fine.
+		if(this->m_sessions.size() >= this->m_options.sessionCacheSize)
+		{
+			auto oldest = std::min_element(this->m_sessions.begin(), this->m_sessions.end(), [](auto& a, auto& b) {
+				return a.second.stamp < b.second.stamp;
+			});
+
+			SSL_SESSION_free(oldest->second.session);
+			this->m_sessions.erase(oldest);
+		}
+
+		this->m_sessions.emplace(key, Session { .session = session, .stamp = this->m_stamp++ });
+	}
+
+	int TLSContext::new_session_callback(SSL* ssl, SSL_SESSION* session)
+	{
+		auto self = static_cast<TLSContext*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+		auto key = static_cast<std::string*>(SSL_get_ex_data(ssl, detail::tls_key_index()));
+
+		if(self == nullptr || key == nullptr || SSL_SESSION_is_resumable(session) != 1)
+			return 0;
+
+		// returning 1 means we keep the reference we were given.
+		self->put_session(*key, session);
+		return 1;
+	}
+
+	SSLInitialiser::SSLInitialiser()
+	{
+		OPENSSL_init_ssl(OPENSSL_INIT_LOAD_SSL_STRINGS | OPENSSL_INIT_LOAD_CRYPTO_STRINGS,
+			nullptr);
+
+		OPENSSL_init_crypto(OPENSSL_INIT_LOAD_CONFIG | OPENSSL_INIT_ADD_ALL_CIPHERS | OPENSSL_INIT_ADD_ALL_DIGESTS,
+			nullptr
+		);
+	}
+
+	static SSLInitialiser sslInitialiser;
+#endif // ZNET_ENABLE_SSL
+}
+
+#endif // ZNET_TCP_IMPLEMENTATION
+
+
+
+
+#if ZNET_UDP_IMPLEMENTATION
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/ip.h>
+
+#if defined(__linux__)
+	#include <netinet/udp.h>
+#endif
+
+namespace znet
+{
+	UDPSocket::UDPSocket(const IPAddress& local, const IPAddress& remote)
+	{
+		if(this->m_sock = socket(PF_INET, SOCK_DGRAM, 0); this->m_sock < 0)
+			ZNET_ERROR_ABORT("error creating udp socket: %s\n", strerror(errno));
+
+		this->m_recvaddr = local;
+		this->m_sendaddr = remote;
+
+		if(this->m_sendaddr.empty())
+			this->m_sendaddr = local;
+
+		// enable broadcast, just in case. it doesn't matter anyway.
+		int yes = 1;
+		setsockopt(this->m_sock, SOL_SOCKET, SO_BROADCAST, &yes, sizeof(yes));
+
+		int size = 1024 * 1024 * 64;
+		setsockopt(this->m_sock, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+		this->m_buffer = new uint8_t[BUFFER_SIZE];
+		this->m_callback = [](auto...) { };
+	}
+
+	UDPSocket::~UDPSocket()
+	{
+		if(this->m_connected)
+			this->close();
+
+		if(this->m_buffer)
+			delete[] this->m_buffer;
+	}
+
+	UDPSocket::UDPSocket(UDPSocket&& other)
+	{
+		if(other.connected())
+			ZNET_ERROR_ABORT("cannot move socket while it is connected!");
+
+		this->m_sock            = other.m_sock;         other.m_sock = -1;
+		this->m_connected       = other.m_connected;    other.m_connected = false;
+		this->m_buffer          = other.m_buffer;       other.m_buffer = nullptr;
+		this->m_loop            = other.m_loop;         other.m_loop = nullptr;
+		this->m_thread          = std::move(other.m_thread);
+		this->m_recvaddr        = std::move(other.m_recvaddr);
+		this->m_sendaddr        = std::move(other.m_sendaddr);
+		this->m_closeCallback   = std::move(other.m_closeCallback);
+		this->m_callback        = std::move(other.m_callback);
+		this->m_batch           = std::move(other.m_batch);
+		this->m_batchCallback   = std::move(other.m_batchCallback);
+		this->m_gso             = other.m_gso;
+		this->m_gro             = other.m_gro;
+	}
+
+	UDPSocket& UDPSocket::operator= (UDPSocket&& other)
+	{
+		if(this != &other)
+		{
+			if(other.connected())
+				ZNET_ERROR_ABORT("cannot move socket while it is connected!");
+
+			this->m_sock            = other.m_sock;         other.m_sock = -1;
+			this->m_connected       = other.m_connected;    other.m_connected = false;
+			this->m_buffer          = other.m_buffer;       other.m_buffer = nullptr;
+			this->m_loop            = other.m_loop;         other.m_loop = nullptr;
+			this->m_thread          = std::move(other.m_thread);
+			this->m_recvaddr        = std::move(other.m_recvaddr);
+			this->m_sendaddr        = std::move(other.m_sendaddr);
+			this->m_closeCallback   = std::move(other.m_closeCallback);
+			this->m_callback        = std::move(other.m_callback);
+			this->m_batch           = std::move(other.m_batch);
+			this->m_batchCallback   = std::move(other.m_batchCallback);
+			this->m_gso             = other.m_gso;
+			this->m_gro             = other.m_gro;
+		}
+		return *this;
+	}
+
+	void UDPSocket::setBlocking(bool blocking)
+	{
+		detail::set_blocking(this->m_sock, blocking);
+	}
+
+	bool UDPSocket::isBlocking() const
+	{
+		return detail::get_blocking(this->m_sock);
+	}
+
+	void UDPSocket::useCallback(bool use)
+	{
+		__atomic_store_n(&this->m_usecallback, use, __ATOMIC_RELEASE);
+	}
+
+	bool UDPSocket::usingCallback() const
+	{
+		return this->m_usecallback;
+	}
+
+	bool UDPSocket::bind()
+	{
+		if(::bind(this->m_sock, this->m_recvaddr.ptr(), this->m_recvaddr.size()) < 0)
+			ZNET_ERROR_RETURN(false, "failed to bind udp socket: %s\n", strerror(errno));
+
+		__atomic_store_n(&this->m_connected, true, __ATOMIC_RELEASE);
+		return true;
+	}
+
+	void UDPSocket::close()
+	{
+		if(this->m_sock == -1)
+			ZNET_ERROR_RETURN_VOID("warning: attempted to close socket that was already closed\n");
+
+		if(this->m_loop)
+			this->m_loop->remove(*this);
+
+		if(this->m_closeCallback)
+			this->m_closeCallback();
+
+		// tell the listener thread to die
+		__atomic_store_n(&this->m_connected, false, __ATOMIC_RELEASE);
+		if(this->m_thread.joinable())
+			this->m_thread.join();
+
+		::close(this->m_sock);
+		this->m_sock = -1;
+	}
+
+	bool UDPSocket::connected() const
+	{
+		return this->m_connected;
+	}
+
+	void UDPSocket::reset()
+	{
+		this->m_callback = { };
+		this->m_closeCallback = { };
+	}
+
+	void UDPSocket::onClose(std::function<void ()> callback)
+	{
+		this->m_closeCallback = std::move(callback);
+	}
+
+	void UDPSocket::onReceive(std::function<void (const uint8_t*, size_t, const IPAddress& from)> callback)
+	{
+		this->m_callback = std::move(callback);
+
+		// when in an event loop, the loop calls the callback for us.
+		if(this->m_loop)
+			this->useCallback(true);
+
+		else if(!this->m_usecallback)
+			this->setup_receiver();
+	}
+
+	bool UDPSocket::onReceiveBatch(std::function<void (const UDPBatch&)> callback, size_t batch_size)
+	{
+		// the batch is shared with the receiver thread, so it needs to be stopped while we swap it out. we can't
+		// do that to an event loop's thread, which might be receiving into the batch right now.
+		if(this->m_loop)
+			ZNET_ERROR_RETURN(false, "cannot change the batch callback of a socket that is in an event loop\n");
+
+		this->stop_receiver();
+
+		// with GRO, each slot may contain many coalesced datagrams, so it needs to be as large as possible.
+		auto slot_size = this->m_gro ? 65535 : BUFFER_SIZE;
+		if(!this->m_batch || this->m_batch->capacity() != batch_size || this->m_batch->maxDatagramSize() != slot_size)
+			this->m_batch = std::make_unique<UDPBatch>(batch_size, slot_size);
+
+		this->m_batchCallback = std::move(callback);
+		this->setup_receiver();
+
+		return true;
+	}
+
+	void UDPSocket::stop_receiver()
+	{
+		this->useCallback(false);
+		if(this->m_thread.joinable())
+			this->m_thread.join();
+	}
+
+	// called by the event loop when the socket is readable. as with TCP, only read a limited number of
+	// datagrams at once, and let the (level-triggered) loop come back for the rest.
+	bool UDPSocket::dispatch_readable()
+	{
+		constexpr int MAX_READS = 64;
+
+		if(this->m_batchCallback)
+		{
+			// one batch is already up to 64 datagrams.
+			for(int i = 0; i < MAX_READS / 16; i++)
+			{
+				if(this->do_batch_read(*this->m_batch, /* wait: */ false) <= 0)
+					break;
+
+				if(this->m_usecallback)
+					this->m_batchCallback(*this->m_batch);
+			}
+
+			return true;
+		}
+
+		for(int i = 0; i < MAX_READS; i++)
+		{
+			socklen_t sa_len = sizeof(struct sockaddr_storage);
+			struct sockaddr_storage sa = { };
+
+			auto bytes = recvfrom(this->m_sock, this->m_buffer, BUFFER_SIZE, 0,
+				reinterpret_cast<struct sockaddr*>(&sa), &sa_len);
+			ZNET_COUNT_IO("znet.udp.recv", bytes);
+
+			if(bytes < 0)
+			{
+				if(errno == EINTR)
+					continue;
+
+				// a UDP socket never gets "closed" by the other side, so just wait for the next datagram.
+				break;
+			}
+
+			if(this->m_usecallback)
+				this->m_callback(this->m_buffer, static_cast<size_t>(bytes), IPAddress(&sa, sa_len));
+		}
+
+		return true;
+	}
+
+	bool EventLoop::add(UDPSocket& sock)
+	{
+		if(!sock.connected())
+			ZNET_ERROR_RETURN(false, "cannot add a socket that is not bound to an event loop\n");
+
+		if(sock.m_loop != nullptr)
+			ZNET_ERROR_RETURN(false, "socket is already in an event loop\n");
+
+		sock.stop_receiver();
+
+		auto wasBlocking = sock.isBlocking();
+		sock.setBlocking(false);
+		sock.m_loop = this;
+		sock.useCallback(true);
+
+		auto detach = [&sock, wasBlocking]() {
+			sock.m_loop = nullptr;
+			sock.useCallback(false);
+			sock.setBlocking(wasBlocking);
+		};
+
+		if(!this->add_fd(sock.m_sock, [&sock]() { return sock.dispatch_readable(); }, []() { }, detach))
+		{
+			detach();
+			return false;
+		}
+
+		return true;
+	}
+
+	void EventLoop::remove(UDPSocket& sock)
+	{
+		if(sock.m_loop == this)
+			this->remove_fd(sock.m_sock);
+	}
+
+	void UDPSocket::setup_receiver()
+	{
+		using namespace std::chrono_literals;
+
+		this->useCallback(true);
+		this->m_thread = std::thread([this]() {
+
+			while(true)
+			{
+				if(!__atomic_load_n(&this->m_connected, __ATOMIC_ACQUIRE) || !__atomic_load_n(&this->m_usecallback, __ATOMIC_ACQUIRE))
+					break;
+
+				if(this->m_batchCallback)
+				{
+					detail::set_timeout(this->m_sock, (0.2s).count());
+					if(this->do_batch_read(*this->m_batch, /* wait: */ true) > 0)
+						this->m_batchCallback(*this->m_batch);
+
+					continue;
+				}
+
+				IPAddress addr = { };
+				auto bytes = this->do_socket_read(this->m_buffer, BUFFER_SIZE, (0.2s).count(), &addr);
+				if(bytes <= 0) continue;
+
+				this->m_callback(this->m_buffer, bytes, addr);
+			}
+		});
+	}
+
+	ssize_t UDPSocket::send(const uint8_t* buf, size_t len)
+	{
+		auto bytes = sendto(this->m_sock, buf, len, 0, this->m_sendaddr.ptr(), this->m_sendaddr.size());
+		ZNET_COUNT_IO("znet.udp.send", bytes);
+
+		return bytes;
+	}
+
+	ssize_t UDPSocket::receive(uint8_t* buf, size_t len, double timeout_secs, IPAddress* from)
+	{
+		this->useCallback(false);
+		return this->do_socket_read(buf, len, timeout_secs, from);
+	}
+
+	ssize_t UDPSocket::do_socket_read(uint8_t* buf, size_t len, double timeout_secs, IPAddress* from)
+	{
+		detail::set_timeout(this->m_sock, timeout_secs);
+
+		socklen_t sa_len = sizeof(struct sockaddr_storage);
+		struct sockaddr_storage sa = { };
+
+		auto bytes = recvfrom(this->m_sock, buf, len,
+			0, reinterpret_cast<struct sockaddr*>(&sa), &sa_len);
+		ZNET_COUNT_IO("znet.udp.recv", bytes);
+
+		if(bytes < 0 && !(errno == EAGAIN || errno == EWOULDBLOCK))
+			ZNET_ERROR_RETURN(-1, "socket error: %s\n", strerror(errno));
+
+		if(from)
+			*from = IPAddress(&sa, sa_len);
+
+		return bytes;
+	}
+
+	ssize_t UDPSocket::receiveBatch(UDPBatch& batch, double timeout_secs)
+	{
+		this->useCallback(false);
+		detail::set_timeout(this->m_sock, timeout_secs);
+
+		return this->do_batch_read(batch, /* wait: */ true);
+	}
+
+	// if `wait` is true, block (subject to the socket's timeout) until the first datagram arrives, then
+	// take whatever else is already queued. returns the number of datagrams, 0 if there were none.
+	ssize_t UDPSocket::do_batch_read(UDPBatch& batch, bool wait)
+	{
+		batch.clear();
+
+		const auto cap = batch.m_capacity;
+		const auto max = batch.m_maxSize;
+
+	#if defined(__linux__)
+		constexpr size_t CONTROL_WORDS = (CMSG_SPACE(sizeof(int)) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+		batch.m_msgs.resize(cap);
+		batch.m_iovs.resize(cap);
+		batch.m_control.resize(this->m_gro ? cap * CONTROL_WORDS : 0);
+
+		for(size_t i = 0; i < cap; i++)
+		{
+			batch.m_iovs[i] = { .iov_base = batch.m_arena.data() + i * max, .iov_len = max };
+
+			auto& hdr = batch.m_msgs[i].msg_hdr;
+			hdr = { };
+			hdr.msg_name = &batch.m_addrs[i];
+			hdr.msg_namelen = sizeof(struct sockaddr_storage);
+			hdr.msg_iov = &batch.m_iovs[i];
+			hdr.msg_iovlen = 1;
+
+			if(this->m_gro)
+			{
+				hdr.msg_control = &batch.m_control[i * CONTROL_WORDS];
+				hdr.msg_controllen = CONTROL_WORDS * sizeof(uint64_t);
+			}
+		}
+
+		int n = 0;
+		do {
+			n = recvmmsg(this->m_sock, batch.m_msgs.data(), cap, wait ? MSG_WAITFORONE : MSG_DONTWAIT, nullptr);
+		} while(n < 0 && errno == EINTR);
+
+	#if ZNET_INSTRUMENT
+		size_t received = 0;
+		for(int i = 0; i < n; i++)
+			received += batch.m_msgs[static_cast<size_t>(i)].msg_len;
+
+		ZNET_COUNT_IO("znet.udp.recv", received);
+	#endif
+
+		if(n < 0)
+		{
+			if(errno == EAGAIN || errno == EWOULDBLOCK)
+				return 0;
+
+			ZNET_ERROR_RETURN(-1, "socket error: %s\n", strerror(errno));
+		}
+
+		// find the segment size of every slot first, so that the entries can be made room for all at once.
+		size_t total = 0;
+		for(size_t i = 0; i < static_cast<size_t>(n); i++)
+		{
+			auto& hdr = batch.m_msgs[i].msg_hdr;
+			batch.m_addrlens[i] = hdr.msg_namelen;
+
+			size_t len = batch.m_msgs[i].msg_len;
+			size_t segment = len;
+
+		#if defined(UDP_GRO)
+			if(this->m_gro)
+			{
+				for(auto cm = CMSG_FIRSTHDR(&hdr); cm != nullptr; cm = CMSG_NXTHDR(&hdr, cm))
+				{
+					if(cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO)
+					{
+						int gso_size = 0;
+						memcpy(&gso_size, CMSG_DATA(cm), sizeof(int));
+
+						if(gso_size > 0)
+							segment = static_cast<size_t>(gso_size);
+					}
+				}
+			}
+		#endif
+
+			if(segment == 0 || segment >= len)
+				segment = len;
+
+			batch.m_segments[i] = segment;
+			total += (len == 0 ? 1 : (len + segment - 1) / segment);
+		}
+
+		// this only allocates when a batch has more datagrams than any before it did.
+		batch.m_entries.reserve(total);
+
+		// split coalesced datagrams back up; they stay where they are in the arena, and share the same slot (and
+		// sender).
+		for(size_t i = 0; i < static_cast<size_t>(n); i++)
+		{
+			size_t len = batch.m_msgs[i].msg_len;
+			size_t segment = batch.m_segments[i];
+
+			if(segment >= len)
+			{
+				batch.m_entries.push_back({ .offset = i * max, .length = len, .slot = i });
+				continue;
+			}
+
+			for(size_t ofs = 0; ofs < len; ofs += segment)
+				batch.m_entries.push_back({ .offset = i * max + ofs, .length = std::min(segment, len - ofs), .slot = i });
+		}
+
+		batch.m_slotsUsed = static_cast<size_t>(n);
+	#else
+		for(size_t i = 0; i < cap; i++)
+		{
+			socklen_t sa_len = sizeof(struct sockaddr_storage);
+			auto bytes = recvfrom(this->m_sock, batch.m_arena.data() + i * max, max, (i == 0 && wait) ? 0 : MSG_DONTWAIT,
+				reinterpret_cast<struct sockaddr*>(&batch.m_addrs[i]), &sa_len);
+			ZNET_COUNT_IO("znet.udp.recv", bytes);
+
+			if(bytes < 0)
+			{
+				if(errno == EINTR)
+				{
+					i--;
+					continue;
+				}
+
+				if(errno == EAGAIN || errno == EWOULDBLOCK || i > 0)
+					break;
+
+				ZNET_ERROR_RETURN(-1, "socket error: %s\n", strerror(errno));
+			}
+
+			batch.m_addrlens[i] = sa_len;
+			batch.m_entries.push_back({ .offset = i * max, .length = static_cast<size_t>(bytes), .slot = i });
+			batch.m_slotsUsed = i + 1;
+		}
+	#endif
+
+		return static_cast<ssize_t>(batch.m_entries.size());
+	}
+
+	ssize_t UDPSocket::sendBatch(const UDPBatch& batch)
+	{
+		const auto count = batch.size();
+
+		size_t sent = 0;
+		size_t pending = 0;
+
+	#if defined(__linux__) && defined(UDP_SEGMENT)
+		// the kernel caps this at 64 segments, and the whole thing still needs to fit in one (max-size) datagram.
+		constexpr size_t MAX_SEGMENTS = 64;
+		constexpr size_t MAX_GSO_BYTES = 65507;
+
+		auto same_dest = [&batch](size_t a, size_t b) -> bool {
+			auto sa = batch.m_entries[a].slot;
+			auto sb = batch.m_entries[b].slot;
+			return batch.m_addrlens[sa] == batch.m_addrlens[sb]
+				&& memcmp(&batch.m_addrs[sa], &batch.m_addrs[sb], batch.m_addrlens[sa]) == 0;
+		};
+
+		for(size_t i = 0; this->m_gso && i < count; )
+		{
+			// find a run of datagrams going to the same place, all the same size except (possibly) a smaller last one.
+			const auto seg = batch.length(i);
+
+			size_t run = 1;
+			size_t total = seg;
+			while(i + run < count && run < MAX_SEGMENTS && seg > 0)
+			{
+				auto len = batch.length(i + run);
+				if(len > seg || total + len > MAX_GSO_BYTES || !same_dest(i, i + run))
+					break;
+
+				total += len;
+				run += 1;
+
+				if(len < seg)
+					break;
+			}
+
+			if(run < 2)
+			{
+				i += 1;
+				continue;
+			}
+
+			// send everything before this run the normal way first, to preserve the ordering.
+			if(pending < i)
+			{
+				auto n = this->do_batch_send(batch, pending, i - pending);
+				if(n > 0)
+					sent += static_cast<size_t>(n);
+
+				if(n < 0 || static_cast<size_t>(n) < i - pending)
+					return sent > 0 ? static_cast<ssize_t>(sent) : -1;
+
+				pending = i;
+			}
+
+			batch.m_iovs.resize(std::max(batch.m_iovs.size(), run));
+			for(size_t k = 0; k < run; k++)
+				batch.m_iovs[k] = { .iov_base = const_cast<uint8_t*>(batch.data(i + k)), .iov_len = batch.length(i + k) };
+
+			alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(uint16_t))] = { };
+
+			auto slot = batch.m_entries[i].slot;
+			auto to_own = batch.m_addrlens[slot] == 0;
+
+			struct msghdr hdr = { };
+			hdr.msg_name = to_own ? static_cast<void*>(this->m_sendaddr.ptr()) : const_cast<struct sockaddr_storage*>(&batch.m_addrs[slot]);
+			hdr.msg_namelen = to_own ? this->m_sendaddr.size() : batch.m_addrlens[slot];
+			hdr.msg_iov = batch.m_iovs.data();
+			hdr.msg_iovlen = run;
+			hdr.msg_control = control;
+			hdr.msg_controllen = sizeof(control);
+
+			auto cm = CMSG_FIRSTHDR(&hdr);
+			cm->cmsg_level = SOL_UDP;
+			cm->cmsg_type = UDP_SEGMENT;
+			cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+
+			auto seg16 = static_cast<uint16_t>(seg);
+			memcpy(CMSG_DATA(cm), &seg16, sizeof(uint16_t));
+
+			ssize_t res = 0;
+			do {
+				res = sendmsg(this->m_sock, &hdr, 0);
+				ZNET_COUNT_IO("znet.udp.send", res);
+			} while(res < 0 && errno == EINTR);
+
+			if(res < 0)
+			{
+				// the device (or the kernel) can't do it after all, so stop trying; whatever is left
+				// gets sent the normal way below.
+				if(errno == EIO || errno == EINVAL || errno == ENOPROTOOPT || errno == EOPNOTSUPP)
+				{
+					this->m_gso = false;
+					break;
+				}
+
+				return sent > 0 ? static_cast<ssize_t>(sent) : -1;
+			}
+
+			i += run;
+			sent += run;
+			pending = i;
+		}
+	#endif
+
+		if(pending < count)
+		{
+			auto n = this->do_batch_send(batch, pending, count - pending);
+			if(n < 0)
+				return sent > 0 ? static_cast<ssize_t>(sent) : -1;
+
+			sent += static_cast<size_t>(n);
+		}
+
+		return static_cast<ssize_t>(sent);
+	}
+
+	// returns the number of datagrams sent; this can be less than `count` if the socket is non-blocking.
+	ssize_t UDPSocket::do_batch_send(const UDPBatch& batch, size_t first, size_t count)
+	{
+		auto dest_of = [&](size_t i) -> std::pair<const struct sockaddr*, socklen_t> {
+			auto slot = batch.m_entries[i].slot;
+			if(batch.m_addrlens[slot] == 0)
+				return { this->m_sendaddr.ptr(), this->m_sendaddr.size() };
+
+			return { reinterpret_cast<const struct sockaddr*>(&batch.m_addrs[slot]), batch.m_addrlens[slot] };
+		};
+
+	#if defined(__linux__)
+		batch.m_msgs.resize(std::max(batch.m_msgs.size(), count));
+		batch.m_iovs.resize(std::max(batch.m_iovs.size(), count));
+
+		for(size_t k = 0; k < count; k++)
+		{
+			auto [ addr, addrlen ] = dest_of(first + k);
+
+			batch.m_iovs[k] = { .iov_base = const_cast<uint8_t*>(batch.data(first + k)), .iov_len = batch.length(first + k) };
+
+			auto& hdr = batch.m_msgs[k].msg_hdr;
+			hdr = { };
+			hdr.msg_name = const_cast<struct sockaddr*>(addr);
+			hdr.msg_namelen = addrlen;
+			hdr.msg_iov = &batch.m_iovs[k];
+			hdr.msg_iovlen = 1;
+		}
+
+		size_t done = 0;
+		while(done < count)
+		{
+			auto n = sendmmsg(this->m_sock, batch.m_msgs.data() + done, count - done, 0);
+
+		#if ZNET_INSTRUMENT
+			size_t bytes = 0;
+			for(int k = 0; k < n; k++)
+				bytes += batch.m_msgs[done + static_cast<size_t>(k)].msg_len;
+
+			ZNET_COUNT_IO("znet.udp.send", bytes);
+		#endif
+
+			if(n < 0)
+			{
+				if(errno == EINTR)
+					continue;
+
+				if(done > 0 || errno == EAGAIN || errno == EWOULDBLOCK)
+					break;
+
+				ZNET_ERROR_RETURN(-1, "socket error: %s\n", strerror(errno));
+			}
+
+			done += static_cast<size_t>(n);
+		}
+
+		return static_cast<ssize_t>(done);
+	#else
+		size_t done = 0;
+		for(; done < count; done++)
+		{
+			auto [ addr, addrlen ] = dest_of(first + done);
+			auto bytes = sendto(this->m_sock, batch.data(first + done), batch.length(first + done), 0, addr, addrlen);
+			ZNET_COUNT_IO("znet.udp.send", bytes);
+
+			if(bytes < 0)
+			{
+				if(errno == EINTR)
+				{
+					done--;
+					continue;
+				}
+
+				if(done > 0 || errno == EAGAIN || errno == EWOULDBLOCK)
+					break;
+
+				ZNET_ERROR_RETURN(-1, "socket error: %s\n", strerror(errno));
+			}
+		}
+
+		return static_cast<ssize_t>(done);
+	#endif
+	}
+
+	bool UDPSocket::useGSO(bool use)
+	{
+	#if defined(__linux__) && defined(UDP_SEGMENT)
+		// setting a segment size of 0 on the socket itself does nothing, but tells us if the kernel knows about it.
+		int zero = 0;
+		if(use && setsockopt(this->m_sock, SOL_UDP, UDP_SEGMENT, &zero, sizeof(zero)) < 0)
+			return (this->m_gso = false);
+
+		this->m_gso = use;
+		return true;
+	#else
+		this->m_gso = false;
+		return !use;
+	#endif
+	}
+
+	bool UDPSocket::useGRO(bool use)
+	{
+	#if defined(__linux__) && defined(UDP_GRO)
+		int val = use ? 1 : 0;
+		if(setsockopt(this->m_sock, SOL_UDP, UDP_GRO, &val, sizeof(val)) < 0)
+			return (this->m_gro = false) || !use;
+
+		this->m_gro = use;
+		return true;
+	#else
+		this->m_gro = false;
+		return !use;
+	#endif
+	}
+
+	bool UDPSocket::usingGSO() const
+	{
+		return this->m_gso;
+	}
+
+	bool UDPSocket::usingGRO() const
+	{
+		return this->m_gro;
+	}
+
+	UDPBatch::UDPBatch(size_t capacity, size_t max_size) : m_capacity(capacity), m_maxSize(max_size)
+	{
+		this->m_arena.resize(capacity * max_size);
+		this->m_addrs.resize(capacity);
+		this->m_addrlens.resize(capacity);
+		this->m_entries.reserve(capacity);
+		this->m_iovs.reserve(capacity);
+
+	#if defined(__linux__)
+		this->m_msgs.reserve(capacity);
+		this->m_segments.resize(capacity);
+	#endif
+	}
+
+	IPAddress UDPBatch::address(size_t i) const
+	{
+		auto slot = this->m_entries[i].slot;
+		if(this->m_addrlens[slot] == 0)
+			return { };
+
+		return IPAddress(const_cast<struct sockaddr_storage*>(&this->m_addrs[slot]), this->m_addrlens[slot]);
+	}
+
+	bool UDPBatch::push(const uint8_t* buf, size_t len)
+	{
+		return this->push(buf, len, IPAddress());
+	}
+
+	bool UDPBatch::push(const uint8_t* buf, size_t len, const IPAddress& to)
+	{
+		if(this->m_slotsUsed >= this->m_capacity || len > this->m_maxSize)
+			return false;
+
+		auto slot = this->m_slotsUsed++;
+		memcpy(this->m_arena.data() + slot * this->m_maxSize, buf, len);
+
+		this->m_addrlens[slot] = static_cast<socklen_t>(to.size());
+		if(!to.empty())
+			memcpy(&this->m_addrs[slot], to.ptr(), to.size());
+
+		this->m_entries.push_back({ .offset = slot * this->m_maxSize, .length = len, .slot = slot });
+		return true;
+	}
+
+	void UDPBatch::clear()
+	{
+		this->m_entries.clear();
+		this->m_slotsUsed = 0;
+	}
+}
+#endif // ZNET_UDP_IMPLEMENTATION
+
+
+
+
+
+// everybody needs this.
+#if ZNET_SOME_IMPLEMENTATION
+
+
+#include <cmath>
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <arpa/inet.h>
+#include <sys/select.h>
+
+#if defined(__linux__)
+	#define ZNET_USE_EPOLL 1
+	#include <sys/epoll.h>
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+	#define ZNET_USE_KQUEUE 1
+	#include <sys/event.h>
+#endif
+
+namespace znet
+{
+	// each poller has its own thread and epoll/kqueue instance; sockets are spread over them round-robin.
+	// a socket's callbacks run with the poller's lock held, which is what lets remove() wait for them to
+	// finish. it is recursive, so that a callback can disconnect its own socket.
+	struct EventLoop::Poller
+	{
+		struct Entry
+		{
+			std::function<bool ()> readable;
+			std::function<bool ()> writable;
+			std::function<void ()> closed;
+			std::function<void ()> detach;
+			bool writing = false;
+		};
+
+		Poller();
+		~Poller();
+
+		bool watch(int fd, bool write = false);
+		void unwatch(int fd, bool write = false);
+		void want_write(int fd, bool write);
+		void run();
+		void stop();
+
+		// the poller whose thread this is, if any.
+		static thread_local Poller* current;
+
+		int fd = -1;
+		int wake[2] = { -1, -1 };
+		std::thread thread;
+		std::atomic<bool> stopping = false;
+
+		std::recursive_mutex lock;
+		std::unordered_map<int, std::shared_ptr<Entry>> entries;
+	};
+
+	EventLoop::Poller::Poller()
+	{
+	#if ZNET_USE_EPOLL
+		this->fd = epoll_create1(EPOLL_CLOEXEC);
+	#elif ZNET_USE_KQUEUE
+		this->fd = kqueue();
+	#endif
+
+		if(this->fd < 0)
+			ZNET_ERROR_ABORT("failed to create event loop: %s\n", strerror(errno));
+
+		// writing to this pipe wakes the thread up, so it can notice that it should stop.
+		if(pipe(this->wake) < 0)
+			ZNET_ERROR_ABORT("failed to create event loop: %s\n", strerror(errno));
+
+		detail::set_blocking(this->wake[0], false);
+		this->watch(this->wake[0]);
+
+		this->thread = std::thread([this]() { this->run(); });
+	}
+
+	EventLoop::Poller::~Poller()
+	{
+		this->stop();
+
+		::close(this->wake[0]);
+		::close(this->wake[1]);
+		::close(this->fd);
+	}
+
+	thread_local EventLoop::Poller* EventLoop::Poller::current = nullptr;
+
+	bool EventLoop::Poller::watch(int sock, bool write)
+	{
+	#if ZNET_USE_EPOLL
+		struct epoll_event ev = { };
+		ev.events = EPOLLIN;
+		ev.data.fd = sock;
+
+		if(write)
+			ev.events |= EPOLLOUT;
+
+		if(epoll_ctl(this->fd, EPOLL_CTL_ADD, sock, &ev) < 0)
+			ZNET_ERROR_RETURN(false, "failed to add socket to event loop: %s\n", strerror(errno));
+	#elif ZNET_USE_KQUEUE
+		struct kevent ev[2];
+		EV_SET(&ev[0], sock, EVFILT_READ, EV_ADD, 0, 0, nullptr);
+		EV_SET(&ev[1], sock, EVFILT_WRITE, EV_ADD, 0, 0, nullptr);
+
+		if(kevent(this->fd, ev, write ? 2 : 1, nullptr, 0, nullptr) < 0)
+			ZNET_ERROR_RETURN(false, "failed to add socket to event loop: %s\n", strerror(errno));
+	#endif
+
+		return true;
+	}
+
+	void EventLoop::Poller::unwatch(int sock, bool write)
+	{
+	#if ZNET_USE_EPOLL
+		(void) write;
+
+		struct epoll_event ev = { };
+		epoll_ctl(this->fd, EPOLL_CTL_DEL, sock, &ev);
+	#elif ZNET_USE_KQUEUE
+		struct kevent ev[2];
+		EV_SET(&ev[0], sock, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+		EV_SET(&ev[1], sock, EVFILT_WRITE, EV_DELETE, 0, 0, nullptr);
+		kevent(this->fd, ev, write ? 2 : 1, nullptr, 0, nullptr);
+	#endif
+	}
+
+	void EventLoop::Poller::want_write(int sock, bool write)
+	{
+		auto lk = std::unique_lock<std::recursive_mutex>(this->lock);
+
+		auto it = this->entries.find(sock);
+		if(it == this->entries.end() || it->second->writing == write)
+			return;
+
+		it->second->writing = write;
+
+	#if ZNET_USE_EPOLL
+		struct epoll_event ev = { };
+		ev.events = EPOLLIN;
+		ev.data.fd = sock;
+
+		if(write)
+			ev.events |= EPOLLOUT;
+
+		epoll_ctl(this->fd, EPOLL_CTL_MOD, sock, &ev);
+	#elif ZNET_USE_KQUEUE
+		struct kevent ev;
+		EV_SET(&ev, sock, EVFILT_WRITE, write ? EV_ADD : EV_DELETE, 0, 0, nullptr);
+
+		kevent(this->fd, &ev, 1, nullptr, 0, nullptr);
+	#endif
+	}
+
+	void EventLoop::Poller::run()
+	{
+		constexpr int MAX_EVENTS = 64;
+
+	#if ZNET_USE_EPOLL
+		struct epoll_event events[MAX_EVENTS];
+	#elif ZNET_USE_KQUEUE
+		struct kevent events[MAX_EVENTS];
+	#endif
+
+		Poller::current = this;
+		while(!this->stopping)
+		{
+		#if ZNET_USE_EPOLL
+			int n = epoll_wait(this->fd, events, MAX_EVENTS, -1);
+		#elif ZNET_USE_KQUEUE
+			int n = kevent(this->fd, nullptr, 0, events, MAX_EVENTS, nullptr);
+		#endif
+
+			if(n < 0)
+			{
+				if(errno == EINTR)
+					continue;
+
+				ZNET_ERROR_RETURN_VOID("event loop error: %s\n", strerror(errno));
+			}
+
+			for(int i = 0; i < n; i++)
+			{
+			#if ZNET_USE_EPOLL
+				int sock = events[i].data.fd;
+				bool isWrite = (events[i].events & EPOLLOUT);
+				bool isRead = (events[i].events & ~EPOLLOUT);
+			#elif ZNET_USE_KQUEUE
+				int sock = static_cast<int>(events[i].ident);
+				bool isWrite = (events[i].filter == EVFILT_WRITE);
+				bool isRead = !isWrite;
+			#endif
+
+				if(sock == this->wake[0])
+				{
+					char buf[64];
+					while(read(this->wake[0], buf, sizeof(buf)) > 0)
+						;
+
+					continue;
+				}
+
+				auto lk = std::unique_lock<std::recursive_mutex>(this->lock);
+
+				// the socket might have been removed by an earlier callback in this batch.
+				auto it = this->entries.find(sock);
+				if(it == this->entries.end())
+					continue;
+
+				// hold a reference, since the callback might remove the socket (and its entry).
+				auto entry = it->second;
+
+				bool open = true;
+				if(isWrite && entry->writable)
+					open = entry->writable();
+
+				if(open && (isRead || !entry->writable))
+					open = entry->readable();
+
+				if(open)
+					continue;
+
+				// the connection was closed; take it out of the loop before telling the socket.
+				if(it = this->entries.find(sock); it != this->entries.end() && it->second == entry)
+				{
+					this->entries.erase(it);
+					this->unwatch(sock, entry->writing);
+
+					entry->detach();
+					entry->closed();
+				}
+			}
+		}
+	}
 
-namespace znet
-{
-	UDPSocket::UDPSocket(const IPAddress& local, const IPAddress& remote)
+	void EventLoop::Poller::stop()
 	{
-		if(this->m_sock = socket(PF_INET, SOCK_DGRAM, 0); this->m_sock < 0)
-			ZNET_ERROR_ABORT("error creating udp socket: %s\n", strerror(errno));
+		if(!this->thread.joinable())
+			return;
 
-		this->m_recvaddr = local;
-		this->m_sendaddr = remote;
+		this->stopping = true;
 
-		if(this->m_sendaddr.empty())
-			this->m_sendaddr = local;
+		char c = 0;
+		(void) write(this->wake[1], &c, 1);
 
-		// enable broadcast, just in case. it doesn't matter anyway.
-		int yes = 1;
-		setsockopt(this->m_sock, SOL_SOCKET, SO_BROADCAST, &yes, sizeof(yes));
+		this->thread.join();
 
-		int size = 1024 * 1024 * 64;
-		setsockopt(this->m_sock, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+		auto lk = std::unique_lock<std::recursive_mutex>(this->lock);
+		for(auto& [ sock, entry ] : this->entries)
+		{
+			this->unwatch(sock, entry->writing);
+			entry->detach();
+		}
 
-		this->m_buffer = new uint8_t[BUFFER_SIZE];
-		this->m_callback = [](auto...) { };
+		this->entries.clear();
 	}
 
-	UDPSocket::~UDPSocket()
+	EventLoop::EventLoop(size_t num_threads)
 	{
-		if(this->m_connected)
-			this->close();
+	#if !ZNET_USE_EPOLL && !ZNET_USE_KQUEUE
+		ZNET_ERROR_ABORT("EventLoop is not supported on this platform (it needs epoll or kqueue)\n");
+	#endif
 
-		if(this->m_buffer)
-			delete[] this->m_buffer;
+		for(size_t i = 0; i < std::max(num_threads, size_t(1)); i++)
+			this->m_pollers.push_back(std::make_unique<Poller>());
 	}
 
-	UDPSocket::UDPSocket(UDPSocket&& other)
+	EventLoop::~EventLoop()
 	{
-		if(other.connected())
-			ZNET_ERROR_ABORT("cannot move socket while it is connected!");
-
-		this->m_sock            = other.m_sock;         other.m_sock = -1;
-		this->m_connected       = other.m_connected;    other.m_connected = false;
-		this->m_buffer          = other.m_buffer;       other.m_buffer = nullptr;
-		this->m_thread          = std::move(other.m_thread);
-		this->m_recvaddr        = std::move(other.m_recvaddr);
-		this->m_sendaddr        = std::move(other.m_sendaddr);
-		this->m_closeCallback   = std::move(other.m_closeCallback);
-		this->m_callback        = std::move(other.m_callback);
+		this->stop();
 	}
 
-	UDPSocket& UDPSocket::operator= (UDPSocket&& other)
+	void EventLoop::stop()
 	{
-		if(this != &other)
-		{
-			if(other.connected())
-				ZNET_ERROR_ABORT("cannot move socket while it is connected!");
+		for(auto& p : this->m_pollers)
+			p->stop();
+	}
 
-			this->m_sock            = other.m_sock;         other.m_sock = -1;
-			this->m_connected       = other.m_connected;    other.m_connected = false;
-			this->m_buffer          = other.m_buffer;       other.m_buffer = nullptr;
-			this->m_thread          = std::move(other.m_thread);
-			this->m_recvaddr        = std::move(other.m_recvaddr);
-			this->m_sendaddr        = std::move(other.m_sendaddr);
-			this->m_closeCallback   = std::move(other.m_closeCallback);
-			this->m_callback        = std::move(other.m_callback);
-		}
-		return *this;
+	size_t EventLoop::numThreads() const
+	{
+		return this->m_pollers.size();
 	}
 
-	void UDPSocket::setBlocking(bool blocking)
+	size_t EventLoop::numSockets() const
 	{
-		detail::set_blocking(this->m_sock, blocking);
+		size_t ret = 0;
+		for(auto& p : this->m_pollers)
+		{
+			auto lk = std::unique_lock<std::recursive_mutex>(p->lock);
+			ret += p->entries.size();
+		}
+
+		return ret;
 	}
 
-	bool UDPSocket::isBlocking() const
+	bool EventLoop::add_fd(int fd, std::function<bool ()> readable, std::function<void ()> closed,
+		std::function<void ()> detach, std::function<bool ()> writable)
 	{
-		return detail::get_blocking(this->m_sock);
+		auto& p = this->m_pollers[this->m_next++ % this->m_pollers.size()];
+		if(!p->thread.joinable())
+			ZNET_ERROR_RETURN(false, "cannot add socket to an event loop that was stopped\n");
+
+		auto lk = std::unique_lock<std::recursive_mutex>(p->lock);
+
+		auto entry = std::make_shared<Poller::Entry>();
+		entry->readable = std::move(readable);
+		entry->closed = std::move(closed);
+		entry->detach = std::move(detach);
+		entry->writing = static_cast<bool>(writable);
+		entry->writable = std::move(writable);
+
+		auto write = entry->writing;
+		p->entries[fd] = std::move(entry);
+		if(!p->watch(fd, write))
+		{
+			p->entries.erase(fd);
+			return false;
+		}
+
+		return true;
 	}
 
-	void UDPSocket::useCallback(bool use)
+	void EventLoop::remove_fd(int fd)
 	{
-		__atomic_store_n(&this->m_usecallback, use, __ATOMIC_RELEASE);
+		for(auto& p : this->m_pollers)
+		{
+			auto lk = std::unique_lock<std::recursive_mutex>(p->lock);
+			if(auto it = p->entries.find(fd); it != p->entries.end())
+			{
+				auto entry = std::move(it->second);
+
+				p->entries.erase(it);
+				p->unwatch(fd, entry->writing);
+
+				entry->detach();
+				return;
+			}
+		}
 	}
 
-	bool UDPSocket::usingCallback() const
+	void EventLoop::want_write(int fd, bool write)
 	{
-		return this->m_usecallback;
+		if(Poller::current != nullptr)
+			Poller::current->want_write(fd, write);
 	}
 
-	bool UDPSocket::bind()
+	IPAddress IPAddress::ip4(const std::string& ip, uint16_t port)
 	{
-		if(::bind(this->m_sock, this->m_recvaddr.ptr(), this->m_recvaddr.size()) < 0)
-			ZNET_ERROR_RETURN(false, "failed to bind udp socket: %s\n", strerror(errno));
+		struct sockaddr_in sa;
+		sa.sin_family = AF_INET;
+		sa.sin_port = htons(port);
 
-		__atomic_store_n(&this->m_connected, true, __ATOMIC_RELEASE);
-		return true;
+		if(inet_pton(AF_INET, ip.c_str(), &sa.sin_addr.s_addr) < 0)
+			ZNET_ERROR_ABORT("invalid ipv4 address '%s'\n", ip.c_str());
+
+		auto ret = IPAddress(sa);
+		ret.hostname_string = ip;
+		return ret;
 	}
 
-	void UDPSocket::close()
+	IPAddress IPAddress::hostname4(const std::string& host, uint16_t port)
 	{
-		if(this->m_sock == -1)
-			ZNET_ERROR_RETURN_VOID("warning: attempted to close socket that was already closed\n");
+		struct addrinfo hints = { };
+		hints.ai_flags = (AI_V4MAPPED | AI_ADDRCONFIG);
+		hints.ai_family = AF_INET;
 
-		if(this->m_closeCallback)
-			this->m_closeCallback();
+		struct addrinfo* info = nullptr;
+		if(int res = getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &info); res != 0 || !info)
+			ZNET_ERROR_RETURN(IPAddress(), "could not resolve '%s': %s\n", host.c_str(), gai_strerror(res));
 
-		// tell the listener thread to die
-		__atomic_store_n(&this->m_connected, false, __ATOMIC_RELEASE);
-		if(this->m_thread.joinable())
-			this->m_thread.join();
+		auto ret = IPAddress(info->ai_addr, info->ai_addrlen);
+		ret.hostname_string = host;
 
-		::close(this->m_sock);
-		this->m_sock = -1;
+		freeaddrinfo(info);
+		return ret;
 	}
 
-	bool UDPSocket::connected() const
+	IPAddress IPAddress::any4(uint16_t port)
 	{
-		return this->m_connected;
-	}
+		struct addrinfo hints = { };
+		hints.ai_flags = AI_PASSIVE;
+		hints.ai_family = AF_INET;
 
-	void UDPSocket::reset()
-	{
-		this->m_callback = { };
-		this->m_closeCallback = { };
+		struct addrinfo* info = nullptr;
+		int res = getaddrinfo(nullptr, std::to_string(port).c_str(), &hints, &info);
+		if(res < 0) ZNET_ERROR_ABORT("could not getaddrinfo(): %s\n", strerror(errno));
+
+		auto ret = IPAddress(info->ai_addr, info->ai_addrlen);
+		freeaddrinfo(info);
+
+		return ret;
 	}
 
-	void UDPSocket::onClose(std::function<void ()> callback)
+	IPAddress IPAddress::udpBroadcast(uint16_t port)
 	{
-		this->m_closeCallback = std::move(callback);
+		return IPAddress::ip4("255.255.255.255", port);
 	}
 
-	void UDPSocket::onReceive(std::function<void (const uint8_t*, size_t, const IPAddress& from)> callback)
+	uint16_t IPAddress::port() const
 	{
-		this->m_callback = std::move(callback);
+		if(this->family() == AF_INET6)
+			return ntohs(reinterpret_cast<const struct sockaddr_in6*>(&this->storage)->sin6_port);
 
-		if(!this->m_usecallback)
-			this->setup_receiver();
+		else if(this->family() == AF_INET)
+			return ntohs(reinterpret_cast<const struct sockaddr_in*>(&this->storage)->sin_port);
+
+		return 0;
 	}
 
-	void UDPSocket::setup_receiver()
+	void IPAddress::setPort(uint16_t port)
 	{
-		using namespace std::chrono_literals;
+		if(this->family() == AF_INET6)
+			reinterpret_cast<struct sockaddr_in6*>(&this->storage)->sin6_port = htons(port);
 
-		this->useCallback(true);
-		this->m_thread = std::thread([this]() {
+		else if(this->family() == AF_INET)
+			reinterpret_cast<struct sockaddr_in*>(&this->storage)->sin_port = htons(port);
+	}
 
-			while(true)
-			{
-				if(!this->m_connected || !this->m_usecallback)
-					break;
 
-				IPAddress addr = { };
-				auto bytes = this->do_socket_read(this->m_buffer, BUFFER_SIZE, (0.2s).count(), &addr);
-				if(bytes <= 0) continue;
 
-				this->m_callback(this->m_buffer, bytes, addr);
-			}
-		});
+	Resolver::Resolver() : Resolver(Options { })
+	{
 	}
 
-	ssize_t UDPSocket::send(const uint8_t* buf, size_t len)
+	Resolver::Resolver(const Options& opts) : m_options(opts)
 	{
-		return sendto(this->m_sock, buf, len, 0, this->m_sendaddr.ptr(), this->m_sendaddr.size());
 	}
 
-	ssize_t UDPSocket::receive(uint8_t* buf, size_t len, double timeout_secs, IPAddress* from)
+	Resolver::~Resolver()
 	{
-		this->useCallback(false);
-		return this->do_socket_read(buf, len, timeout_secs, from);
+		{
+			auto lk = std::lock_guard<std::mutex>(this->m_lock);
+			this->m_stopping = true;
+		}
+
+		this->m_cv.notify_all();
+		for(auto& t : this->m_threads)
+			t.join();
 	}
 
-	ssize_t UDPSocket::do_socket_read(uint8_t* buf, size_t len, double timeout_secs, IPAddress* from)
+	Resolver& Resolver::shared()
 	{
-		detail::set_timeout(this->m_sock, timeout_secs);
+		static Resolver resolver;
+		return resolver;
+	}
 
-		socklen_t sa_len = 0;
-		struct sockaddr_storage sa = { };
+	Resolver::Result Resolver::resolve(const std::string& host, uint16_t port)
+	{
+		auto lk = std::unique_lock<std::mutex>(this->m_lock);
+		if(auto it = this->m_cache.find(host); it != this->m_cache.end())
+		{
+			if(std::chrono::steady_clock::now() < it->second.expiry)
+				return make_result(it->second, port);
 
-		auto bytes = recvfrom(this->m_sock, buf, len,
-			0, reinterpret_cast<struct sockaddr*>(&sa), &sa_len);
+			this->m_cache.erase(it);
+		}
 
-		if(bytes < 0 && !(errno == EAGAIN || errno == EWOULDBLOCK))
-			ZNET_ERROR_RETURN(-1, "socket error: %s\n", strerror(errno));
+		// someone else is already looking it up, so just wait for them.
+		if(auto it = this->m_lookups.find(host); it != this->m_lookups.end())
+		{
+			auto lookup = it->second;
+			this->m_cv.wait(lk, [&lookup]() { return lookup->done; });
 
-		if(from)
-			*from = IPAddress(&sa, sa_len);
+			return make_result(lookup->entry, port);
+		}
 
-		return bytes;
+		this->m_lookups.emplace(host, std::make_shared<Lookup>());
+		lk.unlock();
+
+		auto entry = this->do_lookup(host);
+		auto ret = make_result(entry, port);
+
+		this->finish_lookup(host, std::move(entry));
+		return ret;
 	}
-}
-#endif // ZNET_UDP_IMPLEMENTATION
 
+	void Resolver::resolve(const std::string& host, uint16_t port, std::function<void (Result)> callback)
+	{
+		auto waiter = [callback = std::move(callback), port](const Entry& entry) {
+			callback(make_result(entry, port));
+		};
 
+		auto lk = std::unique_lock<std::mutex>(this->m_lock);
+		if(auto it = this->m_cache.find(host); it != this->m_cache.end())
+		{
+			if(std::chrono::steady_clock::now() < it->second.expiry)
+			{
+				auto entry = it->second;
+				lk.unlock();
 
+				waiter(entry);
+				return;
+			}
 
+			this->m_cache.erase(it);
+		}
 
-// everybody needs this.
-#if ZNET_SOME_IMPLEMENTATION
+		if(auto it = this->m_lookups.find(host); it != this->m_lookups.end())
+		{
+			it->second->waiters.push_back(std::move(waiter));
+			return;
+		}
 
+		auto lookup = std::make_shared<Lookup>();
+		lookup->waiters.push_back(std::move(waiter));
 
-#include <fcntl.h>
-#include <sys/time.h>
-#include <arpa/inet.h>
-#include <sys/select.h>
+		this->m_lookups.emplace(host, std::move(lookup));
+		this->m_queue.push_back(host);
 
-namespace znet
-{
-	IPAddress IPAddress::ip4(const std::string& ip, uint16_t port)
+		if(this->m_threads.size() < std::max(this->m_options.numThreads, size_t(1)))
+			this->m_threads.emplace_back([this]() { this->work(); });
+
+		lk.unlock();
+		this->m_cv.notify_all();
+	}
+
+	void Resolver::clear()
 	{
-		struct sockaddr_in sa;
-		sa.sin_family = AF_INET;
-		sa.sin_port = htons(port);
+		auto lk = std::lock_guard<std::mutex>(this->m_lock);
+		this->m_cache.clear();
+	}
 
-		if(inet_pton(AF_INET, ip.c_str(), &sa.sin_addr.s_addr) < 0)
-			ZNET_ERROR_ABORT("invalid ipv4 address '%s'\n", ip.c_str());
+	size_t Resolver::cacheSize() const
+	{
+		auto lk = std::lock_guard<std::mutex>(this->m_lock);
+		return this->m_cache.size();
+	}
 
-		auto ret = IPAddress(sa);
-		ret.hostname_string = ip;
-		return ret;
+	void Resolver::work()
+	{
+		while(true)
+		{
+			auto lk = std::unique_lock<std::mutex>(this->m_lock);
+			this->m_cv.wait(lk, [this]() { return this->m_stopping || !this->m_queue.empty(); });
+
+			// fail the lookups that haven't started, so that nobody waits for them forever.
+			if(this->m_stopping)
+			{
+				auto pending = std::move(this->m_queue);
+				this->m_queue.clear();
+				lk.unlock();
+
+				for(auto& host : pending)
+				{
+					auto entry = Entry();
+					entry.error = "resolver was destroyed before looking up '" + host + "'";
+					this->finish_lookup(host, std::move(entry));
+				}
+
+				return;
+			}
+
+			auto host = std::move(this->m_queue.front());
+			this->m_queue.pop_front();
+			lk.unlock();
+
+			this->finish_lookup(host, this->do_lookup(host));
+		}
 	}
 
-	IPAddress IPAddress::hostname4(const std::string& host, uint16_t port)
+	void Resolver::finish_lookup(const std::string& host, Entry entry)
 	{
-		struct addrinfo hints = {
-			.ai_family = AF_INET,
-			.ai_flags = (AI_V4MAPPED | AI_ADDRCONFIG),
-		};
+		auto timeout = (entry.error.empty() ? this->m_options.cacheTimeout : this->m_options.failureCacheTimeout);
+		entry.expiry = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+			std::chrono::duration<double>(timeout));
 
-		struct addrinfo* info = nullptr;
-		int res = getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &info);
-		if(res < 0) ZNET_ERROR_ABORT("could not getaddrinfo(%s): %s\n", host.c_str(), strerror(errno));
+		auto lk = std::unique_lock<std::mutex>(this->m_lock);
 
-		auto ret = IPAddress(info->ai_addr, info->ai_addrlen);
-		ret.hostname_string = host;
+		auto it = this->m_lookups.find(host);
+		auto lookup = std::move(it->second);
+		this->m_lookups.erase(it);
 
-		freeaddrinfo(info);
-		return ret;
+		if(timeout > 0 && this->m_options.maxCacheSize > 0)
+		{
+			// expired entries are only replaced when their host is looked up again, so without this a resolver
+			// that sees many different hosts would keep all of them forever.
+			if(this->m_cache.size() >= this->m_options.maxCacheSize && this->m_cache.find(host) == this->m_cache.end())
+			{
+				auto now = std::chrono::steady_clock::now();
+				for(auto it = this->m_cache.begin(); it != this->m_cache.end(); )
+				{
+					if(it->second.expiry <= now)    it = this->m_cache.erase(it);
+					else                            ++it;
+				}
+
+				if(this->m_cache.size() >= this->m_options.maxCacheSize)
+				{
+					auto first = std::min_element(this->m_cache.begin(), this->m_cache.end(), [](auto& a, auto& b) {
+						return a.second.expiry < b.second.expiry;
+					});
+
+					this->m_cache.erase(first);
+				}
+			}
+
+			this->m_cache.insert_or_assign(host, entry);
+		}
+
+		lookup->entry = std::move(entry);
+		lookup->done = true;
+
+		auto waiters = std::move(lookup->waiters);
+		lk.unlock();
+
+		// wake up the synchronous waiters, then call the asynchronous ones.
+		this->m_cv.notify_all();
+
+		for(auto& w : waiters)
+			w(lookup->entry);
 	}
 
-	IPAddress IPAddress::any4(uint16_t port)
+	Resolver::Entry Resolver::do_lookup(const std::string& host) const
 	{
-		struct addrinfo hints = {
-			.ai_family = AF_INET,
-			.ai_flags = AI_PASSIVE
-		};
+		struct addrinfo hints = { };
+		hints.ai_flags = AI_ADDRCONFIG;
+		hints.ai_family = (this->m_options.ipv6 ? AF_UNSPEC : AF_INET);
+		hints.ai_socktype = SOCK_STREAM;
+
+		auto ret = Entry();
 
 		struct addrinfo* info = nullptr;
-		int res = getaddrinfo(nullptr, std::to_string(port).c_str(), &hints, &info);
-		if(res < 0) ZNET_ERROR_ABORT("could not getaddrinfo(): %s\n", strerror(errno));
+		if(int res = getaddrinfo(host.c_str(), nullptr, &hints, &info); res != 0)
+		{
+			ret.error = "could not resolve '" + host + "': " + gai_strerror(res);
+			return ret;
+		}
+
+		// getaddrinfo gives them in order of preference; keep that order within each family, but interleave the
+		// families (starting with the preferred one), so that connecting to them in order tries both early.
+		auto first = Addresses();
+		auto second = Addresses();
+		for(auto ai = info; ai != nullptr; ai = ai->ai_next)
+		{
+			if(ai->ai_family != AF_INET && ai->ai_family != AF_INET6)
+				continue;
+
+			auto addr = IPAddress(ai->ai_addr, ai->ai_addrlen);
+			addr.hostname_string = host;
+
+			if(first.empty() || first[0].family() == addr.family())
+				first.push_back(std::move(addr));
+			else
+				second.push_back(std::move(addr));
+		}
 
-		auto ret = IPAddress(info->ai_addr, info->ai_addrlen);
 		freeaddrinfo(info);
 
+		for(size_t i = 0; i < std::max(first.size(), second.size()); i++)
+		{
+			if(i < first.size())    ret.addresses.push_back(std::move(first[i]));
+			if(i < second.size())   ret.addresses.push_back(std::move(second[i]));
+		}
+
+		if(ret.addresses.empty())
+			ret.error = "no addresses for '" + host + "'";
+
 		return ret;
 	}
 
-	IPAddress IPAddress::udpBroadcast(uint16_t port)
+	Resolver::Result Resolver::make_result(const Entry& entry, uint16_t port)
 	{
-		return IPAddress::ip4("255.255.255.255", port);
+		if(!entry.error.empty())
+			return Result { { }, entry.error };
+
+		auto addrs = entry.addresses;
+		for(auto& a : addrs)
+			a.setPort(port);
+
+		return Result { std::move(addrs), { } };
 	}
 
 	namespace detail
@@ -968,7 +3517,7 @@ namespace znet
 		void set_blocking(int sock, bool block)
 		{
 			const auto flags = fcntl(sock, F_GETFL, 0);
-			const auto newflags = !block ? (flags | O_NONBLOCK) : (flags ^ O_NONBLOCK);
+			const auto newflags = !block ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
 			if(fcntl(sock, F_SETFL, newflags) < 0)
 				ZNET_ERROR_RETURN_VOID("could not set socket to non-blocking: %s\n", strerror(errno));
 		}
@@ -987,3 +3536,6 @@ namespace znet
 #undef ZNET_ERROR_RETURN
 #undef ZNET_ERROR_RETURN_VOID
 
+
+#undef ZNET_USE_EPOLL
+#undef ZNET_USE_KQUEUE
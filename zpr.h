@@ -16,33 +16,13 @@
 
 
 
-    detail::print_floating and detail::print_exponent are adapted from _ftoa and _etoa
-    from https://github.com/mpaland/printf, which is licensed under the MIT license,
-    reproduced below:
-
-    Copyright Marco Paland (info@paland.com), 2014-2019, PALANDesign Hannover, Germany
-
-    Permission is hereby granted, free of charge, to any person obtaining a copy
-    of this software and associated documentation files (the "Software"), to deal
-    in the Software without restriction, including without limitation the rights
-    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
-    copies of the Software, and to permit persons to whom the Software is
-    furnished to do so, subject to the following conditions:
-
-    The above copyright notice and this permission notice shall be included in
-    all copies or substantial portions of the Software.
-
-    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
-    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
-    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
-    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
-    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
-    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
-    THE SOFTWARE.
+    detail::fp::shortest and its tables are adapted from Ryu (d2s.c and d2s_small_table.h)
+    by Ulf Adams, from https://github.com/ulfjack/ryu, which is licensed under the Apache
+    License, Version 2.0 (like this file).
 */
 
 /*
-    Version 2.8.0
+    Version 2.12.0
     =============
 
 
@@ -64,8 +44,9 @@
 
     where `<spec>` is exactly a `printf`-style format specifier (note: there is no leading colon unlike the
     fmtlib/python style), and where the final type specifier (eg. `s`, `d`) is optional. Floating point values
-    will print as if `g` was used. Size specifiers (eg. `lld`) are not supported. Variable width and precision
-    specifiers (eg. `%.*s`) are not supported.
+    print the shortest representation that reads back as the same value, unless a precision or a specifier
+    is given (a precision alone, eg. `{.3}`, behaves like `%.3f`). Size specifiers (eg. `lld`) are not
+    supported. Variable width and precision specifiers (eg. `%.*s`) are not supported.
 
     The currently supported builtin formatters are:
     - integral types            (signed/unsigned char/short/int/long/long long) (but not 'char')
@@ -119,6 +100,11 @@
             the C library specifications, but they are not defined. they are expected to be defined
             elsewhere in the program.
 
+    - ZPR_ASYNC_SINK
+        this is *FALSE* by default. enables zpr::async_sink (see below), which needs threads and
+        POSIX writev(), so it pulls in <thread>, <mutex>, <condition_variable>, <vector> and
+        <sys/uio.h>. it is always disabled if ZPR_FREESTANDING is true.
+
 
     Custom Formatters
     -----------------
@@ -158,6 +144,14 @@
     * only available if ZPR_USE_STD == 1: print to a std::string
     std::string sprint(tt::str_view fmt, Args&&... args);
 
+    * print `count` integers from `values` in decimal to a buffer, with `sep` between them, in one pass;
+    * the same as sprint() with "{}" for each of them (and the same truncation rules), but faster. bool and
+    * the character types (except signed and unsigned char) are not allowed, since "{}" prints them as text.
+    size_t format_ints(size_t len, char* buf, const T* values, size_t count, tt::str_view sep = ", ");
+
+    * only available if ZPR_USE_STD == 1: the same, but print to a std::string
+    std::string format_ints(const T* values, size_t count, tt::str_view sep = ", ");
+
     * only available if ZPR_FREESTANDING != 0: print to stdout.
     size_t print(tt::str_view fmt, Args&&... args);
 
@@ -179,6 +173,47 @@
     auto zpr::with(T value, auto&& formatter);
 
 
+    Compile-time Format Strings
+    ---------------------------
+
+    All of the cprint/sprint/print/fprint functions (and their `ln` versions) also accept a format string
+    that is parsed at compile time, either with `zpr::fmt<"...">` (needs c++20) or `ZPR_FMT("...")`, which
+    works in c++17:
+
+    zpr::println(zpr::fmt<"{} = {.3f}">, "pi", M_PI);
+    zpr::println(ZPR_FMT("{} = {.3f}"), "pi", M_PI);
+
+    The literal text and format specifiers are split apart while compiling, so no parsing happens at runtime.
+    Passing a different number of arguments than there are specifiers, or leaving a '{' unclosed, is a
+    compile error; note that this is stricter than the normal runtime version, which prints extra arguments
+    with the default format.
+
+
+    Asynchronous Sink
+    -----------------
+
+    When ZPR_ASYNC_SINK is enabled, `zpr::async_sink` lets many threads log to one file descriptor without
+    fighting over stdio's lock or doing the write syscalls themselves:
+
+    auto opts = zpr::async_sink::options();
+    opts.num_blocks = 256;
+    opts.on_overflow = zpr::async_sink::overflow::drop;
+
+    zpr::async_sink sink(STDERR_FILENO, opts);
+    sink.println("worker {}: {} jobs", id, count);
+
+    Each thread formats into its own block taken from a pool that is allocated once, up-front; a background
+    thread collects full blocks (and, every `flush_interval`, the partially-filled ones) and writes them out
+    with a single writev(). Formatting never allocates -- the only allocation on the producer side happens
+    the first time a thread writes to a given sink, to register it. Messages are never split or interleaved;
+    a single message longer than `block_size` is truncated.
+
+    When every block is in use, `overflow::block` (the default) makes the writing thread wait for the
+    background thread to free one, and `overflow::drop` discards the message instead (counted by dropped()).
+    flush() waits until everything written before it has reached the file descriptor, and the destructor
+    flushes and joins the background thread.
+
+
     Type-erased API
     ---------------
 
@@ -247,6 +282,13 @@
 	#define ZPR_USE_STD 1
 #endif
 
+#if !defined(ZPR_ASYNC_SINK)
+	#define ZPR_ASYNC_SINK 0
+#elif (ZPR_EXPAND(ZPR_ASYNC_SINK) == 1)
+	#undef ZPR_ASYNC_SINK
+	#define ZPR_ASYNC_SINK 1
+#endif
+
 
 #if !ZPR_FREESTANDING
 	#include <stdio.h>
@@ -256,7 +298,12 @@
 		#undef ZPR_USE_STD
 	#endif
 
+	#if defined(ZPR_ASYNC_SINK)
+		#undef ZPR_ASYNC_SINK
+	#endif
+
 	#define ZPR_USE_STD 0
+	#define ZPR_ASYNC_SINK 0
 
 	extern "C" void* memset(void* s, int c, size_t n);
 	extern "C" void* memcpy(void* dest, const void* src, size_t n);
@@ -293,6 +340,17 @@
 	#define ZPR_LIKELY(x)     (x)
 #endif
 
+// wraps a string literal into a compile-time format string; see zpr::fmt<> for the c++20 version.
+// the local struct gives each call site its own type, so the string can be parsed as a constant.
+#define ZPR_FMT(fmt_str) ([]() {                                                    \
+	struct __zpr_fmt_source                                                         \
+	{                                                                               \
+		static constexpr const char* data() { return fmt_str; }                     \
+		static constexpr size_t size() { return sizeof(fmt_str) - 1; }              \
+	};                                                                              \
+	return zpr::detail::compiled_format<__zpr_fmt_source>{};                        \
+}())
+
 
 
 
@@ -328,11 +386,11 @@ namespace zpr::tt
 	{
 		using value_type = char;
 
-		str_view() : ptr(nullptr), len(0) { }
-		str_view(const char* p, size_t l) : ptr(p), len(l) { }
+		constexpr str_view() : ptr(nullptr), len(0) { }
+		constexpr str_view(const char* p, size_t l) : ptr(p), len(l) { }
 
 		template <size_t _Number>
-		str_view(const char (&s)[_Number]) : ptr(s), len(_Number - 1) { }
+		constexpr str_view(const char (&s)[_Number]) : ptr(s), len(_Number - 1) { }
 
 		template <typename _Type, typename = tt::enable_if_t<tt::is_same_v<const char*, _Type>>>
 		str_view(_Type s) : ptr(s), len(strlen(s)) { }
@@ -356,19 +414,19 @@ namespace zpr::tt
 		inline const char* begin() const { return this->ptr; }
 		inline const char* end() const { return this->ptr + len; }
 
-		inline size_t size() const { return this->len; }
-		inline bool empty() const { return this->len == 0; }
-		inline const char* data() const { return this->ptr; }
+		constexpr inline size_t size() const { return this->len; }
+		constexpr inline bool empty() const { return this->len == 0; }
+		constexpr inline const char* data() const { return this->ptr; }
 
-		inline char operator[] (size_t n) { return this->ptr[n]; }
+		constexpr inline char operator[] (size_t n) { return this->ptr[n]; }
 
-		inline str_view drop(size_t n) const { return (this->size() >= n ? this->substr(n, this->size() - n) : ""); }
-		inline str_view take(size_t n) const { return (this->size() >= n ? this->substr(0, n) : *this); }
-		inline str_view take_last(size_t n) const { return (this->size() >= n ? this->substr(this->size() - n, n) : *this); }
-		inline str_view drop_last(size_t n) const { return (this->size() >= n ? this->substr(0, this->size() - n) : *this); }
+		constexpr inline str_view drop(size_t n) const { return (this->size() >= n ? this->substr(n, this->size() - n) : ""); }
+		constexpr inline str_view take(size_t n) const { return (this->size() >= n ? this->substr(0, n) : *this); }
+		constexpr inline str_view take_last(size_t n) const { return (this->size() >= n ? this->substr(this->size() - n, n) : *this); }
+		constexpr inline str_view drop_last(size_t n) const { return (this->size() >= n ? this->substr(0, this->size() - n) : *this); }
 
-		inline str_view& remove_prefix(size_t n) { return (*this = this->drop(n)); }
-		inline str_view& remove_suffix(size_t n) { return (*this = this->drop_last(n)); }
+		constexpr inline str_view& remove_prefix(size_t n) { return (*this = this->drop(n)); }
+		constexpr inline str_view& remove_suffix(size_t n) { return (*this = this->drop_last(n)); }
 
 		[[nodiscard]] inline str_view take_prefix(size_t n)
 		{
@@ -395,7 +453,7 @@ namespace zpr::tt
 			return static_cast<size_t>(-1);
 		}
 
-		inline str_view substr(size_t pos, size_t cnt) const { return str_view(this->ptr + pos, cnt); }
+		constexpr inline str_view substr(size_t pos, size_t cnt) const { return str_view(this->ptr + pos, cnt); }
 
 
 	#if ZPR_USE_STD
@@ -621,7 +679,8 @@ namespace zpr
 		template <>
 		struct is_iterable<tt::str_view> : tt::true_type { };
 
-		static inline format_args parse_fmt_spec(tt::str_view sv)
+		// this is constexpr so that zpr::fmt<> and ZPR_FMT() can reuse it to parse specifiers at compile time.
+		static constexpr inline format_args parse_fmt_spec(tt::str_view sv)
 		{
 			// remove the first and last (they are { and })
 			sv = sv.drop(1).drop_last(1);
@@ -644,7 +703,7 @@ namespace zpr
 				}
 
 				if(sv.empty())
-					goto done;
+					return fmt_args;
 
 				if('0' <= sv[0] && sv[0] <= '9')
 				{
@@ -660,7 +719,7 @@ namespace zpr
 				}
 
 				if(sv.empty())
-					goto done;
+					return fmt_args;
 
 				if(sv.size() >= 2 && sv[0] == '.')
 				{
@@ -692,7 +751,6 @@ namespace zpr
 					fmt_args.specifier = sv[0];
 			}
 
-		done:
 			return fmt_args;
 		}
 
@@ -752,344 +810,921 @@ namespace zpr
 
 
 
-		// forward declare these
-		template <typename _CallbackFn>
-		size_t print_floating(_CallbackFn& cb, double value, format_args args);
-
+		// forward declare this
 		template <typename _Type>
 		char* print_decimal_integer(char* buf, size_t bufsz, _Type value);
 
 
 
-		template <typename _CallbackFn>
-		size_t print_exponent(_CallbackFn& cb, double value, format_args args)
+		/*
+			Floating point conversion. Without a precision, `{}` and `{g}` print the shortest string that reads
+			back as the same value; the digits come from Ryu (see the notice at the top of the file), using the
+			variant with small tables that rebuilds each 128-bit power of 5 from a 26-entry table of exact powers
+			plus a 2-bit correction.
+
+			Otherwise (`{.3}`, `{.3g}`, `{f}`, `{e}`, ...) the exact binary value is rounded (half-to-even) like
+			printf does; a bare precision means `f`. Fixed notation takes a fast path using a 64x64 multiply when
+			the value lies in [2^-12, 2^63) and at most 19 decimals are needed; everything else expands the exact
+			value in base 10^9 (see exact_digits).
+		*/
+		namespace fp
 		{
-			constexpr int DEFAULT_PRECISION = 6;
+			struct uint128
+			{
+				uint64_t lo;
+				uint64_t hi;
+			};
 
-			// check for NaN and special values
-			if((value != value) || (value > DBL_MAX) || (value < -DBL_MAX))
-				return print_special_floating(cb, value, static_cast<format_args&&>(args));
+			ZPR_ALWAYS_INLINE uint128 mul_64x64(uint64_t a, uint64_t b)
+			{
+			#if defined(__SIZEOF_INT128__)
+				auto p = static_cast<unsigned __int128>(a) * b;
+				return { static_cast<uint64_t>(p), static_cast<uint64_t>(p >> 64) };
+			#else
+				uint64_t a_lo = a & 0xFFFFFFFF;
+				uint64_t a_hi = a >> 32;
+				uint64_t b_lo = b & 0xFFFFFFFF;
+				uint64_t b_hi = b >> 32;
+
+				uint64_t lo_lo = a_lo * b_lo;
+				uint64_t hi_lo = a_hi * b_lo;
+				uint64_t lo_hi = a_lo * b_hi;
+				uint64_t hi_hi = a_hi * b_hi;
+
+				uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+				return { (cross << 32) | (lo_lo & 0xFFFFFFFF), (hi_lo >> 32) + (cross >> 32) + hi_hi };
+			#endif
+			}
+
+			ZPR_ALWAYS_INLINE uint128 add(uint128 a, uint128 b)
+			{
+				uint64_t lo = a.lo + b.lo;
+				return { lo, a.hi + b.hi + (lo < a.lo) };
+			}
 
-			int prec = (args.have_precision() ? static_cast<int>(args.precision) : DEFAULT_PRECISION);
+			// both of these need 0 < n < 128
+			ZPR_ALWAYS_INLINE uint128 shift_right(uint128 a, uint32_t n)
+			{
+				if(n >= 64) return { a.hi >> (n - 64), 0 };
+				else        return { (a.lo >> n) | (a.hi << (64 - n)), a.hi >> n };
+			}
+
+			ZPR_ALWAYS_INLINE uint128 shift_left(uint128 a, uint32_t n)
+			{
+				if(n >= 64) return { 0, a.lo << (n - 64) };
+				else        return { a.lo << n, (a.hi << n) | (a.lo >> (64 - n)) };
+			}
+
+			// ceil(log2(5^e)) for e in [1, 3528], and 1 for e = 0
+			constexpr uint32_t pow5_bits(uint32_t e) { return ((e * 1217359) >> 19) + 1; }
+
+			// floor(log10(2^e)) for e in [0, 1650], and floor(log10(5^e)) for e in [0, 2620]
+			constexpr uint32_t log10_pow2(uint32_t e) { return (e * 78913) >> 18; }
+			constexpr uint32_t log10_pow5(uint32_t e) { return (e * 732923) >> 20; }
+
+			constexpr uint32_t POW5_TABLE_SIZE = 26;
+			constexpr uint32_t POW5_BITCOUNT = 125;
+			constexpr uint32_t POW5_INV_BITCOUNT = 125;
+
+			inline constexpr uint64_t POW5_TABLE[POW5_TABLE_SIZE] = {
+				1u, 5u, 25u, 125u, 625u, 3125u, 15625u, 78125u, 390625u, 1953125u, 9765625u, 48828125u,
+				244140625u, 1220703125u, 6103515625u, 30517578125u, 152587890625u, 762939453125u,
+				3814697265625u, 19073486328125u, 95367431640625u, 476837158203125u, 2384185791015625u,
+				11920928955078125u, 59604644775390625u, 298023223876953125u,
+			};
+
+			// 5^(26k), normalised to 125 bits; { lo, hi }
+			inline constexpr uint64_t POW5_SPLIT2[13][2] = {
+				{ 0x0000000000000000u, 0x1000000000000000u },
+				{ 0x0000000000000000u, 0x14adf4b7320334b9u },
+				{ 0x0e549208b31adb10u, 0x1aba4714957d300du },
+				{ 0x6dc6ad264d8f0866u, 0x1145b7e285bf98f5u },
+				{ 0xeb1dbd923d8596cau, 0x1652efdc6018a1fcu },
+				{ 0xb4c1b80b22ae923cu, 0x1cda62055b2d9d83u },
+				{ 0x5bb28b4e8f7e4c30u, 0x12a5568b9f52f416u },
+				{ 0xf08aed437682d4fbu, 0x1819651531f9e78fu },
+				{ 0xb4ee134ad99bf150u, 0x1f25c186a6f04c28u },
+				{ 0x16499ecb70c25f03u, 0x1420eb449c8842e6u },
+				{ 0x85a56ead360865b0u, 0x1a03fde214caf085u },
+				{ 0x093db1d57999890bu, 0x10cfeb353a97dad8u },
+				{ 0xcf38bb735e3f36acu, 0x15baaf44fa52673eu },
+			};
+
+			// 2-bit corrections for compute_pow5(), 16 per entry
+			inline constexpr uint32_t POW5_OFFSETS[21] = {
+				0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x40000000, 0x59695995, 0x55545555,
+				0x56555515, 0x41150504, 0x40555410, 0x44555145, 0x44504540, 0x45555550, 0x40004000,
+				0x96440440, 0x55565565, 0x54454045, 0x40154151, 0x55559155, 0x51405555, 0x00000105,
+			};
+
+			// 2^(125 + pow5_bits(26k) - 1) / 5^(26k), rounded up; { lo, hi }
+			inline constexpr uint64_t POW5_INV_SPLIT2[15][2] = {
+				{ 0x0000000000000001u, 0x2000000000000000u },
+				{ 0x52a6c95fc0655034u, 0x18c240c4aecb13bbu },
+				{ 0x7ca8d50071dfc806u, 0x1327fc58da0f6ff5u },
+				{ 0x6520247d3556476eu, 0x1da48ce468e7c702u },
+				{ 0x6139cdd76802e6e9u, 0x16ef5b40c2fc7779u },
+				{ 0xf951a7ff43de8c79u, 0x11bebdf578b2f391u },
+				{ 0x7be8bee8d6e957e8u, 0x1b758d848fac54b0u },
+				{ 0x8bd3f9e999a423eau, 0x153eda614071a3b7u },
+				{ 0x0848f973cb3ee3ceu, 0x10701bd527b4978cu },
+				{ 0x153285ebb9efbfa2u, 0x196fbb9bb44db44du },
+				{ 0xadeee7f86c07b696u, 0x13ae3591f5b4d936u },
+				{ 0x4d686a4eaf182222u, 0x1e74404f3daada91u },
+				{ 0x98c0a106e09ebd9fu, 0x17900ea4fda7c257u },
+				{ 0x8f20e37371497d0eu, 0x123b140576d820b2u },
+				{ 0xb043138134743d85u, 0x1c35f4275f7a29adu },
+			};
+
+			// 2-bit corrections for compute_inv_pow5(), 16 per entry
+			inline constexpr uint32_t POW5_INV_OFFSETS[22] = {
+				0x54544554, 0x04055545, 0x10041000, 0x00400414, 0x40010000, 0x41155555, 0x00000454,
+				0x00010044, 0x40000000, 0x44000041, 0x50454450, 0x55550054, 0x51655554, 0x40004000,
+				0x01000001, 0x00010500, 0x51515411, 0x05555554, 0x50411500, 0x40040000, 0x05040110,
+				0x00000000,
+			};
 
-			bool use_precision  = args.have_precision();
-			bool use_zero_pad   = args.zero_pad() && args.positive_width();
-			bool use_right_pad  = !use_zero_pad && args.negative_width();
-			// bool use_left_pad   = !use_zero_pad && args.positive_width();
+			// 5^i, normalised to 125 bits (truncated)
+			inline uint128 compute_pow5(uint32_t i)
+			{
+				uint32_t base = i / POW5_TABLE_SIZE;
+				uint32_t base2 = base * POW5_TABLE_SIZE;
+				uint32_t offset = i - base2;
 
-			// determine the sign
-			const bool negative = (value < 0);
-			if(negative)
-				value = -value;
+				const uint64_t* mul = POW5_SPLIT2[base];
+				if(offset == 0)
+					return { mul[0], mul[1] };
 
-			// determine the decimal exponent
-			// based on the algorithm by David Gay (https://www.ampl.com/netlib/fp/dtoa.c)
-			union {
-				uint64_t U;
-				double F;
-			} conv;
+				uint64_t m = POW5_TABLE[offset];
+				uint32_t delta = pow5_bits(i) - pow5_bits(base2);
 
-			conv.F = value;
-			auto exp2 = static_cast<int64_t>((conv.U >> 52U) & 0x07FFU) - 1023; // effectively log2
-			conv.U = (conv.U & ((1ULL << 52U) - 1U)) | (1023ULL << 52U);        // drop the exponent so conv.F is now in [1,2)
+				auto sum = add(shift_right(mul_64x64(m, mul[0]), delta), shift_left(mul_64x64(m, mul[1]), 64 - delta));
+				return add(sum, { (POW5_OFFSETS[i / 16] >> ((i % 16) << 1)) & 3, 0 });
+			}
 
-			// now approximate log10 from the log2 integer part and an expansion of ln around 1.5
-			auto expval = static_cast<int64_t>(0.1760912590558 + static_cast<double>(exp2) * 0.301029995663981
-				+ (conv.F - 1.5) * 0.289529654602168);
+			// 2^(125 + pow5_bits(i) - 1) / 5^i, rounded up
+			inline uint128 compute_inv_pow5(uint32_t i)
+			{
+				uint32_t base = (i + POW5_TABLE_SIZE - 1) / POW5_TABLE_SIZE;
+				uint32_t base2 = base * POW5_TABLE_SIZE;
+				uint32_t offset = base2 - i;
 
-			// now we want to compute 10^expval but we want to be sure it won't overflow
-			exp2 = static_cast<int64_t>(static_cast<double>(expval) * 3.321928094887362 + 0.5);
+				const uint64_t* mul = POW5_INV_SPLIT2[base];
+				if(offset == 0)
+					return { mul[0], mul[1] };
 
-			const double z = static_cast<double>(expval) * 2.302585092994046
-				- static_cast<double>(exp2) * 0.6931471805599453;
-			const double z2 = z * z;
+				uint64_t m = POW5_TABLE[offset];
+				uint32_t delta = pow5_bits(base2) - pow5_bits(i);
 
-			conv.U = static_cast<uint64_t>(exp2 + 1023) << 52U;
+				auto sum = add(shift_right(mul_64x64(m, mul[0] - 1), delta), shift_left(mul_64x64(m, mul[1]), 64 - delta));
+				return add(sum, { 1 + ((POW5_INV_OFFSETS[i / 16] >> ((i % 16) << 1)) & 3), 0 });
+			}
 
-			// compute exp(z) using continued fractions, see https://en.wikipedia.org/wiki/Exponential_function#Continued_fractions_for_ex
-			conv.F *= 1 + 2 * z / (2 - z + (z2 / (6 + (z2 / (10 + z2 / 14)))));
+			// (m * mul) >> j, where j >= 64
+			ZPR_ALWAYS_INLINE uint64_t mul_shift(uint64_t m, uint128 mul, uint32_t j)
+			{
+				auto b0 = mul_64x64(m, mul.lo);
+				auto b2 = mul_64x64(m, mul.hi);
+				auto sum = add({ b0.hi, 0 }, b2);
+
+				return (j == 64 ? sum : shift_right(sum, j - 64)).lo;
+			}
 
-			// correct for rounding errors
-			if(value < conv.F)
+			constexpr bool multiple_of_pow5(uint64_t value, uint32_t p)
 			{
-				expval--;
-				conv.F /= 10;
+				uint32_t count = 0;
+				for(; count < p && value % 5 == 0; value /= 5)
+					count++;
+
+				return count >= p;
 			}
 
-			// the exponent format is "%+02d" and largest value is "307", so set aside 4-5 characters (including the e+ part)
-			int minwidth = (-100 < expval && expval < 100) ? 4U : 5U;
+			constexpr bool multiple_of_pow2(uint64_t value, uint32_t p)
+			{
+				return (value & ((1ull << p) - 1)) == 0;
+			}
+
+			struct decimal
+			{
+				uint64_t digits;
+				int32_t exponent;
+			};
 
-			// in "%g" mode, "prec" is the number of *significant figures* not decimals
-			if(args.specifier == 'g' || args.specifier == 'G')
+			/*
+				Ryu's d2d(): the shortest `digits * 10^exponent` that rounds to the given (non-zero, finite)
+				value. It is written for doubles, but since the 125-bit tables are accurate for every exponent
+				in that range, it also works as-is for floats (with their mantissa and exponent widths).
+			*/
+			template <uint32_t _MantissaBits, uint32_t _ExponentBits>
+			inline decimal shortest(uint64_t ieee_mantissa, uint32_t ieee_exponent)
 			{
-				// do we want to fall-back to "%f" mode?
-				if((value >= 1e-4) && (value < 1e6))
+				constexpr int32_t bias = (1 << (_ExponentBits - 1)) - 1;
+
+				int32_t e2 = 0;
+				uint64_t m2 = 0;
+				if(ieee_exponent == 0)
+				{
+					e2 = 1 - bias - static_cast<int32_t>(_MantissaBits) - 2;
+					m2 = ieee_mantissa;
+				}
+				else
 				{
-					if(static_cast<int64_t>(prec) > expval)
-						prec = static_cast<int>(static_cast<int64_t>(prec) - expval - 1);
+					e2 = static_cast<int32_t>(ieee_exponent) - bias - static_cast<int32_t>(_MantissaBits) - 2;
+					m2 = (1ull << _MantissaBits) | ieee_mantissa;
+				}
 
-					else
-						prec = 0;
+				const bool accept_bounds = (m2 & 1) == 0;
+
+				// the interval of valid representations is [mv - 1 - mm_shift, mv + 2] / 4 * 2^e2
+				const uint64_t mv = 4 * m2;
+				const uint32_t mm_shift = (ieee_mantissa != 0 || ieee_exponent <= 1);
+
+				uint64_t vr = 0;
+				uint64_t vp = 0;
+				uint64_t vm = 0;
+				int32_t e10 = 0;
+				bool vm_trailing_zeros = false;
+				bool vr_trailing_zeros = false;
+
+				if(e2 >= 0)
+				{
+					const uint32_t e = static_cast<uint32_t>(e2);
+					const uint32_t q = log10_pow2(e) - (e > 3);
+					const uint32_t j = POW5_INV_BITCOUNT + pow5_bits(q) - 1 - e + q;
+					const auto mul = compute_inv_pow5(q);
+
+					e10 = static_cast<int32_t>(q);
+					vr = mul_shift(4 * m2, mul, j);
+					vp = mul_shift(4 * m2 + 2, mul, j);
+					vm = mul_shift(4 * m2 - 1 - mm_shift, mul, j);
+
+					// for larger q, mv can't be a multiple of 5^q.
+					if(q <= 21)
+					{
+						if(mv % 5 == 0)             vr_trailing_zeros = multiple_of_pow5(mv, q);
+						else if(accept_bounds)      vm_trailing_zeros = multiple_of_pow5(mv - 1 - mm_shift, q);
+						else                        vp -= multiple_of_pow5(mv + 2, q);
+					}
+				}
+				else
+				{
+					const uint32_t e = static_cast<uint32_t>(-e2);
+					const uint32_t q = log10_pow5(e) - (e > 1);
+					const uint32_t i = e - q;
+					const uint32_t j = q - (pow5_bits(i) - POW5_BITCOUNT);
+					const auto mul = compute_pow5(i);
+
+					e10 = static_cast<int32_t>(q) + e2;
+					vr = mul_shift(4 * m2, mul, j);
+					vp = mul_shift(4 * m2 + 2, mul, j);
+					vm = mul_shift(4 * m2 - 1 - mm_shift, mul, j);
+
+					if(q <= 1)
+					{
+						// mv has at least q trailing 0 bits, so {vr,vp,vm} all have at least q trailing 0 digits.
+						vr_trailing_zeros = true;
+						if(accept_bounds)   vm_trailing_zeros = (mm_shift == 1);
+						else                vp -= 1;
+					}
+					else if(q < 63)
+					{
+						vr_trailing_zeros = multiple_of_pow2(mv, q);
+					}
+				}
 
-					args.precision = prec;
+				// now remove digits while the interval still contains more than one representation.
+				int32_t removed = 0;
+				uint64_t output = 0;
 
-					// no characters in exponent
-					minwidth = 0;
-					expval = 0;
+				if(ZPR_UNLIKELY(vm_trailing_zeros || vr_trailing_zeros))
+				{
+					uint8_t last_removed = 0;
+					while(vp / 10 > vm / 10)
+					{
+						vm_trailing_zeros &= (vm % 10 == 0);
+						vr_trailing_zeros &= (last_removed == 0);
+						last_removed = static_cast<uint8_t>(vr % 10);
+
+						vr /= 10;
+						vp /= 10;
+						vm /= 10;
+						removed++;
+					}
+
+					if(vm_trailing_zeros)
+					{
+						while(vm % 10 == 0)
+						{
+							vr_trailing_zeros &= (last_removed == 0);
+							last_removed = static_cast<uint8_t>(vr % 10);
+
+							vr /= 10;
+							vp /= 10;
+							vm /= 10;
+							removed++;
+						}
+					}
+
+					// round to even if the exact number is ...50..0
+					if(vr_trailing_zeros && last_removed == 5 && vr % 2 == 0)
+						last_removed = 4;
+
+					output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) || last_removed >= 5);
 				}
 				else
 				{
-					// we use one sigfig for the whole part
-					if(prec > 0 && use_precision)
-						prec -= 1;
+					bool round_up = false;
+					if(vp / 100 > vm / 100)
+					{
+						round_up = (vr % 100) >= 50;
+
+						vr /= 100;
+						vp /= 100;
+						vm /= 100;
+						removed += 2;
+					}
+
+					while(vp / 10 > vm / 10)
+					{
+						round_up = (vr % 10) >= 5;
+
+						vr /= 10;
+						vp /= 10;
+						vm /= 10;
+						removed++;
+					}
+
+					output = vr + (vr == vm || round_up);
 				}
+
+				return { output, e10 + removed };
 			}
 
-			// will everything fit?
-			auto fwidth = static_cast<uint64_t>(args.width);
-			if(args.width > minwidth)
+
+			// enough for the 767 significant digits of the smallest subnormal double
+			constexpr int32_t MAX_EXACT_DIGITS = 800;
+			constexpr uint32_t LIMB_BASE = 1000000000;
+
+			inline uint32_t limbs_from(uint32_t* limbs, uint64_t value)
 			{
-				// we didn't fall-back so subtract the characters required for the exponent
-				fwidth -= static_cast<uint64_t>(minwidth);
+				uint32_t len = 0;
+				for(; value > 0; value /= LIMB_BASE)
+					limbs[len++] = static_cast<uint32_t>(value % LIMB_BASE);
+
+				return len;
 			}
-			else
+
+			inline uint32_t limbs_multiply(uint32_t* limbs, uint32_t len, uint64_t factor)
 			{
-				// not enough characters, so go back to default sizing
-				fwidth = 0;
+				uint64_t carry = 0;
+				for(uint32_t i = 0; i < len; i++)
+				{
+					uint64_t x = limbs[i] * factor + carry;
+					limbs[i] = static_cast<uint32_t>(x % LIMB_BASE);
+					carry = x / LIMB_BASE;
+				}
+
+				for(; carry > 0; carry /= LIMB_BASE)
+					limbs[len++] = static_cast<uint32_t>(carry % LIMB_BASE);
+
+				return len;
 			}
 
-			if(use_right_pad && minwidth)
+			// writes the decimal digits of the (little-endian, base 10^9) number to `buf`, returning the count.
+			inline int32_t limbs_to_chars(const uint32_t* limbs, uint32_t len, char* buf)
 			{
-				// if we're padding on the right, DON'T pad the floating part
-				fwidth = 0;
-			}
+				char tmp[16];
+				auto top = print_decimal_integer(tmp, 16, limbs[len - 1]);
+				auto n = static_cast<int32_t>(tmp + 16 - top);
+				memcpy(buf, top, static_cast<size_t>(n));
 
-			// rescale the float value
-			if(expval)
-				value /= conv.F;
+				for(uint32_t i = len - 1; i-- > 0; n += 9)
+				{
+					auto x = limbs[i];
+					for(int k = 8; k >= 0; k--, x /= 10)
+						buf[n + k] = static_cast<char>('0' + x % 10);
+				}
 
-			// output the floating part
+				return n;
+			}
 
-			auto args_copy = args;
-			args_copy.width = static_cast<int64_t>(fwidth);
-			auto len = static_cast<int64_t>(print_floating(cb, negative ? -value : value, args_copy));
+			/*
+				Writes every significant digit of the exact value `m * 2^e` to `buf` (which should hold
+				MAX_EXACT_DIGITS), without trailing zeros, and returns the number of digits. `sci` is set to
+				the decimal exponent of the first digit. A fraction f / 2^s is expanded as f * 5^s / 10^s.
 
-			// output the exponent part
-			if(minwidth > 0)
+				If the caller only wants `limit` digits, we may stop early; in that case a '1' is appended when
+				the rest is non-zero, which is all that round_digits() needs to know about it.
+			*/
+			inline int32_t exact_digits(uint64_t m, int32_t e, char* buf, int32_t& sci, int32_t limit = MAX_EXACT_DIGITS)
 			{
-				len++;
-				if(args.specifier & 0x20)   cb('e');
-				else                        cb('E');
+				uint32_t limbs[96];
+				int32_t n = 0;
+				sci = 0;
 
-				// output the exponent value
-				char digits_buf[8] = { };
-				size_t digits_len = 0;
+				if(m == 0)
+					return 0;
 
-				auto buf = print_decimal_integer(digits_buf, 8, static_cast<int64_t>(tt::_Absolute(expval)));
-				digits_len = 8 - static_cast<size_t>(buf - digits_buf);
+				// the common case: the whole part and the fraction both fit in 64 bits, so we can peel off 9
+				// fraction digits at a time with a 64x64 multiply (and print them as a 32-bit number).
+				if(-64 <= e && e <= 10)
+				{
+					auto s = static_cast<uint32_t>(e < 0 ? -e : 0);
+					auto whole = (e >= 0 ? m << e : (s == 64 ? 0 : m >> s));
+					auto frac = (e >= 0 ? 0 : (s == 64 ? m : (m & ((1ull << s) - 1)) << (64 - s)));
 
-				len += digits_len + 1;
-				cb(expval < 0 ? '-' : '+');
+					if(whole > 0)
+					{
+						auto digits = print_decimal_integer(buf, 20, whole);
+						n = static_cast<int32_t>(buf + 20 - digits);
+						memmove(buf, digits, static_cast<size_t>(n));
+						sci = n - 1;
+					}
 
-				// zero-pad to minwidth - 2
-				if(auto tmp = (minwidth - 2) - static_cast<int>(digits_len); tmp > 0)
-					len += tmp, cb('0', static_cast<size_t>(tmp));
+					int32_t zeros = 0;
+					while(frac != 0)
+					{
+						if(n > limit)
+						{
+							buf[n++] = '1';
+							break;
+						}
 
-				cb(buf, digits_len);
+						auto prod = mul_64x64(frac, LIMB_BASE);
+						auto chunk = static_cast<uint32_t>(prod.hi);
+						frac = prod.lo;
 
-				// might need to right-pad spaces
-				if(use_right_pad && args.width > len)
-					cb(' ', static_cast<size_t>(args.width - len)), len = args.width;
-			}
+						if(n == 0 && chunk == 0)
+						{
+							zeros += 9;
+							continue;
+						}
 
-			return static_cast<size_t>(len);
-		}
+						char tmp[9];
+						memset(tmp, '0', 9);
+						auto digits = print_decimal_integer(tmp, 9, chunk);
 
+						if(n == 0)
+						{
+							auto k = static_cast<int32_t>(tmp + 9 - digits);
+							sci = -(zeros + 9 - k) - 1;
+							memcpy(buf, digits, static_cast<size_t>(k));
+							n = k;
+						}
+						else
+						{
+							memcpy(buf + n, tmp, 9);
+							n += 9;
+						}
+					}
+				}
+				else if(e >= 0)
+				{
+					auto len = limbs_from(limbs, m);
+					for(auto k = static_cast<uint32_t>(e); k > 0; )
+					{
+						auto shift = tt::_Minimum(k, 32u);
+						len = limbs_multiply(limbs, len, 1ull << shift);
+						k -= shift;
+					}
 
-		template <typename _CallbackFn>
-		size_t print_floating(_CallbackFn& cb, double value, format_args args)
-		{
-			constexpr int DEFAULT_PRECISION = 6;
-			constexpr size_t MAX_BUFFER_LEN = 128;
-			constexpr long double EXPONENTIAL_CUTOFF = 1e15;
+					n = limbs_to_chars(limbs, len, buf);
+					sci = n - 1;
+				}
+				else
+				{
+					auto s = static_cast<uint32_t>(-e);
+					auto whole = (s < 64 ? m >> s : 0);
+					auto frac = (s < 64 ? m & ((1ull << s) - 1) : m);
 
-			char buf[MAX_BUFFER_LEN] = { 0 };
+					if(whole > 0)
+					{
+						n = limbs_to_chars(limbs, limbs_from(limbs, whole), buf);
+						sci = n - 1;
+					}
 
-			size_t len = 0;
+					if(frac > 0)
+					{
+						auto len = limbs_from(limbs, frac);
+						for(auto k = s; k > 0; )
+						{
+							auto x = tt::_Minimum(k, 13u);
+							len = limbs_multiply(limbs, len, POW5_TABLE[x]);
+							k -= x;
+						}
 
-			int prec = (args.have_precision() ? static_cast<int>(args.precision) : DEFAULT_PRECISION);
-
-			bool use_zero_pad   = args.zero_pad() && args.positive_width();
-			bool use_left_pad   = !use_zero_pad && args.positive_width();
-			bool use_right_pad  = !use_zero_pad && args.negative_width();
-
-			// powers of 10
-			constexpr double pow10[] = {
-				1,
-				10,
-				100,
-				1000,
-				10000,
-				100000,
-				1000000,
-				10000000,
-				100000000,
-				1000000000,
-				10000000000,
-				100000000000,
-				1000000000000,
-				10000000000000,
-				100000000000000,
-				1000000000000000,
-				10000000000000000,
-			};
+						// the fraction has exactly `s` digits after the point; the missing ones are leading zeros.
+						auto digits = limbs_to_chars(limbs, len, buf + MAX_EXACT_DIGITS - 1 - 9 * len);
+						auto zeros = static_cast<int32_t>(s) - digits;
+						auto src = buf + MAX_EXACT_DIGITS - 1 - 9 * len;
 
-			// test for special values
-			if((value != value) || (value > DBL_MAX) || (value < -DBL_MAX))
-				return print_special_floating(cb, value, static_cast<format_args&&>(args));
+						if(n > 0)
+						{
+							memset(buf + n, '0', static_cast<size_t>(zeros));
+							n += zeros;
+						}
+						else
+						{
+							sci = -(zeros + 1);
+						}
 
-			// switch to exponential for large values.
-			if((value > EXPONENTIAL_CUTOFF) || (value < -EXPONENTIAL_CUTOFF))
-				return print_exponent(cb, value, static_cast<format_args&&>(args));
+						memmove(buf + n, src, static_cast<size_t>(digits));
+						n += digits;
+					}
+				}
 
-			// default to g.
-			if(args.specifier == 0)
-				args.specifier = 'g';
+				while(n > 0 && buf[n - 1] == '0')
+					n--;
 
-			// test for negative
-			const bool negative = (value < 0);
-			if(value < 0)
-				value = -value;
+				return n;
+			}
 
-			// limit precision to 16, cause a prec >= 17 can lead to overflow errors
-			while((len < MAX_BUFFER_LEN) && (prec > 16))
+			// rounds the exact digits in `buf` to `keep` digits (half-to-even), returning the new count. if the
+			// rounding carries all the way out (eg. 9.99 -> 10.0), `sci` is incremented.
+			inline int32_t round_digits(char* buf, int32_t n, int32_t keep, int32_t& sci)
 			{
-				buf[len++] = '0';
-				prec--;
-			}
+				if(keep >= n)
+					return n;
 
-			auto whole = static_cast<int64_t>(value);
-			auto tmp = (value - static_cast<double>(whole)) * pow10[prec];
-			auto frac = static_cast<unsigned long>(tmp);
+				if(keep < 0)
+					return 0;
 
-			double diff = tmp - static_cast<double>(frac);
+				bool round_up = buf[keep] > '5';
+				if(buf[keep] == '5')
+				{
+					// since there are no trailing zeros, anything after the 5 means we are above the halfway point.
+					if(keep + 1 < n)    round_up = true;
+					else                round_up = (keep > 0 && ((buf[keep - 1] - '0') & 1));
+				}
 
-			if(diff > 0.5)
-			{
-				frac += 1;
+				if(!round_up)
+					return keep;
+
+				auto i = keep - 1;
+				while(i >= 0 && buf[i] == '9')
+					buf[i--] = '0';
 
-				// handle rollover, e.g. case 0.99 with prec 1 is 1.0
-				if(frac >= static_cast<unsigned long>(pow10[prec]))
+				if(i >= 0)
 				{
-					frac = 0;
-					whole += 1;
+					buf[i]++;
+					return keep;
 				}
+
+				buf[0] = '1';
+				sci += 1;
+				return tt::_Maximum(keep, 1);
 			}
-			else if(diff < 0.5)
+		}
+
+		/*
+			Print the digits `digits[0 .. n)` (the first one having the decimal exponent `exp10`) in either fixed
+			or exponent form with exactly `prec` digits after the decimal point; missing digits are printed as 0.
+			Takes care of the sign and padding.
+		*/
+		template <typename _CallbackFn>
+		size_t print_float_digits(_CallbackFn& cb, bool negative, const char* digits, int32_t n, int32_t exp10,
+			bool exp_form, int32_t prec, bool uppercase, const format_args& args)
+		{
+			// integer part: digits[0 .. int_n), then int_zeros zeros.
+			// fraction: frac_zeros zeros, digits[frac_start .. frac_start + frac_n), then trail_zeros zeros.
+			int32_t int_n = 0;
+			int32_t int_zeros = 0;
+			int32_t frac_zeros = 0;
+			int32_t frac_start = 0;
+			int32_t frac_n = 0;
+
+			char exp_buf[8] = { };
+			size_t exp_len = 0;
+
+			if(exp_form)
 			{
-				// ?
+				int_n = tt::_Minimum(n, 1);
+				int_zeros = 1 - int_n;
+
+				frac_start = 1;
+				frac_n = tt::_Maximum(0, tt::_Minimum(n - 1, prec));
+
+				auto x = tt::_Absolute(exp10);
+				exp_buf[exp_len++] = uppercase ? 'E' : 'e';
+				exp_buf[exp_len++] = exp10 < 0 ? '-' : '+';
+
+				if(x >= 100)
+					exp_buf[exp_len++] = static_cast<char>('0' + x / 100);
+
+				exp_buf[exp_len++] = static_cast<char>('0' + (x / 10) % 10);
+				exp_buf[exp_len++] = static_cast<char>('0' + x % 10);
 			}
-			else if((frac == 0U) || (frac & 1U))
+			else
 			{
-				// if halfway, round up if odd OR if last digit is 0
-				frac += 1;
+				auto point = exp10 + 1;
+
+				int_n = tt::_Maximum(0, tt::_Minimum(point, n));
+				int_zeros = (point <= 0 ? 1 : point - int_n);
+
+				frac_zeros = tt::_Minimum(prec, tt::_Maximum(0, -point));
+				frac_start = tt::_Maximum(point, 0);
+				frac_n = tt::_Maximum(0, tt::_Minimum(n, point + prec) - frac_start);
 			}
 
-			if(prec == 0U)
+			const int32_t trail_zeros = prec - frac_zeros - frac_n;
+			const bool decimal_point = (prec > 0 || args.alternate());
+			const char sign = negative ? '-' : args.prepend_plus() ? '+' : args.prepend_space() ? ' ' : 0;
+
+			const auto len = static_cast<int64_t>((sign ? 1 : 0) + int_n + int_zeros + (decimal_point ? 1 : 0)
+				+ frac_zeros + frac_n + trail_zeros) + static_cast<int64_t>(exp_len);
+
+			const bool use_zero_pad = args.zero_pad() && args.positive_width();
+			const auto padding = static_cast<size_t>(args.have_width() && args.width > len ? args.width - len : 0);
+
+			if(padding > 0 && args.positive_width() && !use_zero_pad)
+				cb(' ', padding);
+
+			if(sign)
+				cb(sign);
+
+			if(padding > 0 && use_zero_pad)
+				cb('0', padding);
+
+			// most numbers are short, so assemble them in one place and make a single call to the
+			// callback; only fall back to printing the pieces separately for long ones.
+			char body[64];
+			const auto body_len = static_cast<size_t>(len - (sign ? 1 : 0));
+			const bool buffered = (body_len <= sizeof(body));
+
+			size_t pos = 0;
+			auto emit = [&](const char* s, size_t k) {
+				if(buffered)    { memcpy(body + pos, s, k); pos += k; }
+				else            { cb(s, k); }
+			};
+			auto emit_zeros = [&](int32_t k) {
+				if(k <= 0)      return;
+				if(buffered)    { memset(body + pos, '0', static_cast<size_t>(k)); pos += static_cast<size_t>(k); }
+				else            { cb('0', static_cast<size_t>(k)); }
+			};
+
+			if(int_n > 0)       emit(digits, static_cast<size_t>(int_n));
+			emit_zeros(int_zeros);
+			if(decimal_point)   emit(".", 1);
+			emit_zeros(frac_zeros);
+			if(frac_n > 0)      emit(digits + frac_start, static_cast<size_t>(frac_n));
+			emit_zeros(trail_zeros);
+			if(exp_len > 0)     emit(exp_buf, exp_len);
+
+			if(buffered)
+				cb(body, pos);
+
+			if(padding > 0 && args.negative_width())
+				cb(' ', padding);
+
+			return static_cast<size_t>(len) + padding;
+		}
+
+		template <typename _CallbackFn, typename _Float>
+		size_t print_floating(_CallbackFn& cb, _Float value, format_args args)
+		{
+			static_assert(tt::is_same_v<_Float, float> || tt::is_same_v<_Float, double>);
+
+			constexpr bool is_float = tt::is_same_v<_Float, float>;
+			constexpr uint32_t MANTISSA_BITS = is_float ? 23 : 52;
+			constexpr uint32_t EXPONENT_BITS = is_float ? 8 : 11;
+			constexpr int32_t EXPONENT_BIAS = (1 << (EXPONENT_BITS - 1)) - 1;
+			constexpr int32_t DEFAULT_PRECISION = 6;
+
+			// powers of 10, for the fixed fast path
+			constexpr uint64_t pow10[] = {
+				1u, 10u, 100u, 1000u, 10000u, 100000u, 1000000u, 10000000u, 100000000u, 1000000000u,
+				10000000000u, 100000000000u, 1000000000000u, 10000000000000u, 100000000000000u,
+				1000000000000000u, 10000000000000000u, 100000000000000000u, 1000000000000000000u,
+				10000000000000000000u,
+			};
+
+			// test for special values
+			if((value != value) || (value > DBL_MAX) || (value < -DBL_MAX))
+				return print_special_floating(cb, static_cast<double>(value), static_cast<format_args&&>(args));
+
+			tt::conditional_t<is_float, uint32_t, uint64_t> bits = 0;
+			memcpy(&bits, &value, sizeof(value));
+
+			const bool negative = (bits >> (sizeof(bits) * 8 - 1)) != 0;
+			const auto ieee_mantissa = static_cast<uint64_t>(bits & ((1ull << MANTISSA_BITS) - 1));
+			const auto ieee_exponent = static_cast<uint32_t>((bits >> MANTISSA_BITS) & ((1u << EXPONENT_BITS) - 1));
+
+			const char spec = args.specifier;
+			const bool uppercase = (spec == 'E' || spec == 'G');
+
+			// no precision: the shortest representation that round-trips. it is printed in fixed form
+			// when the exponent is in [-4, 16), which covers all integers that a double can store exactly.
+			if((spec == 0 || spec == 'g' || spec == 'G') && !args.have_precision())
 			{
-				diff = value - static_cast<double>(whole);
-				if((!(diff < 0.5) || (diff > 0.5)) && (whole & 1))
+				char buf[24] = { };
+				const char* digits = buf;
+				int32_t n = 0;
+				int32_t sci = 0;
+
+				if(ieee_mantissa != 0 || ieee_exponent != 0)
 				{
-					// exactly 0.5 and ODD, then round up
-					// 1.5 -> 2, but 2.5 -> 2
-					whole += 1;
+					auto dec = fp::shortest<MANTISSA_BITS, EXPONENT_BITS>(ieee_mantissa, ieee_exponent);
+					digits = print_decimal_integer(buf, sizeof(buf), dec.digits);
+					n = static_cast<int32_t>(buf + sizeof(buf) - digits);
+					sci = dec.exponent + n - 1;
 				}
+
+				if(-4 <= sci && sci < 16)
+					return print_float_digits(cb, negative, digits, n, sci, false, tt::_Maximum(0, n - sci - 1), false, args);
+				else
+					return print_float_digits(cb, negative, digits, n, sci, true, n - 1, uppercase, args);
 			}
-			else
-			{
-				auto count = prec;
 
-				bool flag = (args.specifier == 'g' || args.specifier == 'G');
-				// now do fractional part, as an unsigned number
-				while(len < MAX_BUFFER_LEN)
+			int32_t prec = (args.have_precision() ? static_cast<int32_t>(args.precision) : DEFAULT_PRECISION);
+
+			// the value is exactly m * 2^e
+			const uint64_t m = (ieee_exponent == 0 ? ieee_mantissa : ieee_mantissa | (1ull << MANTISSA_BITS));
+			const int32_t e = (ieee_exponent == 0 ? 1 : static_cast<int32_t>(ieee_exponent)) - EXPONENT_BIAS
+				- static_cast<int32_t>(MANTISSA_BITS);
+
+			// a precision without a specifier (eg. `{.3}`) means fixed, as it always has.
+			if(spec == 0 || spec == 'f' || spec == 'F')
+			{
+				// if the value is (roughly) in [2^-12, 2^63) and at most 19 decimals are needed, we can get the
+				// correctly-rounded fraction with one 64x64 multiply, since the fraction has at most 64 bits.
+				if(prec <= 19 && -64 <= e && e <= 10)
 				{
-					buf[len++] = static_cast<char>('0' + (frac % 10));
-					if(flag && (frac % 10) == 0)
-						goto skip;
+					uint64_t whole = 0;
+					uint64_t frac = 0;
 
-					flag = false;
+					if(e >= 0)
+					{
+						whole = m << e;
+					}
+					else
+					{
+						auto s = static_cast<uint32_t>(-e);
+						auto mask = (s == 64 ? ~0ull : (1ull << s) - 1);
+						whole = (s == 64 ? 0 : m >> s);
 
-				skip:
-					count -= 1;
-					if(!(frac /= 10))
-						break;
+						auto prod = fp::mul_64x64(m & mask, pow10[prec]);
+						auto rem = prod.lo & mask;
+						auto half = 1ull << (s - 1);
+
+						// ties go to even; with no decimals, the last digit is the one in `whole`.
+						frac = fp::shift_right(prod, s).lo;
+						if(rem > half || (rem == half && ((prec > 0 ? frac : whole) & 1)))
+							frac++;
+
+						if(frac == pow10[prec])
+							frac = 0, whole++;
+					}
+
+					char buf[48] = { };
+					auto whole_digits = (whole > 0 ? print_decimal_integer(buf, 20, whole) : buf + 20);
+					auto n = static_cast<int32_t>(buf + 20 - whole_digits);
+
+					for(auto i = prec; i-- > 0; frac /= 10)
+						buf[20 + i] = static_cast<char>('0' + frac % 10);
+
+					return print_float_digits(cb, negative, whole_digits, n + prec, n - 1, false, prec, false, args);
 				}
 
-				// add extra 0s
-				while((len < MAX_BUFFER_LEN) && (count-- > 0))
-					buf[len++] = '0';
+				char buf[fp::MAX_EXACT_DIGITS];
+				int32_t sci = 0;
+				auto n = fp::exact_digits(m, e, buf, sci);
+				n = fp::round_digits(buf, n, sci + 1 + prec, sci);
 
-				// add decimal
-				if(len < MAX_BUFFER_LEN)
-					buf[len++] = '.';
+				return print_float_digits(cb, negative, buf, n, sci, false, prec, false, args);
 			}
 
-			// do whole part, number is reversed
-			while(len < MAX_BUFFER_LEN)
+			// 'e' needs prec + 1 digits, and 'g' needs prec digits.
+			if(prec == 0 && spec != 'e' && spec != 'E')
+				prec = 1;
+
+			char buf[fp::MAX_EXACT_DIGITS];
+			int32_t sci = 0;
+			auto n = fp::exact_digits(m, e, buf, sci, (spec == 'e' || spec == 'E') ? prec + 1 : prec);
+
+			if(spec == 'e' || spec == 'E')
 			{
-				buf[len++] = static_cast<char>('0' + (whole % 10));
-				if(!(whole /= 10))
-					break;
+				n = fp::round_digits(buf, n, prec + 1, sci);
+				return print_float_digits(cb, negative, buf, n, sci, true, prec, uppercase, args);
 			}
 
-			// pad leading zeros
-			if(use_zero_pad)
-			{
-				auto width = args.width;
+			// otherwise, 'g' with a precision: it's the number of significant digits. we use the exponent
+			// form if the exponent (after rounding) is less than -4, or not less than the precision.
+			n = fp::round_digits(buf, n, prec, sci);
+			if(n == 0)
+				sci = 0;
 
-				if(args.have_width() != 0 && (negative || args.prepend_plus() || args.prepend_space()))
-					width--;
+			const bool exp_form = (sci < -4 || sci >= prec);
 
-				while((len < static_cast<size_t>(width)) && (len < MAX_BUFFER_LEN))
-					buf[len++] = '0';
+			// unless '#' was given, trailing zeros are removed.
+			int32_t digits_after_point = 0;
+			if(args.alternate())
+			{
+				digits_after_point = (exp_form ? prec - 1 : prec - 1 - sci);
 			}
-
-			if(len < MAX_BUFFER_LEN)
+			else
 			{
-				if(negative)
-					buf[len++] = '-';
+				while(n > 0 && buf[n - 1] == '0')
+					n--;
 
-				else if(args.prepend_plus())
-					buf[len++] = '+'; // ignore the space if the '+' exists
-
-				else if(args.prepend_space())
-					buf[len++] = ' ';
+				digits_after_point = tt::_Maximum(0, exp_form ? n - 1 : n - sci - 1);
 			}
 
-			// reverse it.
-			for(size_t i = 0; i < len / 2; i++)
-				tt::swap(buf[i], buf[len - i - 1]);
+			return print_float_digits(cb, negative, buf, n, sci, exp_form, digits_after_point, uppercase, args);
+		}
+
+
+		// floor(log2(x)), for x > 0.
+		ZPR_ALWAYS_INLINE int log2_floor(uint64_t x)
+		{
+		#if defined(__GNUC__)
+			return 63 - __builtin_clzll(x);
+		#else
+			int ret = 0;
+			while(x >>= 1)
+				ret++;
 
-			auto padding_width = static_cast<size_t>(tt::_Maximum(int64_t(0), args.width - static_cast<int64_t>(len)));
+			return ret;
+		#endif
+		}
 
-			if(use_left_pad) cb(' ', padding_width);
-			if(use_zero_pad) cb('0', padding_width);
+		// the number of decimal digits in x (at least 1). the number of bits gives an estimate of log10 that is
+		// either right or one too big, so it only needs one comparison to fix it -- no loop.
+		ZPR_ALWAYS_INLINE int count_decimal_digits(uint64_t x)
+		{
+			constexpr uint64_t pow10[] = {
+				1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+				1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+				100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+				1000000000000000000ULL, 10000000000000000000ULL
+			};
 
-			cb(buf, len);
+			// (x | 1 has the same number of digits as x, and it makes 0 have 1 digit.)
+			x |= 1;
 
-			if(use_right_pad)
-				cb(' ', padding_width);
+			auto t = ((log2_floor(x) + 1) * 1233) >> 12;
+			return t - (x < pow10[t]) + 1;
+		}
 
-			return len + ((use_left_pad || use_right_pad) ? padding_width : 0);
+		ZPR_ALWAYS_INLINE int count_hex_digits(uint64_t x)
+		{
+			return log2_floor(x | 1) / 4 + 1;
 		}
 
+		// on little-endian machines, 8 digits are made at once in the bytes of a 64-bit word (SWAR), with the
+		// most significant digit in the lowest byte so that it goes first when the word is stored.
+	#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || defined(_MSC_VER)
+		#define ZPR_SWAR_DIGITS 1
+	#else
+		#define ZPR_SWAR_DIGITS 0
+	#endif
 
-		template <typename _Type>
-		char* print_hex_integer(char* buf, size_t bufsz, _Type value)
+		// exactly 8 digits of x (which is less than 10^8), with leading zeros.
+		ZPR_ALWAYS_INLINE void write_8_decimal_digits(char* dst, uint32_t x)
 		{
-			static_assert(sizeof(_Type) <= 8);
+		#if ZPR_SWAR_DIGITS
+			// split into two halves of 4 digits (one per 32-bit lane), then each of those into two 2-digit
+			// halves (one per 16-bit lane), and then those into single digits (one per byte). each step divides
+			// every lane at once with a multiply and a shift, which is exact for the range of values in the lane.
+			uint64_t v = (x / 10000) | (static_cast<uint64_t>(x % 10000) << 32);
+
+			uint64_t q = ((v * 10486) >> 20) & 0x0000007F0000007FULL;
+			v = q | ((v - q * 100) << 16);
+
+			q = ((v * 103) >> 10) & 0x000F000F000F000FULL;
+			v = q | ((v - q * 10) << 8);
+
+			v |= 0x3030303030303030ULL;
+			memcpy(dst, &v, 8);
+		#elif ZPR_DECIMAL_LOOKUP_TABLE
+			constexpr const char lookup_table[] =
+				"000102030405060708091011121314151617181920212223242526272829"
+				"303132333435363738394041424344454647484950515253545556575859"
+				"606162636465666768697071727374757677787980818283848586878889"
+				"90919293949596979899";
 
-		#if ZPR_HEXADECIMAL_LOOKUP_TABLE
+			for(int i = 6; i >= 0; i -= 2, x /= 100)
+				memcpy(&dst[i], &lookup_table[(x % 100) * 2], 2);
+		#else
+			for(int i = 8; i-- > 0; x /= 10)
+				dst[i] = static_cast<char>('0' + x % 10);
+		#endif
+		}
+
+		// exactly 8 (lowercase) hex digits of x, with leading zeros.
+		ZPR_ALWAYS_INLINE void write_8_hex_digits(char* dst, uint32_t x)
+		{
+		#if ZPR_SWAR_DIGITS
+			// spread the nibbles out into bytes, most significant first; then every byte that is 10 or more
+			// gets an extra 39 to go from '9' + 1 to 'a'.
+			uint64_t v = (x >> 16) | (static_cast<uint64_t>(x & 0xFFFF) << 32);
+			v = ((v >> 8) & 0x000000FF000000FFULL) | ((v & 0x000000FF000000FFULL) << 16);
+			v = ((v >> 4) & 0x000F000F000F000FULL) | ((v & 0x000F000F000F000FULL) << 8);
+
+			auto letters = ((v + 0x0606060606060606ULL) >> 4) & 0x0101010101010101ULL;
+			v += 0x3030303030303030ULL + letters * 39;
+
+			memcpy(dst, &v, 8);
+		#elif ZPR_HEXADECIMAL_LOOKUP_TABLE
 			constexpr const char lookup_table[] =
 				"000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
 				"202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
@@ -1099,48 +1734,38 @@ namespace zpr
 				"a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
 				"c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
 				"e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
-		#endif
 
-			constexpr auto hex_digit = [](int x) -> char {
-				if(0 <= x && x <= 9)
-					return static_cast<char>('0' + x);
+			for(int i = 6; i >= 0; i -= 2, x >>= 8)
+				memcpy(&dst[i], &lookup_table[(x & 0xFF) * 2], 2);
+		#else
+			for(int i = 8; i-- > 0; x >>= 4)
+				dst[i] = "0123456789abcdef"[x & 0xF];
+		#endif
+		}
 
-				return static_cast<char>('a' + x - 10);
-			};
+		template <typename _Type>
+		char* print_hex_integer(char* buf, size_t bufsz, _Type value)
+		{
+			static_assert(sizeof(_Type) <= 8);
 
 			char* ptr = buf + bufsz;
+			auto x = static_cast<tt::make_unsigned_t<_Type>>(value);
 
-			// if we have the lookup table, do two digits at a time.
-		#if ZPR_HEXADECIMAL_LOOKUP_TABLE
-
-			constexpr auto copy = [](char* dst, const char* src) {
-				memcpy(dst, src, 2);
-			};
-
-			if constexpr (sizeof(_Type) > 1)
+			if constexpr (sizeof(_Type) > 4)
 			{
-				while(value >= 0x100)
+				while(x > 0xFFFFFFFF)
 				{
-					copy((ptr -= 2), &lookup_table[(value & 0xFF) * 2]);
-					value /= static_cast<_Type>(0x100);
+					write_8_hex_digits((ptr -= 8), static_cast<uint32_t>(x));
+					x >>= 32;
 				}
 			}
 
-			if(value < 0x10)
-				*(--ptr) = hex_digit(static_cast<int>(value));
+			// the rest has at most 8 digits; make all of them and keep the ones we need.
+			char tmp[8];
+			write_8_hex_digits(tmp, static_cast<uint32_t>(x));
 
-			else
-				copy((ptr -= 2), &lookup_table[value * 2]);
-
-		#else
-
-			do {
-				*(--ptr) = hex_digit(value & 0xF);
-				value /= 0x10;
-
-			} while(value > 0);
-
-		#endif
+			auto n = static_cast<size_t>(count_hex_digits(x));
+			memcpy((ptr -= n), tmp + 8 - n, n);
 
 			return ptr;
 		}
@@ -1172,44 +1797,48 @@ namespace zpr
 				"90919293949596979899";
 		#endif
 
+			// negate it as unsigned, so that the most negative value works too.
+			using _Unsigned = tt::make_unsigned_t<_Type>;
+			auto x = static_cast<_Unsigned>(value);
+
 			bool neg = false;
 			if constexpr (tt::is_signed_v<_Type>)
 			{
 				neg = (value < 0);
 				if(neg)
-					value = -value;
+					x = static_cast<_Unsigned>(0 - x);
 			}
 
 			char* ptr = buf + bufsz;
 
-			// if we have the lookup table, do two digits at a time.
-		#if ZPR_DECIMAL_LOOKUP_TABLE
-
-			constexpr auto copy = [](char* dst, const char* src) {
-				memcpy(dst, src, 2);
-			};
-
-			while(value >= 100)
+			if constexpr (sizeof(_Type) >= 4)
 			{
-				copy((ptr -= 2), &lookup_table[(value % 100) * 2]);
-				value /= 100;
+				while(x >= 100000000)
+				{
+					auto q = x / 100000000;
+					write_8_decimal_digits((ptr -= 8), static_cast<uint32_t>(x - q * 100000000));
+					x = static_cast<_Unsigned>(q);
+				}
 			}
 
-			if(value < 10)
-				*(--ptr) = static_cast<char>(value + '0');
-
+			// small numbers are the most common, and two digits at a time is faster for those.
+		#if ZPR_DECIMAL_LOOKUP_TABLE
+			if(x < 100)
+			{
+				if(x < 10)
+					*(--ptr) = static_cast<char>(x + '0');
+				else
+					memcpy((ptr -= 2), &lookup_table[x * 2], 2);
+			}
 			else
-				copy((ptr -= 2), &lookup_table[value * 2]);
-
-		#else
-
-			do {
-				*(--ptr) = ('0' + (value % 10));
-				value /= 10;
-
-			} while(value > 0);
-
 		#endif
+			{
+				char tmp[8];
+				write_8_decimal_digits(tmp, static_cast<uint32_t>(x));
+
+				auto n = static_cast<size_t>(count_decimal_digits(x));
+				memcpy((ptr -= n), tmp + 8 - n, n);
+			}
 
 			if(neg)
 				*(--ptr) = '-';
@@ -1217,6 +1846,29 @@ namespace zpr
 			return ptr;
 		}
 
+		// writes the decimal digits of x (and a '-' if it is negative) forwards from `out`, which needs room for 20
+		// characters; returns the end.
+		template <typename _Type>
+		ZPR_ALWAYS_INLINE char* append_decimal_integer(char* out, _Type value)
+		{
+			using _Unsigned = tt::make_unsigned_t<_Type>;
+			auto x = static_cast<_Unsigned>(value);
+
+			if constexpr (tt::is_signed_v<_Type>)
+			{
+				if(value < 0)
+				{
+					*out++ = '-';
+					x = static_cast<_Unsigned>(0 - x);
+				}
+			}
+
+			auto n = static_cast<size_t>(count_decimal_digits(x));
+			print_decimal_integer(out, n, x);
+
+			return out + n;
+		}
+
 		template <typename _Type>
 		ZPR_ALWAYS_INLINE char* print_integer(char* buf, size_t bufsz, _Type value, int base)
 		{
@@ -1409,6 +2061,186 @@ namespace zpr
 			flush_format_string(cb, st.beg, static_cast<size_t>(st.fmtend - st.beg));
 		}
 
+
+
+		/*
+			Compile-time format strings. A format string given via `zpr::fmt<"...">` (c++20) or `ZPR_FMT("...")`
+			is split into its literal chunks (with {{ and }} already unescaped) and its parsed format_args while
+			compiling, so that printing only needs to emit each chunk and call print_one() for each argument.
+			This also lets us check that the number of arguments matches the number of specifiers.
+
+			The `_Source` type must have two static constexpr methods, `data()` and `size()`, which return the
+			format string and its length (without the NULL terminator) respectively.
+		*/
+		constexpr size_t __INVALID_FORMAT_STRING = static_cast<size_t>(-1);
+
+		// returns the number of format specifiers, or __INVALID_FORMAT_STRING if a '{' is never closed.
+		constexpr inline size_t count_fmt_specs(const char* fmt, size_t len)
+		{
+			size_t count = 0;
+			for(size_t i = 0; i < len; i++)
+			{
+				if(fmt[i] == '{' && i + 1 < len && fmt[i + 1] == '{')
+				{
+					i++;
+				}
+				else if(fmt[i] == '{')
+				{
+					while(i < len && fmt[i] != '}')
+						i++;
+
+					if(i == len)
+						return __INVALID_FORMAT_STRING;
+
+					count++;
+				}
+			}
+
+			return count;
+		}
+
+		template <size_t _NumSpecs, size_t _Length>
+		struct compiled_spec
+		{
+			static constexpr size_t num_specs = _NumSpecs;
+
+			// chunk `i` is the literal text printed before the i-th argument; the last chunk is the
+			// text trailing the last specifier. all the chunks live back-to-back in `literals`.
+			char literals[_Length == 0 ? 1 : _Length] { };
+			size_t chunk_begin[_NumSpecs + 1] { };
+			size_t chunk_size[_NumSpecs + 1] { };
+			format_args args[_NumSpecs == 0 ? 1 : _NumSpecs] { };
+		};
+
+		template <typename _Source>
+		constexpr auto compile_format_string()
+		{
+			constexpr const char* fmt = _Source::data();
+			constexpr size_t len = _Source::size();
+			constexpr size_t num_specs = count_fmt_specs(fmt, len);
+
+			static_assert(num_specs != __INVALID_FORMAT_STRING, "unterminated '{' in format string");
+
+			if constexpr (num_specs == __INVALID_FORMAT_STRING)
+			{
+				return compiled_spec<0, 0>{};
+			}
+			else
+			{
+				compiled_spec<num_specs, len> ret {};
+
+				size_t out = 0;
+				size_t chunk = 0;
+				for(size_t i = 0; i < len; i++)
+				{
+					if(fmt[i] == '{' && i + 1 < len && fmt[i + 1] == '{')
+					{
+						ret.literals[out++] = '{';
+						i++;
+					}
+					else if(fmt[i] == '{')
+					{
+						size_t k = i;
+						while(fmt[k] != '}')
+							k++;
+
+						ret.args[chunk] = parse_fmt_spec(tt::str_view(fmt + i, k - i + 1));
+						ret.chunk_size[chunk] = out - ret.chunk_begin[chunk];
+						ret.chunk_begin[++chunk] = out;
+						i = k;
+					}
+					else if(fmt[i] == '}')
+					{
+						// same as the runtime version, either } or }} prints one }.
+						ret.literals[out++] = '}';
+						if(i + 1 < len && fmt[i + 1] == '}')
+							i++;
+					}
+					else
+					{
+						ret.literals[out++] = fmt[i];
+					}
+				}
+
+				ret.chunk_size[chunk] = out - ret.chunk_begin[chunk];
+				return ret;
+			}
+		}
+
+		template <typename _Source>
+		struct compiled_format
+		{
+			static constexpr auto spec = compile_format_string<_Source>();
+		};
+
+	#if defined(__cpp_nontype_template_args) && __cpp_nontype_template_args >= 201911L
+		template <size_t _Number>
+		struct fixed_string
+		{
+			constexpr fixed_string(const char (&s)[_Number])
+			{
+				for(size_t i = 0; i < _Number; i++)
+					this->chars[i] = s[i];
+			}
+
+			char chars[_Number] { };
+		};
+
+		template <fixed_string _String>
+		struct fixed_string_source
+		{
+			static constexpr const char* data() { return _String.chars; }
+			static constexpr size_t size() { return sizeof(_String.chars) - 1; }
+		};
+	#endif
+
+		// <utility> isn't freestanding, so roll our own index_sequence.
+		template <size_t... _Indices>
+		struct __index_seq { };
+
+		template <size_t _Number, size_t... _Indices>
+		struct __make_index_seq : __make_index_seq<_Number - 1, _Number - 1, _Indices...> { };
+
+		template <size_t... _Indices>
+		struct __make_index_seq<0, _Indices...> { using type = __index_seq<_Indices...>; };
+
+		template <typename _Source, size_t _Index, typename _CallbackFn>
+		ZPR_ALWAYS_INLINE void print_compiled_chunk(_CallbackFn& cb)
+		{
+			constexpr auto& spec = compiled_format<_Source>::spec;
+
+			if constexpr (spec.chunk_size[_Index] == 1)
+				cb(spec.literals[spec.chunk_begin[_Index]]);
+			else if constexpr (spec.chunk_size[_Index] > 1)
+				cb(&spec.literals[spec.chunk_begin[_Index]], spec.chunk_size[_Index]);
+		}
+
+		template <typename _Source, typename _CallbackFn, size_t... _Indices, typename... _Types>
+		ZPR_ALWAYS_INLINE void print_compiled(_CallbackFn& cb, __index_seq<_Indices...>, _Types&&... args)
+		{
+			constexpr auto& spec = compiled_format<_Source>::spec;
+
+			((print_compiled_chunk<_Source, _Indices>(cb), print_one(cb, spec.args[_Indices], static_cast<_Types&&>(args))), ...);
+			print_compiled_chunk<_Source, sizeof...(_Indices)>(cb);
+		}
+
+		/*
+			Same as the other detail::print(), but with a compile-time format string; the number of arguments
+			must match the number of format specifiers exactly.
+		*/
+		template <typename _CallbackFn, typename _Source, typename... _Types>
+		ZPR_ALWAYS_INLINE void print(_CallbackFn& cb, compiled_format<_Source>, _Types&&... args)
+		{
+			constexpr bool matches = (sizeof...(_Types) == compiled_format<_Source>::spec.num_specs);
+			static_assert(matches, "number of arguments does not match the number of format specifiers");
+
+			if constexpr (matches)
+			{
+				print_compiled<_Source>(cb, typename __make_index_seq<sizeof...(_Types)>::type{},
+					static_cast<_Types&&>(args)...);
+			}
+		}
+
 	#if ZPR_USE_STD
 		template <typename _Type, typename = void>
 		struct has_resize_default_init
@@ -1810,6 +2642,97 @@ namespace zpr
 #endif
 
 
+	/*
+		Print an array of integers in decimal to a user-specified buffer `buf`, with size `len`, with `sep` between
+		each one. This is the same as calling sprint("{}") for each of them, but it is done in one pass, writing the
+		digits straight into the buffer. As with sprint(), a NULL-terminator is *NOT* inserted, and the output is
+		truncated if it does not fit. bool and the character types (other than signed and unsigned char) are a
+		compile error, since sprint("{}") prints them as text.
+
+		Arguments:
+		`len`       -- the capacity of the buffer pointed to by `buf`
+		`buf`       -- the buffer into which characters should be printed
+		`values`    -- the integers to print
+		`count`     -- the number of integers in `values`
+		`sep`       -- the separator between each integer
+
+		Returns the number of bytes printed.
+	*/
+	template <typename _Type>
+	size_t format_ints(size_t len, char* buf, const _Type* values, size_t count, tt::str_view sep = ", ")
+	{
+		// "{}" prints bool and the character types as text, so they would not come out the same; signed and
+		// unsigned char are fine, since they are printed as numbers anyway.
+		static_assert(tt::is_integral_v<_Type> && sizeof(_Type) <= 8, "format_ints() only prints integers");
+		static_assert(!tt::is_any<tt::remove_cv_t<_Type>, bool, char, wchar_t, char16_t, char32_t>::value,
+			"format_ints() does not print bools or characters");
+	#if defined(__cpp_char8_t)
+		static_assert(!tt::is_same_v<tt::remove_cv_t<_Type>, char8_t>, "format_ints() does not print characters");
+	#endif
+
+		// the longest is INT64_MIN, at 20 characters.
+		constexpr size_t max_digits = 20;
+
+		char* ptr = buf;
+		char* end = buf + len;
+
+		for(size_t i = 0; i < count; i++)
+		{
+			if(i > 0)
+			{
+				auto n = tt::_Minimum(sep.size(), static_cast<size_t>(end - ptr));
+				memcpy(ptr, sep.data(), n);
+				ptr += n;
+			}
+
+			if(ZPR_LIKELY(static_cast<size_t>(end - ptr) >= max_digits))
+			{
+				ptr = detail::append_decimal_integer(ptr, values[i]);
+			}
+			else
+			{
+				char tmp[max_digits];
+				auto n = static_cast<size_t>(detail::append_decimal_integer(tmp, values[i]) - tmp);
+
+				auto k = tt::_Minimum(n, static_cast<size_t>(end - ptr));
+				memcpy(ptr, tmp, k);
+				ptr += k;
+
+				if(k < n)
+					break;
+			}
+		}
+
+		return static_cast<size_t>(ptr - buf);
+	}
+
+#if ZPR_USE_STD
+	/*
+		Prints an array of integers in decimal to a std::string, with `sep` between each one; see the other
+		overload of format_ints(). The string is allocated once, for the longest possible output.
+
+		Arguments:
+		`values`    -- the integers to print
+		`count`     -- the number of integers in `values`
+		`sep`       -- the separator between each integer
+
+		Returns the std::string.
+	*/
+	template <typename _Type>
+	std::string format_ints(const _Type* values, size_t count, tt::str_view sep = ", ")
+	{
+		std::string buf {};
+		if(count == 0)
+			return buf;
+
+		buf.resize(count * 20 + (count - 1) * sep.size());
+		buf.resize(format_ints(buf.size(), buf.data(), values, count, sep));
+
+		return buf;
+	}
+#endif
+
+
 	/*
 		Forward the provided format-string and arguments to another zpr printing function. The implementation
 		of this mechanism creates and stores pointers to the argument values, so you should *NOT* store the
@@ -1910,10 +2833,123 @@ namespace zpr
 		`fmt`       -- the format string
 		`args`      -- the values to print
 
-		Returns the number of bytes printed.
-	*/
-	template <typename... _Types>
-	size_t fprintln(FILE* file, tt::str_view fmt, _Types&&... args)
+		Returns the number of bytes printed.
+	*/
+	template <typename... _Types>
+	size_t fprintln(FILE* file, tt::str_view fmt, _Types&&... args)
+	{
+		size_t ret = 0;
+		{
+			auto appender = detail::file_appender<detail::STDIO_BUFFER_SIZE, true>(file, ret);
+			detail::print(appender, fmt, static_cast<_Types&&>(args)...);
+		}
+		return ret;
+	}
+#endif
+
+
+
+	/*
+		A compile-time format string (needs c++20). The string is parsed during compilation, and passing the
+		wrong number of arguments is a compile error. Example: `zpr::println(zpr::fmt<"{} {.3f}">, "owo", 3.14)`
+
+		In c++17, use the `ZPR_FMT("...")` macro instead, which does the same thing.
+	*/
+#if defined(__cpp_nontype_template_args) && __cpp_nontype_template_args >= 201911L
+	template <detail::fixed_string _String>
+	constexpr detail::compiled_format<detail::fixed_string_source<_String>> fmt { };
+#endif
+
+	/*
+		Overloads of the print functions above that take a compile-time format string (from `zpr::fmt<"...">`
+		or `ZPR_FMT("...")`) instead of a tt::str_view. They behave identically, except that the format string
+		is not parsed at runtime.
+	*/
+	template <typename _CallbackFn, typename _Source, typename... _Types>
+	size_t cprint(_CallbackFn&& callback, detail::compiled_format<_Source> fmt, _Types&&... args)
+	{
+		size_t n = 0;
+		{
+			auto appender = detail::callback_appender(&callback, /* newline: */ false);
+			detail::print(appender, fmt, static_cast<_Types&&>(args)...);
+			n = appender.size();
+		}
+		return n;
+	}
+
+	template <typename _CallbackFn, typename _Source, typename... _Types>
+	size_t cprintln(_CallbackFn&& callback, detail::compiled_format<_Source> fmt, _Types&&... args)
+	{
+		size_t n = 0;
+		{
+			auto appender = detail::callback_appender(&callback, /* newline: */ true);
+			detail::print(appender, fmt, static_cast<_Types&&>(args)...);
+			n = appender.size();
+		}
+		return n;
+	}
+
+	template <typename _Source, typename... _Types>
+	size_t sprint(size_t len, char* buf, detail::compiled_format<_Source> fmt, _Types&&... args)
+	{
+		size_t n = 0;
+		{
+			auto appender = detail::buffer_appender(buf, len);
+			detail::print(appender, fmt, static_cast<_Types&&>(args)...);
+			n = appender.size();
+		}
+		return n;
+	}
+
+#if ZPR_USE_STD
+	template <typename _Source, typename... _Types>
+	std::string sprint(detail::compiled_format<_Source> fmt, _Types&&... args)
+	{
+		std::string buf {};
+		{
+			auto appender = detail::string_appender(buf);
+			detail::print(appender, fmt, static_cast<_Types&&>(args)...);
+		}
+		return buf;
+	}
+#endif
+
+#if !ZPR_FREESTANDING
+	template <typename _Source, typename... _Types>
+	size_t print(detail::compiled_format<_Source> fmt, _Types&&... args)
+	{
+		size_t ret = 0;
+		{
+			auto appender = detail::file_appender<detail::STDIO_BUFFER_SIZE, false>(stdout, ret);
+			detail::print(appender, fmt, static_cast<_Types&&>(args)...);
+		}
+		return ret;
+	}
+
+	template <typename _Source, typename... _Types>
+	size_t println(detail::compiled_format<_Source> fmt, _Types&&... args)
+	{
+		size_t ret = 0;
+		{
+			auto appender = detail::file_appender<detail::STDIO_BUFFER_SIZE, true>(stdout, ret);
+			detail::print(appender, fmt, static_cast<_Types&&>(args)...);
+		}
+		return ret;
+	}
+
+	template <typename _Source, typename... _Types>
+	size_t fprint(FILE* file, detail::compiled_format<_Source> fmt, _Types&&... args)
+	{
+		size_t ret = 0;
+		{
+			auto appender = detail::file_appender<detail::STDIO_BUFFER_SIZE, false>(file, ret);
+			detail::print(appender, fmt, static_cast<_Types&&>(args)...);
+		}
+		return ret;
+	}
+
+	template <typename _Source, typename... _Types>
+	size_t fprintln(FILE* file, detail::compiled_format<_Source> fmt, _Types&&... args)
 	{
 		size_t ret = 0;
 		{
@@ -2256,9 +3292,9 @@ namespace zpr
 					args.flags |= FMT_FLAG_ALTERNATE;
 				}
 
-				// if we print base 2 we need 64 digits!
-				constexpr size_t digits_buf_sz = 65;
-				char digits_buf[digits_buf_sz] = { };
+				// if we print base 2 we need 64 digits! (and one more for a '-', on the fast path below)
+				constexpr size_t digits_buf_sz = 66;
+				char digits_buf[digits_buf_sz];
 
 				char* digits = 0;
 				size_t digits_len = 0;
@@ -2272,20 +3308,15 @@ namespace zpr
 					}
 					else
 					{
-						if(base == 16)
-						{
-							digits = detail::print_integer(digits_buf, digits_buf_sz,
-								static_cast<tt::make_unsigned_t<Decayed_T>>(x), base);
+						// negate as unsigned, so that the most negative value (which has no positive) works.
+						using _Unsigned = tt::make_unsigned_t<Decayed_T>;
 
-							digits_len = digits_buf_sz - static_cast<size_t>(digits - digits_buf);
-						}
-						else
-						{
-							auto abs_val = tt::_Absolute(x);
-							digits = detail::print_integer(digits_buf, digits_buf_sz, abs_val, base);
+						auto val = static_cast<_Unsigned>(x);
+						if(base != 16 && x < 0)
+							val = static_cast<_Unsigned>(0 - val);
 
-							digits_len = digits_buf_sz - static_cast<size_t>(digits - digits_buf);
-						}
+						digits = detail::print_integer(digits_buf, digits_buf_sz, val, base);
+						digits_len = digits_buf_sz - static_cast<size_t>(digits - digits_buf);
 					}
 
 					if('A' <= args.specifier && args.specifier <= 'Z')
@@ -2298,20 +3329,32 @@ namespace zpr
 					}
 				}
 
+				// the common case -- no width, precision, sign or prefix -- needs none of the padding logic,
+				// and goes out in one piece.
+				if(!args.have_width() && !args.have_precision() && !args.prepend_plus() && !args.prepend_space()
+					&& !(base != 10 && args.alternate()))
+				{
+					if(x < 0 && base == 10)
+						*(--digits) = '-', digits_len++;
+
+					cb(digits, digits_len);
+					return;
+				}
+
 				char prefix[4] = { 0 };
 				int64_t prefix_len = 0;
 				int64_t prefix_digits_length = 0;
 				{
 					char* pf = prefix;
-					if(args.prepend_plus())
+					if(x < 0 && base == 10)
+						prefix_len++, *pf++ = '-';
+
+					else if(args.prepend_plus())
 						prefix_len++, *pf++ = '+';
 
 					else if(args.prepend_space())
 						prefix_len++, *pf++ = ' ';
 
-					else if(x < 0 && base == 10)
-						prefix_len++, *pf++ = '-';
-
 					if(base != 10 && args.alternate())
 					{
 						*pf++ = '0';
@@ -2393,21 +3436,13 @@ namespace zpr
 		template <typename _Cb>
 		ZPR_ALWAYS_INLINE void print(float x, _Cb&& cb, format_args args)
 		{
-			if(args.specifier == 'e' || args.specifier == 'E')
-				print_exponent(static_cast<_Cb&&>(cb), x, static_cast<format_args&&>(args));
-
-			else
-				print_floating(static_cast<_Cb&&>(cb), x, static_cast<format_args&&>(args));
+			detail::print_floating(cb, x, static_cast<format_args&&>(args));
 		}
 
 		template <typename _Cb>
 		ZPR_ALWAYS_INLINE void print(double x, _Cb&& cb, format_args args)
 		{
-			if(args.specifier == 'e' || args.specifier == 'E')
-				print_exponent(static_cast<_Cb&&>(cb), x, static_cast<format_args&&>(args));
-
-			else
-				print_floating(static_cast<_Cb&&>(cb), x, static_cast<format_args&&>(args));
+			detail::print_floating(cb, x, static_cast<format_args&&>(args));
 		}
 	};
 
@@ -2768,6 +3803,473 @@ namespace zpr
 }
 
 
+#if ZPR_ASYNC_SINK
+
+#if defined(_WIN32)
+	#error "zpr::async_sink needs writev(), which is not available on windows"
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+namespace zpr
+{
+	namespace detail
+	{
+		// like buffer_appender, but remembers whether anything was cut off, so that async_sink can
+		// retry the message in an empty block.
+		struct sink_appender
+		{
+			sink_appender(char* buf_, size_t cap_) : buf(buf_), cap(cap_), len(0), truncated(false) { }
+
+			ZPR_ALWAYS_INLINE void reserve(size_t) {}
+
+			ZPR_ALWAYS_INLINE void operator() (char c) { (*this)(c, 1); }
+			ZPR_ALWAYS_INLINE void operator() (tt::str_view sv) { (*this)(sv.data(), sv.size()); }
+			ZPR_ALWAYS_INLINE void operator() (const char* begin, const char* end) { (*this)(begin, static_cast<size_t>(end - begin)); }
+
+			ZPR_ALWAYS_INLINE void operator() (char c, size_t n)
+			{
+				auto l = this->remaining(n);
+				memset(&this->buf[this->len], c, l);
+				this->len += l;
+			}
+
+			ZPR_ALWAYS_INLINE void operator() (const char* begin, size_t n)
+			{
+				auto l = this->remaining(n);
+				memcpy(&this->buf[this->len], begin, l);
+				this->len += l;
+			}
+
+			sink_appender(sink_appender&&) = delete;
+			sink_appender(const sink_appender&) = delete;
+			sink_appender& operator= (sink_appender&&) = delete;
+			sink_appender& operator= (const sink_appender&) = delete;
+
+			ZPR_ALWAYS_INLINE size_t size() const { return this->len; }
+			ZPR_ALWAYS_INLINE bool overflowed() const { return this->truncated; }
+
+		private:
+			ZPR_ALWAYS_INLINE size_t remaining(size_t n)
+			{
+				if(ZPR_UNLIKELY(n > this->cap - this->len))
+				{
+					this->truncated = true;
+					return this->cap - this->len;
+				}
+				return n;
+			}
+
+			char* buf = 0;
+			size_t cap = 0;
+			size_t len = 0;
+			bool truncated = false;
+		};
+	}
+
+	/*
+		A sink that many threads can print() into at once; the output is written to `fd` by a background
+		thread. See the "Asynchronous Sink" section at the top of this file for how it works.
+
+		The print functions return the number of bytes printed, or 0 if the message was dropped.
+	*/
+	struct async_sink
+	{
+		enum class overflow
+		{
+			block,
+			drop,
+		};
+
+		struct options
+		{
+			// each thread formats into a block of this size, so this is also the longest message that
+			// can be printed; longer ones are truncated.
+			size_t block_size = 16384;
+
+			// the number of blocks shared by all threads. this bounds both the memory used and the amount
+			// of output that can be waiting to be written; it should be more than the number of threads.
+			size_t num_blocks = 64;
+
+			// what to do when a thread needs a new block and none are free.
+			overflow on_overflow = overflow::block;
+
+			// partially-filled blocks are written out at least this often.
+			std::chrono::milliseconds flush_interval = std::chrono::milliseconds(100);
+		};
+
+		explicit async_sink(int fd) : async_sink(fd, options {}) { }
+		explicit async_sink(FILE* file) : async_sink(file, options {}) { }
+
+		// anything already buffered in `file` is flushed first; don't use `file` while the sink is alive.
+		async_sink(FILE* file, const options& opts) : async_sink((fflush(file), fileno(file)), opts) { }
+
+		async_sink(int fd, const options& opts) : m_fd(fd), m_opts(opts), m_id(next_id()++)
+		{
+			if(this->m_opts.block_size == 0)
+				this->m_opts.block_size = 1;
+			if(this->m_opts.num_blocks == 0)
+				this->m_opts.num_blocks = 1;
+
+			auto n = this->m_opts.num_blocks;
+
+			m_memory = std::make_unique<char[]>(n * this->m_opts.block_size);
+			m_blocks = std::make_unique<block[]>(n);
+
+			m_free.reserve(n);
+			m_full.reserve(n);
+
+			for(size_t i = 0; i < n; i++)
+			{
+				m_blocks[i].data = &m_memory[i * this->m_opts.block_size];
+				m_free.push_back(&m_blocks[i]);
+			}
+
+			m_writer = std::thread([this]() { this->writer_loop(); });
+		}
+
+		~async_sink()
+		{
+			{
+				auto lk = std::unique_lock<std::mutex>(this->m_lock);
+				this->m_stopping = true;
+			}
+			this->m_writer_cv.notify_one();
+			this->m_writer.join();
+		}
+
+		async_sink(async_sink&&) = delete;
+		async_sink(const async_sink&) = delete;
+		async_sink& operator= (async_sink&&) = delete;
+		async_sink& operator= (const async_sink&) = delete;
+
+		template <typename... _Types>
+		size_t print(tt::str_view fmt, _Types&&... args)
+		{
+			return this->write<false>(fmt, args...);
+		}
+
+		template <typename... _Types>
+		size_t println(tt::str_view fmt, _Types&&... args)
+		{
+			return this->write<true>(fmt, args...);
+		}
+
+		template <typename _Source, typename... _Types>
+		size_t print(detail::compiled_format<_Source> fmt, _Types&&... args)
+		{
+			return this->write<false>(fmt, args...);
+		}
+
+		template <typename _Source, typename... _Types>
+		size_t println(detail::compiled_format<_Source> fmt, _Types&&... args)
+		{
+			return this->write<true>(fmt, args...);
+		}
+
+		// waits until everything printed (by any thread) before this call has been written to the file.
+		void flush()
+		{
+			auto lk = std::unique_lock<std::mutex>(this->m_lock);
+			auto target = ++this->m_flush_requested;
+
+			this->m_writer_cv.notify_one();
+			this->m_producer_cv.wait(lk, [&]() { return this->m_flush_completed >= target; });
+		}
+
+		// the number of messages that were discarded because no blocks were free (with overflow::drop).
+		size_t dropped() const
+		{
+			return this->m_dropped.load(std::memory_order_relaxed);
+		}
+
+	private:
+		struct block
+		{
+			char* data = nullptr;
+			size_t len = 0;
+		};
+
+		// one per thread that prints to this sink. `lock` is only contended when the background thread
+		// comes to collect a partially-filled block, so taking it is cheap.
+		struct producer
+		{
+			std::thread::id thread;
+			std::mutex lock;
+			block* current = nullptr;
+		};
+
+		template <bool _Newline, typename _Fmt, typename... _Types>
+		size_t write(const _Fmt& fmt, _Types&... args)
+		{
+			auto p = this->get_producer();
+			auto lk = std::unique_lock<std::mutex>(p->lock);
+
+			while(true)
+			{
+				if(p->current == nullptr && (p->current = this->take_block(lk)) == nullptr)
+				{
+					this->m_dropped.fetch_add(1, std::memory_order_relaxed);
+					return 0;
+				}
+
+				auto blk = p->current;
+				auto appender = detail::sink_appender(blk->data + blk->len, this->m_opts.block_size - blk->len);
+				detail::print(appender, fmt, args...);
+
+				if constexpr (_Newline)
+					appender('\n');
+
+				// if it didn't fit in what was left of the block, send the block off and print the message
+				// again into an empty one. if it doesn't even fit in an empty block, it gets truncated.
+				if(!appender.overflowed() || blk->len == 0)
+				{
+					if constexpr (_Newline)
+					{
+						if(appender.overflowed())
+							blk->data[blk->len + appender.size() - 1] = '\n';
+					}
+
+					blk->len += appender.size();
+					return appender.size();
+				}
+
+				p->current = nullptr;
+				this->submit(blk);
+			}
+		}
+
+		producer* get_producer()
+		{
+			// cache the last sink that this thread printed to, so the usual case doesn't need the lock.
+			// sinks are compared by id and not by address, since a new one might reuse the memory.
+			struct cache_entry { uint64_t sink = 0; producer* p = nullptr; };
+			static thread_local cache_entry cache {};
+
+			if(ZPR_LIKELY(cache.sink == this->m_id))
+				return cache.p;
+
+			auto lk = std::unique_lock<std::mutex>(this->m_lock);
+			auto tid = std::this_thread::get_id();
+
+			producer* p = nullptr;
+			for(auto& x : this->m_producers)
+			{
+				if(x->thread == tid)
+				{
+					p = x.get();
+					break;
+				}
+			}
+
+			if(p == nullptr)
+			{
+				p = this->m_producers.emplace_back(std::make_unique<producer>()).get();
+				p->thread = tid;
+			}
+
+			cache = cache_entry { this->m_id, p };
+			return p;
+		}
+
+		// the lock order is always producer::lock, then m_lock. `plk` (the producer's lock) is released
+		// while waiting for a free block, so that the background thread is never stuck behind it.
+		block* take_block(std::unique_lock<std::mutex>& plk)
+		{
+			auto lk = std::unique_lock<std::mutex>(this->m_lock);
+			if(this->m_free.empty())
+			{
+				if(this->m_opts.on_overflow == overflow::drop)
+					return nullptr;
+
+				plk.unlock();
+				this->m_producer_cv.wait(lk, [this]() { return !this->m_free.empty(); });
+			}
+
+			auto blk = this->m_free.back();
+			this->m_free.pop_back();
+
+			if(!plk.owns_lock())
+			{
+				lk.unlock();
+				plk.lock();
+			}
+
+			return blk;
+		}
+
+		void submit(block* blk)
+		{
+			{
+				auto lk = std::unique_lock<std::mutex>(this->m_lock);
+				this->m_full.push_back(blk);
+			}
+			this->m_writer_cv.notify_one();
+		}
+
+		void writer_loop()
+		{
+			auto batch = std::vector<block*>();
+			auto producers = std::vector<producer*>();
+			batch.reserve(this->m_opts.num_blocks);
+
+			auto lk = std::unique_lock<std::mutex>(this->m_lock);
+			auto next_sweep = std::chrono::steady_clock::now() + this->m_opts.flush_interval;
+
+			while(true)
+			{
+				this->m_writer_cv.wait_until(lk, next_sweep, [&]() {
+					return this->m_stopping || !this->m_full.empty() || this->m_flush_requested != this->m_flush_completed;
+				});
+
+				const bool stopping = this->m_stopping;
+				const auto flush_target = this->m_flush_requested;
+
+				// besides the full blocks, collect the partially-filled ones every flush interval,
+				// when someone is waiting in flush(), and before stopping.
+				const bool sweep = stopping || flush_target != this->m_flush_completed
+					|| std::chrono::steady_clock::now() >= next_sweep;
+
+				if(sweep)
+				{
+					producers.clear();
+					for(auto& p : this->m_producers)
+						producers.push_back(p.get());
+
+					lk.unlock();
+					for(auto p : producers)
+					{
+						// hold the producer's lock while queueing its block, so that its next full block
+						// can't get ahead of this one.
+						auto plk = std::unique_lock<std::mutex>(p->lock);
+						if(p->current != nullptr && p->current->len > 0)
+						{
+							auto lk2 = std::unique_lock<std::mutex>(this->m_lock);
+							this->m_full.push_back(p->current);
+							p->current = nullptr;
+						}
+					}
+					lk.lock();
+
+					next_sweep = std::chrono::steady_clock::now() + this->m_opts.flush_interval;
+				}
+
+				// both vectors have room for every block, so swapping them never allocates.
+				batch.swap(this->m_full);
+				lk.unlock();
+
+				this->write_blocks(batch);
+
+				lk.lock();
+				for(auto blk : batch)
+				{
+					blk->len = 0;
+					this->m_free.push_back(blk);
+				}
+				batch.clear();
+
+				if(sweep)
+					this->m_flush_completed = flush_target;
+
+				this->m_producer_cv.notify_all();
+
+				if(stopping)
+					break;
+			}
+		}
+
+		// writes are retried on EINTR and after short writes; on any other error, the rest of the batch
+		// is discarded, since there is nobody to report it to.
+		void write_blocks(const std::vector<block*>& batch)
+		{
+			constexpr size_t MAX_IOVECS = 64;
+			struct iovec iovs[MAX_IOVECS];
+
+			for(size_t i = 0; i < batch.size(); )
+			{
+				int n = 0;
+				for(; n < static_cast<int>(MAX_IOVECS) && i < batch.size(); i++)
+				{
+					if(batch[i]->len == 0)
+						continue;
+
+					iovs[n].iov_base = batch[i]->data;
+					iovs[n].iov_len = batch[i]->len;
+					n++;
+				}
+
+				auto iov = &iovs[0];
+				while(n > 0)
+				{
+					auto w = writev(this->m_fd, iov, n);
+					if(w < 0)
+					{
+						if(errno == EINTR)
+							continue;
+
+						return;
+					}
+
+					auto done = static_cast<size_t>(w);
+					while(n > 0 && done >= iov->iov_len)
+					{
+						done -= iov->iov_len;
+						iov++;
+						n--;
+					}
+
+					if(n > 0)
+					{
+						iov->iov_base = static_cast<char*>(iov->iov_base) + done;
+						iov->iov_len -= done;
+					}
+				}
+			}
+		}
+
+		static std::atomic<uint64_t>& next_id()
+		{
+			static std::atomic<uint64_t> id { 1 };
+			return id;
+		}
+
+		int m_fd;
+		options m_opts;
+		uint64_t m_id;
+
+		std::unique_ptr<char[]> m_memory;
+		std::unique_ptr<block[]> m_blocks;
+
+		std::mutex m_lock;
+		std::condition_variable m_writer_cv;
+		std::condition_variable m_producer_cv;
+
+		std::vector<block*> m_free;
+		std::vector<block*> m_full;
+		std::vector<std::unique_ptr<producer>> m_producers;
+
+		uint64_t m_flush_requested = 0;
+		uint64_t m_flush_completed = 0;
+		bool m_stopping = false;
+
+		std::atomic<size_t> m_dropped { 0 };
+		std::thread m_writer;
+	};
+}
+
+#endif
+
+
 
 
 
@@ -2778,6 +4280,37 @@ namespace zpr
     Version History
     ===============
 
+    2.12.0 - 14/10/2026
+    -------------------
+    - Print integers 8 digits at a time (SWAR, in a 64-bit register), with a branchless digit count
+    - Skip the padding logic when printing integers without a width, precision, sign or prefix
+    - Fix printing the most negative value of a signed integer type (negating it overflowed)
+    - Fix printing negative integers with '+' or ' ', which replaced the '-' instead of only applying
+      to positive values
+    - Add zpr::format_ints(), which prints an array of integers with a separator in one pass
+
+
+    2.11.0 - 14/10/2026
+    -------------------
+    - Add zpr::async_sink (enabled with ZPR_ASYNC_SINK), which lets many threads print into their own
+      blocks while a background thread writes them out with writev()
+
+
+    2.10.0 - 14/10/2026
+    -------------------
+    - Print floating point values with the shortest representation that round-trips (using Ryu)
+      when no precision is given; this changes the output of `{}` and `{g}`
+    - Round f, e and g conversions exactly (matching printf) instead of going through doubles
+    - Print negative zero as "-0"
+
+
+    2.9.0 - 14/10/2026
+    ------------------
+    - Add compile-time format strings via zpr::fmt<"..."> (c++20) and ZPR_FMT("..."), which check
+      the number of arguments and skip parsing the format string at runtime
+    - Make tt::str_view and parse_fmt_spec constexpr
+
+
     2.8.0 - 25/11/2024
     ------------------
     - Respect width and precision specifiers when printing a zpr::fwd() instance
@@ -16,7 +16,7 @@
 */
 
 /*
-    Version 2.0.2
+    Version 2.1.0
     =============
 
 
@@ -47,7 +47,13 @@
    errors, then set this to false.
 
 
-    Note that ZST_FREESTANDING implies ZST_USE_STD = 0.
+    - ZST_USE_SIMD
+        this is *TRUE* by default. controls whether str_view::find(), rfind()
+        and find_first_of() use SSE2, AVX2 or NEON instructions (whichever the
+        compiler is targeting) for 1-byte character types.
+
+
+    Note that ZST_FREESTANDING implies ZST_USE_STD = 0 and ZST_USE_SIMD = 0.
 
     Also note that buffer<T>, while it is itself a RAII type, it does *NOT*
     correctly RAII its contents. notably, no copy or move constructors will be
@@ -56,6 +62,11 @@
 
     This may change in the future.
 
+    buffer<T> can also get its memory from a `zst::Allocator` (passed to the
+    constructor) instead of new[]; `zst::Arena` is a bump allocator that
+    releases everything at once. In that case the elements are not destroyed
+    at all, which is another reason to stick to POD types.
+
 
     Version history is at the bottom of the file.
 */
@@ -91,6 +102,13 @@
 	#define ZST_HAVE_BUFFER 1
 #endif
 
+#if !defined(ZST_USE_SIMD)
+	#define ZST_USE_SIMD 1
+#elif (ZST_EXPAND(ZST_USE_SIMD) == 1)
+	#undef ZST_USE_SIMD
+	#define ZST_USE_SIMD 1
+#endif
+
 
 #if !ZST_FREESTANDING
 	#include <cstring>
@@ -98,6 +116,9 @@
 	#undef ZST_USE_STD
 	#define ZST_USE_STD 0
 
+	#undef ZST_USE_SIMD
+	#define ZST_USE_SIMD 0
+
 	extern "C" void* memset(void* s, int c, size_t n);
 	extern "C" int memcmp(const void* s1, const void* s2, size_t n);
 	extern "C" void* memmove(void* dest, const void* src, size_t n);
@@ -125,6 +146,14 @@ namespace std
 
 
 
+#if ZST_USE_SIMD
+	#if defined(__AVX2__) || defined(__SSE2__)
+		#include <immintrin.h>
+	#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+		#include <arm_neon.h>
+	#endif
+#endif
+
 #undef ZST_DO_EXPAND
 #undef ZST_EXPAND
 
@@ -150,8 +179,258 @@ namespace zst
 	namespace detail
 	{
 		template <typename T> T min(T a, T b) { return a < b ? a : b;}
+
+		// vectorised searching for str_view. these only look at bytes, so they are only used for 1-byte character types.
+		// the widest instruction set that the compiler was told to use is picked (so compile with -mavx2 or
+		// -march=native to get AVX2); anything else gets the scalar loops.
+		namespace search
+		{
+		#if ZST_USE_SIMD && defined(__AVX2__)
+			constexpr size_t WIDTH = 32;
+			using vec_t = __m256i;
+			using mask_t = uint32_t;
+			constexpr size_t BITS_PER_BYTE = 1;
+
+			inline vec_t load(const char* p)  { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+			inline vec_t splat(char c)        { return _mm256_set1_epi8(c); }
+			inline mask_t match(vec_t a, vec_t b)
+			{
+				return static_cast<mask_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)));
+			}
+
+			#define ZST_HAVE_SIMD_SEARCH 1
+
+		#elif ZST_USE_SIMD && defined(__SSE2__)
+			constexpr size_t WIDTH = 16;
+			using vec_t = __m128i;
+			using mask_t = uint32_t;
+			constexpr size_t BITS_PER_BYTE = 1;
+
+			inline vec_t load(const char* p)  { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+			inline vec_t splat(char c)        { return _mm_set1_epi8(c); }
+			inline mask_t match(vec_t a, vec_t b)
+			{
+				return static_cast<mask_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)));
+			}
+
+			#define ZST_HAVE_SIMD_SEARCH 1
+
+		#elif ZST_USE_SIMD && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+			constexpr size_t WIDTH = 16;
+			using vec_t = uint8x16_t;
+			using mask_t = uint64_t;
+			constexpr size_t BITS_PER_BYTE = 4;
+
+			inline vec_t load(const char* p)  { return vld1q_u8(reinterpret_cast<const uint8_t*>(p)); }
+			inline vec_t splat(char c)        { return vdupq_n_u8(static_cast<uint8_t>(c)); }
+
+			// there's no movemask, so narrow each byte of the comparison to 4 bits, and keep one bit of those.
+			inline mask_t match(vec_t a, vec_t b)
+			{
+				auto nibbles = vshrn_n_u16(vreinterpretq_u16_u8(vceqq_u8(a, b)), 4);
+				return vget_lane_u64(vreinterpret_u64_u8(nibbles), 0) & 0x8888888888888888ull;
+			}
+
+			#define ZST_HAVE_SIMD_SEARCH 1
+		#endif
+
+		#if defined(ZST_HAVE_SIMD_SEARCH)
+			constexpr size_t MASK_BITS = sizeof(mask_t) * 8;
+
+			inline size_t ctz(uint32_t x) { return static_cast<size_t>(__builtin_ctz(x)); }
+			inline size_t ctz(uint64_t x) { return static_cast<size_t>(__builtin_ctzll(x)); }
+			inline size_t clz(uint32_t x) { return static_cast<size_t>(__builtin_clz(x)); }
+			inline size_t clz(uint64_t x) { return static_cast<size_t>(__builtin_clzll(x)); }
+
+			// the byte offsets of the first and last matches in a (non-zero) mask, and the mask without them.
+			inline size_t first(mask_t m)     { return ctz(m) / BITS_PER_BYTE; }
+			inline size_t last(mask_t m)      { return (MASK_BITS - 1 - clz(m)) / BITS_PER_BYTE; }
+			inline mask_t pop_first(mask_t m) { return m & (m - 1); }
+			inline mask_t pop_last(mask_t m)  { return m & ~(static_cast<mask_t>(1) << (MASK_BITS - 1 - clz(m))); }
+		#endif
+
+			inline size_t find_byte(const char* s, size_t n, char c)
+			{
+				size_t i = 0;
+
+			#if defined(ZST_HAVE_SIMD_SEARCH)
+				const auto v = splat(c);
+
+				// four vectors at a time, since the loop overhead is otherwise about as large as the actual work.
+				for(; i + 4 * WIDTH <= n; i += 4 * WIDTH)
+				{
+					auto m0 = match(load(s + i + 0 * WIDTH), v);
+					auto m1 = match(load(s + i + 1 * WIDTH), v);
+					auto m2 = match(load(s + i + 2 * WIDTH), v);
+					auto m3 = match(load(s + i + 3 * WIDTH), v);
+
+					if((m0 | m1 | m2 | m3) != 0)
+					{
+						if(m0 != 0) return i + 0 * WIDTH + first(m0);
+						if(m1 != 0) return i + 1 * WIDTH + first(m1);
+						if(m2 != 0) return i + 2 * WIDTH + first(m2);
+						return i + 3 * WIDTH + first(m3);
+					}
+				}
+
+				for(; i + WIDTH <= n; i += WIDTH)
+				{
+					auto m = match(load(s + i), v);
+					if(m != 0)
+						return i + first(m);
+				}
+			#endif
+
+				for(; i < n; i++)
+				{
+					if(s[i] == c)
+						return i;
+				}
+
+				return static_cast<size_t>(-1);
+			}
+
+			inline size_t rfind_byte(const char* s, size_t n, char c)
+			{
+				size_t i = n;
+
+			#if defined(ZST_HAVE_SIMD_SEARCH)
+				for(auto v = splat(c); i >= WIDTH; )
+				{
+					i -= WIDTH;
+
+					auto m = match(load(s + i), v);
+					if(m != 0)
+						return i + last(m);
+				}
+			#endif
+
+				while(i-- > 0)
+				{
+					if(s[i] == c)
+						return i;
+				}
+
+				return static_cast<size_t>(-1);
+			}
+
+			// for substrings, look for the first and last characters of the needle at the same time (which filters out
+			// nearly all false positives), then check the rest of it for each candidate.
+			inline size_t find(const char* s, size_t n, const char* t, size_t m)
+			{
+				if(m > n)       return static_cast<size_t>(-1);
+				else if(m == 0) return 0;
+				else if(m == 1) return find_byte(s, n, t[0]);
+
+				// the number of places where the needle could start.
+				const size_t positions = n - m + 1;
+				size_t i = 0;
+
+			#if defined(ZST_HAVE_SIMD_SEARCH)
+				const auto head = splat(t[0]);
+				const auto tail = splat(t[m - 1]);
+
+				for(; i + WIDTH <= positions; i += WIDTH)
+				{
+					for(auto k = match(load(s + i), head) & match(load(s + i + m - 1), tail); k != 0; k = pop_first(k))
+					{
+						auto at = i + first(k);
+						if(memcmp(s + at + 1, t + 1, m - 2) == 0)
+							return at;
+					}
+				}
+			#endif
+
+				for(; i < positions; i++)
+				{
+					if(s[i] == t[0] && s[i + m - 1] == t[m - 1] && memcmp(s + i + 1, t + 1, m - 2) == 0)
+						return i;
+				}
+
+				return static_cast<size_t>(-1);
+			}
+
+			inline size_t rfind(const char* s, size_t n, const char* t, size_t m)
+			{
+				if(m > n)       return static_cast<size_t>(-1);
+				else if(m == 0) return n - 1;
+				else if(m == 1) return rfind_byte(s, n, t[0]);
+
+				size_t i = n - m + 1;
+
+			#if defined(ZST_HAVE_SIMD_SEARCH)
+				const auto head = splat(t[0]);
+				const auto tail = splat(t[m - 1]);
+
+				while(i >= WIDTH)
+				{
+					i -= WIDTH;
+					for(auto k = match(load(s + i), head) & match(load(s + i + m - 1), tail); k != 0; k = pop_last(k))
+					{
+						auto at = i + last(k);
+						if(memcmp(s + at + 1, t + 1, m - 2) == 0)
+							return at;
+					}
+				}
+			#endif
+
+				while(i-- > 0)
+				{
+					if(s[i] == t[0] && s[i + m - 1] == t[m - 1] && memcmp(s + i + 1, t + 1, m - 2) == 0)
+						return i;
+				}
+
+				return static_cast<size_t>(-1);
+			}
+
+			// small sets are compared against every character in the set at once; large ones use a lookup table.
+			inline size_t find_first_of(const char* s, size_t n, const char* set, size_t k)
+			{
+				if(k == 0)      return static_cast<size_t>(-1);
+				else if(k == 1) return find_byte(s, n, set[0]);
+
+				size_t i = 0;
+
+			#if defined(ZST_HAVE_SIMD_SEARCH)
+				constexpr size_t MAX_SIMD_SET = 16;
+
+				if(k <= MAX_SIMD_SET)
+				{
+					vec_t chars[MAX_SIMD_SET];
+					for(size_t j = 0; j < k; j++)
+						chars[j] = splat(set[j]);
+
+					for(; i + WIDTH <= n; i += WIDTH)
+					{
+						auto v = load(s + i);
+
+						mask_t m = 0;
+						for(size_t j = 0; j < k; j++)
+							m |= match(v, chars[j]);
+
+						if(m != 0)
+							return i + first(m);
+					}
+				}
+			#endif
+
+				bool table[256] = { };
+				for(size_t j = 0; j < k; j++)
+					table[static_cast<uint8_t>(set[j])] = true;
+
+				for(; i < n; i++)
+				{
+					if(table[static_cast<uint8_t>(s[i])])
+						return i;
+				}
+
+				return static_cast<size_t>(-1);
+			}
+		}
 	}
 
+	#undef ZST_HAVE_SIMD_SEARCH
+
 	namespace impl
 	{
 		template <typename... Args>
@@ -288,9 +567,19 @@ namespace zst
 				return zst::byteswap(this->ptr[n]);
 			}
 
-			inline size_t find(value_type c) const { return this->find(str_view(&c, 1)); }
+			inline size_t find(value_type c) const
+			{
+				if constexpr (sizeof(value_type) == 1)
+					return detail::search::find_byte(this->chars_ptr(), this->len, static_cast<char>(c));
+				else
+					return this->find(str_view(&c, 1));
+			}
+
 			inline size_t find(str_view sv) const
 			{
+				if constexpr (sizeof(value_type) == 1)
+					return detail::search::find(this->chars_ptr(), this->len, sv.chars_ptr(), sv.len);
+
 				if(sv.size() > this->size())
 					return static_cast<size_t>(-1);
 
@@ -306,9 +595,19 @@ namespace zst
 				return static_cast<size_t>(-1);
 			}
 
-			inline size_t rfind(value_type c) const { return this->rfind(str_view(&c, 1)); }
+			inline size_t rfind(value_type c) const
+			{
+				if constexpr (sizeof(value_type) == 1)
+					return detail::search::rfind_byte(this->chars_ptr(), this->len, static_cast<char>(c));
+				else
+					return this->rfind(str_view(&c, 1));
+			}
+
 			inline size_t rfind(str_view sv) const
 			{
+				if constexpr (sizeof(value_type) == 1)
+					return detail::search::rfind(this->chars_ptr(), this->len, sv.chars_ptr(), sv.len);
+
 				if(sv.size() > this->size())
 					return static_cast<size_t>(-1);
 
@@ -317,15 +616,24 @@ namespace zst
 
 				for(size_t i = 1 + this->size() - sv.size(); i-- > 0;)
 				{
-					if(this->take(1 + i).take_last(sv.size()) == sv)
+					if(this->drop(i).take(sv.size()) == sv)
 						return i;
 				}
 
 				return static_cast<size_t>(-1);
 			}
 
-			inline size_t find_first_of(str_view sv, size_t start = 0)
+			inline size_t find_first_of(str_view sv, size_t start = 0) const
 			{
+				if(start >= this->len)
+					return static_cast<size_t>(-1);
+
+				if constexpr (sizeof(value_type) == 1)
+				{
+					auto i = detail::search::find_first_of(this->chars_ptr() + start, this->len - start, sv.chars_ptr(), sv.len);
+					return i == static_cast<size_t>(-1) ? i : start + i;
+				}
+
 				for(size_t i = start; i < this->len; i++)
 				{
 					for(value_type k : sv)
@@ -503,6 +811,8 @@ namespace zst
 			}
 
 		private:
+			inline const char* chars_ptr() const { return reinterpret_cast<const char*>(this->ptr); }
+
 			const value_type* ptr;
 			size_t len;
 		};
@@ -576,6 +886,170 @@ namespace zst
 #if ZST_HAVE_BUFFER
 namespace zst
 {
+	// where a buffer<T> gets its memory from. a buffer without an allocator uses new[] and delete[].
+	struct Allocator
+	{
+		virtual void* allocate(size_t size, size_t align) = 0;
+		virtual void deallocate(void* ptr, size_t size) = 0;
+
+		// change the size of the allocation at `ptr` without moving it; returns false if that can't be done.
+		virtual bool resize(void* ptr, size_t old_size, size_t new_size) { (void) ptr; (void) old_size; (void) new_size; return false; }
+
+	protected:
+		~Allocator() = default;
+	};
+
+	// a bump allocator: memory is handed out from large blocks, and only given back all at once, by reset() or
+	// the destructor. deallocate() and resize() only do something for the most recent allocation, which is what
+	// makes a growing buffer cheap. the blocks come from `backing` (or new[], if it is null).
+	//
+	// an arena can also start with a buffer of your own (eg. on the stack), which is used before any blocks are
+	// allocated. it is not thread-safe, so use one per thread, or one per request.
+	struct Arena : Allocator
+	{
+		inline explicit Arena(size_t block_size = 65536, Allocator* backing = nullptr)
+			: m_blockSize(block_size), m_backing(backing) { }
+
+		inline Arena(void* initial, size_t size, size_t block_size = 65536, Allocator* backing = nullptr)
+			: m_blockSize(block_size), m_backing(backing)
+		{
+			this->m_initial = static_cast<uint8_t*>(initial);
+			this->m_initialSize = size;
+			this->m_cur = this->m_initial;
+			this->m_end = this->m_initial + size;
+		}
+
+		inline ~Arena() { this->free_blocks(nullptr); }
+
+		Arena(const Arena&) = delete;
+		Arena& operator= (const Arena&) = delete;
+
+		inline void* allocate(size_t size, size_t align) override
+		{
+			auto p = this->align_up(this->m_cur, align);
+			if(p == nullptr || p > this->m_end || size > static_cast<size_t>(this->m_end - p))
+			{
+				this->new_block(size + align);
+				p = this->align_up(this->m_cur, align);
+			}
+
+			this->m_last = p;
+			this->m_cur = p + size;
+			this->m_used += size;
+
+			return p;
+		}
+
+		inline void deallocate(void* ptr, size_t size) override
+		{
+			if(ptr != nullptr && ptr == this->m_last && this->m_last + size == this->m_cur)
+			{
+				this->m_cur = this->m_last;
+				this->m_last = nullptr;
+				this->m_used -= size;
+			}
+		}
+
+		inline bool resize(void* ptr, size_t old_size, size_t new_size) override
+		{
+			if(ptr == nullptr || ptr != this->m_last || this->m_last + old_size != this->m_cur)
+				return false;
+
+			if(new_size > static_cast<size_t>(this->m_end - this->m_last))
+				return false;
+
+			this->m_cur = this->m_last + new_size;
+			this->m_used = this->m_used - old_size + new_size;
+			return true;
+		}
+
+		// everything that was allocated is gone after this. the most recent block is kept to be reused
+		// (or the initial buffer, if there was one).
+		inline void reset()
+		{
+			if(this->m_initial != nullptr)
+			{
+				this->free_blocks(nullptr);
+				this->m_cur = this->m_initial;
+				this->m_end = this->m_initial + this->m_initialSize;
+			}
+			else if(this->m_block != nullptr)
+			{
+				this->free_blocks(this->m_block);
+				this->m_cur = reinterpret_cast<uint8_t*>(this->m_block) + BLOCK_HEADER;
+			}
+
+			this->m_last = nullptr;
+			this->m_used = 0;
+		}
+
+		// the number of bytes handed out since the last reset.
+		inline size_t used() const { return this->m_used; }
+
+	private:
+		struct Block
+		{
+			Block* prev;
+			size_t size;
+		};
+
+		static constexpr size_t BLOCK_ALIGN = 16;
+		static constexpr size_t BLOCK_HEADER = (sizeof(Block) + BLOCK_ALIGN - 1) & ~(BLOCK_ALIGN - 1);
+
+		static inline uint8_t* align_up(uint8_t* p, size_t align)
+		{
+			auto x = reinterpret_cast<uintptr_t>(p);
+			return reinterpret_cast<uint8_t*>((x + align - 1) & ~static_cast<uintptr_t>(align - 1));
+		}
+
+		inline void new_block(size_t min_size)
+		{
+			auto size = BLOCK_HEADER + (min_size > this->m_blockSize ? min_size : this->m_blockSize);
+			auto mem = (this->m_backing != nullptr
+				? static_cast<uint8_t*>(this->m_backing->allocate(size, BLOCK_ALIGN))
+				: new uint8_t[size]);
+
+			auto blk = reinterpret_cast<Block*>(mem);
+			blk->prev = this->m_block;
+			blk->size = size;
+
+			this->m_block = blk;
+			this->m_cur = mem + BLOCK_HEADER;
+			this->m_end = mem + size;
+		}
+
+		// frees every block except `keep` (which must be the most recent one, if it isn't null).
+		inline void free_blocks(Block* keep)
+		{
+			auto blk = this->m_block;
+			if(keep != nullptr)
+				blk = keep->prev, keep->prev = nullptr;
+
+			while(blk != nullptr)
+			{
+				auto prev = blk->prev;
+				if(this->m_backing != nullptr)  this->m_backing->deallocate(blk, blk->size);
+				else                            delete[] reinterpret_cast<uint8_t*>(blk);
+
+				blk = prev;
+			}
+
+			this->m_block = keep;
+		}
+
+		size_t m_blockSize;
+		Allocator* m_backing;
+
+		Block* m_block = nullptr;
+		uint8_t* m_cur = nullptr;
+		uint8_t* m_end = nullptr;
+		uint8_t* m_last = nullptr;
+		size_t m_used = 0;
+
+		uint8_t* m_initial = nullptr;
+		size_t m_initialSize = 0;
+	};
+
 	namespace impl
 	{
 		template <typename value_type>
@@ -586,19 +1060,23 @@ namespace zst
 
 
 			buffer() : buffer(64) { }
-			buffer(size_t capacity) : mem(new value_type[capacity]), cap(capacity), len(0) { }
+
+			// if `allocator` is given, all the memory of the buffer comes from it (so it must outlive the buffer).
+			buffer(size_t capacity, Allocator* allocator = nullptr) : cap(capacity), len(0), alloc(allocator)
+			{
+				this->mem = this->allocate(capacity);
+			}
 
 			~buffer()
 			{
-				if(this->mem != nullptr)
-					delete[] this->mem;
+				this->deallocate(this->mem, this->cap);
 
 				this->mem = 0;
 				this->len = 0;
 				this->cap = 0;
 			}
 
-			buffer(buffer&& b) : mem(b.mem), cap(b.cap), len(b.len)
+			buffer(buffer&& b) : mem(b.mem), cap(b.cap), len(b.len), alloc(b.alloc)
 			{
 				b.mem = nullptr;
 				b.cap = 0;
@@ -609,24 +1087,27 @@ namespace zst
 			{
 				if(this != &b)
 				{
-					if(this->mem)
-						delete[] this->mem;
+					this->deallocate(this->mem, this->cap);
 
 					this->mem = b.mem;  b.mem = nullptr;
 					this->len = b.len;  b.len = 0;
 					this->cap = b.cap;  b.cap = 0;
+					this->alloc = b.alloc;
 				}
 				return *this;
 			}
 
 
+			// the clone uses the same allocator.
 			inline buffer clone() const
 			{
-				auto ret = buffer(this->cap);
+				auto ret = buffer(this->cap, this->alloc);
 				ret.append(*this);
 				return ret;
 			}
 
+			inline Allocator* allocator() const { return this->alloc; }
+
 			inline bool operator== (const buffer& b) const
 			{
 				return this->len == b.len
@@ -647,8 +1128,8 @@ namespace zst
 			inline value_type* data() { return this->mem; }
 			inline const value_type* data() const { return this->mem; }
 
-			inline const value_type* begin() const { return this->ptr; }
-			inline const value_type* end() const { return this->ptr + this->len; }
+			inline const value_type* begin() const { return this->mem; }
+			inline const value_type* end() const { return this->mem + this->len; }
 
 			inline byte_span bytes() const
 			{
@@ -721,18 +1202,44 @@ namespace zst
 				if(this->len + extra > newcap)
 					newcap = this->len + extra;
 
-				auto newmem = new value_type[newcap];
+				// an arena can usually just extend the last allocation.
+				if(this->alloc != nullptr && this->mem != nullptr
+					&& this->alloc->resize(this->mem, sizeof(value_type) * this->cap, sizeof(value_type) * newcap))
+				{
+					this->cap = newcap;
+					return;
+				}
+
+				auto newmem = this->allocate(newcap);
 				memmove(newmem, this->mem, sizeof(value_type) * this->len);
 
-				delete[] this->mem;
+				this->deallocate(this->mem, this->cap);
 				this->mem = newmem;
 				this->cap = newcap;
 			}
 
+			inline value_type* allocate(size_t n)
+			{
+				if(this->alloc != nullptr)
+					return static_cast<value_type*>(this->alloc->allocate(sizeof(value_type) * n, alignof(value_type)));
+
+				return new value_type[n];
+			}
+
+			inline void deallocate(value_type* p, size_t n)
+			{
+				if(p == nullptr)
+					return;
+
+				if(this->alloc != nullptr)  this->alloc->deallocate(p, sizeof(value_type) * n);
+				else                        delete[] p;
+			}
+
 
 			value_type* mem = 0;
 			size_t cap = 0;
 			size_t len = 0;
+			Allocator* alloc = nullptr;
 		};
 	}
 
@@ -1100,7 +1607,7 @@ namespace zst
 
 		const T& or_else(const T& default_value) const
 		{
-			if(this->ok())  return this->unwrap();
+			if(this->ok())  return this->val;
 			else            return default_value;
 		}
 
@@ -1577,6 +2084,16 @@ constexpr inline zst::byte_span operator""_bs(const char* s, size_t n)
     Version History
     ===============
 
+    2.1.0 - 14/10/2026
+    ------------------
+    - use SSE2/AVX2/NEON for `find`, `rfind` and `find_first_of` on str_views of 1-byte characters
+    - fix `rfind` for needles longer than one character returning the wrong position
+    - make `find_first_of` const
+    - add Allocator and Arena; buffer<T> can now get its memory from an allocator
+    - fix `begin` and `end` of buffer<T> not compiling
+    - `or_else` of Result no longer needs `error_and_exit` (it can't fail)
+
+
     2.0.2 - 24/12/2024
     ------------------
     - Fix erroneous N-1 length accounting for reference-to-array constructor for str_view for non-char cases
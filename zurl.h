@@ -16,7 +16,7 @@
 */
 
 /*
-	Version 0.1.0
+	Version 0.2.0
 	=============
 
 
@@ -24,13 +24,13 @@
 	Documentation
 	=============
 
-	This library requires `znet.h` and `zbuf.h`.
+	This library requires `znet.h`, `zbuf.h`, and `zmt.h`.
 
 	This is a library for making HTTP/1.1 requests. It currently supports GET, PUT, POST, and PATCH, but it should
 	be trivial to support the rest. You can attach arbitrary HTTP headers and query parameters (eg. ?asdf=A&bsdf=B),
 	and SSL is supported as well (through znet).
 
-	Two API styles are supported, for now:
+	These API styles are supported, for now:
 	1. Fully synchronous
 		a call to any of the request methods blocks until the entire response is received. The headers and response
 		body are returned together.
@@ -40,6 +40,17 @@
 		are returned. When new data is received, a user-provided callback is called to process the new data. Note
 		that the call *still blocks* until the entire response is received.
 
+	3. Streaming
+		the same as (2), but you also pass in a buffer, and the response body is received directly into it. The spans
+		given to the callback point into this buffer, so nothing is copied; see below.
+
+	4. Concurrent (only on a `zurl::Client`)
+		getAsync, postAsync, etc. return immediately with a `zmt::future` of the response, or call a completion
+		callback with it; the request is made on a worker thread. See below.
+
+	The free functions (zurl::get, zurl::post, etc.) make a new connection for every request. To keep connections
+	open and reuse them, make requests through a `zurl::Client` instead, which has the same methods; see below.
+
 	Currently it also supports redirect (301) following up to a configurable depth. It is a recursive implementation,
 	so the limit should probably be reasonably low.
 
@@ -68,9 +79,124 @@
 
 
 
+	Streaming
+	---------
+	With the streaming API, every read from the socket goes into the buffer that you passed in, starting at the
+	beginning; the callback is then called with the content that was read, and the buffer is reused for the next
+	read once it returns. For chunked responses, the chunk framing is skipped over without moving any of the data,
+	so one read can result in several calls to the callback, each with a span into a different part of the buffer.
+
+	The only exception is any content that arrives together with the response headers, which is passed to the
+	callback from an internal buffer.
+
+	The synchronous API works the same way, receiving directly into the end of the `Response::content` buffer (which
+	is sized up-front if there is a Content-Length).
+
+
+
+	Headers
+	-------
+	`HttpHeaders` keeps the headers as they were received, and get() returns a view into them (so no strings are
+	made for lookups). Header names are compared case-insensitively. For headers that you look up often, you can
+	make a `zurl::HeaderName` once (it can be constexpr) so that its hash is not recomputed every time:
+
+		constexpr auto ETAG = zurl::HeaderName("etag");
+		auto etag = headers.get(ETAG);
+
+	Response headers are parsed as they arrive, by `HttpHeaders::Parser`, which does not allocate until they are
+	complete (unless there are more than 32 of them).
+
+
+
+	Concurrent Requests
+	-------------------
+	Requests made with the *Async methods of a `zurl::Client` are queued per host, and run on a `zmt::ThreadPool`
+	(either `Options::threadPool`, or one that the client makes). At most `Options::maxConcurrentPerHost` of them
+	are in flight to each host; the rest wait their turn, in the order they were made. Completion callbacks run
+	on the worker thread, so they should not block for long. waitAll() (which the destructor also calls) blocks
+	until every queued request has completed.
+
+	If `Options::pipelineDepth` is more than 1, waiting GET requests to a host are sent back-to-back on a single
+	connection, and the responses are read in order. If the server closes the connection partway, or sends a
+	response that can't be delimited without closing the connection, the requests that didn't get a response are
+	sent again by themselves.
+
+
+
+	Connection Pooling
+	------------------
+	A `zurl::Client` keeps a pool of idle connections for each protocol+host+port, and reuses one when another request
+	goes to the same place -- skipping the DNS lookup, TCP connect, and TLS handshake. A connection is returned to the
+	pool after its response has been read completely, unless the server sent `Connection: close` (or it is a HTTP/1.0
+	response without keep-alive), or the body had neither a Content-Length nor chunked encoding.
+
+	Connections are closed once they have been idle for longer than `Options::idleTimeout`; this is checked whenever
+	a connection to that host is needed, or when you call evictIdle(). If the server closed a pooled connection and
+	nothing at all was received, the request is sent again on a new connection.
+
+	When a new connection is needed, the addresses of the host are reused for `Options::dnsCacheTimeout` seconds (the
+	client has its own `znet::Resolver`; the concurrent API starts the lookup as soon as a request is queued), the
+	connection is made to whichever address answers first, and the TLS session of the last connection to that host
+	is resumed if possible (all of a client's connections share one
+	`znet::TLSContext`, which keeps the sessions).
+
+
+
+	Compression
+	-----------
+	With ZURL_ENABLE_ZLIB defined (where ZURL_IMPLEMENTATION is; link with -lz), requests are sent with
+	`Accept-Encoding: gzip, deflate`, and a response with one of those as its Content-Encoding is decompressed as it
+	is received; ZURL_ENABLE_BROTLI (link with -lbrotlidec) adds `br`. Set `Request::decompress` to false to get the
+	body exactly as it was sent instead.
+
+	The compressed body is never kept in full: it is received into a fixed-size buffer, and decompressed into
+	another, and the callback gets the decompressed content one piece at a time. This means that for a compressed
+	response, the spans do not point into the buffer passed to the streaming API, and the total size that is given
+	to the callback is empty, since the Content-Length (if any) is the compressed size. The headers that are returned
+	are the ones that were received, including the Content-Encoding and Content-Length.
+
+
+
+	Instrumentation
+	---------------
+	With ZURL_INSTRUMENT defined (where ZURL_IMPLEMENTATION is), the time taken by each phase of a request is sampled
+	into the sink set with zmt::instrument::set_sink(): `zurl.dns_ns` for resolving the host, `zurl.connect_ns` for
+	connecting (including the TLS handshake), `zurl.ttfb_ns` from sending the request to the first byte of the
+	response, and `zurl.body_ns` from the end of the headers to the end of the body (`zurl.body.bytes` counts the
+	bodies' sizes). To see the TCP connect and the TLS handshake separately, also define ZNET_INSTRUMENT, which adds
+	`znet.tcp.connect_ns` and `znet.tls.handshake_ns` (and counts the syscalls). When ZURL_INSTRUMENT is not defined, the hooks
+	compile to nothing.
+
+
+
 	Version History
 	===============
 
+	0.2.0 - 14/10/2026
+	------------------
+	- add zurl::Client, which keeps a pool of connections (with keep-alive, idle eviction, and TLS session reuse)
+	- fix reading chunked responses when more than one chunk arrives at once
+	- fix hanging forever when the server closes the connection before the response is complete
+	- treat 1xx, 204 and 304 responses as having no body, even if they have a Content-Length
+	- add a streaming API that receives the response body directly into a user-provided buffer
+	- parse chunked responses incrementally, without copying or moving the data
+	- receive the body directly into the response buffer in the synchronous API, and size it up-front
+	- parse response headers incrementally as they arrive, without allocating for each header
+	- make header lookups case-insensitive, and return views from get() and status()
+	- add zurl::HeaderName, for header names with a precomputed hash
+	- fail cleanly on an invalid Content-Length instead of throwing
+	- add a concurrent API to zurl::Client (getAsync etc.), with futures or completion callbacks
+	- limit the number of concurrent requests to each host, and optionally pipeline GET requests
+	- receive response headers into a buffer on the stack (through a zbuf::Arena)
+	- send the request headers and body with one writev, instead of copying them into one buffer first
+	- add Request::bodyFile, to send a file as the body (with sendfile() where possible)
+	- keep TLS sessions in the client's znet::TLSContext (configurable with Options::tls), shared by all its connections
+	- resolve hosts with znet::Resolver (all IPv4 and IPv6 addresses), and connect to them with happy eyeballs
+	- add optional instrumentation of the phases of each request (ZURL_INSTRUMENT)
+	- add optional gzip, deflate (ZURL_ENABLE_ZLIB) and brotli (ZURL_ENABLE_BROTLI) decompression of responses,
+	  which are decoded as they are received
+
+
 	0.1.0 - 15/03/2021
 	------------------
 	Initial release.
@@ -83,11 +209,47 @@
 #include <cstddef>
 #include <cstdarg>
 
+#include <mutex>
+#include <deque>
+#include <chrono>
+#include <memory>
 #include <vector>
 #include <string>
 #include <optional>
 #include <string_view>
-
+#include <utility>
+#include <functional>
+#include <unordered_map>
+#include <condition_variable>
+
+#define ZURL_DO_EXPAND(VAL)  VAL ## 1
+#define ZURL_EXPAND(VAL)     ZURL_DO_EXPAND(VAL)
+
+#if !defined(ZURL_INSTRUMENT)
+	#define ZURL_INSTRUMENT 0
+#elif (ZURL_EXPAND(ZURL_INSTRUMENT) == 1)
+	#undef ZURL_INSTRUMENT
+	#define ZURL_INSTRUMENT 1
+#endif
+
+#if !defined(ZURL_ENABLE_ZLIB)
+	#define ZURL_ENABLE_ZLIB 0
+#elif (ZURL_EXPAND(ZURL_ENABLE_ZLIB) == 1)
+	#undef ZURL_ENABLE_ZLIB
+	#define ZURL_ENABLE_ZLIB 1
+#endif
+
+#if !defined(ZURL_ENABLE_BROTLI)
+	#define ZURL_ENABLE_BROTLI 0
+#elif (ZURL_EXPAND(ZURL_ENABLE_BROTLI) == 1)
+	#undef ZURL_ENABLE_BROTLI
+	#define ZURL_ENABLE_BROTLI 1
+#endif
+
+#undef ZURL_DO_EXPAND
+#undef ZURL_EXPAND
+
+#include "zmt.h"
 #include "zbuf.h"
 #include "znet.h"
 
@@ -115,29 +277,115 @@ namespace zurl
 	};
 
 
+	// a header name along with its (case-insensitive) hash, so that looking it up doesn't need to hash it again.
+	// when constructed from a string literal in a constexpr context, the hash is computed at compile time.
+	struct HeaderName
+	{
+		template <size_t N>
+		explicit constexpr HeaderName(const char (&s)[N]) : name(s), length(N - 1), hash(HeaderName::hash_of(s, N - 1)) { }
+		explicit HeaderName(zbuf::str_view s) : name(s.data()), length(s.size()), hash(HeaderName::hash_of(s.data(), s.size())) { }
+
+		zbuf::str_view str() const { return zbuf::str_view(this->name, this->length); }
+
+		// FNV-1a, ignoring case.
+		static constexpr uint32_t hash_of(const char* s, size_t n)
+		{
+			uint32_t h = 2166136261u;
+			for(size_t i = 0; i < n; i++)
+			{
+				auto c = static_cast<uint8_t>(s[i]);
+				h = (h ^ static_cast<uint32_t>(('A' <= c && c <= 'Z') ? (c | 0x20) : c)) * 16777619u;
+			}
+
+			return h;
+		}
+
+		const char* name;
+		size_t length;
+		uint32_t hash;
+	};
+
+	// the headers are stored as they appear on the wire (in one string), with the position of each key and value.
+	// lookups are case-insensitive, and return views into that string (which are valid as long as the HttpHeaders is).
 	struct HttpHeaders
 	{
 		HttpHeaders() { }
 		HttpHeaders(zbuf::str_view status);
 
-		HttpHeaders& add(std::string&& key, std::string&& value);
-		HttpHeaders& add(const std::string& key, const std::string& value);
+		HttpHeaders& add(zbuf::str_view key, zbuf::str_view value);
 
 		std::string bytes() const;
-		std::string status() const;
+		zbuf::str_view status() const;
 		int statusCode() const;
-		const std::vector<std::pair<std::string, std::string>>& headers() const;
+
+		size_t size() const { return this->m_entries.size(); }
+		std::vector<std::pair<zbuf::str_view, zbuf::str_view>> headers() const;
+
+		// returns an empty view if the header is not present; if it appears more than once, the first one is returned.
+		zbuf::str_view get(zbuf::str_view key) const;
+		zbuf::str_view get(const HeaderName& key) const;
 
 		static std::optional<HttpHeaders> parse(zbuf::str_view data);
 		static std::optional<HttpHeaders> parse(const zbuf::Buffer& data);
 
-		std::string get(zbuf::str_view key) const;
+		// parses headers incrementally, as they are received. call feed() with *all* the data received so far
+		// every time more arrives; it continues from where it stopped the last time, so each byte is looked at
+		// only once. nothing is allocated until the headers are complete.
+		struct Parser
+		{
+			// returns true once the headers are complete, or if they are invalid (check failed()).
+			bool feed(zbuf::str_view data);
+
+			bool done() const   { return this->m_state != State::Incomplete; }
+			bool failed() const { return this->m_state == State::Failed; }
+
+			// the size of the headers (including the empty line at the end); the body starts after this.
+			size_t size() const { return this->m_end; }
+
+			// once the headers are complete, copy them out of `data` (which must be what was passed to feed()).
+			HttpHeaders finish(zbuf::str_view data);
+
+		private:
+			enum class State { Incomplete, Done, Failed };
+
+			bool parse_line(zbuf::str_view data, size_t begin, size_t end);
+
+			State m_state = State::Incomplete;
+
+			size_t m_scanned = 0;
+			size_t m_lineStart = 0;
+			size_t m_end = 0;
+			size_t m_statusLength = static_cast<size_t>(-1);
+			bool m_folded = false;
+
+			// fixed capacity, so that parsing doesn't allocate; the rest (if there are any) go into the vector.
+			static constexpr size_t INLINE_HEADERS = 32;
+
+			struct Entry
+			{
+				uint32_t hash;
+				uint32_t key;
+				uint32_t keyLength;
+				uint32_t value;
+				uint32_t valueLength;
+			};
+
+			Entry m_inline[INLINE_HEADERS];
+			size_t m_count = 0;
+			std::vector<Entry> m_overflow;
+
+			friend struct HttpHeaders;
+		};
 
 	private:
-		size_t expected_len = 0;
+		using Entry = Parser::Entry;
+
+		// the status line, then "key: value\r\n" for each header (but not the final \r\n).
+		std::string m_raw;
+		size_t m_statusLength = 0;
+		int m_statusCode = 0;
 
-		std::string m_status;
-		std::vector<std::pair<std::string, std::string>> m_headers;
+		std::vector<Entry> m_entries;
 	};
 
 	struct Param
@@ -172,6 +420,13 @@ namespace zurl
 		std::string contentType;
 		std::string body;
 
+		// if set, the body is the contents of this file instead (sent with sendfile() where possible).
+		std::string bodyFile;
+
+		// with ZURL_ENABLE_ZLIB or ZURL_ENABLE_BROTLI, ask for a compressed response (unless there is already an
+		// Accept-Encoding header), and decompress it as it arrives. without either of them, this does nothing.
+		bool decompress = true;
+
 		int _numRedirects = 0;
 	};
 
@@ -195,23 +450,184 @@ namespace zurl
 	std::optional<HttpHeaders> post(const Request& request, const RequestCallbackFn& callback);
 	std::optional<HttpHeaders> patch(const Request& request, const RequestCallbackFn& callback);
 
+	// streaming API: like the asynchronous API, but the body is received directly into `buffer` (which is reused
+	// for every read), and the spans passed to the callback point into it.
+	std::optional<HttpHeaders> get(const Request& request, uint8_t* buffer, size_t size, const RequestCallbackFn& callback);
+	std::optional<HttpHeaders> put(const Request& request, uint8_t* buffer, size_t size, const RequestCallbackFn& callback);
+	std::optional<HttpHeaders> post(const Request& request, uint8_t* buffer, size_t size, const RequestCallbackFn& callback);
+	std::optional<HttpHeaders> patch(const Request& request, uint8_t* buffer, size_t size, const RequestCallbackFn& callback);
+
+	struct Client;
+
 	namespace detail
 	{
 		std::string urlencode(zbuf::str_view s);
 		std::string lowercase(zbuf::str_view s);
+		bool equal_ignoring_case(zbuf::str_view a, zbuf::str_view b);
+		int parse_status_code(zbuf::str_view status);
 		std::optional<int64_t> stoi(zbuf::str_view s, int base = 10);
 		std::vector<zbuf::str_view> split(zbuf::str_view view, char delim);
 
 		std::string encode_params(const std::vector<Param>& params);
 
+		// returns the next buffer that the body should be received into; it must not be empty.
+		using ReceiveBufferFn = std::function<std::pair<uint8_t*, size_t> ()>;
 
-		std::optional<Response> make_http_request(const std::string& method, const Request& request);
+		// if `client` is null, a new connection is made (and closed) for the request. if `buffers` is empty,
+		// the body is received into an internal buffer.
+		std::optional<Response> make_http_request(const std::string& method, const Request& request,
+			Client* client = nullptr);
 		std::optional<HttpHeaders> make_http_request(const std::string& method, const Request& request,
-			const RequestCallbackFn& callback);
+			const RequestCallbackFn& callback, Client* client = nullptr, const ReceiveBufferFn& buffers = { });
 
 		// warning: you must free the buffer!!!
 		zbuf::str_view vsprint(const char* fmt, ...);
 	}
+
+	// a client keeps connections open after a request (unless the server says otherwise), and reuses them
+	// for later requests to the same protocol+host+port. it is safe to use from multiple threads.
+	struct Client
+	{
+		struct Options
+		{
+			// at most this many idle connections are kept for each host.
+			size_t maxIdlePerHost = 4;
+
+			// idle connections that have been unused for longer than this (in seconds) are closed.
+			double idleTimeout = 30;
+
+			// how long (in seconds) to remember the address that a hostname resolved to.
+			double dnsCacheTimeout = 60;
+
+			// at most this many requests made with the concurrent API are in flight to one host at any time;
+			// the rest wait (in order) until one of them completes.
+			size_t maxConcurrentPerHost = 6;
+
+			// if more than 1, up to this many waiting GET requests to the same host are sent together on one
+			// connection, without waiting for each response (HTTP/1.1 pipelining). some servers mishandle this,
+			// so it is off by default.
+			size_t pipelineDepth = 1;
+
+			// the pool that the concurrent API runs requests on. if null, the client makes its own, with
+			// `numThreads` workers, the first time it is needed.
+			zmt::ThreadPool* threadPool = nullptr;
+			size_t numThreads = 8;
+
+		#if ZNET_ENABLE_SSL
+			// for the client's TLS context, which all of its connections share (along with their sessions).
+			znet::TLSContext::Options tls;
+		#endif
+		};
+
+		using CompletionFn = std::function<void (std::optional<Response>)>;
+
+		Client();
+		explicit Client(const Options& opts);
+		~Client();
+
+		Client(Client&&) = delete;
+		Client(const Client&) = delete;
+		Client& operator= (Client&&) = delete;
+		Client& operator= (const Client&) = delete;
+
+		// synchronous API
+		std::optional<Response> get(const Request& request);
+		std::optional<Response> put(const Request& request);
+		std::optional<Response> post(const Request& request);
+		std::optional<Response> patch(const Request& request);
+
+		// asynchronous API
+		std::optional<HttpHeaders> get(const Request& request, const RequestCallbackFn& callback);
+		std::optional<HttpHeaders> put(const Request& request, const RequestCallbackFn& callback);
+		std::optional<HttpHeaders> post(const Request& request, const RequestCallbackFn& callback);
+		std::optional<HttpHeaders> patch(const Request& request, const RequestCallbackFn& callback);
+
+		// streaming API
+		std::optional<HttpHeaders> get(const Request& request, uint8_t* buffer, size_t size, const RequestCallbackFn& callback);
+		std::optional<HttpHeaders> put(const Request& request, uint8_t* buffer, size_t size, const RequestCallbackFn& callback);
+		std::optional<HttpHeaders> post(const Request& request, uint8_t* buffer, size_t size, const RequestCallbackFn& callback);
+		std::optional<HttpHeaders> patch(const Request& request, uint8_t* buffer, size_t size, const RequestCallbackFn& callback);
+
+		// concurrent API: these return immediately, and the request is made on a worker thread. the callback
+		// versions call `done` on that worker thread when the response is complete (or the request failed).
+		zmt::future<std::optional<Response>> getAsync(const Request& request);
+		zmt::future<std::optional<Response>> putAsync(const Request& request);
+		zmt::future<std::optional<Response>> postAsync(const Request& request);
+		zmt::future<std::optional<Response>> patchAsync(const Request& request);
+
+		void getAsync(const Request& request, CompletionFn done);
+		void putAsync(const Request& request, CompletionFn done);
+		void postAsync(const Request& request, CompletionFn done);
+		void patchAsync(const Request& request, CompletionFn done);
+
+		// blocks until every request made with the concurrent API has completed.
+		void waitAll();
+
+		// close the connections that have been idle for longer than `idleTimeout`. this also happens
+		// (for one host) whenever a connection to that host is needed.
+		void evictIdle();
+
+		// close all idle connections, and forget all cached addresses and TLS sessions.
+		void clear();
+
+		size_t idleConnections() const;
+
+	private:
+		using clock = std::chrono::steady_clock;
+
+		struct Connection
+		{
+			std::string key;
+			std::unique_ptr<znet::TCPSocket> socket;
+			clock::time_point lastUsed;
+			bool reused = false;
+		};
+
+		struct PendingRequest
+		{
+			std::string method;
+			Request request;
+			CompletionFn done;
+		};
+
+		struct HostQueue
+		{
+			size_t active = 0;
+			std::deque<PendingRequest> pending;
+		};
+
+		static std::string host_key(const URL& url);
+
+		std::unique_ptr<Connection> acquire(const URL& url, bool ssl, double timeout);
+		void release(std::unique_ptr<Connection> conn, bool reusable);
+
+		zmt::future<std::optional<Response>> enqueue(std::string method, const Request& request);
+		void enqueue(std::string method, const Request& request, CompletionFn done);
+		void run_queue(const std::string& key);
+		void run_pipelined(std::vector<PendingRequest>& batch);
+
+		friend std::optional<HttpHeaders> detail::make_http_request(const std::string& method,
+			const Request& request, const RequestCallbackFn& callback, Client* client, const detail::ReceiveBufferFn& buffers);
+
+		Options m_options;
+
+		mutable std::mutex m_lock;
+		std::unordered_map<std::string, std::vector<std::unique_ptr<Connection>>> m_idle;
+		znet::Resolver m_resolver;
+
+	#if ZNET_ENABLE_SSL
+		znet::TLSContext m_tls;
+	#endif
+
+		// for the concurrent API; this is a separate lock, so that it isn't held while connecting.
+		std::mutex m_queueLock;
+		std::condition_variable m_queueCV;
+		std::unordered_map<std::string, HostQueue> m_queues;
+		size_t m_outstanding = 0;
+
+		zmt::ThreadPool* m_pool = nullptr;
+		std::unique_ptr<zmt::ThreadPool> m_ownPool;
+	};
 }
 
 
@@ -226,7 +642,20 @@ namespace zurl
 #include <cstdlib>
 #include <cstring>
 #include <cassert>
-#include <unordered_map>
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#if ZURL_ENABLE_ZLIB
+	#include <zlib.h>
+#endif
+
+#if ZURL_ENABLE_BROTLI
+	#include <brotli/decode.h>
+#endif
 
 namespace zurl
 {
@@ -324,22 +753,30 @@ namespace zurl
 
 	HttpHeaders::HttpHeaders(zbuf::str_view status)
 	{
-		this->m_status = status.str();
-		this->expected_len = this->m_status.size() + 2;
-	}
+		this->m_raw.reserve(status.size() + 256);
 
-	HttpHeaders& HttpHeaders::add(const std::string& key, const std::string& value)
-	{
-		this->expected_len += 4 + key.size() + value.size();
-		this->m_headers.emplace_back(key, value);
+		this->m_raw.append(status.data(), status.size());
+		this->m_raw += "\r\n";
 
-		return *this;
+		this->m_statusLength = status.size();
+		this->m_statusCode = detail::parse_status_code(status);
 	}
 
-	HttpHeaders& HttpHeaders::add(std::string&& key, std::string&& value)
+	HttpHeaders& HttpHeaders::add(zbuf::str_view key, zbuf::str_view value)
 	{
-		this->expected_len += 4 + key.size() + value.size();
-		this->m_headers.emplace_back(std::move(key), std::move(value));
+		auto ofs = static_cast<uint32_t>(this->m_raw.size());
+		this->m_entries.push_back(Entry {
+			.hash = HeaderName::hash_of(key.data(), key.size()),
+			.key = ofs,
+			.keyLength = static_cast<uint32_t>(key.size()),
+			.value = static_cast<uint32_t>(ofs + key.size() + 2),
+			.valueLength = static_cast<uint32_t>(value.size()),
+		});
+
+		this->m_raw.append(key.data(), key.size());
+		this->m_raw += ": ";
+		this->m_raw.append(value.data(), value.size());
+		this->m_raw += "\r\n";
 
 		return *this;
 	}
@@ -347,50 +784,55 @@ namespace zurl
 	std::string HttpHeaders::bytes() const
 	{
 		std::string ret;
-		ret.reserve(this->expected_len + 2);
-
-		ret += this->m_status;
-		ret += "\r\n";
-
-		for(auto& [ k, v] : this->m_headers)
-			ret += k, ret += ": ", ret += v, ret += "\r\n";
+		ret.reserve(this->m_raw.size() + 2);
 
+		ret += this->m_raw;
 		ret += "\r\n";
 		return ret;
 	}
 
-	std::string HttpHeaders::status() const
+	zbuf::str_view HttpHeaders::status() const
 	{
-		return this->m_status;
+		return zbuf::str_view(this->m_raw.data(), this->m_statusLength);
 	}
 
 	int HttpHeaders::statusCode() const
 	{
-		if(this->m_status.empty())
-			return 0;
+		return this->m_statusCode;
+	}
+
+	std::vector<std::pair<zbuf::str_view, zbuf::str_view>> HttpHeaders::headers() const
+	{
+		std::vector<std::pair<zbuf::str_view, zbuf::str_view>> ret;
+		ret.reserve(this->m_entries.size());
 
-		auto xs = detail::split(this->m_status, ' ');
-		if(xs.size() < 3)
-			return 0;
+		for(auto& e : this->m_entries)
+		{
+			ret.emplace_back(zbuf::str_view(this->m_raw.data() + e.key, e.keyLength),
+				zbuf::str_view(this->m_raw.data() + e.value, e.valueLength));
+		}
 
-		// http version <space> code <space> message
-		return (int) detail::stoi(xs[1]).value();
+		return ret;
 	}
 
-	const std::vector<std::pair<std::string, std::string>>& HttpHeaders::headers() const
+	zbuf::str_view HttpHeaders::get(zbuf::str_view key) const
 	{
-		return this->m_headers;
+		return this->get(HeaderName(key));
 	}
 
-	std::string HttpHeaders::get(zbuf::str_view key) const
+	zbuf::str_view HttpHeaders::get(const HeaderName& key) const
 	{
-		for(const auto& [ k, v ] : this->m_headers)
+		for(auto& e : this->m_entries)
 		{
-			if(k == key)
-				return v;
+			if(e.hash != key.hash || e.keyLength != key.length)
+				continue;
+
+			auto k = zbuf::str_view(this->m_raw.data() + e.key, e.keyLength);
+			if(detail::equal_ignoring_case(k, key.str()))
+				return zbuf::str_view(this->m_raw.data() + e.value, e.valueLength);
 		}
 
-		return "";
+		return { };
 	}
 
 	std::optional<HttpHeaders> HttpHeaders::parse(const zbuf::Buffer& buf)
@@ -398,45 +840,131 @@ namespace zurl
 		return parse(buf.sv());
 	}
 
-
 	std::optional<HttpHeaders> HttpHeaders::parse(zbuf::str_view data)
 	{
-		auto x = data.find("\r\n");
-		if(x == std::string::npos)
+		auto parser = Parser();
+		if(!parser.feed(data) || parser.failed())
 			return std::nullopt;
 
-		auto hdrs = HttpHeaders(data.take(x));
-		data.remove_prefix(x + 2);
+		return parser.finish(data);
+	}
 
-		while(data.find("\r\n") > 0)
+	bool HttpHeaders::Parser::feed(zbuf::str_view data)
+	{
+		while(this->m_state == State::Incomplete)
 		{
-			auto ki = data.find(':');
-			if(ki == std::string::npos)
-				return std::nullopt;
+			auto nl = data.drop(this->m_scanned).find('\n');
+			if(nl == static_cast<size_t>(-1))
+			{
+				this->m_scanned = data.size();
+				return false;
+			}
 
-			auto key = detail::lowercase(data.take(ki));
-			data.remove_prefix(ki + 1);
+			auto end = this->m_scanned + nl;
+			this->m_scanned = end + 1;
 
-			// strip spaces
-			while(data.size() > 0 && data[0] == ' ')
-				data.remove_prefix(1);
+			// lines should end with \r\n, but be lenient and accept just \n.
+			auto begin = this->m_lineStart;
+			this->m_lineStart = end + 1;
 
-			if(data.size() == 0)
-				return std::nullopt;
+			if(end > begin && data[end - 1] == '\r')
+				end -= 1;
 
-			auto vi = data.find("\r\n");
-			if(vi == std::string::npos)
-				return std::nullopt;
+			if(!this->parse_line(data, begin, end))
+				this->m_state = State::Failed;
+		}
+
+		return true;
+	}
 
-			hdrs.add(std::move(key), data.take(vi).str());
+	bool HttpHeaders::Parser::parse_line(zbuf::str_view data, size_t begin, size_t end)
+	{
+		// the first line is the status.
+		if(this->m_statusLength == static_cast<size_t>(-1))
+		{
+			this->m_statusLength = end - begin;
+			return end > begin;
+		}
 
-			data.remove_prefix(vi + 2);
+		// and an empty line ends the headers.
+		if(end == begin)
+		{
+			this->m_end = this->m_lineStart;
+			this->m_state = State::Done;
+			return true;
 		}
 
-		if(data.find("\r\n") != 0)
-			return std::nullopt;
+		auto line = data.drop(begin).take(end - begin);
+
+		// a line starting with whitespace continues the previous header (this is obsolete, but still allowed).
+		if(line[0] == ' ' || line[0] == '\t')
+		{
+			if(this->m_count == 0)
+				return false;
+
+			auto& prev = (this->m_count <= INLINE_HEADERS ? this->m_inline[this->m_count - 1] : this->m_overflow.back());
+			prev.valueLength = static_cast<uint32_t>(end - prev.value);
+			this->m_folded = true;
+			return true;
+		}
+
+		auto colon = line.find(':');
+		if(colon == static_cast<size_t>(-1) || colon == 0)
+			return false;
+
+		auto value = line.drop(colon + 1);
+		while(value.size() > 0 && (value[0] == ' ' || value[0] == '\t'))
+			value.remove_prefix(1);
+
+		while(value.size() > 0 && (value.back() == ' ' || value.back() == '\t'))
+			value.remove_suffix(1);
+
+		auto entry = Entry {
+			.hash = HeaderName::hash_of(line.data(), colon),
+			.key = static_cast<uint32_t>(begin),
+			.keyLength = static_cast<uint32_t>(colon),
+			.value = static_cast<uint32_t>(value.data() - data.data()),
+			.valueLength = static_cast<uint32_t>(value.size()),
+		};
+
+		if(this->m_count < INLINE_HEADERS)
+			this->m_inline[this->m_count] = entry;
+		else
+			this->m_overflow.push_back(entry);
+
+		this->m_count += 1;
+		return true;
+	}
+
+	HttpHeaders HttpHeaders::Parser::finish(zbuf::str_view data)
+	{
+		auto ret = HttpHeaders();
+		if(this->m_state != State::Done)
+			return ret;
+
+		// leave out the final empty line, since bytes() adds it.
+		auto raw = data.take(this->m_end);
+		raw.remove_suffix(raw.take_last(2) == "\r\n" ? 2 : 1);
 
-		return hdrs;
+		ret.m_raw = raw.str();
+		ret.m_statusLength = this->m_statusLength;
+		ret.m_statusCode = detail::parse_status_code(ret.status());
+
+		ret.m_entries.reserve(this->m_count);
+		ret.m_entries.insert(ret.m_entries.end(), this->m_inline, this->m_inline + std::min(this->m_count, INLINE_HEADERS));
+		ret.m_entries.insert(ret.m_entries.end(), this->m_overflow.begin(), this->m_overflow.end());
+
+		// folded values keep their line breaks in `data`, but they should read as spaces.
+		if(this->m_folded)
+		{
+			for(auto& e : ret.m_entries)
+			{
+				auto v = ret.m_raw.data() + e.value;
+				std::replace_if(v, v + e.valueLength, [](char c) { return c == '\r' || c == '\n'; }, ' ');
+			}
+		}
+
+		return ret;
 	}
 
 
@@ -463,6 +991,26 @@ namespace zurl
 		return detail::make_http_request("PATCH", request, callback);
 	}
 
+	std::optional<HttpHeaders> get(const Request& request, uint8_t* buffer, size_t size, const RequestCallbackFn& callback)
+	{
+		return detail::make_http_request("GET", request, callback, nullptr, [buffer, size]() { return std::pair(buffer, size); });
+	}
+
+	std::optional<HttpHeaders> put(const Request& request, uint8_t* buffer, size_t size, const RequestCallbackFn& callback)
+	{
+		return detail::make_http_request("PUT", request, callback, nullptr, [buffer, size]() { return std::pair(buffer, size); });
+	}
+
+	std::optional<HttpHeaders> post(const Request& request, uint8_t* buffer, size_t size, const RequestCallbackFn& callback)
+	{
+		return detail::make_http_request("POST", request, callback, nullptr, [buffer, size]() { return std::pair(buffer, size); });
+	}
+
+	std::optional<HttpHeaders> patch(const Request& request, uint8_t* buffer, size_t size, const RequestCallbackFn& callback)
+	{
+		return detail::make_http_request("PATCH", request, callback, nullptr, [buffer, size]() { return std::pair(buffer, size); });
+	}
+
 	std::optional<Response> get(const Request& request)
 	{
 		return detail::make_http_request("GET", request);
@@ -555,6 +1103,49 @@ namespace zurl
 			return ret;
 		}
 
+		bool equal_ignoring_case(zbuf::str_view a, zbuf::str_view b)
+		{
+			if(a.size() != b.size())
+				return false;
+
+			for(size_t i = 0; i < a.size(); i++)
+			{
+				auto x = a[i];
+				auto y = b[i];
+
+				if('A' <= x && x <= 'Z') x = (char) (x | 0x20);
+				if('A' <= y && y <= 'Z') y = (char) (y | 0x20);
+
+				if(x != y)
+					return false;
+			}
+
+			return true;
+		}
+
+		// http version <space> code <space> message
+		int parse_status_code(zbuf::str_view status)
+		{
+			auto sp = status.find(' ');
+			if(sp == static_cast<size_t>(-1))
+				return 0;
+
+			auto code = status.drop(sp + 1).take(3);
+			if(code.size() != 3)
+				return 0;
+
+			int ret = 0;
+			for(char c : code)
+			{
+				if(c < '0' || c > '9')
+					return 0;
+
+				ret = 10 * ret + (c - '0');
+			}
+
+			return ret;
+		}
+
 		std::string lowercase(zbuf::str_view s)
 		{
 			std::string ret; ret.reserve(s.size());
@@ -609,229 +1200,1353 @@ namespace zurl
 		}
 
 
-		template <typename Cb>
-		std::optional<HttpHeaders> read_response(znet::TCPSocket& sock, double timeout, Cb&& callback)
+		// the headers that we look at ourselves.
+		namespace header_names
 		{
-			constexpr size_t CHUNK_BUFFER_SIZE = 4096;
+			constexpr auto CONNECTION           = HeaderName("connection");
+			constexpr auto CONTENT_LENGTH       = HeaderName("content-length");
+			constexpr auto TRANSFER_ENCODING    = HeaderName("transfer-encoding");
+			constexpr auto LOCATION             = HeaderName("location");
+			constexpr auto ACCEPT_ENCODING      = HeaderName("accept-encoding");
+			constexpr auto CONTENT_ENCODING     = HeaderName("content-encoding");
+		}
 
-			size_t processed = 0;
+		// statuses that never have a body, even without a content-length.
+		static bool has_no_body(int status)
+		{
+			return (100 <= status && status < 200) || status == 204 || status == 304;
+		}
 
-			auto hdrbuf = zbuf::Buffer(CHUNK_BUFFER_SIZE);
-			auto chunkbuf = zbuf::Buffer(CHUNK_BUFFER_SIZE);
+		// whether the connection can be used for another request after this response. that's the case
+		// unless the server asked to close it, it's http/1.0 without keep-alive, or the end of the body
+		// was only signalled by closing the connection.
+		static bool keep_alive(const HttpHeaders& headers)
+		{
+			auto conn = detail::lowercase(headers.get(header_names::CONNECTION));
+			if(conn.find("close") != std::string::npos)
+				return false;
 
-			bool isChunked = false;
-			std::optional<HttpHeaders> headers;
-			std::optional<size_t> contentLength;
+			if(zbuf::str_view(headers.status()).take(8) == "HTTP/1.0" && conn.find("keep-alive") == std::string::npos)
+				return false;
 
-			auto read_some = [timeout](znet::TCPSocket& sock, zbuf::Buffer& buf) -> bool {
-				if(buf.remaining() < CHUNK_BUFFER_SIZE)
-					buf.grow(CHUNK_BUFFER_SIZE);
+			return has_no_body(headers.statusCode())
+				|| !headers.get(header_names::CONTENT_LENGTH).empty()
+				|| headers.get(header_names::TRANSFER_ENCODING).find("chunked") != std::string::npos;
+		}
+
+		// decodes the chunked transfer-encoding incrementally, without buffering anything; the parts of
+		// the input that are content are passed to the callback as-is.
+		struct ChunkDecoder
+		{
+			// returns false if the framing is invalid. any data after the end of the body is ignored.
+			template <typename Cb>
+			bool feed(zbuf::Span data, Cb&& callback);
 
-				auto amt = sock.receive(buf.data() + buf.size(), buf.remaining(), timeout);
-				if(amt < 0) { fprintf(stderr, "socket error: %s\n", strerror(errno)); return false; }
+			bool done() const { return this->m_state == State::Done; }
 
-				buf.incrementSize(amt);
-				return true;
+			// once done, how many bytes at the end of the last span passed to feed() came after the body.
+			size_t excess() const { return this->m_excess; }
+
+		private:
+			enum class State
+			{
+				Size,           // reading the hex digits of the chunk size
+				Extension,      // skipping ';foo=bar' after the size
+				SizeLF,         // expecting the \n after the size line
+				Data,           // in the body of the chunk
+				DataCR,         // expecting the \r\n after the body
+				DataLF,
+				Trailer,        // at the start of a line after the last chunk (either a trailer, or the end)
+				TrailerLine,    // skipping over a trailer
+				FinalLF,        // expecting the \n of the empty line that ends the message
+				Done,
 			};
 
-			while(true)
+			State m_state = State::Size;
+			uint64_t m_remaining = 0;
+			size_t m_digits = 0;
+			size_t m_excess = 0;
+		};
+
+		template <typename Cb>
+		bool ChunkDecoder::feed(zbuf::Span data, Cb&& callback)
+		{
+			auto hex = [](uint8_t c) -> int {
+				if('0' <= c && c <= '9') return c - '0';
+				if('a' <= c && c <= 'f') return 10 + c - 'a';
+				if('A' <= c && c <= 'F') return 10 + c - 'A';
+				return -1;
+			};
+
+			while(data.size() > 0 && this->m_state != State::Done)
 			{
-				if(!headers.has_value())
+				// the content is passed through in one piece; everything else is handled a byte at a time.
+				if(this->m_state == State::Data)
 				{
-					if(!read_some(sock, hdrbuf))
-						return { };
+					auto n = static_cast<size_t>(std::min(this->m_remaining, static_cast<uint64_t>(data.size())));
+					callback(data.take(n));
 
-					if(auto hdrs = HttpHeaders::parse(hdrbuf); hdrs.has_value())
-					{
-						headers = hdrs;
+					data.remove_prefix(n);
+					if(this->m_remaining -= n; this->m_remaining == 0)
+						this->m_state = State::DataCR;
 
-						if(auto len = headers->get("content-length"); !contentLength && !len.empty())
-							contentLength = static_cast<size_t>(detail::stoi(len).value());
+					continue;
+				}
 
-						else if(headers->get("transfer-encoding").find("chunked") != static_cast<size_t>(-1))
-							isChunked = true;
+				auto c = data.peek();
+				data.remove_prefix(1);
 
-						auto tmp = hdrbuf.sv();
-						auto i = tmp.find("\r\n\r\n");
-						if(i != static_cast<size_t>(-1))
+				switch(this->m_state)
+				{
+					case State::Size:
+						if(auto d = hex(c); d >= 0)
 						{
-							auto x = tmp.drop(i + 4).span();
-							chunkbuf.autoWrite(x.data(), x.size());
-
-							if(!isChunked)
-							{
-								callback(x, contentLength);
-								processed += chunkbuf.size();
-							}
+							// 15 hex digits is more than enough for anybody.
+							if(++this->m_digits > 15)
+								return false;
 
-							goto have_header;
+							this->m_remaining = (this->m_remaining << 4) | static_cast<uint64_t>(d);
+							break;
 						}
-					}
-				}
-				else
-				{
-				have_header:
 
-					if(!isChunked)
-					{
-						if(contentLength && processed >= *contentLength)
-							break;
+						if(this->m_digits == 0)
+							return false;
 
-						// since we are not chunked, then we would have already called the callback with
-						// the partial data after the header; thus, we are safe to clear the buffer.
-						chunkbuf.unsafeClear();
-						if(!read_some(sock, chunkbuf))
-							return { };
+						if(c == ';' || c == ' ' || c == '\t')   this->m_state = State::Extension;
+						else if(c == '\r')                      this->m_state = State::SizeLF;
+						else                                    return false;
+						break;
 
-						processed += chunkbuf.size();
-						callback(chunkbuf.span(), contentLength);
-					}
-					else
-					{
-						// we might end up here with some data in the chunked buffer already
-						if(chunkbuf.sv().find("\r\n") == static_cast<size_t>(-1))
-						{
-							if(!read_some(sock, chunkbuf))
-								return { };
+					case State::Extension:
+						if(c == '\r')
+							this->m_state = State::SizeLF;
+						break;
 
-							// from the top.
-							continue;
-						}
+					case State::SizeLF:
+						if(c != '\n')
+							return false;
 
-						// because we are constantly shifting the buffer "forward" for each parsed chunk,
-						// we know that the start of the buffer must coincide with the start of a chunk.
-						auto chunk = chunkbuf.span();
-						auto body = chunk.drop(chunk.sv().find("\r\n") + 2);
+						this->m_state = (this->m_remaining == 0 ? State::Trailer : State::Data);
+						break;
 
-						// chunks are also apparently terminated by \r\n. so if it's not there,
-						// we don't have the whole chunk yet, so bail for now.
-						if(body.sv().rfind("\r\n") + 2 != body.size())
-							continue;
+					case State::DataCR:
+						if(c != '\r')
+							return false;
 
-						body = body.drop_last(2);
+						this->m_state = State::DataLF;
+						break;
 
-						// ok, we have a complete body now.
-						// first line contains the chunk size, as well as other nonsense.
-						auto tmp2 = chunk.take(chunk.sv().find("\r\n")).take(chunk.sv().find(';'));
-						auto size = static_cast<size_t>(detail::stoi(tmp2.sv(), /* base: */ 16).value());
+					case State::DataLF:
+						if(c != '\n')
+							return false;
 
-						// if the size of the body and the indicate size don't match, then we also have a problem
-						if(size != body.size())
-							fprintf(stderr, "chunk size mismatch: expected %zu, got %zu\n", size, body.size());
+						this->m_digits = 0;
+						this->m_state = State::Size;
+						break;
 
-						callback(body, contentLength);
+					case State::Trailer:
+						this->m_state = (c == '\r' ? State::FinalLF : State::TrailerLine);
+						break;
 
-						// ok, now shift the data.
-						auto todrop = (body.data() + body.size()) - chunkbuf.data();
-						chunkbuf.drop(todrop);
+					case State::TrailerLine:
+						if(c == '\n')
+							this->m_state = State::Trailer;
+						break;
 
-						// chunks are "null-terminated". (ie. last chunk has a size of 0)
-						if(size == 0)
-							break;
-					}
+					case State::FinalLF:
+						if(c != '\n')
+							return false;
+
+						this->m_state = State::Done;
+						break;
+
+					case State::Data:
+					case State::Done:
+						break;
 				}
 			}
 
-			return headers;
+			this->m_excess = data.size();
+			return true;
 		}
 
-		std::optional<Response> make_http_request(const std::string& method, const Request& request)
+		// decompresses a body with a Content-Encoding incrementally; the output goes into a fixed-size buffer, which
+		// is passed to the callback each time it fills up (or the input runs out). the compressed data should also be
+		// received into a buffer of ours (see input()), since the callback might write over wherever it came from.
+		struct BodyDecoder
 		{
-			int curid = 0;
-			auto buf = zbuf::Buffer(512);
-			auto hdr = detail::make_http_request(method, request, [&buf, &curid](int id, zbuf::Span s, ...) {
-				if(curid != id)
-					curid = id, buf.clear();
+			enum class Kind { None, Gzip, Deflate, Brotli };
 
-				buf.autoWrite(s);
-			});
+			static constexpr size_t BUFFER_SIZE = 16384;
 
-			if(!hdr) return { };
+			// what we send in Accept-Encoding, depending on which ones are enabled.
+			static constexpr const char* ACCEPT_ENCODING =
+			#if ZURL_ENABLE_BROTLI && ZURL_ENABLE_ZLIB
+				"br, gzip, deflate";
+			#elif ZURL_ENABLE_BROTLI
+				"br";
+			#elif ZURL_ENABLE_ZLIB
+				"gzip, deflate";
+			#else
+				"";
+			#endif
 
-			return Response {
-				.headers = std::move(hdr.value()),
-				.content = std::move(buf)
-			};
-		}
+			// None if we can't decode it (or it has more than one encoding, which nobody does).
+			static Kind kind_of(zbuf::str_view encoding);
 
-		std::optional<HttpHeaders> make_http_request(const std::string& method, const Request& request, const RequestCallbackFn& callback)
-		{
-			auto tmpsv = detail::vsprint("%s://%s", request.url.protocol().c_str(), request.url.hostname().c_str());
-			auto address = URL(tmpsv);
-			auto path = request.url.resource();
+			explicit BodyDecoder(Kind kind);
+			~BodyDecoder();
 
-			delete[] tmpsv.data();
-			tmpsv.clear();
+			BodyDecoder(const BodyDecoder&) = delete;
+			BodyDecoder& operator= (const BodyDecoder&) = delete;
 
-			// open a socket, write, wait for response, close.
-			auto sock = znet::TCPSocket(
-				znet::IPAddress::hostname4(request.url.hostname(), request.url.port()),
-				/* ssl: */ request.url.protocol() == "https"
-			);
+			// returns false if the data is invalid. anything after the end of the compressed stream is ignored.
+			template <typename Cb>
+			bool feed(zbuf::Span data, Cb&& callback);
 
-			if(!sock.connect(request.timeout))
-				return { };
+			// whether the end of the compressed stream was seen.
+			bool done() const { return this->m_done; }
 
-			tmpsv = detail::vsprint("%s %s%s HTTP/1.1", method.c_str(), path.c_str(),
+			// the total size of the decompressed data so far.
+			size_t decoded() const { return this->m_decoded; }
+
+			std::pair<uint8_t*, size_t> input() { return std::pair(this->m_in.get(), BUFFER_SIZE); }
+
+		private:
+		#if ZURL_ENABLE_ZLIB
+			bool start_zlib();
+
+			z_stream m_zlib { };
+			bool m_zlibStarted = false;
+
+			// "deflate" is meant to have a zlib header, but some servers send it raw; we look at the first two
+			// bytes to tell, so one might need to be kept until the next one arrives.
+			uint8_t m_header[2] = { };
+			size_t m_headerLength = 0;
+		#endif
+
+		#if ZURL_ENABLE_BROTLI
+			BrotliDecoderState* m_brotli = nullptr;
+		#endif
+
+			Kind m_kind;
+			bool m_done = false;
+			size_t m_decoded = 0;
+
+			std::unique_ptr<uint8_t[]> m_in;
+			std::unique_ptr<uint8_t[]> m_out;
+		};
+
+		template <typename Cb>
+		bool BodyDecoder::feed(zbuf::Span data, Cb&& callback)
+		{
+			auto emit = [&](size_t n) {
+				if(n > 0)
+				{
+					this->m_decoded += n;
+					callback(zbuf::Span(this->m_out.get(), n));
+				}
+			};
+
+		#if ZURL_ENABLE_ZLIB
+			if(this->m_kind == Kind::Gzip || this->m_kind == Kind::Deflate)
+			{
+				if(!this->m_zlibStarted)
+				{
+					while(this->m_headerLength < 2 && data.size() > 0)
+					{
+						this->m_header[this->m_headerLength++] = data.peek();
+						data.remove_prefix(1);
+					}
+
+					if(this->m_headerLength < 2 || !this->start_zlib())
+						return this->m_headerLength < 2;
+				}
+
+				// the header bytes go first (until they're used up), then the data.
+				auto pending = zbuf::Span(this->m_header, this->m_headerLength);
+				while(!this->m_done)
+				{
+					auto& in = (pending.size() > 0 ? pending : data);
+					if(in.size() == 0)
+						break;
+
+					this->m_zlib.next_in = const_cast<Bytef*>(in.data());
+					this->m_zlib.avail_in = static_cast<uInt>(std::min(in.size(), static_cast<size_t>(UINT32_MAX)));
+
+					do {
+						this->m_zlib.next_out = this->m_out.get();
+						this->m_zlib.avail_out = BUFFER_SIZE;
+
+						auto ret = inflate(&this->m_zlib, Z_NO_FLUSH);
+						emit(BUFFER_SIZE - this->m_zlib.avail_out);
+
+						if(ret == Z_STREAM_END)
+						{
+							// gzip allows several members one after the other, each starting with the magic 1f 8b;
+							// anything else after the end (some servers pad it with zeroes) is ignored.
+							auto next = this->m_zlib.next_in;
+							if(this->m_kind == Kind::Gzip && this->m_zlib.avail_in >= 2 && next[0] == 0x1f && next[1] == 0x8b
+								&& inflateReset(&this->m_zlib) == Z_OK)
+							{
+								continue;
+							}
+
+							this->m_done = true;
+							break;
+						}
+						else if(ret != Z_OK && !(ret == Z_BUF_ERROR && this->m_zlib.avail_in == 0))
+						{
+							return false;
+						}
+
+						// it only stops early if the output is full, so there might be more without more input.
+					} while(this->m_zlib.avail_out == 0);
+
+					in.remove_prefix(in.size() - this->m_zlib.avail_in);
+					if(&in == &pending)
+						this->m_headerLength = 0;
+				}
+
+				return true;
+			}
+		#endif
+
+		#if ZURL_ENABLE_BROTLI
+			if(this->m_kind == Kind::Brotli)
+			{
+				auto avail_in = data.size();
+				auto next_in = data.data();
+
+				while(!this->m_done)
+				{
+					auto avail_out = BUFFER_SIZE;
+					auto next_out = this->m_out.get();
+
+					auto ret = BrotliDecoderDecompressStream(this->m_brotli, &avail_in, &next_in, &avail_out, &next_out, nullptr);
+					emit(BUFFER_SIZE - avail_out);
+
+					if(ret == BROTLI_DECODER_RESULT_SUCCESS)                this->m_done = true;
+					else if(ret == BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT)  break;
+					else if(ret != BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT) return false;
+				}
+
+				return true;
+			}
+		#endif
+
+			(void) data;
+			(void) emit;
+			return false;
+		}
+
+		BodyDecoder::Kind BodyDecoder::kind_of(zbuf::str_view encoding)
+		{
+			// values are trimmed when the headers are parsed.
+			auto enc = encoding;
+
+		#if ZURL_ENABLE_ZLIB
+			if(equal_ignoring_case(enc, "gzip") || equal_ignoring_case(enc, "x-gzip"))
+				return Kind::Gzip;
+			else if(equal_ignoring_case(enc, "deflate"))
+				return Kind::Deflate;
+		#endif
+
+		#if ZURL_ENABLE_BROTLI
+			if(equal_ignoring_case(enc, "br"))
+				return Kind::Brotli;
+		#endif
+
+			(void) enc;
+			return Kind::None;
+		}
+
+		BodyDecoder::BodyDecoder(Kind kind) : m_kind(kind)
+		{
+			this->m_in = std::make_unique<uint8_t[]>(BUFFER_SIZE);
+			this->m_out = std::make_unique<uint8_t[]>(BUFFER_SIZE);
+
+		#if ZURL_ENABLE_BROTLI
+			if(kind == Kind::Brotli)
+				this->m_brotli = BrotliDecoderCreateInstance(nullptr, nullptr, nullptr);
+		#endif
+		}
+
+		BodyDecoder::~BodyDecoder()
+		{
+		#if ZURL_ENABLE_ZLIB
+			if(this->m_zlibStarted)
+				inflateEnd(&this->m_zlib);
+		#endif
+
+		#if ZURL_ENABLE_BROTLI
+			if(this->m_brotli != nullptr)
+				BrotliDecoderDestroyInstance(this->m_brotli);
+		#endif
+		}
+
+	#if ZURL_ENABLE_ZLIB
+		bool BodyDecoder::start_zlib()
+		{
+			// 15 + 32 detects a gzip or zlib header; a raw deflate stream has a negative window size. a zlib header
+			// is a multiple of 31 (as a big-endian u16) and says that the method is 8 (deflate).
+			int bits = 15 + 32;
+			if(this->m_kind == Kind::Deflate)
+			{
+				auto a = this->m_header[0];
+				auto b = this->m_header[1];
+				if((a & 0x0F) != 8 || ((a << 8) | b) % 31 != 0)
+					bits = -15;
+			}
+
+			if(inflateInit2(&this->m_zlib, bits) != Z_OK)
+				return false;
+
+			this->m_zlibStarted = true;
+			return true;
+		}
+	#endif
+
+		// reads exactly one response, so that the connection can be reused. `receivedAny` is set once any
+		// data arrives; if it is still false when this fails, the request never reached the server. the body
+		// is received into the buffers handed out by `next_buffer`, and the callback gets spans pointing into
+		// them (except for whatever arrived together with the headers, which points into the header buffer).
+		//
+		// if `leftover` is given, its contents are treated as having been received before anything else, and
+		// when this returns it holds whatever was received after the end of the response (for pipelining).
+		//
+		// if `decompress` is set and the body has a Content-Encoding that we can decode, it is received into the
+		// decoder's buffer instead, and the callback gets the decompressed data.
+		template <typename Buf, typename Cb>
+		std::optional<HttpHeaders> read_response(znet::TCPSocket& sock, double timeout, bool& receivedAny,
+			Buf&& next_buffer, Cb&& callback, zbuf::Buffer* leftover = nullptr, bool decompress = false)
+		{
+			constexpr size_t HEADER_BUFFER_SIZE = 4096;
+
+		#if ZURL_INSTRUMENT
+			// the request was sent just before this, so the first read gives the time to the first byte.
+			auto start = zmt::instrument::now();
+			bool first = true;
+		#endif
+
+			// returns the number of bytes read; 0 means the connection was closed (or the read timed out).
+			auto receive = [&](uint8_t* buf, size_t len) -> ssize_t {
+				auto amt = sock.receive(buf, len, timeout);
+				if(amt < 0) { fprintf(stderr, "socket error: %s\n", strerror(errno)); return -1; }
+
+			#if ZURL_INSTRUMENT
+				if(first && amt > 0)
+				{
+					zmt::instrument::sample("zurl.ttfb_ns", zmt::instrument::now() - start);
+					first = false;
+				}
+			#endif
+
+				receivedAny |= (amt > 0);
+				return amt;
+			};
+
+			// headers almost always fit in this, so usually nothing needs to be allocated for them.
+			uint8_t hdrstack[HEADER_BUFFER_SIZE];
+			auto arena = zbuf::Arena(hdrstack, sizeof(hdrstack), 4 * HEADER_BUFFER_SIZE);
+			auto hdrbuf = zbuf::Buffer(HEADER_BUFFER_SIZE, &arena);
+
+			if(leftover != nullptr && leftover->size() > 0)
+			{
+				hdrbuf.autoWrite(leftover->span());
+				leftover->unsafeClear();
+			}
+
+			// the parser picks up where it left off, so slowly-arriving headers are only parsed once.
+			auto parser = HttpHeaders::Parser();
+			while(!parser.feed(hdrbuf.sv()))
+			{
+				if(hdrbuf.remaining() < HEADER_BUFFER_SIZE)
+					hdrbuf.grow(HEADER_BUFFER_SIZE);
+
+				auto amt = receive(hdrbuf.data() + hdrbuf.size(), hdrbuf.remaining());
+				if(amt <= 0)
+					return { };
+
+				hdrbuf.incrementSize(static_cast<size_t>(amt));
+			}
+
+			if(parser.failed())
+			{
+				fprintf(stderr, "invalid response headers\n");
+				return { };
+			}
+
+			auto header_end = parser.size();
+			auto headers = std::optional<HttpHeaders>(parser.finish(hdrbuf.sv()));
+
+		#if ZURL_INSTRUMENT
+			auto body_start = zmt::instrument::now();
+		#endif
+
+			bool isChunked = false;
+			std::optional<size_t> contentLength;
+
+			// these never have a body, even if they say how long it would have been (which a 304 is allowed to),
+			// so the headers are all there is and waiting for more would eat into the next response.
+			if(has_no_body(headers->statusCode()))
+			{
+				contentLength = 0;
+			}
+			else if(auto len = headers->get(header_names::CONTENT_LENGTH); !len.empty())
+			{
+				auto n = detail::stoi(len);
+				if(!n || *n < 0)
+				{
+					fprintf(stderr, "invalid content-length '%.*s'\n", (int) len.size(), len.data());
+					return { };
+				}
+
+				contentLength = static_cast<size_t>(*n);
+			}
+			else if(headers->get(header_names::TRANSFER_ENCODING).find("chunked") != static_cast<size_t>(-1))
+			{
+				isChunked = true;
+			}
+
+			size_t processed = 0;
+			auto chunks = ChunkDecoder();
+
+			auto decoder = std::unique_ptr<BodyDecoder>();
+			if(auto kind = BodyDecoder::kind_of(headers->get(header_names::CONTENT_ENCODING));
+				decompress && kind != BodyDecoder::Kind::None)
+			{
+				decoder = std::make_unique<BodyDecoder>(kind);
+			}
+
+			// anything after the end of the body belongs to the next response.
+			auto excess = zbuf::Span(hdrbuf.data(), 0);
+
+			// the content goes through the decoder first, if there is one. its size isn't known then, since the
+			// content-length is how much there is before decoding.
+			bool invalid = false;
+			auto deliver = [&](zbuf::Span s) {
+				if(!decoder)
+					callback(s, contentLength);
+
+				else if(!invalid && !decoder->feed(s, [&](zbuf::Span out) { callback(out, std::optional<size_t>()); }))
+					invalid = true;
+			};
+
+			auto consume = [&](zbuf::Span data) -> bool {
+				if(isChunked)
+				{
+					auto ok = chunks.feed(data, [&](zbuf::Span s) {
+						processed += s.size();
+						deliver(s);
+					});
+
+					if(chunks.done())
+						excess = data.drop(data.size() - chunks.excess());
+
+					if(!ok)
+						fprintf(stderr, "invalid chunked encoding\n");
+
+					return ok;
+				}
+
+				if(contentLength)
+				{
+					excess = data.drop(*contentLength - processed);
+					data = data.take(*contentLength - processed);
+				}
+
+				processed += data.size();
+				deliver(data);
+				return true;
+			};
+
+			auto failed = [&](bool ok) -> bool {
+				if(ok && invalid)
+					fprintf(stderr, "invalid compressed body\n");
+
+				return !ok || invalid;
+			};
+
+			auto finished = [&]() -> bool {
+				return isChunked ? chunks.done() : (contentLength && processed >= *contentLength);
+			};
+
+			if(auto rest = hdrbuf.span().drop(header_end); (rest.size() > 0 || !isChunked) && failed(consume(rest)))
+				return { };
+
+			while(!finished())
+			{
+				auto [ buf, len ] = (decoder ? decoder->input() : next_buffer());
+
+				// don't read past the end of the body.
+				if(contentLength)
+					len = std::min(len, *contentLength - processed);
+
+				auto amt = receive(buf, len);
+				if(amt < 0)
+					return { };
+
+				// without a content-length, the body only ends when the server closes the connection.
+				if(amt == 0)
+				{
+					if(isChunked || contentLength)
+						return { };
+
+					break;
+				}
+
+				if(failed(consume(zbuf::Span(buf, static_cast<size_t>(amt)))))
+					return { };
+			}
+
+			// the body ended, but the compressed data didn't.
+			if(decoder && processed > 0 && !decoder->done())
+			{
+				fprintf(stderr, "truncated compressed body\n");
+				return { };
+			}
+
+			if(leftover != nullptr)
+				leftover->autoWrite(excess);
+
+		#if ZURL_INSTRUMENT
+			zmt::instrument::sample("zurl.body_ns", zmt::instrument::now() - body_start);
+			zmt::instrument::count("zurl.body.bytes", processed);
+
+			if(decoder)
+				zmt::instrument::count("zurl.body.decoded_bytes", decoder->decoded());
+		#endif
+
+			return headers;
+		}
+
+		// collects the body of a response, receiving straight into the end of the content buffer so that
+		// nothing needs to be copied.
+		struct ContentSink
+		{
+			static constexpr size_t MIN_RECEIVE_SIZE = 16384;
+
+			std::pair<uint8_t*, size_t> next_buffer()
+			{
+				if(this->buf.remaining() < MIN_RECEIVE_SIZE)
+					this->buf.resize(std::max(this->buf.size() + MIN_RECEIVE_SIZE, 2 * this->buf.size()));
+
+				return std::pair(this->buf.data() + this->buf.size(), this->buf.remaining());
+			}
+
+			void append(int id, zbuf::Span s, std::optional<size_t> total)
+			{
+				if(this->id != id)
+					this->id = id, this->buf.unsafeClear();
+
+				// if the data was received in place, it is already where it needs to be. if not, it's either from
+				// the header buffer, or it's further along in our buffer because of the chunk framing; in the latter
+				// case, it's already in the space we have, so writing it won't resize the buffer.
+				if(s.data() == this->buf.data() + this->buf.size())
+				{
+					this->buf.incrementSize(s.size());
+				}
+				else
+				{
+					// this happens first (with the data after the headers, if any), so we can make space for everything.
+					if(total && this->buf.size() == 0 && this->buf.remaining() < *total)
+						this->buf.resize(*total);
+
+					this->buf.autoWrite(s);
+				}
+			}
+
+			int id = 0;
+			zbuf::Buffer buf = zbuf::Buffer(512);
+		};
+
+		// reads one response on a connection that is already open, into a Response.
+		static std::optional<Response> receive_response(znet::TCPSocket& sock, double timeout, bool& receivedAny,
+			zbuf::Buffer* leftover, bool decompress)
+		{
+			auto sink = ContentSink();
+			auto hdr = read_response(sock, timeout, receivedAny, [&sink]() { return sink.next_buffer(); },
+				[&sink](zbuf::Span s, std::optional<size_t> total) { sink.append(0, s, total); }, leftover, decompress);
+
+			if(!hdr) return { };
+
+			return Response {
+				.headers = std::move(hdr.value()),
+				.content = std::move(sink.buf)
+			};
+		}
+
+		// an open Request::bodyFile.
+		struct BodyFile
+		{
+			BodyFile() { }
+			~BodyFile() { if(this->fd >= 0) close(this->fd); }
+
+			BodyFile(BodyFile&& o) : fd(o.fd), size(o.size) { o.fd = -1; }
+			BodyFile& operator= (BodyFile&&) = delete;
+
+			int fd = -1;
+			size_t size = 0;
+		};
+
+		static std::optional<BodyFile> open_body_file(const Request& request)
+		{
+			auto ret = BodyFile();
+			if(request.bodyFile.empty())
+				return ret;
+
+			struct stat st { };
+			if(ret.fd = open(request.bodyFile.c_str(), O_RDONLY); ret.fd < 0 || fstat(ret.fd, &st) != 0)
+			{
+				fprintf(stderr, "failed to open '%s': %s\n", request.bodyFile.c_str(), strerror(errno));
+				return { };
+			}
+
+			ret.size = static_cast<size_t>(st.st_size);
+			return ret;
+		}
+
+		// just the request line and headers; the body is sent separately, so that it never needs to be copied.
+		static std::string serialise_headers(const std::string& method, const Request& request, const BodyFile& file)
+		{
+			auto path = request.url.resource();
+
+			auto tmpsv = detail::vsprint("%s %s%s HTTP/1.1", method.c_str(), path.c_str(),
 				detail::encode_params(request.params).c_str());
 
 			auto hdr = HttpHeaders(tmpsv);
 			delete[] tmpsv.data();
 
+			auto length = (file.fd >= 0 ? file.size : request.body.size());
 
 			hdr.add("Host", request.url.hostname());
+
+			bool acceptEncoding = false;
 			for(const auto& h : request.headers)
+			{
 				hdr.add(h.name, h.value);
+				acceptEncoding |= detail::equal_ignoring_case(h.name, header_names::ACCEPT_ENCODING.str());
+			}
+
+			if(request.decompress && !acceptEncoding && BodyDecoder::ACCEPT_ENCODING[0] != '\0')
+				hdr.add("Accept-Encoding", BodyDecoder::ACCEPT_ENCODING);
 
-			if(request.body.size() > 0)
+			if(length > 0)
 				hdr.add("Content-Type", request.contentType.empty() ? "text/plain" : request.contentType);
 
-			hdr.add("Content-Length", std::to_string(request.body.size()));
+			hdr.add("Content-Length", std::to_string(length));
+
+			return hdr.bytes();
+		}
+
+		static bool send_request(znet::TCPSocket& sock, const std::string& head, const Request& request, const BodyFile& file)
+		{
+			iovec parts[2] = {
+				{ .iov_base = const_cast<char*>(head.data()), .iov_len = head.size() },
+				{ .iov_base = const_cast<char*>(request.body.data()), .iov_len = request.body.size() },
+			};
 
-			auto h = hdr.bytes();
-			auto buf = zbuf::Buffer(h.size() + request.body.size());
+			auto count = (file.fd >= 0 ? 1 : 2);
+			auto total = head.size() + (file.fd >= 0 ? 0 : request.body.size());
 
-			buf.autoWrite(zbuf::Span::fromString(h));
-			buf.autoWrite(zbuf::Span::fromString(request.body));
+			if(sock.sendv(parts, static_cast<size_t>(count)) != static_cast<ssize_t>(total))
+				return false;
 
-			sock.send(buf.data(), buf.size());
+			return file.fd < 0 || sock.sendFile(file.fd, 0, file.size) == static_cast<ssize_t>(file.size);
+		}
+
+		// all the addresses of the url's host (which is empty if it doesn't resolve).
+		static std::vector<znet::IPAddress> resolve(znet::Resolver& resolver, const URL& url)
+		{
+		#if ZURL_INSTRUMENT
+			auto start = zmt::instrument::now();
+			auto addrs = resolver.resolve(url.hostname(), url.port());
+			zmt::instrument::sample("zurl.dns_ns", zmt::instrument::now() - start);
+		#else
+			auto addrs = resolver.resolve(url.hostname(), url.port());
+		#endif
+			if(!addrs.ok())
+			{
+				fprintf(stderr, "could not resolve '%s'\n", url.hostname().c_str());
+				return { };
+			}
+
+			return std::move(addrs.addresses);
+		}
+
+		// if the response is a redirect that should be followed, returns the request to make next.
+		static std::optional<Request> redirect_for(const Request& request, const HttpHeaders& response)
+		{
+			if(response.statusCode() != 301)
+				return { };
 
-			// the actual socket reader has no concept of an "id" -- this is purely a request thing.
-			// so, we need to wrap it in another lambda to pass in the id.
-			auto resp = detail::read_response(sock, request.timeout, [&request, &callback](auto... xs) {
-				callback(request._numRedirects, static_cast<decltype(xs)&&>(xs)...);
+			if(!request.followRedirects || request._numRedirects > request.maxRedirects)
+				return { };
+
+			auto to = response.get(header_names::LOCATION);
+			if(to.empty())
+				return { };
+
+			auto copy = request;
+			copy._numRedirects += 1;
+			copy.url = URL(to);
+
+			return copy;
+		}
+
+		std::optional<Response> make_http_request(const std::string& method, const Request& request, Client* client)
+		{
+			auto sink = ContentSink();
+			auto hdr = detail::make_http_request(method, request, [&sink](int id, zbuf::Span s, std::optional<size_t> total) {
+				sink.append(id, s, total);
+			}, client, [&sink]() { return sink.next_buffer(); });
+
+			if(!hdr) return { };
+
+			return Response {
+				.headers = std::move(hdr.value()),
+				.content = std::move(sink.buf)
+			};
+		}
+
+		std::optional<HttpHeaders> make_http_request(const std::string& method, const Request& request,
+			const RequestCallbackFn& callback, Client* client, const ReceiveBufferFn& buffers)
+		{
+			auto ssl = (request.url.protocol() == "https");
+
+			auto file = open_body_file(request);
+			if(!file)
+				return { };
+
+			auto head = serialise_headers(method, request, *file);
+
+			constexpr size_t RECEIVE_BUFFER_SIZE = 16384;
+			auto recvbuf = std::vector<uint8_t>();
+
+			auto send_and_receive = [&](znet::TCPSocket& sock, bool& receivedAny) -> std::optional<HttpHeaders> {
+				if(!send_request(sock, head, request, *file))
+					return { };
+
+				// the actual socket reader has no concept of an "id" -- this is purely a request thing.
+				// so, we need to wrap it in another lambda to pass in the id.
+				auto cb = [&request, &callback](auto... xs) {
+					callback(request._numRedirects, static_cast<decltype(xs)&&>(xs)...);
+				};
+
+				if(buffers)
+					return detail::read_response(sock, request.timeout, receivedAny, buffers, cb, nullptr, request.decompress);
+
+				if(recvbuf.empty())
+					recvbuf.resize(RECEIVE_BUFFER_SIZE);
+
+				return detail::read_response(sock, request.timeout, receivedAny, [&recvbuf]() {
+					return std::pair(recvbuf.data(), recvbuf.size());
+				}, cb, nullptr, request.decompress);
+			};
+
+			std::optional<HttpHeaders> resp;
+			if(client == nullptr)
+			{
+				// open a socket, write, wait for response, close.
+				auto addrs = resolve(znet::Resolver::shared(), request.url);
+				if(addrs.empty())
+					return { };
+
+			#if ZURL_INSTRUMENT
+				auto start = zmt::instrument::now();
+			#endif
+
+				auto sock = znet::TCPSocket::connectFirst(addrs, /* ssl: */ ssl, request.timeout);
+				if(!sock)
+					return { };
+
+			#if ZURL_INSTRUMENT
+				zmt::instrument::sample("zurl.connect_ns", zmt::instrument::now() - start);
+			#endif
+
+				bool receivedAny = false;
+				if(resp = send_and_receive(*sock, receivedAny); !resp)
+					return { };
+
+				sock->disconnect();
+			}
+			else
+			{
+				while(true)
+				{
+					auto conn = client->acquire(request.url, ssl, request.timeout);
+					if(!conn)
+						return { };
+
+					bool receivedAny = false;
+					resp = send_and_receive(*conn->socket, receivedAny);
+
+					// the server might have closed a pooled connection while it was idle. if nothing came back,
+					// the request was never processed, so it's safe to send it again on another connection.
+					if(!resp && conn->reused && !receivedAny)
+						continue;
+
+					if(!resp)
+						return { };
+
+					client->release(std::move(conn), detail::keep_alive(*resp));
+					break;
+				}
+			}
+
+			if(auto next = redirect_for(request, *resp); next.has_value())
+				return make_http_request(method, *next, callback, client, buffers);
+
+			return resp;
+		}
+	}
+
+
+
+
+	Client::Client() : Client(Options { })
+	{
+	}
+
+#if ZNET_ENABLE_SSL
+	Client::Client(const Options& opts) : m_options(opts),
+		m_resolver(znet::Resolver::Options { .cacheTimeout = opts.dnsCacheTimeout }), m_tls(opts.tls)
+	{
+	}
+#else
+	Client::Client(const Options& opts) : m_options(opts),
+		m_resolver(znet::Resolver::Options { .cacheTimeout = opts.dnsCacheTimeout })
+	{
+	}
+#endif
+
+	Client::~Client()
+	{
+		this->waitAll();
+		this->m_ownPool.reset();
+
+		this->clear();
+	}
+
+	std::optional<HttpHeaders> Client::get(const Request& request, const RequestCallbackFn& callback)
+	{
+		return detail::make_http_request("GET", request, callback, this);
+	}
+
+	std::optional<HttpHeaders> Client::put(const Request& request, const RequestCallbackFn& callback)
+	{
+		return detail::make_http_request("PUT", request, callback, this);
+	}
+
+	std::optional<HttpHeaders> Client::post(const Request& request, const RequestCallbackFn& callback)
+	{
+		return detail::make_http_request("POST", request, callback, this);
+	}
+
+	std::optional<HttpHeaders> Client::patch(const Request& request, const RequestCallbackFn& callback)
+	{
+		return detail::make_http_request("PATCH", request, callback, this);
+	}
+
+	std::optional<HttpHeaders> Client::get(const Request& request, uint8_t* buffer, size_t size, const RequestCallbackFn& callback)
+	{
+		return detail::make_http_request("GET", request, callback, this, [buffer, size]() { return std::pair(buffer, size); });
+	}
+
+	std::optional<HttpHeaders> Client::put(const Request& request, uint8_t* buffer, size_t size, const RequestCallbackFn& callback)
+	{
+		return detail::make_http_request("PUT", request, callback, this, [buffer, size]() { return std::pair(buffer, size); });
+	}
+
+	std::optional<HttpHeaders> Client::post(const Request& request, uint8_t* buffer, size_t size, const RequestCallbackFn& callback)
+	{
+		return detail::make_http_request("POST", request, callback, this, [buffer, size]() { return std::pair(buffer, size); });
+	}
+
+	std::optional<HttpHeaders> Client::patch(const Request& request, uint8_t* buffer, size_t size, const RequestCallbackFn& callback)
+	{
+		return detail::make_http_request("PATCH", request, callback, this, [buffer, size]() { return std::pair(buffer, size); });
+	}
+
+	std::optional<Response> Client::get(const Request& request)
+	{
+		return detail::make_http_request("GET", request, this);
+	}
+
+	std::optional<Response> Client::post(const Request& request)
+	{
+		return detail::make_http_request("POST", request, this);
+	}
+
+	std::optional<Response> Client::put(const Request& request)
+	{
+		return detail::make_http_request("PUT", request, this);
+	}
+
+	std::optional<Response> Client::patch(const Request& request)
+	{
+		return detail::make_http_request("PATCH", request, this);
+	}
+
+	zmt::future<std::optional<Response>> Client::getAsync(const Request& request)
+	{
+		return this->enqueue("GET", request);
+	}
+
+	zmt::future<std::optional<Response>> Client::putAsync(const Request& request)
+	{
+		return this->enqueue("PUT", request);
+	}
+
+	zmt::future<std::optional<Response>> Client::postAsync(const Request& request)
+	{
+		return this->enqueue("POST", request);
+	}
+
+	zmt::future<std::optional<Response>> Client::patchAsync(const Request& request)
+	{
+		return this->enqueue("PATCH", request);
+	}
+
+	void Client::getAsync(const Request& request, CompletionFn done)
+	{
+		this->enqueue("GET", request, std::move(done));
+	}
+
+	void Client::putAsync(const Request& request, CompletionFn done)
+	{
+		this->enqueue("PUT", request, std::move(done));
+	}
+
+	void Client::postAsync(const Request& request, CompletionFn done)
+	{
+		this->enqueue("POST", request, std::move(done));
+	}
+
+	void Client::patchAsync(const Request& request, CompletionFn done)
+	{
+		this->enqueue("PATCH", request, std::move(done));
+	}
+
+	void Client::waitAll()
+	{
+		auto lk = std::unique_lock<std::mutex>(this->m_queueLock);
+		this->m_queueCV.wait(lk, [this]() { return this->m_outstanding == 0; });
+	}
+
+	zmt::future<std::optional<Response>> Client::enqueue(std::string method, const Request& request)
+	{
+		// std::function needs to be copyable, but the promise isn't.
+		auto promise = std::make_shared<zmt::promise<std::optional<Response>>>();
+		auto fut = promise->get_future();
+
+		this->enqueue(std::move(method), request, [promise](std::optional<Response> resp) {
+			promise->set(std::move(resp));
+		});
+
+		return fut;
+	}
+
+	void Client::enqueue(std::string method, const Request& request, CompletionFn done)
+	{
+		auto key = host_key(request.url);
+		{
+			auto lk = std::lock_guard<std::mutex>(this->m_queueLock);
+			if(this->m_pool == nullptr)
+			{
+				if(this->m_options.threadPool == nullptr)
+				{
+					this->m_ownPool = std::make_unique<zmt::ThreadPool>(this->m_options.numThreads);
+					this->m_pool = this->m_ownPool.get();
+				}
+				else
+				{
+					this->m_pool = this->m_options.threadPool;
+				}
+			}
+
+			this->m_outstanding += 1;
+
+			// start looking up the host now, so that it is (more likely to be) cached by the time this
+			// request gets to run.
+			this->m_resolver.resolve(request.url.hostname(), request.url.port(), [](auto) { });
+
+			auto& queue = this->m_queues[key];
+			queue.pending.push_back(PendingRequest {
+				.method = std::move(method),
+				.request = request,
+				.done = std::move(done)
 			});
 
-			if(!resp) return { };
+			// otherwise, one of the running ones will get to it.
+			if(queue.active >= std::max(this->m_options.maxConcurrentPerHost, size_t(1)))
+				return;
+
+			queue.active += 1;
+		}
+
+		this->m_pool->run([this, key = std::move(key)]() { this->run_queue(key); }).discard();
+	}
+
+	void Client::run_queue(const std::string& key)
+	{
+		// only GETs are pipelined, since everything else might not be safe to send again if the server
+		// gives up halfway through.
+		auto can_pipeline = [](const PendingRequest& r) {
+			return r.method == "GET" && r.request.body.empty() && r.request.bodyFile.empty();
+		};
+
+		// returns true if this worker should go away.
+		auto finish_if_empty = [this](decltype(this->m_queues)::iterator it) -> bool {
+			if(!it->second.pending.empty())
+				return false;
+
+			if(it->second.active -= 1; it->second.active == 0)
+				this->m_queues.erase(it);
+
+			return true;
+		};
+
+		auto batch = std::vector<PendingRequest>();
+		{
+			auto lk = std::lock_guard<std::mutex>(this->m_queueLock);
 
-			auto r = std::move(resp.value());
-			sock.disconnect();
+			// another worker for this host might have taken the last request since we were scheduled.
+			auto it = this->m_queues.find(key);
+			if(finish_if_empty(it))
+				return;
 
-			if(r.statusCode() == 301)
+			auto& queue = it->second;
+			batch.push_back(std::move(queue.pending.front()));
+			queue.pending.pop_front();
+
+			while(can_pipeline(batch.front()) && batch.size() < this->m_options.pipelineDepth
+				&& !queue.pending.empty() && can_pipeline(queue.pending.front()))
 			{
-				if(!request.followRedirects || request._numRedirects > request.maxRedirects)
-					goto out;
+				batch.push_back(std::move(queue.pending.front()));
+				queue.pending.pop_front();
+			}
+		}
+
+		if(batch.size() == 1)
+			batch[0].done(detail::make_http_request(batch[0].method, batch[0].request, this));
+		else
+			this->run_pipelined(batch);
 
-				auto to = r.get("location");
-				if(to.empty())
-					goto out;
+		bool more = false;
+		{
+			auto lk = std::lock_guard<std::mutex>(this->m_queueLock);
+
+			more = !finish_if_empty(this->m_queues.find(key));
+			this->m_outstanding -= batch.size();
+			this->m_queueCV.notify_all();
+		}
 
-				auto copy = request;
-				copy._numRedirects += 1;
-				copy.url = URL(to);
+		// instead of looping here, go to the back of the line, so that requests to other hosts get a turn
+		// when there are more hosts than threads.
+		if(more)
+			this->m_pool->run([this, key]() { this->run_queue(key); }).discard();
+	}
 
-				return make_http_request(method, copy, callback);
+	void Client::run_pipelined(std::vector<PendingRequest>& batch)
+	{
+		auto& first = batch.front().request;
+		auto responses = std::vector<std::optional<Response>>();
+
+		if(auto conn = this->acquire(first.url, first.url.protocol() == "https", first.timeout); conn != nullptr)
+		{
+			// these are all GETs without a body, so the headers are everything.
+			auto heads = std::vector<std::string>();
+			auto parts = std::vector<iovec>();
+			size_t total = 0;
+
+			heads.reserve(batch.size());
+			for(auto& r : batch)
+			{
+				auto& h = heads.emplace_back(detail::serialise_headers(r.method, r.request, detail::BodyFile()));
+				parts.push_back(iovec { .iov_base = h.data(), .iov_len = h.size() });
+				total += h.size();
 			}
 
-		out:
-			return r;
+			bool reusable = false;
+			if(conn->socket->sendv(parts.data(), parts.size()) == static_cast<ssize_t>(total))
+			{
+				// the responses come back in the same order. the last read for one response might have
+				// picked up the start of the next one, so that gets carried over.
+				auto leftover = zbuf::Buffer(256);
+				while(responses.size() < batch.size())
+				{
+					bool receivedAny = false;
+					auto& req = batch[responses.size()].request;
+					auto resp = detail::receive_response(*conn->socket, req.timeout, receivedAny, &leftover,
+						req.decompress);
 
-			// return Response {
-			// 	.headers = std::move(r.first),
-			// 	.content = std::move(r.second)
-			// };
+					if(!resp)
+						break;
+
+					reusable = detail::keep_alive(resp->headers);
+					responses.push_back(std::move(resp));
+
+					if(!reusable)
+						break;
+				}
+
+				reusable = reusable && responses.size() == batch.size() && leftover.size() == 0;
+			}
+
+			this->release(std::move(conn), reusable);
+		}
+
+		for(size_t i = 0; i < batch.size(); i++)
+		{
+			auto& [ method, request, done ] = batch[i];
+
+			// the server might not support pipelining, or it closed the connection partway; whatever didn't
+			// get a response is sent again by itself (which is fine, since these are all GETs).
+			if(i >= responses.size())
+				done(detail::make_http_request(method, request, this));
+
+			else if(auto next = detail::redirect_for(request, responses[i]->headers); next.has_value())
+				done(detail::make_http_request(method, *next, this));
+
+			else
+				done(std::move(responses[i]));
 		}
 	}
+
+	std::string Client::host_key(const URL& url)
+	{
+		return url.protocol() + "://" + url.hostname() + ":" + std::to_string(url.port());
+	}
+
+	void Client::evictIdle()
+	{
+		auto now = clock::now();
+		auto evicted = std::vector<std::unique_ptr<Connection>>();
+		{
+			auto lk = std::lock_guard<std::mutex>(this->m_lock);
+			for(auto& [ key, conns ] : this->m_idle)
+			{
+				for(auto it = conns.begin(); it != conns.end(); )
+				{
+					if(std::chrono::duration<double>(now - (*it)->lastUsed).count() >= this->m_options.idleTimeout)
+						evicted.push_back(std::move(*it)), it = conns.erase(it);
+					else
+						++it;
+				}
+			}
+		}
+
+		// the sockets get closed here, outside the lock.
+	}
+
+	void Client::clear()
+	{
+		auto idle = decltype(this->m_idle)();
+		{
+			auto lk = std::lock_guard<std::mutex>(this->m_lock);
+
+			idle.swap(this->m_idle);
+		}
+
+		this->m_resolver.clear();
+
+	#if ZNET_ENABLE_SSL
+		this->m_tls.clearSessions();
+	#endif
+	}
+
+	size_t Client::idleConnections() const
+	{
+		auto lk = std::lock_guard<std::mutex>(this->m_lock);
+
+		size_t ret = 0;
+		for(auto& [ key, conns ] : this->m_idle)
+			ret += conns.size();
+
+		return ret;
+	}
+
+	std::unique_ptr<Client::Connection> Client::acquire(const URL& url, bool ssl, double timeout)
+	{
+		auto key = host_key(url);
+		auto now = clock::now();
+
+		auto stale = std::vector<std::unique_ptr<Connection>>();
+
+		{
+			auto lk = std::lock_guard<std::mutex>(this->m_lock);
+			auto& idle = this->m_idle[key];
+
+			// prefer the most recently used connection, since it is the least likely to have been closed
+			// by the server. everything older than the idle timeout gets closed.
+			while(!idle.empty())
+			{
+				auto conn = std::move(idle.back());
+				idle.pop_back();
+
+				auto age = std::chrono::duration<double>(now - conn->lastUsed).count();
+				if(age < this->m_options.idleTimeout && conn->socket->connected())
+				{
+					conn->reused = true;
+					return conn;
+				}
+
+				stale.push_back(std::move(conn));
+			}
+		}
+
+		auto addrs = detail::resolve(this->m_resolver, url);
+		if(addrs.empty())
+			return nullptr;
+
+		auto conn = std::make_unique<Connection>();
+		conn->key = std::move(key);
+
+	#if ZURL_INSTRUMENT
+		auto start = zmt::instrument::now();
+	#endif
+
+		// the context resumes the last TLS session with this host, if it has one.
+	#if ZNET_ENABLE_SSL
+		if(ssl)
+			conn->socket = znet::TCPSocket::connectFirst(addrs, this->m_tls, timeout);
+		else
+	#endif
+			conn->socket = znet::TCPSocket::connectFirst(addrs, ssl, timeout);
+
+		if(!conn->socket)
+			return nullptr;
+
+	#if ZURL_INSTRUMENT
+		zmt::instrument::sample("zurl.connect_ns", zmt::instrument::now() - start);
+	#endif
+
+		return conn;
+	}
+
+	void Client::release(std::unique_ptr<Connection> conn, bool reusable)
+	{
+		conn->lastUsed = clock::now();
+		conn->reused = false;
+
+		std::unique_ptr<Connection> evicted;
+		auto lk = std::lock_guard<std::mutex>(this->m_lock);
+
+		if(!reusable || !conn->socket->connected())
+			return;
+
+		auto& idle = this->m_idle[conn->key];
+		if(idle.size() >= this->m_options.maxIdlePerHost)
+		{
+			evicted = std::move(idle.front());
+			idle.erase(idle.begin());
+		}
+
+		if(this->m_options.maxIdlePerHost > 0)
+			idle.push_back(std::move(conn));
+	}
 }
 
 